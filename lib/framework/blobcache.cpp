@@ -0,0 +1,166 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "frame.h"
+#include "blobcache.h"
+#include "file.h"
+#include "physfs_ext.h"
+
+#include <algorithm>
+
+#define BLOB_CACHE_DIR "cache"
+
+static const uint8_t blobMagic[4] = {'W', 'Z', 'B', 'C'};
+
+struct BlobHeader
+{
+	uint8_t magic[4];
+	uint32_t formatVersion;
+	uint64_t size;
+	uint32_t crc;
+	uint32_t padding;
+};
+
+static std::string blobPath(const char *category, const std::string &key)
+{
+	return std::string(BLOB_CACHE_DIR "/") + category + "/" + key + ".bin";
+}
+
+bool blobCacheRead(const char *category, const std::string &key, uint32_t formatVersion, std::vector<uint8_t> &output)
+{
+	std::string path = blobPath(category, key);
+	PHYSFS_file *fileHandle = PHYSFS_openRead(path.c_str());
+	if (fileHandle == nullptr)
+	{
+		return false;
+	}
+
+	BlobHeader header;
+	bool success = WZ_PHYSFS_readBytes(fileHandle, &header, sizeof(header)) == static_cast<PHYSFS_sint64>(sizeof(header))
+	            && memcmp(header.magic, blobMagic, sizeof(blobMagic)) == 0
+	            && header.formatVersion == formatVersion
+	            && PHYSFS_fileLength(fileHandle) == static_cast<PHYSFS_sint64>(sizeof(header) + header.size);
+	if (success)
+	{
+		output.resize(static_cast<size_t>(header.size));
+		success = WZ_PHYSFS_readBytes(fileHandle, output.data(), static_cast<PHYSFS_uint32>(header.size)) == static_cast<PHYSFS_sint64>(header.size)
+		       && wz::crc_update(wz::crc_init(), output.data(), output.size()) == header.crc;
+	}
+	PHYSFS_close(fileHandle);
+
+	if (!success)
+	{
+		debug(LOG_WZ, "Ignoring stale or damaged cache file: %s", path.c_str());
+		output.clear();
+	}
+	return success;
+}
+
+bool blobCacheWrite(const char *category, const std::string &key, uint32_t formatVersion, const std::vector<uint8_t> &data)
+{
+	std::string dir = std::string(BLOB_CACHE_DIR "/") + category;
+	if (!WZ_PHYSFS_isDirectory(dir.c_str()) && PHYSFS_mkdir(dir.c_str()) == 0)
+	{
+		debug(LOG_WZ, "Failed to create cache folder %s: %s", dir.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+
+	BlobHeader header;
+	memcpy(header.magic, blobMagic, sizeof(blobMagic));
+	header.formatVersion = formatVersion;
+	header.size = data.size();
+	header.crc = wz::crc_update(wz::crc_init(), data.data(), data.size());
+	header.padding = 0;
+
+	std::string path = blobPath(category, key);
+	PHYSFS_file *fileHandle = PHYSFS_openWrite(path.c_str());
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_WZ, "Failed to write cache file %s: %s", path.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+	bool success = WZ_PHYSFS_writeBytes(fileHandle, &header, sizeof(header)) == static_cast<PHYSFS_sint64>(sizeof(header))
+	            && WZ_PHYSFS_writeBytes(fileHandle, data.data(), static_cast<PHYSFS_uint32>(data.size())) == static_cast<PHYSFS_sint64>(data.size());
+	if (!PHYSFS_close(fileHandle) || !success)
+	{
+		debug(LOG_WZ, "Failed to write cache file %s: %s", path.c_str(), WZ_PHYSFS_getLastError());
+		PHYSFS_delete(path.c_str());
+		return false;
+	}
+	return true;
+}
+
+void blobCachePrune(const char *category, uint64_t maxTotalSize)
+{
+	std::string dir = std::string(BLOB_CACHE_DIR "/") + category;
+	if (!WZ_PHYSFS_isDirectory(dir.c_str()))
+	{
+		return;
+	}
+
+	struct BlobFile
+	{
+		std::string path;
+		PHYSFS_sint64 modTime;
+		uint64_t size;
+	};
+	std::vector<BlobFile> blobFiles;
+	uint64_t totalSize = 0;
+	WZ_PHYSFS_enumerateFiles(dir.c_str(), [&](const char *file) -> bool {
+		if (!filenameEndWithExtension(file, ".bin"))
+		{
+			return true;
+		}
+		std::string path = dir + "/" + file;
+		PHYSFS_file *fileHandle = PHYSFS_openRead(path.c_str());
+		if (fileHandle == nullptr)
+		{
+			return true;
+		}
+		PHYSFS_sint64 length = PHYSFS_fileLength(fileHandle);
+		PHYSFS_close(fileHandle);
+		uint64_t size = (length > 0) ? static_cast<uint64_t>(length) : 0;
+		blobFiles.push_back(BlobFile{path, WZ_PHYSFS_getLastModTime(path.c_str()), size});
+		totalSize += size;
+		return true;
+	});
+	if (totalSize <= maxTotalSize)
+	{
+		return;
+	}
+
+	// Blobs are only written on a cache miss, so an evicted blob that is still in use is simply written again (as the newest)
+	std::sort(blobFiles.begin(), blobFiles.end(), [](const BlobFile &a, const BlobFile &b) { return a.modTime < b.modTime; });
+	size_t numDeleted = 0;
+	for (const BlobFile &blobFile : blobFiles)
+	{
+		if (totalSize <= maxTotalSize)
+		{
+			break;
+		}
+		if (PHYSFS_delete(blobFile.path.c_str()) == 0)
+		{
+			debug(LOG_WZ, "Failed to delete cache file %s: %s", blobFile.path.c_str(), WZ_PHYSFS_getLastError());
+			continue;
+		}
+		totalSize -= blobFile.size;
+		++numDeleted;
+	}
+	debug(LOG_WZ, "Pruned %zu files from %s, %" PRIu64 " bytes left", numDeleted, dir.c_str(), totalSize);
+}
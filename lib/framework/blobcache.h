@@ -0,0 +1,146 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file blobcache.h
+ * Binary blobs derived from game data (such as parsed models), stored in the
+ * cache folder of the write directory so they don't need to be rebuilt on
+ * every launch.
+ *
+ * Blobs are keyed by a category (a subfolder) and a key, which should include
+ * a hash of the source data. Each blob carries a format version and a CRC of
+ * its contents, so stale or truncated blobs are never returned.
+ *
+ * Blobs keyed by data that is gone (older versions, removed mods, other
+ * drivers) are never read again, so each category should be pruned to a size
+ * cap at startup with blobCachePrune().
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// Read the blob `key` of `category`. Returns false if there is none, or it was written with another format version.
+bool blobCacheRead(const char *category, const std::string &key, uint32_t formatVersion, std::vector<uint8_t> &output);
+/// Write the blob `key` of `category`, replacing any previous one. Failures are only logged. Thread-safe.
+bool blobCacheWrite(const char *category, const std::string &key, uint32_t formatVersion, const std::vector<uint8_t> &data);
+/// Delete the least recently written blobs of `category` until the rest total at most `maxTotalSize` bytes. Call before the category is used.
+void blobCachePrune(const char *category, uint64_t maxTotalSize);
+
+/// Appends values in native byte order, for blobs which are only read back by the same build.
+class BlobWriter
+{
+public:
+	template <typename T>
+	void write(const T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T, typename Alloc>
+	void writeVector(const std::vector<T, Alloc> &values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+		write<uint32_t>(static_cast<uint32_t>(values.size()));
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(values.data());
+		data.insert(data.end(), bytes, bytes + values.size() * sizeof(T));
+	}
+
+	void writeString(const std::string &value)
+	{
+		write<uint32_t>(static_cast<uint32_t>(value.size()));
+		data.insert(data.end(), value.begin(), value.end());
+	}
+
+	std::vector<uint8_t> data;
+};
+
+/// Reads values written by BlobWriter. Once a read runs past the end, all further reads fail.
+class BlobReader
+{
+public:
+	BlobReader(const uint8_t *data, size_t size) : pos(data), end(data + size) {}
+
+	template <typename T>
+	bool read(T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read");
+		if (pos == nullptr || static_cast<size_t>(end - pos) < sizeof(T))
+		{
+			pos = nullptr;
+			return false;
+		}
+		memcpy(&value, pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	template <typename T, typename Alloc>
+	bool readVector(std::vector<T, Alloc> &values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read");
+		uint32_t count = 0;
+		if (!read(count) || static_cast<size_t>(end - pos) / sizeof(T) < count)
+		{
+			pos = nullptr;
+			return false;
+		}
+		values.resize(count);
+		if (count == 0)
+		{
+			return true; // data() may be nullptr, which memcpy must not be given even for 0 bytes
+		}
+		memcpy(values.data(), pos, count * sizeof(T));
+		pos += count * sizeof(T);
+		return true;
+	}
+
+	bool readString(std::string &value)
+	{
+		uint32_t length = 0;
+		if (!read(length) || static_cast<size_t>(end - pos) < length)
+		{
+			pos = nullptr;
+			return false;
+		}
+		value.assign(reinterpret_cast<const char *>(pos), length);
+		pos += length;
+		return true;
+	}
+
+	/// True if all reads succeeded and all data was consumed.
+	bool finished() const
+	{
+		return pos == end;
+	}
+
+	bool ok() const
+	{
+		return pos != nullptr;
+	}
+
+private:
+	const uint8_t *pos;
+	const uint8_t *end;
+};
@@ -44,6 +44,9 @@ bool loadFileToBufferVector(const char *pFileName, std::vector<char>& outputBuff
 /** Load a file from disk, but returns quietly if no file found. */
 WZ_DECL_NONNULL(1, 2) bool loadFileToBufferNoError(const char *pFileName, char *pFileBuffer, UDWORD bufferSize, UDWORD *pSize);
 
+/** Find the hash of a file. Hashes are remembered until the file's size or modification time changes. */
 WZ_DECL_NONNULL(1) Sha256 findHashOfFile(char const *realFileName);
+/** Remember the hash of a file which was just verified, so findHashOfFile() doesn't need to read it. */
+WZ_DECL_NONNULL(1) void cacheHashOfFile(char const *realFileName, Sha256 const &hash);
 
 #endif // _file_h
@@ -36,6 +36,8 @@
 #include "file_ext.h"
 
 #include <limits>
+#include <mutex>
+#include <unordered_map>
 
 /************************************************************************************
  *
@@ -328,14 +330,57 @@ bool loadFileToBufferNoError(const char *pFileName, char *pFileBuffer, UDWORD bu
 	return loadFile2(pFileName, &pFileBuffer, pSize, false, false);
 }
 
+// Hashes of files found so far, which stay valid as long as the file keeps its size and modification time.
+struct FileHashCacheEntry
+{
+	PHYSFS_sint64 size;
+	PHYSFS_sint64 modTime;
+	Sha256 hash;
+};
+static std::unordered_map<std::string, FileHashCacheEntry> fileHashCache;
+static std::mutex fileHashCacheMutex;
+
+static bool statFileForHashCache(char const *realFileName, PHYSFS_sint64 &size, PHYSFS_sint64 &modTime)
+{
+#if defined(WZ_PHYSFS_2_1_OR_GREATER)
+	PHYSFS_Stat metaData;
+	if (PHYSFS_stat(realFileName, &metaData) == 0 || metaData.filetype != PHYSFS_FILETYPE_REGULAR || metaData.filesize < 0)
+	{
+		return false;
+	}
+	size = metaData.filesize;
+	modTime = metaData.modtime;
+	return true;
+#else
+	return false;
+#endif
+}
+
 Sha256 findHashOfFile(char const *realFileName)
 {
+	PHYSFS_sint64 size = 0, modTime = 0;
+	bool cacheable = statFileForHashCache(realFileName, size, modTime);
+	if (cacheable)
+	{
+		std::lock_guard<std::mutex> guard(fileHashCacheMutex);
+		auto it = fileHashCache.find(realFileName);
+		if (it != fileHashCache.end() && it->second.size == size && it->second.modTime == modTime)
+		{
+			return it->second.hash;
+		}
+	}
+
 	char *realFileData = nullptr;
 	uint32_t realFileSize = 0;
 	if (loadFile(realFileName, &realFileData, &realFileSize))
 	{
 		Sha256 realFileHash = sha256Sum(realFileData, realFileSize);
 		free(realFileData);
+		if (cacheable && realFileSize == size)
+		{
+			std::lock_guard<std::mutex> guard(fileHashCacheMutex);
+			fileHashCache[realFileName] = {size, modTime, realFileHash};
+		}
 		return realFileHash;
 	}
 	Sha256 zero;
@@ -343,6 +388,16 @@ Sha256 findHashOfFile(char const *realFileName)
 	return zero;
 }
 
+void cacheHashOfFile(char const *realFileName, Sha256 const &hash)
+{
+	PHYSFS_sint64 size = 0, modTime = 0;
+	if (statFileForHashCache(realFileName, size, modTime))
+	{
+		std::lock_guard<std::mutex> guard(fileHashCacheMutex);
+		fileHashCache[realFileName] = {size, modTime, hash};
+	}
+}
+
 bool PHYSFS_printf(PHYSFS_file *file, const char *format, ...)
 {
 	char vaBuffer[PATH_MAX];
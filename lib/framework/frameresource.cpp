@@ -34,6 +34,11 @@
 
 #include <list>
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Local prototypes
 static std::list<RES_TYPE *> psResTypes;
@@ -45,12 +50,28 @@ char aCurrResDir[PATH_MAX];
 // the current resource block ID
 static SDWORD resBlockID;
 
-// prototypes
-static void ResetResourceFile();
-
 // callback to resload screen.
 static RESLOAD_CALLBACK resLoadCallback = nullptr;
 
+// A file line of the .wrf being parsed, loaded once the whole .wrf has been read
+struct RES_PENDING
+{
+	std::string type;
+	std::string file;
+	std::string currResDir;	// aCurrResDir at the time of the file line
+	std::string fileName;	// full name of the file to read ahead, empty for file load types
+	char *pBuffer = nullptr;
+	UDWORD size = 0;
+	bool read = false;
+	bool readOK = false;
+};
+
+// true while resLoad is parsing, resLoadFile then only queues the file
+static bool resCollecting = false;
+static std::vector<RES_PENDING> resPending;
+
+static bool resLoadPending(std::vector<RES_PENDING> &pending);
+
 
 /* next four used in HashPJW */
 #define	BITS_IN_int		32
@@ -155,8 +176,6 @@ bool resInitialise()
 	resBlockID = 0;
 	resLoadCallback = nullptr;
 
-	ResetResourceFile();
-
 	return true;
 }
 
@@ -206,17 +225,29 @@ bool resLoad(const char *pResFile, SDWORD blockID)
 		return false;
 	}
 
-	// and parse it
+	// and parse it, collecting the files to load
+	ASSERT(!resCollecting && resPending.empty(), "resLoad called recursively");
+	resCollecting = true;
 	res_set_extra(&input);
 	if (res_parse() != 0)
 	{
 		debug(LOG_FATAL, "Failed to parse %s", pResFile);
 		retval = false;
 	}
+	resCollecting = false;
 
 	res_lex_destroy();
 	PHYSFS_close(input.input.physfsfile);
 
+	// Load the collected files in order, reading the following ones ahead on worker threads
+	std::vector<RES_PENDING> pending;
+	pending.swap(resPending);
+	if (!resLoadPending(pending) && retval)
+	{
+		debug(LOG_FATAL, "Failed to load %s", pResFile);
+		retval = false;
+	}
+
 	return retval;
 }
 
@@ -304,100 +335,6 @@ void SetLastResourceFilename(const char *pName)
 }
 
 
-// Structure for each file currently in use in the resource  ... probably only going to be one ... but we will handle upto MAXLOADEDRESOURCE
-struct RESOURCEFILE
-{
-	char *pBuffer;	// a pointer to the data
-	UDWORD size;	// number of bytes
-	UBYTE	type;	// what type of resource is it
-};
-
-#define RESFILETYPE_EMPTY (0)			// empty entry
-#define RESFILETYPE_LOADED (2)			// Loaded from a file (!)
-
-
-#define MAXLOADEDRESOURCES (6)
-static RESOURCEFILE LoadedResourceFiles[MAXLOADEDRESOURCES];
-
-
-
-// Clear out the resource list ... needs to be called during init.
-static void ResetResourceFile()
-{
-	UWORD i;
-
-	for (i = 0; i < MAXLOADEDRESOURCES; i++)
-	{
-		LoadedResourceFiles[i].type = RESFILETYPE_EMPTY;
-	}
-}
-
-// Returns an empty resource entry or -1 if none exsist
-static SDWORD FindEmptyResourceFile()
-{
-	UWORD i;
-	for (i = 0; i < MAXLOADEDRESOURCES ; i++)
-	{
-		if (LoadedResourceFiles[i].type == RESFILETYPE_EMPTY)
-		{
-			return (i);
-		}
-
-	}
-	return (-1);			// ERROR
-}
-
-
-// Get a resource data file ... either loads it or just returns a pointer
-static bool RetreiveResourceFile(char *ResourceName, RESOURCEFILE **NewResource)
-{
-	SDWORD ResID;
-	RESOURCEFILE *ResData;
-	UDWORD size;
-	char *pBuffer;
-
-	ResID = FindEmptyResourceFile();
-	if (ResID == -1)
-	{
-		return (false);    // all resource files are full
-	}
-
-	ResData = &LoadedResourceFiles[ResID];
-	*NewResource = ResData;
-
-	// This is needed for files that do not fit in the WDG cache ... (VAB file for example)
-	if (!loadFile(ResourceName, &pBuffer, &size))
-	{
-		return false;
-	}
-
-	ResData->type = RESFILETYPE_LOADED;
-	ResData->size = size;
-	ResData->pBuffer = pBuffer;
-	return (true);
-}
-
-
-// Free up the file depending on what type it is
-static void FreeResourceFile(RESOURCEFILE *OldResource)
-{
-	switch (OldResource->type)
-	{
-	case RESFILETYPE_LOADED:
-		free(OldResource->pBuffer);
-		OldResource->pBuffer = nullptr;
-		break;
-
-	default:
-		debug(LOG_WARNING, "resource not freed");
-	}
-
-
-	// Remove from the list
-	OldResource->type = RESFILETYPE_EMPTY;
-}
-
-
 static inline RES_DATA *resDataInit(const char *DebugName, UDWORD DataIDHash, void *pData, UDWORD BlockID)
 {
 	char *resID;
@@ -459,17 +396,11 @@ static void makeLocaleFile(char *fileName, size_t maxlen)  // given string must
 }
 
 
-/*!
- * Call the load function (registered in data.c)
- * for this filetype
- */
-bool resLoadFile(const char *pType, const char *pFile)
+/* Find the resource type, or return nullptr if it is unknown */
+static RES_TYPE *resFindType(const char *pType)
 {
-	void		*pData = nullptr;
-	char		aFileName[PATH_MAX];
-	UDWORD HashedName, HashedType = HashString(pType);
+	UDWORD HashedType = HashString(pType);
 
-	// Find the resource-type
 	auto resTypeIt = std::find_if(psResTypes.begin(), psResTypes.end(), [pType, HashedType](const RES_TYPE* psT)
 	{
 		if (psT->HashedType == HashedType)
@@ -479,13 +410,41 @@ bool resLoadFile(const char *pType, const char *pFile)
 		}
 		return false;
 	});
+	return resTypeIt != psResTypes.end() ? *resTypeIt : nullptr;
+}
 
-	if (resTypeIt == psResTypes.end())
+/* Create the (possibly translated) name of a file in the current resource directory */
+static bool resMakeFileName(const char *pFile, char *aFileName, size_t maxlen)
+{
+	if (strlen(aCurrResDir) + strlen(pFile) + 1 >= maxlen)
+	{
+		debug(LOG_ERROR, "resLoadFile: Filename too long!! %s%s", aCurrResDir, pFile);
+		return false;
+	}
+	strlcpy(aFileName, aCurrResDir, maxlen);
+	strlcat(aFileName, pFile, maxlen);
+
+	makeLocaleFile(aFileName, maxlen);  // check for translated file
+	return true;
+}
+
+/*!
+ * Call the load function (registered in data.c) for this filetype,
+ * using the buffer of psPending if it was read ahead.
+ */
+static bool resLoadFileData(const char *pType, const char *pFile, RES_PENDING *psPending)
+{
+	void		*pData = nullptr;
+	char		aFileName[PATH_MAX];
+	UDWORD HashedName;
+
+	// Find the resource-type
+	RES_TYPE *psT = resFindType(pType);
+	if (psT == nullptr)
 	{
 		debug(LOG_WZ, "resLoadFile: Unknown type: %s", pType);
 		return false;
 	}
-	RES_TYPE* psT = *resTypeIt;
 
 	// Check for duplicates
 	HashedName = HashStringIgnoreCase(pFile);
@@ -503,35 +462,37 @@ bool resLoadFile(const char *pType, const char *pFile)
 	}
 
 	// Create the file name
-	if (strlen(aCurrResDir) + strlen(pFile) + 1 >= PATH_MAX)
+	if (!resMakeFileName(pFile, aFileName, sizeof(aFileName)))
 	{
-		debug(LOG_ERROR, "resLoadFile: Filename too long!! %s%s", aCurrResDir, pFile);
 		return false;
 	}
-	sstrcpy(aFileName, aCurrResDir);
-	sstrcat(aFileName, pFile);
-
-	makeLocaleFile(aFileName, sizeof(aFileName));  // check for translated file
 
 	SetLastResourceFilename(pFile); // Save the filename in case any routines need it
 
 	// load the resource
 	if (psT->buffLoad)
 	{
-		RESOURCEFILE *Resource;
+		char *pBuffer = nullptr;
+		UDWORD size = 0;
 
-		// Load the file in a buffer
-		if (!RetreiveResourceFile(aFileName, &Resource))
+		// Take the buffer read ahead, or load the file in a buffer
+		if (psPending != nullptr && psPending->readOK)
+		{
+			pBuffer = psPending->pBuffer;
+			size = psPending->size;
+			psPending->pBuffer = nullptr;
+		}
+		else if (!loadFile(aFileName, &pBuffer, &size))
 		{
 			debug(LOG_ERROR, "resLoadFile: Unable to retrieve resource - %s", aFileName);
 			return false;
 		}
 
 		// Now process the buffer data
-		if (!psT->buffLoad(Resource->pBuffer, Resource->size, &pData))
+		if (!psT->buffLoad(pBuffer, size, &pData))
 		{
 			ASSERT(false, "The load function for resource type \"%s\" failed for file \"%s\"", pType, pFile);
-			FreeResourceFile(Resource);
+			free(pBuffer);
 			if (psT->release != nullptr)
 			{
 				psT->release(pData);
@@ -539,7 +500,7 @@ bool resLoadFile(const char *pType, const char *pFile)
 			return false;
 		}
 
-		FreeResourceFile(Resource);
+		free(pBuffer);
 	}
 	else if (psT->fileLoad)
 	{
@@ -577,6 +538,158 @@ bool resLoadFile(const char *pType, const char *pFile)
 	return true;
 }
 
+/*!
+ * Call the load function (registered in data.c)
+ * for this filetype
+ */
+bool resLoadFile(const char *pType, const char *pFile)
+{
+	if (!resCollecting)
+	{
+		return resLoadFileData(pType, pFile, nullptr);
+	}
+
+	// Called from the .wrf parser, so queue the file and read it ahead if it is loaded from a buffer.
+	// Unknown types and duplicates are reported when the file is loaded, as before.
+	RES_PENDING pending;
+	pending.type = pType;
+	pending.file = pFile;
+	pending.currResDir = aCurrResDir;
+	RES_TYPE *psT = resFindType(pType);
+	char aFileName[PATH_MAX];
+	if (psT != nullptr && psT->buffLoad && resMakeFileName(pFile, aFileName, sizeof(aFileName)))
+	{
+		pending.fileName = aFileName;
+	}
+	resPending.push_back(std::move(pending));
+	return true;
+}
+
+#define RES_READAHEAD_THREADS	4	// maximum number of threads reading files
+#define RES_READAHEAD_WINDOW	32	// maximum number of files read ahead of the one being loaded
+
+/*!
+ * Reads the files of a list of pending resources on worker threads, while they
+ * are loaded in order on the main thread. Only the file reading (and archive
+ * decompression) is done by the workers, since the load functions touch global
+ * tables and the GPU.
+ */
+class ResReadAhead
+{
+public:
+	explicit ResReadAhead(std::vector<RES_PENDING> &pending)
+		: pending(pending)
+	{
+		size_t numReads = std::count_if(pending.begin(), pending.end(), [](const RES_PENDING &entry) { return !entry.fileName.empty(); });
+		size_t numThreads = std::min<size_t>({RES_READAHEAD_THREADS, std::max(std::thread::hardware_concurrency(), 1u), numReads});
+		if (numThreads == 0)
+		{
+			for (RES_PENDING &entry : pending)
+			{
+				entry.read = true;
+			}
+			nextRead = pending.size();
+		}
+		for (size_t i = 0; i < numThreads; ++i)
+		{
+			threads.emplace_back(&ResReadAhead::readFiles, this);
+		}
+	}
+
+	~ResReadAhead()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		windowCond.notify_all();
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+		for (RES_PENDING &entry : pending)
+		{
+			free(entry.pBuffer);
+			entry.pBuffer = nullptr;
+		}
+	}
+
+	/// Wait until entry `index` has been read. Must be called in order for every entry.
+	void wait(size_t index)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		readCond.wait(lock, [this, index] { return pending[index].read; });
+		loading = index + 1;
+		windowCond.notify_all();
+	}
+
+private:
+	void readFiles()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			windowCond.wait(lock, [this] { return stop || nextRead >= pending.size() || nextRead < loading + RES_READAHEAD_WINDOW; });
+			if (stop || nextRead >= pending.size())
+			{
+				return;
+			}
+			RES_PENDING &entry = pending[nextRead++];
+			if (!entry.fileName.empty())
+			{
+				lock.unlock();
+				// Don't fail hard here, the main thread retries and reports failures
+				char *pBuffer = nullptr;
+				UDWORD size = 0;
+				bool readOK = loadFile(entry.fileName.c_str(), &pBuffer, &size, false);
+				lock.lock();
+				entry.pBuffer = readOK ? pBuffer : nullptr;
+				entry.size = size;
+				entry.readOK = readOK;
+			}
+			entry.read = true;
+			readCond.notify_all();
+		}
+	}
+
+	std::vector<RES_PENDING> &pending;
+	std::mutex mutex;
+	std::condition_variable readCond;    ///< Signalled when an entry has been read
+	std::condition_variable windowCond;  ///< Signalled when the read ahead window moves
+	size_t nextRead = 0;                 ///< Next entry to be read
+	size_t loading = 0;                  ///< Entries before this one have been taken by the main thread
+	bool stop = false;
+	std::vector<std::thread> threads;
+};
+
+/* Load the files queued while parsing a .wrf, in the order they were listed */
+static bool resLoadPending(std::vector<RES_PENDING> &pending)
+{
+	if (pending.empty())
+	{
+		return true;
+	}
+
+	std::string parsedResDir = aCurrResDir;
+	bool retval = true;
+	{
+		ResReadAhead readAhead(pending);
+		for (size_t i = 0; i < pending.size(); ++i)
+		{
+			readAhead.wait(i);
+			sstrcpy(aCurrResDir, pending[i].currResDir.c_str());
+			if (!resLoadFileData(pending[i].type.c_str(), pending[i].file.c_str(), &pending[i]))
+			{
+				retval = false;
+				break;
+			}
+		}
+	}
+	sstrcpy(aCurrResDir, parsedResDir.c_str());
+
+	return retval;
+}
+
 /* Return the resource for a type and hashedname */
 void *resGetDataFromHash(const char *pType, UDWORD HashedID)
 {
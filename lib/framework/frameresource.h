@@ -91,7 +91,7 @@ void resShutDown();
 WZ_DECL_NONNULL(1) void resSetBaseDir(const char *pResDir);
 WZ_DECL_NONNULL(1) void resForceBaseDir(const char *pResDir);
 
-/** Parse the res file. */
+/** Parse the res file, and load its files in order while reading the following ones ahead on worker threads. */
 WZ_DECL_NONNULL(1) bool resLoad(const char *pResFile, SDWORD blockID);
 
 /** Release all the resources currently loaded and the resource load functions. */
@@ -0,0 +1,160 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "pooled_allocator.h"
+#include "wzapp.h"
+
+#include <new>
+
+namespace wz
+{
+
+// Block sizes are powers of two from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE bytes, larger requests bypass the pool.
+static constexpr size_t MIN_BLOCK_SHIFT = 5;
+static constexpr size_t NUM_SIZE_CLASSES = 9;
+static constexpr size_t MAX_BLOCK_SIZE = size_t(1) << (MIN_BLOCK_SHIFT + NUM_SIZE_CLASSES - 1);
+// Free memory kept per size class when trimming.
+static constexpr size_t RETAINED_BYTES_PER_CLASS = 256 * 1024;
+
+namespace
+{
+	struct FreeBlock
+	{
+		FreeBlock *next;
+	};
+
+	struct SizeClass
+	{
+		FreeBlock *freeList = nullptr;
+		size_t numFree = 0;
+	};
+
+	struct PoolState
+	{
+		wz::mutex mutex;
+		SizeClass classes[NUM_SIZE_CLASSES];
+		PoolAllocatorStatistics stats;
+	};
+}
+
+static PoolState &poolState()
+{
+	static PoolState *state = new PoolState;  // Never destroyed, since containers may outlive static destruction.
+	return *state;
+}
+
+static size_t sizeClassIndex(size_t bytes)
+{
+	size_t index = 0;
+	while ((size_t(1) << (MIN_BLOCK_SHIFT + index)) < bytes)
+	{
+		++index;
+	}
+	return index;
+}
+
+static size_t sizeClassBytes(size_t index)
+{
+	return size_t(1) << (MIN_BLOCK_SHIFT + index);
+}
+
+void *poolAllocate(size_t bytes)
+{
+	PoolState &state = poolState();
+	if (bytes > MAX_BLOCK_SIZE)
+	{
+		std::lock_guard<wz::mutex> lock(state.mutex);
+		++state.stats.heapAllocations;
+		return ::operator new(bytes);
+	}
+
+	size_t index = sizeClassIndex(bytes);
+	{
+		std::lock_guard<wz::mutex> lock(state.mutex);
+		SizeClass &sizeClass = state.classes[index];
+		if (sizeClass.freeList != nullptr)
+		{
+			FreeBlock *block = sizeClass.freeList;
+			sizeClass.freeList = block->next;
+			--sizeClass.numFree;
+			++state.stats.pooledAllocations;
+			return block;
+		}
+		++state.stats.heapAllocations;
+	}
+	return ::operator new(sizeClassBytes(index));
+}
+
+void poolDeallocate(void *ptr, size_t bytes)
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+	if (bytes > MAX_BLOCK_SIZE)
+	{
+		::operator delete(ptr);
+		return;
+	}
+
+	PoolState &state = poolState();
+	std::lock_guard<wz::mutex> lock(state.mutex);
+	SizeClass &sizeClass = state.classes[sizeClassIndex(bytes)];
+	FreeBlock *block = static_cast<FreeBlock *>(ptr);
+	block->next = sizeClass.freeList;
+	sizeClass.freeList = block;
+	++sizeClass.numFree;
+}
+
+PoolAllocatorStatistics poolAllocatorTrim()
+{
+	PoolState &state = poolState();
+	FreeBlock *release = nullptr;
+	PoolAllocatorStatistics stats;
+	{
+		std::lock_guard<wz::mutex> lock(state.mutex);
+		for (size_t index = 0; index < NUM_SIZE_CLASSES; ++index)
+		{
+			SizeClass &sizeClass = state.classes[index];
+			size_t retain = RETAINED_BYTES_PER_CLASS / sizeClassBytes(index);
+			while (sizeClass.numFree > retain)
+			{
+				FreeBlock *block = sizeClass.freeList;
+				sizeClass.freeList = block->next;
+				--sizeClass.numFree;
+				block->next = release;
+				release = block;
+			}
+			state.stats.bytesPooled += sizeClass.numFree * sizeClassBytes(index);
+		}
+		stats = state.stats;
+		state.stats = PoolAllocatorStatistics();
+	}
+
+	// Free outside of the lock, so the path thread isn't kept waiting.
+	while (release != nullptr)
+	{
+		FreeBlock *next = release->next;
+		::operator delete(release);
+		release = next;
+	}
+	return stats;
+}
+
+} // namespace wz
@@ -0,0 +1,85 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file pooled_allocator.h
+ * Allocator for small, frequently reallocated containers (such as per-object
+ * order lists and paths), which recycles freed storage through shared
+ * power-of-two sized free lists instead of returning it to the heap.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace wz
+{
+
+/// Allocation counts of the container pool, accumulated since the last call to poolAllocatorTrim().
+struct PoolAllocatorStatistics
+{
+	uint64_t heapAllocations = 0;    ///< Allocations which had to go to the heap
+	uint64_t pooledAllocations = 0;  ///< Allocations served from the free lists
+	size_t bytesPooled = 0;          ///< Bytes held in the free lists, after trimming
+};
+
+/// Allocate a block of at least `bytes` bytes. Thread-safe.
+void *poolAllocate(size_t bytes);
+/// Return a block obtained from poolAllocate() with the same `bytes`. Thread-safe.
+void poolDeallocate(void *ptr, size_t bytes);
+/// Give free blocks above the retained limit back to the heap, and return (and reset) the allocation counts.
+PoolAllocatorStatistics poolAllocatorTrim();
+
+/// Standard allocator using poolAllocate()/poolDeallocate(). All instances are interchangeable.
+template <typename T>
+struct PooledAllocator
+{
+	typedef T value_type;
+
+	PooledAllocator() noexcept = default;
+	template <typename U>
+	PooledAllocator(PooledAllocator<U> const &) noexcept {}
+
+	T *allocate(size_t n)
+	{
+		return static_cast<T *>(poolAllocate(n * sizeof(T)));
+	}
+
+	void deallocate(T *ptr, size_t n) noexcept
+	{
+		poolDeallocate(ptr, n * sizeof(T));
+	}
+};
+
+template <typename T, typename U>
+bool operator ==(PooledAllocator<T> const &, PooledAllocator<U> const &) noexcept
+{
+	return true;
+}
+
+template <typename T, typename U>
+bool operator !=(PooledAllocator<T> const &, PooledAllocator<U> const &) noexcept
+{
+	return false;
+}
+
+template <typename T>
+using pooled_vector = std::vector<T, PooledAllocator<T>>;
+
+} // namespace wz
@@ -71,6 +71,9 @@ bool gfx_api::context::initialize(const gfx_api::backend_Impl_Factory& impl, int
 	// Calculate the best available run-time compression formats
 	gfx_api::initBestRealTimeCompressionFormats();
 
+	// Keep the compressed image cache bounded (entries for older versions, mods or drivers are never read again)
+	gfx_api::pruneCompressedImageCache();
+
 #if defined(BASIS_ENABLED)
 	// Init basis transcoder
 	gfx_api::initBasisTranscoder();
@@ -221,21 +224,6 @@ optional<gfx_api::max_texture_compression_level> gfx_api::getMaxTextureCompressi
 
 #include "png_util.h"
 
-static gfx_api::texture* loadImageTextureFromFile_PNG(const std::string& filename, gfx_api::texture_type textureType, int maxWidth /*= -1*/, int maxHeight /*= -1*/, bool quiet)
-{
-	iV_Image loadedUncompressedImage;
-
-	// 1.) Load the PNG into an iV_Image
-	bool forceRGB = (textureType == gfx_api::texture_type::game_texture) || (textureType == gfx_api::texture_type::user_interface);
-	if (!iV_loadImage_PNG2(filename.c_str(), loadedUncompressedImage, forceRGB, quiet))
-	{
-		// Failed to load the image
-		return nullptr;
-	}
-
-	return gfx_api::context::get().loadTextureFromUncompressedImage(std::move(loadedUncompressedImage), textureType, filename, maxWidth, maxHeight);
-}
-
 #if defined(BASIS_ENABLED)
 const WzString wz_png_extension = WzString(".png");
 #endif
@@ -303,24 +291,12 @@ bool gfx_api::checkImageFilesWouldLoadFromSameParentMountPath(const std::vector<
 // (which loads straight to a texture based on the appropriate texture_type, handling mip_maps, compression, etc)
 gfx_api::texture* gfx_api::context::loadTextureFromFile(const char *filename, gfx_api::texture_type textureType, int maxWidth /*= -1*/, int maxHeight /*= -1*/, bool quiet /*= false*/)
 {
-	auto imageLoadFilename = imageLoadFilenameFromInputFilename(filename);
-
-#if defined(BASIS_ENABLED)
-	if (imageLoadFilename.endsWith(".ktx2"))
+	auto images = gfx_api::loadTextureImagesFromFile(filename, textureType, maxWidth, maxHeight, quiet);
+	if (images.empty())
 	{
-		return gfx_api::loadImageTextureFromFile_KTX2(imageLoadFilename.toUtf8(), textureType, maxWidth, maxHeight);
-	}
-	else
-#endif
-	if (imageLoadFilename.endsWith(".png"))
-	{
-		return loadImageTextureFromFile_PNG(imageLoadFilename.toUtf8(), textureType, maxWidth, maxHeight, quiet);
-	}
-	else
-	{
-		debug(LOG_ERROR, "Unable to load image file: %s", filename);
 		return nullptr;
 	}
+	return loadTextureFromImages(images, imageLoadFilenameFromInputFilename(filename).toUtf8());
 }
 
 static inline size_t calcMipmapLevelsForUncompressedImage(const iV_BaseImage& image, gfx_api::texture_type textureType)
@@ -427,10 +403,42 @@ static std::vector<std::unique_ptr<iV_Image>> generateMipMapsFromUncompressedIma
 // Takes an iv_Image and texture_type and loads a texture as appropriate / possible
 gfx_api::texture* gfx_api::context::loadTextureFromUncompressedImage(iV_Image&& image, gfx_api::texture_type textureType, const std::string& filename, int maxWidth /*= -1*/, int maxHeight /*= -1*/)
 {
+	auto images = gfx_api::textureImagesFromUncompressedImage(std::move(image), textureType, filename, maxWidth, maxHeight);
+	if (images.empty())
+	{
+		return nullptr;
+	}
+	return loadTextureFromImages(images, filename);
+}
+
+// Takes the image levels returned by textureImagesFromUncompressedImage / loadTextureImagesFromFile and creates a texture from them
+gfx_api::texture* gfx_api::context::loadTextureFromImages(const std::vector<std::unique_ptr<iV_BaseImage>>& images, const std::string& filename)
+{
+	ASSERT_OR_RETURN(nullptr, !images.empty(), "No image levels for: %s", filename.c_str());
+
+	// 5.) Create a new compatible gpu texture object
+	std::unique_ptr<gfx_api::texture> pTexture = std::unique_ptr<gfx_api::texture>(gfx_api::context::get().create_texture(images.size(), images[0]->width(), images[0]->height(), images[0]->pixel_format(), filename));
+
+	// 6.) Upload all levels
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		bool uploadResult = pTexture->upload(i, *(images[i]));
+		ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
+	}
+
+	return pTexture.release();
+}
+
+// Prepares the image levels (mip maps) of a texture from an iV_Image, compressing them if possible
+// Only queries the gfx backend's capabilities, so this may be called from any thread
+std::vector<std::unique_ptr<iV_BaseImage>> gfx_api::textureImagesFromUncompressedImage(iV_Image&& image, gfx_api::texture_type textureType, const std::string& filename, int maxWidth /*= -1*/, int maxHeight /*= -1*/)
+{
+	std::vector<std::unique_ptr<iV_BaseImage>> results;
+
 	// 1.) Convert to expected # of channels based on textureType
 	if (!uncompressedPNGImageConvertChannels(image, gfx_api::pixel_format_target::texture_2d, textureType, filename))
 	{
-		return nullptr;
+		return results;
 	}
 
 	// 2.) If maxWidth / maxHeight exceed current image dimensions, resize()
@@ -442,8 +450,8 @@ gfx_api::texture* gfx_api::context::loadTextureFromUncompressedImage(iV_Image&&
 	// 4.) Extend channels, if needed, to a supported uncompressed format
 	auto channels = image.channels();
 	// Verify that the gfx backend supports this format
-	auto closestSupportedChannels = getClosestSupportedUncompressedImageFormatChannels(gfx_api::pixel_format_target::texture_2d, channels);
-	ASSERT_OR_RETURN(nullptr, closestSupportedChannels.has_value(), "Exhausted all possible uncompressed formats??");
+	auto closestSupportedChannels = gfx_api::context::get().getClosestSupportedUncompressedImageFormatChannels(gfx_api::pixel_format_target::texture_2d, channels);
+	ASSERT_OR_RETURN(results, closestSupportedChannels.has_value(), "Exhausted all possible uncompressed formats??");
 	for (auto i = image.channels(); i < closestSupportedChannels; ++i)
 	{
 		image.expand_channels_towards_rgba();
@@ -463,54 +471,90 @@ gfx_api::texture* gfx_api::context::loadTextureFromUncompressedImage(iV_Image&&
 		}
 	}
 
-	// 5.) Create a new compatible gpu texture object
-	std::unique_ptr<gfx_api::texture> pTexture = std::unique_ptr<gfx_api::texture>(gfx_api::context::get().create_texture(mipmap_levels, image.width(), image.height(), uploadFormat, filename));
-
-	// 6.) Upload initial (full) level
-	if (uploadFormat == image.pixel_format())
+	// 5.) Prepare the initial (full) level, then generate the mipmaps (if needed) from the previous level
+	optional<int> alphaChannelOverride;
+	if (textureType == gfx_api::texture_type::alpha_mask)
 	{
-		bool uploadResult = pTexture->upload(0, image);
-		ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
+		alphaChannelOverride = 0;
 	}
-	else
+	std::unique_ptr<iV_Image> pLevel = std::make_unique<iV_Image>(std::move(image));
+	for (size_t i = 0; i < mipmap_levels; i++)
 	{
-		// Run-time compression
-		auto compressedImage = gfx_api::compressImage(image, uploadFormat);
-		ASSERT_OR_RETURN(nullptr, compressedImage != nullptr, "Failed to compress image to format: %zu", static_cast<size_t>(uploadFormat));
-		bool uploadResult = pTexture->upload(0, *compressedImage);
-		ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
-	}
+		std::unique_ptr<iV_Image> pNextLevel;
+		if (i + 1 < mipmap_levels)
+		{
+			unsigned int output_w = std::max<unsigned int>(1, pLevel->width() >> 1);
+			unsigned int output_h = std::max<unsigned int>(1, pLevel->height() >> 1);
+			pNextLevel = std::make_unique<iV_Image>();
+			pNextLevel->resizedFromOther(*pLevel, output_w, output_h, alphaChannelOverride);
+		}
 
-	// 7.) Generate and upload mipmaps (if needed)
-	for (size_t i = 1; i < mipmap_levels; i++)
-	{
-		optional<int> alphaChannelOverride;
-		if (textureType == gfx_api::texture_type::alpha_mask)
+		if (uploadFormat == pLevel->pixel_format())
 		{
-			alphaChannelOverride = 0;
+			results.push_back(std::move(pLevel));
+		}
+		else
+		{
+			// Run-time compression
+			auto compressedImage = gfx_api::compressImage(*pLevel, uploadFormat);
+			ASSERT_OR_RETURN({}, compressedImage != nullptr, "Failed to compress image to format: %zu", static_cast<size_t>(uploadFormat));
+			results.push_back(std::move(compressedImage));
 		}
 
-		unsigned int output_w = std::max<unsigned int>(1, image.width() >> 1);
-		unsigned int output_h = std::max<unsigned int>(1, image.height() >> 1);
+		pLevel = std::move(pNextLevel);
+	}
 
-		image.resize(output_w, output_h, alphaChannelOverride);
+	return results;
+}
 
-		if (uploadFormat == image.pixel_format())
+// Load a texture file into the image levels a texture is created from, handling mip_maps, compression, etc
+// Does not touch the gfx backend (beyond querying its capabilities), so this may be called from any thread
+std::vector<std::unique_ptr<iV_BaseImage>> gfx_api::loadTextureImagesFromFile(const char *filename, gfx_api::texture_type textureType, int maxWidth /*= -1*/, int maxHeight /*= -1*/, bool quiet /*= false*/)
+{
+	auto imageLoadFilename = imageLoadFilenameFromInputFilename(filename);
+	std::vector<std::unique_ptr<iV_BaseImage>> images;
+
+	// Compressed / transcoded images are kept in the compressed image cache
+	auto cacheKey = gfx_api::compressedImageCacheKey(imageLoadFilename.toUtf8(), textureType, gfx_api::pixel_format_target::texture_2d, nullopt, maxWidth, maxHeight);
+	if (cacheKey.has_value())
+	{
+		images = gfx_api::loadCompressedImagesFromCache(cacheKey.value());
+		if (!images.empty())
 		{
-			bool uploadResult = pTexture->upload(i, image);
-			ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
+			return images;
 		}
-		else
+	}
+
+#if defined(BASIS_ENABLED)
+	if (imageLoadFilename.endsWith(".ktx2"))
+	{
+		uint32_t maxWidth_u32 = (maxWidth > 0) ? static_cast<uint32_t>(maxWidth) : UINT32_MAX;
+		uint32_t maxHeight_u32 = (maxHeight > 0) ? static_cast<uint32_t>(maxHeight) : UINT32_MAX;
+		images = gfx_api::loadiVImagesFromFile_Basis(imageLoadFilename.toUtf8(), textureType, gfx_api::pixel_format_target::texture_2d, nullopt /* auto-detect best possible format */, maxWidth_u32, maxHeight_u32);
+	}
+	else
+#endif
+	if (imageLoadFilename.endsWith(".png"))
+	{
+		iV_Image loadedUncompressedImage;
+		bool forceRGB = (textureType == gfx_api::texture_type::game_texture) || (textureType == gfx_api::texture_type::user_interface);
+		if (!iV_loadImage_PNG2(imageLoadFilename.toUtf8().c_str(), loadedUncompressedImage, forceRGB, quiet))
 		{
-			// Run-time compression
-			auto compressedImage = gfx_api::compressImage(image, uploadFormat);
-			ASSERT_OR_RETURN(nullptr, compressedImage != nullptr, "Failed to compress image to format: %zu", static_cast<size_t>(uploadFormat));
-			bool uploadResult = pTexture->upload(i, *compressedImage);
-			ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
+			return {};
 		}
+		images = gfx_api::textureImagesFromUncompressedImage(std::move(loadedUncompressedImage), textureType, imageLoadFilename.toUtf8(), maxWidth, maxHeight);
+	}
+	else
+	{
+		debug(LOG_ERROR, "Unable to load image file: %s", filename);
+		return {};
 	}
 
-	return pTexture.release();
+	if (cacheKey.has_value())
+	{
+		gfx_api::saveCompressedImagesToCache(cacheKey.value(), images);
+	}
+	return images;
 }
 
 std::unique_ptr<iV_Image> gfx_api::loadUncompressedImageFromFile(const char *filename, gfx_api::pixel_format_target target, gfx_api::texture_type textureType, int maxWidth /*= -1*/, int maxHeight /*= -1*/, bool forceRGBA8 /*= false*/)
@@ -993,7 +1037,33 @@ gfx_api::texture_array* gfx_api::context::loadTextureArrayFromFiles(const std::v
 		// load the file to an array of base images
 		std::vector<std::unique_ptr<iV_BaseImage>> loadedImagesForLayer;
 		std::vector<std::unique_ptr<iV_BaseImage>>* pImagesForLayer = nullptr;
-		if (imageLoadFilename.isEmpty())
+		bool loadedFromCache = false;
+
+		// layers already compressed / transcoded to the uploadFormat are kept in the compressed image cache
+		optional<std::string> cacheKey;
+		if (!imageLoadFilename.isEmpty() && !gfx_api::is_uncompressed_format(uploadFormat))
+		{
+			cacheKey = gfx_api::compressedImageCacheKey(imageLoadFilename.toUtf8(), textureType, gfx_api::pixel_format_target::texture_2d_array, uploadFormat, maxWidth, maxHeight);
+			if (cacheKey.has_value())
+			{
+				loadedImagesForLayer = gfx_api::loadCompressedImagesFromCache(cacheKey.value());
+				if (!loadedImagesForLayer.empty() && loadedImagesForLayer.front()->pixel_format() == uploadFormat)
+				{
+					pImagesForLayer = &loadedImagesForLayer;
+					loadedFromCache = true;
+				}
+				else
+				{
+					loadedImagesForLayer.clear();
+				}
+			}
+		}
+
+		if (loadedFromCache)
+		{
+			// nothing else to load
+		}
+		else if (imageLoadFilename.isEmpty())
 		{
 			pImagesForLayer = getDefaultTextureMipsP(layer, width, height, mipmap_levels, desiredImageExtractionFormat);
 			ASSERT_OR_RETURN(nullptr, pImagesForLayer != nullptr, "Failed to generate matching default texture");
@@ -1055,17 +1125,22 @@ gfx_api::texture_array* gfx_api::context::loadTextureArrayFromFiles(const std::v
 		// upload the layer
 
 		// If already in the uploadFormat
-		if (uploadFormat == desiredImageExtractionFormat)
+		if (loadedFromCache || uploadFormat == desiredImageExtractionFormat)
 		{
 			// just load directly
 			bool uploadSuccess = gfx_api::context::get().loadTextureArrayLayerFromBaseImages(*texture_array, layer, *pImagesForLayer, imageLoadFilename.toUtf8(), width, height);
 			ASSERT_OR_RETURN(nullptr, uploadSuccess, "Failed to loadTextureArrayLayerFromBaseImages");
+			if (cacheKey.has_value() && !loadedFromCache && pImagesForLayer == &loadedImagesForLayer)
+			{
+				gfx_api::saveCompressedImagesToCache(cacheKey.value(), loadedImagesForLayer);
+			}
 		}
 		else
 		{
 			// convert from (presumably uncompressed) to desired run-time compressed target format (for each mip level)
 			ASSERT_OR_RETURN(nullptr, uncompressedExtractionFormat, "Expected uncompressed extraction format, but received: %s", gfx_api::format_to_str(desiredImageExtractionFormat));
 
+			std::vector<std::unique_ptr<iV_BaseImage>> compressedImagesForLayer;
 			for (size_t level = 0; level < pImagesForLayer->size(); ++level)
 			{
 				const iV_Image* image = dynamic_cast<iV_Image*>(pImagesForLayer->at(level).get());
@@ -1075,6 +1150,11 @@ gfx_api::texture_array* gfx_api::context::loadTextureArrayFromFiles(const std::v
 				ASSERT_OR_RETURN(nullptr, compressedImage != nullptr, "Failed to compress image to format: %zu", static_cast<size_t>(uploadFormat));
 				bool uploadResult = texture_array->upload_layer(layer, level, *compressedImage);
 				ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
+				compressedImagesForLayer.push_back(std::move(compressedImage));
+			}
+			if (cacheKey.has_value() && pImagesForLayer == &loadedImagesForLayer)
+			{
+				gfx_api::saveCompressedImagesToCache(cacheKey.value(), compressedImagesForLayer);
 			}
 		}
 	}
@@ -499,40 +499,6 @@ std::vector<std::unique_ptr<iV_BaseImage>> gfx_api::loadiVImagesFromFile_Basis(c
 	return loadiVImagesFromFile_Basis_internal(filename, textureType, target, desiredFormat, maxWidth, maxHeight, nullopt);
 }
 
-gfx_api::texture* gfx_api::loadImageTextureFromFile_KTX2(const std::string& filename, gfx_api::texture_type textureType, int maxWidth /*= -1*/, int maxHeight /*= -1*/)
-{
-	uint32_t maxWidth_u32 = (maxWidth > 0) ? static_cast<uint32_t>(maxWidth) : UINT32_MAX;
-	uint32_t maxHeight_u32 = (maxHeight > 0) ? static_cast<uint32_t>(maxHeight) : UINT32_MAX;
-
-	auto images = gfx_api::loadiVImagesFromFile_Basis(filename.c_str(), textureType, gfx_api::pixel_format_target::texture_2d, nullopt /* auto-detect best possible format */, maxWidth_u32, maxHeight_u32);
-	if (images.empty())
-	{
-		// Failed to load
-		return nullptr;
-	}
-
-	// Create a new compatible gpu texture object
-	size_t mipmap_levels = images.size();
-	unsigned int toplevel_width = images[0]->width();
-	unsigned int toplevel_height = images[0]->height();
-	auto uploadFormat = images[0]->pixel_format();
-	std::unique_ptr<gfx_api::texture> pTexture = std::unique_ptr<gfx_api::texture>(gfx_api::context::get().create_texture(mipmap_levels, toplevel_width, toplevel_width, uploadFormat, filename));
-
-	// Upload image levels to texture
-	for (size_t i = 0; i < mipmap_levels; i++)
-	{
-		unsigned int expected_width = std::max<unsigned int>(1, toplevel_width >> i);
-		unsigned int expected_height = std::max<unsigned int>(1, toplevel_height >> i);
-
-		ASSERT(images[i]->width() == expected_width && images[i]->height() == expected_height, "Actual mip-level dimensions (%u x %u) do not match expected dimensions (%u x %u) for level[%zu] in image: %s", images[i]->width(), images[i]->height(), expected_width, expected_height, i, filename.c_str());
-
-		bool uploadResult = pTexture->upload(i, *(images[i]));
-		ASSERT_OR_RETURN(nullptr, uploadResult, "Failed to upload buffer to image");
-	}
-
-	return pTexture.release();
-}
-
 std::unique_ptr<iV_Image> gfx_api::loadUncompressedImageFromFile_KTX2(const std::string& filename, gfx_api::texture_type textureType, gfx_api::pixel_format_target target, int maxWidth /*= -1*/, int maxHeight /*= -1*/)
 {
 	uint32_t maxWidth_u32 = (maxWidth > 0) ? static_cast<uint32_t>(maxWidth) : UINT32_MAX;
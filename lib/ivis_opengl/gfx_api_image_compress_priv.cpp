@@ -19,6 +19,14 @@
 
 #include "gfx_api_image_compress_priv.h"
 #include "gfx_api.h"
+#if defined(BASIS_ENABLED)
+#include "gfx_api_image_basis_priv.h"
+#endif
+#include "lib/framework/blobcache.h"
+#include "lib/framework/crc.h"
+#include "lib/framework/file.h"
+#include "lib/framework/physfs_ext.h"
+#include "lib/framework/string_ext.h"
 
 #include <vector>
 #include <array>
@@ -414,3 +422,145 @@ std::unique_ptr<iV_BaseImage> gfx_api::compressImage(const iV_Image& image, gfx_
 
 	return nullptr;
 }
+
+// MARK: - Compressed image cache
+
+#define COMPRESSED_IMAGE_CACHE_CATEGORY "textures"
+#define COMPRESSED_IMAGE_CACHE_VERSION 1
+#define COMPRESSED_IMAGE_CACHE_MAX_SIZE (512 * 1024 * 1024) // room for the textures of a few game versions, mods or drivers
+
+void gfx_api::pruneCompressedImageCache()
+{
+	blobCachePrune(COMPRESSED_IMAGE_CACHE_CATEGORY, COMPRESSED_IMAGE_CACHE_MAX_SIZE);
+}
+
+// A cache key for the compressed images produced from a file, covering the file (by where it is found, its size and
+// modification time - so looking up the cache doesn't read the file) and everything else the result depends on (the texture type and target, the max size, the compression override and the formats this system supports)
+// Returns nullopt if loading the file wouldn't produce compressed images (or it can't be read), so there is nothing to cache
+optional<std::string> gfx_api::compressedImageCacheKey(const std::string& imageLoadFilename, gfx_api::texture_type textureType, gfx_api::pixel_format_target target, optional<gfx_api::pixel_format> transcodeFormat, int maxWidth, int maxHeight)
+{
+	size_t target_idx = static_cast<size_t>(target);
+	std::string formats;
+	if (strEndsWith(imageLoadFilename, ".ktx2"))
+	{
+#if defined(BASIS_ENABLED)
+		auto format = (transcodeFormat.has_value()) ? transcodeFormat : gfx_api::getBestAvailableTranscodeFormatForBasis(target, textureType);
+		if (!format.has_value() || gfx_api::is_uncompressed_format(format.value()))
+		{
+			return nullopt;
+		}
+		formats = gfx_api::format_to_str(format.value());
+#else
+		return nullopt;
+#endif
+	}
+	else
+	{
+		// Only game textures are compressed at run-time
+		if (textureType != gfx_api::texture_type::game_texture || (!bestAvailableCompressionFormat_GameTextureRGBA[target_idx].has_value() && !bestAvailableCompressionFormat_GameTextureRGB[target_idx].has_value()))
+		{
+			return nullopt;
+		}
+		formats = gfx_api::format_to_str(bestAvailableCompressionFormat_GameTextureRGBA[target_idx].value_or(gfx_api::pixel_format::invalid));
+		formats += ",";
+		formats += gfx_api::format_to_str(bestAvailableCompressionFormat_GameTextureRGB[target_idx].value_or(gfx_api::pixel_format::invalid));
+	}
+
+	// The choice of formats also depends on which formats the gfx backend supports
+	std::string supportedFormats;
+	for (size_t format = 0; format <= static_cast<size_t>(gfx_api::MAX_PIXEL_FORMAT); format++)
+	{
+		bool supported = gfx_api::context::get().textureFormatIsSupported(target, static_cast<gfx_api::pixel_format>(format), gfx_api::pixel_format_usage::sampled_image);
+		supportedFormats += (supported) ? '1' : '0';
+	}
+
+	auto maxLevel = gfx_api::getMaxTextureCompressionLevelOverride(imageLoadFilename);
+
+	PHYSFS_Stat metaData;
+	if (PHYSFS_stat(imageLoadFilename.c_str(), &metaData) == 0 || metaData.filetype != PHYSFS_FILETYPE_REGULAR || metaData.filesize < 0)
+	{
+		return nullopt;
+	}
+
+	// The search path entry the file is found in, so an override (ex. a mod, or graphics_overrides) gets its own entries
+	std::string key = WZ_PHYSFS_getRealDir_String(imageLoadFilename.c_str()) + ":" + imageLoadFilename;
+	key += ":" + std::to_string(static_cast<int64_t>(metaData.filesize));
+	key += ":" + std::to_string(static_cast<int64_t>(metaData.modtime));
+	key += ":" + std::to_string(static_cast<int>(textureType));
+	key += ":" + std::to_string(target_idx);
+	key += ":" + formats;
+	key += ":" + supportedFormats;
+	key += ":" + std::to_string(maxWidth) + "x" + std::to_string(maxHeight);
+	key += ":" + ((maxLevel.has_value()) ? std::to_string(static_cast<int>(maxLevel.value())) : std::string("-"));
+	return sha256Sum(key.data(), key.size()).toString();
+}
+
+// Load the images stored for a key by saveCompressedImagesToCache (returns an empty vector if there are none)
+std::vector<std::unique_ptr<iV_BaseImage>> gfx_api::loadCompressedImagesFromCache(const std::string& key)
+{
+	std::vector<std::unique_ptr<iV_BaseImage>> results;
+	std::vector<uint8_t> blob;
+	if (!blobCacheRead(COMPRESSED_IMAGE_CACHE_CATEGORY, key, COMPRESSED_IMAGE_CACHE_VERSION, blob))
+	{
+		return results;
+	}
+
+	BlobReader reader(blob.data(), blob.size());
+	uint32_t levels = 0;
+	if (!reader.read(levels) || levels == 0)
+	{
+		return {};
+	}
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		uint32_t format = 0, width = 0, height = 0, bufferRowLength = 0, bufferImageHeight = 0;
+		std::vector<uint8_t> data;
+		if (!(reader.read(format) && reader.read(width) && reader.read(height) && reader.read(bufferRowLength) && reader.read(bufferImageHeight) && reader.readVector(data)))
+		{
+			return {};
+		}
+		if (format == static_cast<uint32_t>(gfx_api::pixel_format::invalid) || format > static_cast<uint32_t>(gfx_api::MAX_PIXEL_FORMAT)
+			|| gfx_api::is_uncompressed_format(static_cast<gfx_api::pixel_format>(format))
+			|| width == 0 || height == 0 || data.empty())
+		{
+			return {};
+		}
+		auto image = std::make_unique<iV_CompressedImage>();
+		if (!image->allocate(static_cast<gfx_api::pixel_format>(format), data.size(), bufferRowLength, bufferImageHeight, width, height))
+		{
+			return {};
+		}
+		memcpy(image->uint64_w(), data.data(), data.size());
+		results.push_back(std::move(image));
+	}
+	if (!reader.finished())
+	{
+		return {};
+	}
+	return results;
+}
+
+// Store the images for a key, if they are all compressed (uncompressed images are cheap to produce, and large)
+void gfx_api::saveCompressedImagesToCache(const std::string& key, const std::vector<std::unique_ptr<iV_BaseImage>>& images)
+{
+	if (images.empty() || std::any_of(images.begin(), images.end(), [](const std::unique_ptr<iV_BaseImage>& image) {
+		return !image || gfx_api::is_uncompressed_format(image->pixel_format());
+	}))
+	{
+		return;
+	}
+
+	BlobWriter writer;
+	writer.write<uint32_t>(static_cast<uint32_t>(images.size()));
+	for (const auto& image : images)
+	{
+		writer.write<uint32_t>(static_cast<uint32_t>(image->pixel_format()));
+		writer.write<uint32_t>(image->width());
+		writer.write<uint32_t>(image->height());
+		writer.write<uint32_t>(image->bufferRowLength());
+		writer.write<uint32_t>(image->bufferImageHeight());
+		writer.write<uint32_t>(static_cast<uint32_t>(image->data_size()));
+		writer.data.insert(writer.data.end(), image->data(), image->data() + image->data_size());
+	}
+	blobCacheWrite(COMPRESSED_IMAGE_CACHE_CATEGORY, key, COMPRESSED_IMAGE_CACHE_VERSION, writer.data);
+}
@@ -23,6 +23,8 @@
 #include "gfx_api_formats_def.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <nonstd/optional.hpp>
 using nonstd::optional;
@@ -38,6 +40,14 @@ namespace gfx_api
 
 	// Compresses an iV_Image to the desired compressed image format (if possible)
 	std::unique_ptr<iV_BaseImage> compressImage(const iV_Image& image, gfx_api::pixel_format desiredFormat);
+
+	// Persistent cache (in the cache folder of the write directory) of the compressed images produced from image files,
+	// so that they don't have to be compressed / transcoded again on every launch
+	optional<std::string> compressedImageCacheKey(const std::string& imageLoadFilename, gfx_api::texture_type textureType, gfx_api::pixel_format_target target, optional<gfx_api::pixel_format> transcodeFormat, int maxWidth, int maxHeight);
+	std::vector<std::unique_ptr<iV_BaseImage>> loadCompressedImagesFromCache(const std::string& key);
+	void saveCompressedImagesToCache(const std::string& key, const std::vector<std::unique_ptr<iV_BaseImage>>& images);
+	// Drop the oldest entries of the compressed image cache (call before any textures are loaded)
+	void pruneCompressedImageCache();
 }
 
 // An image in a compressed format
@@ -54,6 +54,9 @@ struct iIMDBaseShape;
 
 //*************************************************************************
 
+/// Limit the size of the parsed model cache (call at startup, before any models are loaded)
+void modelCachePrune();
+
 void modelShutdown();
 
 void modelUpdateTilesetIdx(size_t tilesetIdx);
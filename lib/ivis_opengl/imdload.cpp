@@ -28,8 +28,10 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <array>
+#include <algorithm>
 
 #include "lib/framework/frame.h"
+#include "lib/framework/blobcache.h"
 #include "lib/framework/string_ext.h"
 #include "lib/framework/frameresource.h"
 #include "lib/framework/fixedpoint.h"
@@ -43,6 +45,8 @@
 #include "imd.h" // for imd structures
 #include "tex.h" // texture page loading
 
+#include "src/version.h"
+
 #include <glm/vec4.hpp>
 using Vector4f = glm::vec4;
 
@@ -56,6 +60,12 @@ static_assert(MAX_PIE_POLYGONS <= ((UINT16_MAX-1) / 3), "MAX_PIE_POLYGONS must n
 // Scale animation numbers from int to float
 #define INT_SCALE       1000
 
+// Folder and format version of the binary model cache. Bump the version whenever the parsing or the layout of iIMDShape changes.
+// (Entries are also keyed by the game version and the sizes of the structs stored raw, see imdCacheKey.)
+#define IMD_CACHE_CATEGORY	"models"
+#define IMD_CACHE_VERSION	1
+#define IMD_CACHE_MAX_SIZE	(64 * 1024 * 1024)	// room for the models of a few game versions and mods
+
 typedef std::unordered_map<std::string, std::unique_ptr<iIMDBaseShape>> ModelMap;
 static ModelMap models;
 static size_t currentTilesetIdx = 0;
@@ -63,7 +73,12 @@ static size_t currentTilesetIdx = 0;
 static size_t modelLoadingErrors = 0;
 static size_t modelTextureLoadingFailures = 0;
 
-static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const char **ppFileData, const char *FileDataEnd, bool skipGPUData);
+struct IMDCacheData;
+
+static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const char **ppFileData, const char *FileDataEnd, bool skipGPUData, IMDCacheData *pCacheOut);
+static std::string imdCacheKey(const Sha256 &sourceHash);
+static std::unique_ptr<iIMDShape> _imd_load_cached(const WzString &filename, const std::string &cacheKey, bool skipGPUData);
+static void _imd_write_cache(const std::string &cacheKey, const iIMDShape &firstLevel, const IMDCacheData &cacheData);
 static bool _imd_load_level_textures(const iIMDShape& s, size_t tilesetIdx, iIMDShapeTextures& output);
 
 iIMDShape::~iIMDShape()
@@ -134,6 +149,11 @@ size_t getModelTextureLoadingFailuresCount()
 	return modelTextureLoadingFailures;
 }
 
+void modelCachePrune()
+{
+	blobCachePrune(IMD_CACHE_CATEGORY, IMD_CACHE_MAX_SIZE);
+}
+
 void modelShutdown()
 {
 	models.clear();
@@ -200,10 +220,24 @@ static std::unique_ptr<iIMDShape> tryLoadDisplayModelInternal(const WzString &pa
 			debug(LOG_ERROR, "Failed to load model file: %s", WzString(path + filename).toUtf8().c_str());
 			return nullptr;
 		}
+		// Models which were parsed before are loaded from the model cache, keyed by the hash of the source file
+		const std::string cacheKey = imdCacheKey(sha256Sum(pFileData, size));
+		auto result = _imd_load_cached(filename, cacheKey, skipGPUupload);
+		if (result)
+		{
+			free(pFileData);
+			return result;
+		}
+
 		fileEnd = pFileData + size;
 		const char *pFileDataPt = pFileData;
-		auto result = iV_ProcessIMD(filename, (const char **)&pFileDataPt, fileEnd, skipGPUupload);
+		IMDCacheData cacheData;
+		result = iV_ProcessIMD(filename, (const char **)&pFileDataPt, fileEnd, skipGPUupload, &cacheData);
 		free(pFileData);
+		if (result)
+		{
+			_imd_write_cache(cacheKey, *result, cacheData);
+		}
 		return result;
 	}
 	return nullptr;
@@ -1088,7 +1122,7 @@ static bool _imd_load_level_textures(const iIMDShape& s, size_t tilesetIdx, iIMD
 	const TilesetTextureFiles* pLevelSettingsToUseForTextures = (!tilesetSettings.texfile.empty()) ? &tilesetSettings : &defaultSettings;
 	if (!pLevelSettingsToUseForTextures->texfile.empty())
 	{
-		optional<size_t> texpage = iV_GetTexture(pLevelSettingsToUseForTextures->texfile.c_str(), gfx_api::texture_type::game_texture);
+		optional<size_t> texpage = iV_GetTextureAsync(pLevelSettingsToUseForTextures->texfile.c_str(), gfx_api::texture_type::game_texture);
 		optional<size_t> tcmaskpage;
 		optional<size_t> normalpage;
 		optional<size_t> specpage;
@@ -1100,7 +1134,7 @@ static bool _imd_load_level_textures(const iIMDShape& s, size_t tilesetIdx, iIMD
 		{
 			// load explicitly specified tcmask file
 			debug(LOG_TEXTURE, "Loading tcmask %s for %s", pLevelSettingsToUseForTCMask->tcmaskfile.c_str(), filename.toUtf8().c_str());
-			tcmaskpage = iV_GetTexture(pLevelSettingsToUseForTCMask->tcmaskfile.c_str(), gfx_api::texture_type::alpha_mask);
+			tcmaskpage = iV_GetTextureAsync(pLevelSettingsToUseForTCMask->tcmaskfile.c_str(), gfx_api::texture_type::alpha_mask);
 			ASSERT_OR_RETURN(false, tcmaskpage.has_value(), "%s could not load tcmask %s", filename.toUtf8().c_str(), pLevelSettingsToUseForTCMask->tcmaskfile.c_str());
 		}
 		else
@@ -1111,7 +1145,7 @@ static bool _imd_load_level_textures(const iIMDShape& s, size_t tilesetIdx, iIMD
 			{
 				std::string tcmask_name = pie_MakeTexPageTCMaskName(pLevelSettingsToUseForTextures->texfile.c_str());
 				tcmask_name += ".png";
-				tcmaskpage = iV_GetTexture(tcmask_name.c_str(), gfx_api::texture_type::alpha_mask);
+				tcmaskpage = iV_GetTextureAsync(tcmask_name.c_str(), gfx_api::texture_type::alpha_mask);
 				ASSERT_OR_RETURN(false, tcmaskpage.has_value(), "%s could not load tcmask %s", filename.toUtf8().c_str(), tcmask_name.c_str());
 			}
 		}
@@ -1120,7 +1154,7 @@ static bool _imd_load_level_textures(const iIMDShape& s, size_t tilesetIdx, iIMD
 		if (!pLevelSettingsToUseForNormals->normalfile.empty())
 		{
 			debug(LOG_TEXTURE, "Loading normal map %s for %s", pLevelSettingsToUseForNormals->normalfile.c_str(), filename.toUtf8().c_str());
-			normalpage = iV_GetTexture(pLevelSettingsToUseForNormals->normalfile.c_str(), gfx_api::texture_type::normal_map);
+			normalpage = iV_GetTextureAsync(pLevelSettingsToUseForNormals->normalfile.c_str(), gfx_api::texture_type::normal_map);
 			ASSERT_OR_RETURN(false, normalpage.has_value(), "%s could not load tex page %s", filename.toUtf8().c_str(), pLevelSettingsToUseForNormals->normalfile.c_str());
 		}
 
@@ -1128,7 +1162,7 @@ static bool _imd_load_level_textures(const iIMDShape& s, size_t tilesetIdx, iIMD
 		if (!pLevelSettingsToUseForSpecular->specfile.empty())
 		{
 			debug(LOG_TEXTURE, "Loading specular map %s for %s", pLevelSettingsToUseForSpecular->specfile.c_str(), filename.toUtf8().c_str());
-			specpage = iV_GetTexture(pLevelSettingsToUseForSpecular->specfile.c_str(), gfx_api::texture_type::specular_map);
+			specpage = iV_GetTextureAsync(pLevelSettingsToUseForSpecular->specfile.c_str(), gfx_api::texture_type::specular_map);
 			ASSERT_OR_RETURN(false, specpage.has_value(), "%s could not load tex page %s", filename.toUtf8().c_str(), pLevelSettingsToUseForSpecular->specfile.c_str());
 		}
 
@@ -1151,6 +1185,65 @@ static std::vector<gfx_api::gfxFloat> bitangents;
 static std::vector<uint16_t> indices; // size is npolys * 3 * numFrames
 static uint16_t vertexCount = 0;
 
+// GPU-ready data of one model level
+struct IMDLevelBuffers
+{
+	std::vector<gfx_api::gfxFloat> vertices;
+	std::vector<gfx_api::gfxFloat> normals;
+	std::vector<gfx_api::gfxFloat> texcoords;
+	std::vector<gfx_api::gfxFloat> tangents;
+	std::vector<uint16_t> indices;
+};
+
+// What the model cache stores beyond the shapes themselves
+struct IMDCacheData
+{
+	std::array<std::string, ANIM_EVENT_COUNT> eventModels;
+	std::vector<IMDLevelBuffers> levels;
+};
+
+static void _imd_upload_level_buffers(iIMDShape &s, const WzString &filename, const std::string &key, const IMDLevelBuffers &levelBuffers)
+{
+	if (!levelBuffers.tangents.empty())
+	{
+		if (!s.buffers[VBO_TANGENT])
+			s.buffers[VBO_TANGENT] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "tangent buffer");
+		s.buffers[VBO_TANGENT]->upload(levelBuffers.tangents.size() * sizeof(gfx_api::gfxFloat), levelBuffers.tangents.data());
+	}
+
+	if (!s.buffers[VBO_VERTEX])
+		s.buffers[VBO_VERTEX] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "vertex buffer");
+	if (levelBuffers.vertices.empty())
+	{
+		debug(LOG_ERROR, "_imd_load_level: file corrupt? - no vertices?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
+	}
+	s.buffers[VBO_VERTEX]->upload(levelBuffers.vertices.size() * sizeof(gfx_api::gfxFloat), levelBuffers.vertices.data());
+
+	if (!s.buffers[VBO_NORMAL])
+		s.buffers[VBO_NORMAL] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "normals buffer");
+	if (levelBuffers.normals.empty())
+	{
+		debug(LOG_ERROR, "_imd_load_level: file corrupt? - no normals?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
+	}
+	s.buffers[VBO_NORMAL]->upload(levelBuffers.normals.size() * sizeof(gfx_api::gfxFloat), levelBuffers.normals.data());
+
+	if (!s.buffers[VBO_INDEX])
+		s.buffers[VBO_INDEX] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::index_buffer, gfx_api::context::buffer_storage_hint::static_draw, "index buffer");
+	if (levelBuffers.indices.empty())
+	{
+		debug(LOG_ERROR, "_imd_load_level: file corrupt? - no indices?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
+	}
+	s.buffers[VBO_INDEX]->upload(levelBuffers.indices.size() * sizeof(uint16_t), levelBuffers.indices.data());
+
+	if (!s.buffers[VBO_TEXCOORD])
+		s.buffers[VBO_TEXCOORD] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "tex coords buffer");
+	if (levelBuffers.texcoords.empty())
+	{
+		debug(LOG_ERROR, "_imd_load_level: file corrupt? - no texcoords?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
+	}
+	s.buffers[VBO_TEXCOORD]->upload(levelBuffers.texcoords.size() * sizeof(gfx_api::gfxFloat), levelBuffers.texcoords.data());
+}
+
 static bool ReadNormals(const char **ppFileData, const char *FileDataEnd, std::vector<Vector3f> &pie_level_normals, uint32_t num_normal_lines)
 {
 	const char *pFileData = *ppFileData;
@@ -1326,12 +1419,13 @@ void finishTangentsGeneration()
  * \param ppFileData Pointer to the data (usually read from a file)
  * \param FileDataEnd ???
  * \param nlevels Number of levels to load
+ * \param pLevelBuffersOut If not NULL, receives the GPU data of the level (even if skipGPUData is set)
  * \return pointer to iFSDShape structure (or NULL on error)
  * \pre ppFileData loaded
  * \post s allocated
  */
 static_assert(PATH_MAX >= 255, "PATH_MAX is insufficient!");
-static std::unique_ptr<iIMDShape> _imd_load_level(const WzString &filename, const char **ppFileData, const char *FileDataEnd, int pieVersion, uint32_t level, const LevelSettings &globalLevelSettings, bool skipGPUData)
+static std::unique_ptr<iIMDShape> _imd_load_level(const WzString &filename, const char **ppFileData, const char *FileDataEnd, int pieVersion, uint32_t level, const LevelSettings &globalLevelSettings, bool skipGPUData, IMDLevelBuffers *pLevelBuffersOut)
 {
 	const char *pFileData = *ppFileData;
 	char buffer[PATH_MAX] = {'\0'}; uint32_t value = 0;
@@ -1603,7 +1697,7 @@ static std::unique_ptr<iIMDShape> _imd_load_level(const WzString &filename, cons
 	}
 
 	// FINALLY, massage the data into what can stream directly to GPU buffers
-	if (!skipGPUData)
+	if (!skipGPUData || pLevelBuffersOut != nullptr)
 	{
 		vertexCount = 0;
 		// Go through all polygons for each frame
@@ -1627,46 +1721,28 @@ static std::unique_ptr<iIMDShape> _imd_load_level(const WzString &filename, cons
 			for (size_t i = 0; i < indices.size(); i += 3)
 				calculateTangentsForTriangle(indices[i], indices[i+1], indices[i+2]);
 			finishTangentsGeneration();
-
-			if (!tangents.empty())
-			{
-				if (!s.buffers[VBO_TANGENT])
-					s.buffers[VBO_TANGENT] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "tangent buffer");
-				s.buffers[VBO_TANGENT]->upload(tangents.size() * sizeof(gfx_api::gfxFloat), tangents.data());
-			}
-		}
-
-		if (!s.buffers[VBO_VERTEX])
-			s.buffers[VBO_VERTEX] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "vertex buffer");
-		if (vertices.empty())
-		{
-			debug(LOG_ERROR, "_imd_load_level: file corrupt? - no vertices?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
-		}
-		s.buffers[VBO_VERTEX]->upload(vertices.size() * sizeof(gfx_api::gfxFloat), vertices.data());
-
-		if (!s.buffers[VBO_NORMAL])
-			s.buffers[VBO_NORMAL] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "normals buffer");
-		if (normals.empty())
-		{
-			debug(LOG_ERROR, "_imd_load_level: file corrupt? - no normals?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
 		}
-		s.buffers[VBO_NORMAL]->upload(normals.size() * sizeof(gfx_api::gfxFloat), normals.data());
 
-		if (!s.buffers[VBO_INDEX])
-			s.buffers[VBO_INDEX] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::index_buffer, gfx_api::context::buffer_storage_hint::static_draw, "index buffer");
-		if (indices.empty())
+		// swap the data in and out, to keep reusing the capacity of the static vectors
+		IMDLevelBuffers levelBuffers;
+		levelBuffers.vertices.swap(vertices);
+		levelBuffers.normals.swap(normals);
+		levelBuffers.texcoords.swap(texcoords);
+		levelBuffers.tangents.swap(tangents);
+		levelBuffers.indices.swap(indices);
+		if (!skipGPUData)
 		{
-			debug(LOG_ERROR, "_imd_load_level: file corrupt? - no indices?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
+			_imd_upload_level_buffers(s, filename, key, levelBuffers);
 		}
-		s.buffers[VBO_INDEX]->upload(indices.size() * sizeof(uint16_t), indices.data());
-
-		if (!s.buffers[VBO_TEXCOORD])
-			s.buffers[VBO_TEXCOORD] = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::static_draw, "tex coords buffer");
-		if (texcoords.empty())
+		if (pLevelBuffersOut != nullptr)
 		{
-			debug(LOG_ERROR, "_imd_load_level: file corrupt? - no texcoords?: %s (key: %s)", filename.toUtf8().c_str(), key.c_str());
+			*pLevelBuffersOut = levelBuffers;
 		}
-		s.buffers[VBO_TEXCOORD]->upload(texcoords.size() * sizeof(gfx_api::gfxFloat), texcoords.data());
+		vertices.swap(levelBuffers.vertices);
+		normals.swap(levelBuffers.normals);
+		texcoords.swap(levelBuffers.texcoords);
+		tangents.swap(levelBuffers.tangents);
+		indices.swap(levelBuffers.indices);
 	}
 
 	indices.resize(0);
@@ -1694,10 +1770,11 @@ static std::unique_ptr<iIMDShape> _imd_load_level(const WzString &filename, cons
  * Load ppFileData into a shape
  * \param ppFileData Data from the IMD file
  * \param FileDataEnd Endpointer
+ * \param pCacheOut If not NULL, receives the data needed to write the model to the model cache
  * \return The shape, constructed from the data read
  */
 // ppFileData is incremented to the end of the file on exit!
-static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const char **ppFileData, const char *FileDataEnd, bool skipGPUData)
+static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const char **ppFileData, const char *FileDataEnd, bool skipGPUData, IMDCacheData *pCacheOut)
 {
 	const char *pFileData = *ppFileData;
 	char buffer[PATH_MAX] = {};
@@ -1785,6 +1862,10 @@ static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const
 		}
 
 		objanimpie[value] = modelGet(animpie);
+		if (pCacheOut != nullptr && value < ANIM_EVENT_COUNT)
+		{
+			pCacheOut->eventModels[value] = animpie;
+		}
 
 		/* Try -yet again- to read in LEVELS directive */
 		if (!getNextPossibleCommandLine())
@@ -1827,7 +1908,13 @@ static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const
 			return nullptr;
 		}
 
-		std::unique_ptr<iIMDShape> shape = _imd_load_level(filename, &lineToProcess.pNextLineBegin, FileDataEnd, imd_version, level, globalLevelSettings, skipGPUData);
+		IMDLevelBuffers *pLevelBuffers = nullptr;
+		if (pCacheOut != nullptr)
+		{
+			pCacheOut->levels.emplace_back();
+			pLevelBuffers = &pCacheOut->levels.back();
+		}
+		std::unique_ptr<iIMDShape> shape = _imd_load_level(filename, &lineToProcess.pNextLineBegin, FileDataEnd, imd_version, level, globalLevelSettings, skipGPUData, pLevelBuffers);
 		if (shape == nullptr)
 		{
 			debug(LOG_ERROR, "%s: Unsuccessful loading level %" PRIu32, filename.toUtf8().c_str(), (level + 1));
@@ -1863,3 +1950,241 @@ static std::unique_ptr<iIMDShape> iV_ProcessIMD(const WzString &filename, const
 	*ppFileData = pFileData;
 	return firstLevel;
 }
+
+// Model cache
+
+static void _imd_write_polys(BlobWriter &writer, const std::vector<iIMDPoly> &polys)
+{
+	writer.write<uint32_t>(static_cast<uint32_t>(polys.size()));
+	for (const iIMDPoly &poly : polys)
+	{
+		writer.writeVector(poly.texCoord);
+		writer.write(poly.texAnim);
+		writer.write(poly.flags);
+		writer.write(poly.zcentre);
+		writer.write(poly.normal);
+		writer.write(poly.pindex);
+	}
+}
+
+static bool _imd_read_polys(BlobReader &reader, std::vector<iIMDPoly> &polys, size_t numPoints)
+{
+	uint32_t numPolys = 0;
+	if (!reader.read(numPolys) || numPolys > MAX_PIE_POLYGONS)
+	{
+		return false;
+	}
+	polys.resize(numPolys);
+	for (iIMDPoly &poly : polys)
+	{
+		if (!(reader.readVector(poly.texCoord) && reader.read(poly.texAnim) && reader.read(poly.flags) && reader.read(poly.zcentre) && reader.read(poly.normal) && reader.read(poly.pindex)))
+		{
+			return false;
+		}
+		if (poly.texCoord.size() < 3 || poly.pindex[0] >= numPoints || poly.pindex[1] >= numPoints || poly.pindex[2] >= numPoints)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The cache stores vectors and values as raw bytes, so an entry written by another build (which may have a different struct layout,
+// or parse models differently without a bumped IMD_CACHE_VERSION) must never be read back
+static std::string imdCacheKey(const Sha256 &sourceHash)
+{
+	static const std::string buildKey = astringf("%s|%zu|%zu|%zu|%zu|%zu|%zu|%zu|%zu", version_getVersionString(),
+		sizeof(Vector2f), sizeof(Vector3f), sizeof(Vector3i), sizeof(Rotation), sizeof(iIMDPoly::pindex),
+		sizeof(gfx_api::gfxFloat), sizeof(int), sizeof(unsigned short));
+	const std::string key = sourceHash.toString() + "|" + buildKey;
+	return sha256Sum(key.data(), key.size()).toString();
+}
+
+static void _imd_write_cache(const std::string &cacheKey, const iIMDShape &firstLevel, const IMDCacheData &cacheData)
+{
+	BlobWriter writer;
+	for (const std::string &eventModel : cacheData.eventModels)
+	{
+		writer.writeString(eventModel);
+	}
+	writer.write<uint32_t>(static_cast<uint32_t>(cacheData.levels.size()));
+
+	const iIMDShape *s = &firstLevel;
+	for (const IMDLevelBuffers &levelBuffers : cacheData.levels)
+	{
+		ASSERT_OR_RETURN(, s != nullptr, "Fewer levels than level buffers?");
+		writer.write(s->min);
+		writer.write(s->max);
+		writer.write(s->sradius);
+		writer.write(s->radius);
+		writer.write(s->ocen);
+		writer.write(s->flags);
+		writer.write(s->numFrames);
+		writer.write(s->animInterval);
+		writer.write(s->interpolate);
+		writer.write(s->objanimtime);
+		writer.write(s->objanimcycles);
+		writer.write<int32_t>(s->objanimframes);
+		for (const ANIMFRAME &frame : s->objanimdata)
+		{
+			writer.write(frame.scale);
+			writer.write(frame.pos);
+			writer.write(frame.rot.direction);
+			writer.write(frame.rot.pitch);
+			writer.write(frame.rot.roll);
+		}
+		writer.writeVector(s->connectors);
+		writer.writeVector(s->points);
+		_imd_write_polys(writer, s->polys);
+		writer.writeVector(s->altShadowPoints);
+		_imd_write_polys(writer, s->altShadowPolys);
+		for (const TilesetTextureFiles &files : s->tilesetTextureFiles)
+		{
+			writer.writeString(files.texfile);
+			writer.writeString(files.tcmaskfile);
+			writer.writeString(files.normalfile);
+			writer.writeString(files.specfile);
+		}
+		writer.write(s->vertexCount);
+		writer.writeVector(levelBuffers.vertices);
+		writer.writeVector(levelBuffers.normals);
+		writer.writeVector(levelBuffers.texcoords);
+		writer.writeVector(levelBuffers.tangents);
+		writer.writeVector(levelBuffers.indices);
+		s = s->next.get();
+	}
+
+	blobCacheWrite(IMD_CACHE_CATEGORY, cacheKey, IMD_CACHE_VERSION, writer.data);
+}
+
+static std::unique_ptr<iIMDShape> _imd_read_cached_level(BlobReader &reader, const std::string &key, uint32_t level, IMDLevelBuffers &levelBuffers)
+{
+	auto pAllocatedShape = std::make_unique<iIMDShape>();
+	iIMDShape &s = *pAllocatedShape;
+	s.modelName = WzString::fromUtf8(key);
+	s.modelLevel = level;
+
+	int32_t objanimframes = 0;
+	if (!(reader.read(s.min) && reader.read(s.max) && reader.read(s.sradius) && reader.read(s.radius) && reader.read(s.ocen)
+	      && reader.read(s.flags) && reader.read(s.numFrames) && reader.read(s.animInterval) && reader.read(s.interpolate)
+	      && reader.read(s.objanimtime) && reader.read(s.objanimcycles) && reader.read(objanimframes))
+	    || objanimframes < 0 || objanimframes > UINT16_MAX)
+	{
+		return nullptr;
+	}
+	s.objanimframes = objanimframes;
+	s.objanimdata.resize(objanimframes);
+	for (ANIMFRAME &frame : s.objanimdata)
+	{
+		if (!(reader.read(frame.scale) && reader.read(frame.pos) && reader.read(frame.rot.direction) && reader.read(frame.rot.pitch) && reader.read(frame.rot.roll)))
+		{
+			return nullptr;
+		}
+	}
+	if (!(reader.readVector(s.connectors) && reader.readVector(s.points) && _imd_read_polys(reader, s.polys, s.points.size())
+	      && reader.readVector(s.altShadowPoints) && _imd_read_polys(reader, s.altShadowPolys, s.altShadowPoints.size())))
+	{
+		return nullptr;
+	}
+	for (TilesetTextureFiles &files : s.tilesetTextureFiles)
+	{
+		if (!(reader.readString(files.texfile) && reader.readString(files.tcmaskfile) && reader.readString(files.normalfile) && reader.readString(files.specfile)))
+		{
+			return nullptr;
+		}
+	}
+	if (!(reader.read(s.vertexCount) && reader.readVector(levelBuffers.vertices) && reader.readVector(levelBuffers.normals)
+	      && reader.readVector(levelBuffers.texcoords) && reader.readVector(levelBuffers.tangents) && reader.readVector(levelBuffers.indices)))
+	{
+		return nullptr;
+	}
+	if (levelBuffers.vertices.size() != s.vertexCount * 3u || levelBuffers.normals.size() != s.vertexCount * 3u || levelBuffers.texcoords.size() != s.vertexCount * 4u
+	    || (!levelBuffers.tangents.empty() && levelBuffers.tangents.size() != s.vertexCount * 4u)
+	    || std::any_of(levelBuffers.indices.begin(), levelBuffers.indices.end(), [&s](uint16_t index) { return index >= s.vertexCount; }))
+	{
+		return nullptr;
+	}
+
+	if (!s.altShadowPoints.empty())
+	{
+		s.pShadowPoints = &s.altShadowPoints;
+		s.pShadowPolys = &s.altShadowPolys;
+	}
+	else
+	{
+		s.pShadowPoints = &s.points;
+		s.pShadowPolys = &s.polys;
+	}
+	return pAllocatedShape;
+}
+
+static std::unique_ptr<iIMDShape> _imd_load_cached(const WzString &filename, const std::string &cacheKey, bool skipGPUData)
+{
+	std::vector<uint8_t> blob;
+	if (!blobCacheRead(IMD_CACHE_CATEGORY, cacheKey, IMD_CACHE_VERSION, blob))
+	{
+		return nullptr;
+	}
+
+	BlobReader reader(blob.data(), blob.size());
+	std::array<std::string, ANIM_EVENT_COUNT> eventModels;
+	uint32_t nlevels = 0;
+	for (std::string &eventModel : eventModels)
+	{
+		reader.readString(eventModel);
+	}
+	if (!reader.read(nlevels) || nlevels == 0)
+	{
+		debug(LOG_WZ, "%s: Invalid model cache entry", filename.toUtf8().c_str());
+		return nullptr;
+	}
+
+	std::unique_ptr<iIMDShape> firstLevel = nullptr;
+	iIMDShape *lastLevel = nullptr;
+	std::vector<IMDLevelBuffers> levels(nlevels);
+	for (uint32_t level = 0; level < nlevels; ++level)
+	{
+		std::string key = filename.toStdString();
+		if (level > 0)
+		{
+			key += "_" + std::to_string(level);
+		}
+		std::unique_ptr<iIMDShape> shape = _imd_read_cached_level(reader, key, level, levels[level]);
+		if (shape == nullptr)
+		{
+			debug(LOG_WZ, "%s: Invalid model cache entry (level %" PRIu32 ")", filename.toUtf8().c_str(), level + 1);
+			return nullptr;
+		}
+		if (lastLevel)
+		{
+			lastLevel->next = std::move(shape);
+			lastLevel = lastLevel->next.get();
+		}
+		else
+		{
+			firstLevel = std::move(shape);
+			lastLevel = firstLevel.get();
+		}
+	}
+	if (!reader.finished())
+	{
+		debug(LOG_WZ, "%s: Invalid model cache entry (trailing data)", filename.toUtf8().c_str());
+		return nullptr;
+	}
+
+	// Same order of side effects as iV_ProcessIMD: animation models are loaded before the buffers are uploaded
+	for (int i = 0; i < ANIM_EVENT_COUNT; i++)
+	{
+		firstLevel->objanimpie[i] = eventModels[i].empty() ? nullptr : modelGet(WzString::fromUtf8(eventModels[i]));
+	}
+	if (!skipGPUData)
+	{
+		iIMDShape *s = firstLevel.get();
+		for (const IMDLevelBuffers &levelBuffers : levels)
+		{
+			_imd_upload_level_buffers(*s, filename, s->modelName.toStdString(), levelBuffers);
+			s = s->next.get();
+		}
+	}
+	return firstLevel;
+}
@@ -103,6 +103,7 @@ void pie_ScreenFrameRenderBegin()
 	}
 	renderingFrame = true;
 	gfx_api::context::get().beginRenderPass();
+	iV_ProcessAsyncTextureUploads();
 	if (screen_GetBackDrop())
 	{
 		screen_Display();
@@ -30,6 +30,10 @@
 #include "screen.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #if defined(__clang__)
@@ -57,6 +61,8 @@ struct iTexPage
 	std::string filename;
 	gfx_api::texture* id = nullptr;
 	gfx_api::texture_type textureType = gfx_api::texture_type::user_interface;
+	bool asyncLoadPending = false; ///< id is a placeholder, until the texture has been loaded by iV_GetTextureAsync
+	bool loadFailed = false; ///< id is a placeholder, because loading the texture for iV_GetTextureAsync failed
 
 	iTexPage() = default;
 
@@ -66,6 +72,8 @@ struct iTexPage
 		id = input.id;
 		input.id = nullptr;
 		std::swap(textureType, input.textureType);
+		asyncLoadPending = input.asyncLoadPending;
+		loadFailed = input.loadFailed;
 	}
 
 	~iTexPage()
@@ -128,6 +136,8 @@ static size_t pie_AddTexPage_Impl(gfx_api::texture *pTexture, const char *filena
 		delete _TEX_PAGE[page].id;
 	_TEX_PAGE[page].id = pTexture;
 	_TEX_PAGE[page].textureType = textureType;
+	_TEX_PAGE[page].asyncLoadPending = false;
+	_TEX_PAGE[page].loadFailed = false;
 
 	/* Send back the texpage number so we can store it in the IMD */
 	return page;
@@ -211,7 +221,25 @@ optional<size_t> iV_GetTexture(const char *filename, gfx_api::texture_type textu
 	const auto it = _NAME_TO_TEX_PAGE_MAP.find(filename);
 	if (it != _NAME_TO_TEX_PAGE_MAP.end())
 	{
-		return it->second;
+		size_t page = it->second;
+		if (_TEX_PAGE[page].asyncLoadPending)
+		{
+			// Still a placeholder from iV_GetTextureAsync - load it now (the asynchronous result is then discarded)
+			gfx_api::texture *pTexture = loadTextureHandleGraphicsOverrides(filename, textureType, maxWidth, maxHeight);
+			if (!pTexture)
+			{
+				debug(LOG_ERROR, "Failed to load %s", filename);
+				_TEX_PAGE[page].asyncLoadPending = false;
+				_TEX_PAGE[page].loadFailed = true;
+				return nullopt;
+			}
+			pie_AddTexPage_Impl(pTexture, filename, textureType, page);
+		}
+		if (_TEX_PAGE[page].loadFailed)
+		{
+			return nullopt;
+		}
+		return page;
 	}
 
 	gfx_api::texture *pTexture = loadTextureHandleGraphicsOverrides(filename, textureType, maxWidth, maxHeight);
@@ -226,6 +254,241 @@ optional<size_t> iV_GetTexture(const char *filename, gfx_api::texture_type textu
 	return optional<size_t>(page);
 }
 
+// MARK: - Asynchronous texture loading
+
+#define ASYNC_TEXTURE_THREADS 2
+// Bytes of texture data uploaded per frame by iV_ProcessAsyncTextureUploads (at least one texture is always uploaded)
+#define ASYNC_TEXTURE_UPLOAD_BUDGET (4 * 1024 * 1024)
+
+struct AsyncTextureRequest
+{
+	size_t page = 0;
+	uint32_t generation = 0;
+	std::string filename;
+	gfx_api::texture_type textureType = gfx_api::texture_type::game_texture;
+	int maxWidth = -1;
+	int maxHeight = -1;
+	std::vector<std::unique_ptr<iV_BaseImage>> images; ///< Filled in by a worker thread, empty if loading failed
+};
+
+// Decodes (and compresses) requested textures on worker threads, keeping the results until the main thread uploads them
+class AsyncTextureLoader
+{
+public:
+	~AsyncTextureLoader()
+	{
+		stop();
+	}
+
+	void request(AsyncTextureRequest &&request)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(std::move(request));
+		}
+		if (threads.empty())
+		{
+			size_t numThreads = std::min<size_t>(ASYNC_TEXTURE_THREADS, std::max(std::thread::hardware_concurrency(), 2u) - 1);
+			for (size_t i = 0; i < numThreads; ++i)
+			{
+				threads.emplace_back(&AsyncTextureLoader::loadTextures, this);
+			}
+		}
+		requestCond.notify_one();
+	}
+
+	/// Take the textures which have finished loading, up to (roughly) the given number of bytes
+	std::vector<AsyncTextureRequest> takeFinished(size_t budget)
+	{
+		std::vector<AsyncTextureRequest> result;
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t bytes = 0;
+		while (!finished.empty() && (result.empty() || bytes < budget))
+		{
+			for (const auto &image : finished.front().images)
+			{
+				bytes += image->data_size();
+			}
+			result.push_back(std::move(finished.front()));
+			finished.pop_front();
+		}
+		return result;
+	}
+
+	/// Stop the worker threads, discarding all requests and results
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			requests.clear();
+		}
+		requestCond.notify_all();
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+		threads.clear();
+		finished.clear();
+		stopping = false;
+	}
+
+private:
+	void loadTextures()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			requestCond.wait(lock, [this] { return stopping || !requests.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			AsyncTextureRequest request = std::move(requests.front());
+			requests.pop_front();
+			lock.unlock();
+			request.images = loadTextureImagesHandleGraphicsOverrides(request.filename.c_str(), request.textureType, request.maxWidth, request.maxHeight);
+			lock.lock();
+			finished.push_back(std::move(request));
+		}
+	}
+
+	static std::vector<std::unique_ptr<iV_BaseImage>> loadTextureImagesHandleGraphicsOverrides(const char *filename, gfx_api::texture_type textureType, int maxWidth, int maxHeight)
+	{
+		// Same search order as loadTextureHandleGraphicsOverrides
+		std::string loadPath = WZ_CURRENT_GRAPHICS_OVERRIDES_PREFIX "/texpages/";
+		loadPath += filename;
+		auto images = gfx_api::loadTextureImagesFromFile(loadPath.c_str(), textureType, maxWidth, maxHeight, true);
+		if (images.empty())
+		{
+			loadPath = "texpages/";
+			loadPath += filename;
+			images = gfx_api::loadTextureImagesFromFile(loadPath.c_str(), textureType, maxWidth, maxHeight);
+		}
+		return images;
+	}
+
+	std::mutex mutex;
+	std::condition_variable requestCond;
+	std::deque<AsyncTextureRequest> requests;
+	std::deque<AsyncTextureRequest> finished;
+	bool stopping = false;
+	std::vector<std::thread> threads;
+};
+
+static AsyncTextureLoader asyncTextureLoader;
+static uint32_t asyncTextureGeneration = 0; ///< Bumped by pie_TexShutDown, so results for old pages are dropped
+
+// Load the texture of a page on a worker thread, keeping its current texture until iV_ProcessAsyncTextureUploads replaces it
+static void requestAsyncTextureLoad(size_t page, int maxWidth, int maxHeight)
+{
+	_TEX_PAGE[page].asyncLoadPending = true;
+
+	AsyncTextureRequest request;
+	request.page = page;
+	request.generation = asyncTextureGeneration;
+	request.filename = _TEX_PAGE[page].filename;
+	request.textureType = _TEX_PAGE[page].textureType;
+	request.maxWidth = maxWidth;
+	request.maxHeight = maxHeight;
+	asyncTextureLoader.request(std::move(request));
+}
+
+// A tiny texture of a neutral colour for the texture type, shown until the real texture has been loaded
+static gfx_api::texture* createPlaceholderTexture(gfx_api::texture_type textureType, const char *filename)
+{
+	std::vector<unsigned char> colour;
+	switch (textureType)
+	{
+		case gfx_api::texture_type::alpha_mask:
+		case gfx_api::texture_type::specular_map:
+		case gfx_api::texture_type::height_map:
+			colour = {0};
+			break;
+		case gfx_api::texture_type::normal_map:
+			colour = {128, 128, 255};
+			break;
+		default:
+			colour = {128, 128, 128, 255};
+			break;
+	}
+
+	const unsigned int size = 4;
+	iV_Image image;
+	if (!image.allocate(size, size, static_cast<unsigned int>(colour.size())))
+	{
+		return nullptr;
+	}
+	unsigned char *pixels = image.bmp_w();
+	for (size_t i = 0; i < size * size; ++i)
+	{
+		std::copy(colour.begin(), colour.end(), pixels + i * colour.size());
+	}
+	return gfx_api::context::get().loadTextureFromUncompressedImage(std::move(image), textureType, std::string(filename) + " (placeholder)");
+}
+
+/** Like iV_GetTexture, but returns without loading the texture: until it has been decoded on a worker
+ *  thread and uploaded by iV_ProcessAsyncTextureUploads, the page holds a placeholder.
+ */
+optional<size_t> iV_GetTextureAsync(const char *filename, gfx_api::texture_type textureType, int maxWidth /*= -1*/, int maxHeight /*= -1*/)
+{
+	ASSERT(filename != nullptr, "filename must not be null");
+
+	/* Have we already loaded (or requested) this one then? */
+	const auto it = _NAME_TO_TEX_PAGE_MAP.find(filename);
+	if (it != _NAME_TO_TEX_PAGE_MAP.end())
+	{
+		if (_TEX_PAGE[it->second].loadFailed)
+		{
+			return nullopt;
+		}
+		return it->second;
+	}
+
+	gfx_api::texture *pPlaceholder = createPlaceholderTexture(textureType, filename);
+	if (!pPlaceholder)
+	{
+		// Shouldn't happen - but fall back to loading it right away
+		return iV_GetTexture(filename, textureType, maxWidth, maxHeight);
+	}
+
+	size_t page = pie_AddTexPage(pPlaceholder, filename, textureType);
+	requestAsyncTextureLoad(page, maxWidth, maxHeight);
+	return page;
+}
+
+void iV_ProcessAsyncTextureUploads()
+{
+	for (AsyncTextureRequest &request : asyncTextureLoader.takeFinished(ASYNC_TEXTURE_UPLOAD_BUDGET))
+	{
+		if (request.generation != asyncTextureGeneration || request.page >= _TEX_PAGE.size())
+		{
+			continue;
+		}
+		iTexPage &texPage = _TEX_PAGE[request.page];
+		if (!texPage.asyncLoadPending || texPage.filename != request.filename)
+		{
+			continue; // already loaded synchronously, or replaced
+		}
+		if (request.images.empty())
+		{
+			debug(LOG_ERROR, "Failed to load %s, keeping its placeholder", request.filename.c_str());
+			texPage.asyncLoadPending = false;
+			texPage.loadFailed = true;
+			continue;
+		}
+		gfx_api::texture *pTexture = gfx_api::context::get().loadTextureFromImages(request.images, request.filename);
+		if (!pTexture)
+		{
+			debug(LOG_ERROR, "Failed to upload %s, keeping its placeholder", request.filename.c_str());
+			texPage.asyncLoadPending = false;
+			texPage.loadFailed = true;
+			continue;
+		}
+		pie_AddTexPage_Impl(pTexture, request.filename.c_str(), texPage.textureType, request.page);
+	}
+}
+
 bool replaceTexture(const WzString &oldfile, const WzString &newfile)
 {
 	// Load new one to replace it
@@ -252,19 +515,11 @@ bool replaceTexture(const WzString &oldfile, const WzString &newfile)
 
 bool debugReloadTexturesFromDisk(const std::unordered_set<size_t>& texPages)
 {
-	std::string filename;
+	// The current textures stay in use until the reloaded ones have been decoded on the worker threads
 	for (auto page : texPages)
 	{
-		gfx_api::texture_type existingTextureType = _TEX_PAGE[page].textureType;
-		filename = _TEX_PAGE[page].filename;
-		debug(LOG_TEXTURE, "Reloading texture %s from index %zu", filename.c_str(), page);
-		gfx_api::texture *pTexture = loadTextureHandleGraphicsOverrides(filename.c_str(), existingTextureType);
-		if (!pTexture)
-		{
-			debug(LOG_INFO, "Failed to reload texture: %s", filename.c_str());
-			continue;
-		}
-		pie_AddTexPage(pTexture, filename.c_str(), existingTextureType, page);
+		debug(LOG_TEXTURE, "Reloading texture %s from index %zu", _TEX_PAGE[page].filename.c_str(), page);
+		requestAsyncTextureLoad(page, -1, -1);
 	}
 	return true;
 }
@@ -273,6 +528,8 @@ void pie_TexShutDown()
 {
 	// TODO, lazy deletions for faster loading of next level
 	debug(LOG_TEXTURE, "Cleaning out %u textures", static_cast<unsigned>(_TEX_PAGE.size()));
+	asyncTextureLoader.stop();
+	++asyncTextureGeneration;
 	_TEX_PAGE.clear();
 	_NAME_TO_TEX_PAGE_MAP.clear();
 }
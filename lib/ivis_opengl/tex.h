@@ -45,6 +45,9 @@ void pie_AssignTexture(size_t page, gfx_api::texture* texture);
 //*************************************************************************
 
 optional<size_t> iV_GetTexture(const char *filename, gfx_api::texture_type textureType, int maxWidth = -1, int maxHeight = -1);
+optional<size_t> iV_GetTextureAsync(const char *filename, gfx_api::texture_type textureType, int maxWidth = -1, int maxHeight = -1);
+/// Upload textures loaded for iV_GetTextureAsync, within a per-frame budget. Called at the start of every frame.
+void iV_ProcessAsyncTextureUploads();
 void iV_unloadImage(iV_Image *image);
 gfx_api::pixel_format iV_getPixelFormat(const iV_Image *image);
 
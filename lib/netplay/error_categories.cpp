@@ -31,6 +31,10 @@
 
 #include <zlib.h>
 
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+# include <zstd_errors.h>
+#endif
+
 std::string GenericSystemErrorCategory::message(int ev) const
 {
 #if defined(WZ_OS_WIN)
@@ -122,6 +126,15 @@ std::string ZlibErrorCategory::message(int ev) const
 	}
 }
 
+std::string ZstdErrorCategory::message(int ev) const
+{
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+	return ZSTD_getErrorString(static_cast<ZSTD_ErrorCode>(ev));
+#else
+	return "zstd error " + std::to_string(ev);
+#endif
+}
+
 const std::error_category& generic_system_error_category()
 {
 	static GenericSystemErrorCategory instance;
@@ -140,6 +153,12 @@ const std::error_category& zlib_error_category()
 	return instance;
 }
 
+const std::error_category& zstd_error_category()
+{
+	static ZstdErrorCategory instance;
+	return instance;
+}
+
 std::error_code make_network_error_code(int ev)
 {
 	return { ev, generic_system_error_category() };
@@ -154,3 +173,8 @@ std::error_code make_zlib_error_code(int ev)
 {
 	return { ev, zlib_error_category() };
 }
+
+std::error_code make_zstd_error_code(int ev)
+{
+	return { ev, zstd_error_category() };
+}
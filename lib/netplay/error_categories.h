@@ -88,10 +88,30 @@ public:
 	std::string message(int ev) const override;
 };
 
+/// <summary>
+/// Custom error category which maps the error codes from zstd (`ZSTD_getErrorCode()`) to
+/// the appropriate error messages.
+/// </summary>
+class ZstdErrorCategory : public std::error_category
+{
+public:
+
+	constexpr ZstdErrorCategory() = default;
+
+	const char* name() const noexcept override
+	{
+		return "zstd";
+	}
+
+	std::string message(int ev) const override;
+};
+
 const std::error_category& generic_system_error_category();
 const std::error_category& getaddrinfo_error_category();
 const std::error_category& zlib_error_category();
+const std::error_category& zstd_error_category();
 
 std::error_code make_network_error_code(int ev);
 std::error_code make_getaddrinfo_error_code(int ev);
 std::error_code make_zlib_error_code(int ev);
+std::error_code make_zstd_error_code(int ev);
@@ -19,6 +19,7 @@
 */
 // ////////////////////////////////////////////////////////////////////////
 // Includes
+#include <nlohmann/json.hpp> // Must come before WZ includes
 #include "lib/framework/frame.h"
 
 #include <time.h>
@@ -30,30 +31,66 @@
 #include "netplay.h"
 #include "netpermissions.h"
 
+#include <algorithm>
+#include <atomic>
+
 // ////////////////////////////////////////////////////////////////////////
 // Logging for debug only
 // ////////////////////////////////////////////////////////////////////////
 
 #define NUM_GAME_PACKETS 256
+#define NUM_LATENCY_BUCKETS 10
+
+// Upper limits (exclusive) of the round trip time buckets, in milliseconds. The last bucket takes everything else.
+static const uint32_t latencyBucketLimits[NUM_LATENCY_BUCKETS - 1] = {25, 50, 75, 100, 150, 200, 300, 500, 1000};
 
 static PHYSFS_file	*pFileHandle = nullptr;
-static uint32_t		packetcount[2][NUM_GAME_PACKETS];
-static uint32_t		packetsize[2][NUM_GAME_PACKETS];
+static std::atomic<uint64_t>	packetcount[2][NUM_GAME_PACKETS];
+static std::atomic<uint64_t>	packetsize[2][NUM_GAME_PACKETS];
+static std::atomic<uint32_t>	latencyHistogram[MAX_CONNECTED_PLAYERS][NUM_LATENCY_BUCKETS];
+static std::atomic<size_t>	incompleteBytesLast[MAX_CONNECTED_PLAYERS], incompleteBytesMax[MAX_CONNECTED_PLAYERS];
+static std::atomic<size_t>	pendingGameTimeLast[MAX_CONNECTED_PLAYERS], pendingGameTimeMax[MAX_CONNECTED_PLAYERS];
+
+static void resetTelemetry()
+{
+	for (int i = 0; i < NUM_GAME_PACKETS; i++)
+	{
+		packetcount[0][i].store(0, std::memory_order_relaxed);
+		packetsize[0][i].store(0, std::memory_order_relaxed);
+		packetcount[1][i].store(0, std::memory_order_relaxed);
+		packetsize[1][i].store(0, std::memory_order_relaxed);
+	}
+	for (int player = 0; player < MAX_CONNECTED_PLAYERS; player++)
+	{
+		for (auto &bucket : latencyHistogram[player])
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		incompleteBytesLast[player].store(0, std::memory_order_relaxed);
+		incompleteBytesMax[player].store(0, std::memory_order_relaxed);
+		pendingGameTimeLast[player].store(0, std::memory_order_relaxed);
+		pendingGameTimeMax[player].store(0, std::memory_order_relaxed);
+	}
+}
+
+static void storeMax(std::atomic<size_t> &max, size_t value)
+{
+	size_t old = max.load(std::memory_order_relaxed);
+	while (value > old && !max.compare_exchange_weak(old, value, std::memory_order_relaxed)) {}
+}
+
+static uint64_t relaxed(const std::atomic<uint64_t> &value)
+{
+	return value.load(std::memory_order_relaxed);
+}
 
 bool NETstartLogging(void)
 {
 	time_t aclock;
 	char buf[256];
 	static char filename[256] = {'\0'};
-	int i;
 
-	for (i = 0; i < NUM_GAME_PACKETS; i++)
-	{
-		packetcount[0][i] = 0;
-		packetsize[0][i] = 0;
-		packetcount[1][i] = 0;
-		packetsize[1][i] = 0;
-	}
+	resetTelemetry();
 
 	time(&aclock);                   /* Get time in seconds */
 	auto newtime = getLocalTime(aclock);    /* Convert time to struct */
@@ -76,7 +113,7 @@ bool NETstopLogging(void)
 	static const char dash_line[] = "-----------------------------------------------------------\n";
 	char buf[256];
 	int i;
-	UDWORD totalBytessent = 0, totalBytesrecv = 0, totalPacketsent = 0, totalPacketrecv = 0;
+	uint64_t totalBytessent = 0, totalBytesrecv = 0, totalPacketsent = 0, totalPacketrecv = 0;
 
 	if (!pFileHandle)
 	{
@@ -92,19 +129,40 @@ bool NETstopLogging(void)
 		}
 		else
 		{
-			snprintf(buf, sizeof(buf), "%-24s:\t received %u times, %u bytes; sent %u times, %u bytes\n", messageTypeToString(i),
-			         packetcount[1][i], packetsize[1][i], packetcount[0][i], packetsize[0][i]);
+			snprintf(buf, sizeof(buf), "%-24s:\t received %" PRIu64 " times, %" PRIu64 " bytes; sent %" PRIu64 " times, %" PRIu64 " bytes\n", messageTypeToString(i),
+			         relaxed(packetcount[1][i]), relaxed(packetsize[1][i]), relaxed(packetcount[0][i]), relaxed(packetsize[0][i]));
 		}
 		WZ_PHYSFS_writeBytes(pFileHandle, buf, static_cast<PHYSFS_uint32>(strlen(buf)));
-		totalBytessent += packetsize[0][i];
-		totalBytesrecv += packetsize[1][i];
-		totalPacketsent += packetcount[0][i];
-		totalPacketrecv += packetcount[1][i];
+		totalBytessent += relaxed(packetsize[0][i]);
+		totalBytesrecv += relaxed(packetsize[1][i]);
+		totalPacketsent += relaxed(packetcount[0][i]);
+		totalPacketrecv += relaxed(packetcount[1][i]);
 	}
-	snprintf(buf, sizeof(buf), "== Total bytes sent %u, Total bytes received %u ==\n", totalBytessent, totalBytesrecv);
+	snprintf(buf, sizeof(buf), "== Total bytes sent %" PRIu64 ", Total bytes received %" PRIu64 " ==\n", totalBytessent, totalBytesrecv);
 	WZ_PHYSFS_writeBytes(pFileHandle, buf, static_cast<PHYSFS_uint32>(strlen(buf)));
-	snprintf(buf, sizeof(buf), "== Total packets sent %u, recv %u ==\n", totalPacketsent, totalPacketrecv);
+	snprintf(buf, sizeof(buf), "== Total packets sent %" PRIu64 ", recv %" PRIu64 " ==\n", totalPacketsent, totalPacketrecv);
 	WZ_PHYSFS_writeBytes(pFileHandle, buf, static_cast<PHYSFS_uint32>(strlen(buf)));
+	snprintf(buf, sizeof(buf), "\n-Latency and queue statistics -\n");
+	WZ_PHYSFS_writeBytes(pFileHandle, buf, static_cast<PHYSFS_uint32>(strlen(buf)));
+	WZ_PHYSFS_writeBytes(pFileHandle, dash_line, static_cast<PHYSFS_uint32>(strlen(dash_line)));
+	for (int player = 0; player < MAX_CONNECTED_PLAYERS; player++)
+	{
+		std::string histogram;
+		uint32_t samples = 0;
+		for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; bucket++)
+		{
+			uint32_t count = latencyHistogram[player][bucket].load(std::memory_order_relaxed);
+			samples += count;
+			histogram += bucket < NUM_LATENCY_BUCKETS - 1 ? astringf(" <%u:%u", latencyBucketLimits[bucket], count) : astringf(" more:%u", count);
+		}
+		if (samples == 0 && incompleteBytesMax[player].load(std::memory_order_relaxed) == 0 && pendingGameTimeMax[player].load(std::memory_order_relaxed) == 0)
+		{
+			continue;
+		}
+		snprintf(buf, sizeof(buf), "player %d: round trip ms%s; max incomplete bytes %zu; max pending game time updates %zu\n", player, histogram.c_str(),
+		         incompleteBytesMax[player].load(std::memory_order_relaxed), pendingGameTimeMax[player].load(std::memory_order_relaxed));
+		WZ_PHYSFS_writeBytes(pFileHandle, buf, static_cast<PHYSFS_uint32>(strlen(buf)));
+	}
 	snprintf(buf, sizeof(buf), "\n-Sync statistics -\n");
 	WZ_PHYSFS_writeBytes(pFileHandle, buf, static_cast<PHYSFS_uint32>(strlen(buf)));
 	WZ_PHYSFS_writeBytes(pFileHandle, dash_line, static_cast<PHYSFS_uint32>(strlen(dash_line)));
@@ -151,8 +209,83 @@ bool NETstopLogging(void)
 void NETlogPacket(uint8_t type, uint32_t size, bool received)
 {
 	STATIC_ASSERT((1 << (8 * sizeof(type))) == NUM_GAME_PACKETS); // NUM_GAME_PACKETS must be larger than maximum possible type.
-	packetcount[received][type]++;
-	packetsize[received][type] += size;
+	packetcount[received][type].fetch_add(1, std::memory_order_relaxed);
+	packetsize[received][type].fetch_add(size, std::memory_order_relaxed);
+}
+
+void NETlogLatency(uint8_t player, uint32_t roundTripMs)
+{
+	ASSERT_OR_RETURN(, player < MAX_CONNECTED_PLAYERS, "Invalid player: %u", static_cast<unsigned>(player));
+	size_t bucket = static_cast<size_t>(std::upper_bound(latencyBucketLimits, latencyBucketLimits + NUM_LATENCY_BUCKETS - 1, roundTripMs) - latencyBucketLimits);
+	latencyHistogram[player][bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void NETlogQueueDepth(uint8_t player, size_t incompleteBytes, size_t pendingGameTimeUpdates)
+{
+	ASSERT_OR_RETURN(, player < MAX_CONNECTED_PLAYERS, "Invalid player: %u", static_cast<unsigned>(player));
+	incompleteBytesLast[player].store(incompleteBytes, std::memory_order_relaxed);
+	storeMax(incompleteBytesMax[player], incompleteBytes);
+	pendingGameTimeLast[player].store(pendingGameTimeUpdates, std::memory_order_relaxed);
+	storeMax(pendingGameTimeMax[player], pendingGameTimeUpdates);
+}
+
+nlohmann::json NETlogTelemetryJSON()
+{
+	nlohmann::json types = nlohmann::json::array();
+	for (int i = 0; i < NUM_GAME_PACKETS; i++)
+	{
+		if (relaxed(packetcount[0][i]) == 0 && relaxed(packetcount[1][i]) == 0)
+		{
+			continue;
+		}
+		nlohmann::json type = nlohmann::json::object();
+		type["type"] = messageTypeToString(i);
+		type["sent"] = {{"count", relaxed(packetcount[0][i])}, {"bytes", relaxed(packetsize[0][i])}};
+		type["recv"] = {{"count", relaxed(packetcount[1][i])}, {"bytes", relaxed(packetsize[1][i])}};
+		types.push_back(std::move(type));
+	}
+
+	nlohmann::json players = nlohmann::json::array();
+	for (int player = 0; player < MAX_CONNECTED_PLAYERS; player++)
+	{
+		nlohmann::json histogram = nlohmann::json::array();
+		uint32_t samples = 0;
+		for (const auto &bucket : latencyHistogram[player])
+		{
+			uint32_t count = bucket.load(std::memory_order_relaxed);
+			samples += count;
+			histogram.push_back(count);
+		}
+		// Totals of our direct connection to the player (all 0 if there is none)
+		auto connectionStats = [player](bool sent) {
+			return nlohmann::json {
+				{"bytes", NETgetConnectionStatistic(player, NetStatisticRawBytes, sent)},
+				{"uncompressedBytes", NETgetConnectionStatistic(player, NetStatisticUncompressedBytes, sent)},
+				{"packets", NETgetConnectionStatistic(player, NetStatisticPackets, sent)},
+				{"compressionUs", NETgetConnectionStatistic(player, NetStatisticCompressionTime, sent)}
+			};
+		};
+		nlohmann::json connection = {{"sent", connectionStats(true)}, {"recv", connectionStats(false)}};
+		bool hasConnection = connection["sent"]["packets"].get<size_t>() != 0 || connection["recv"]["packets"].get<size_t>() != 0;
+		if (samples == 0 && incompleteBytesMax[player].load(std::memory_order_relaxed) == 0 && pendingGameTimeMax[player].load(std::memory_order_relaxed) == 0 && !hasConnection)
+		{
+			continue;
+		}
+		nlohmann::json j = nlohmann::json::object();
+		j["player"] = player;
+		j["rtt"] = std::move(histogram);
+		j["incompleteBytes"] = {{"last", incompleteBytesLast[player].load(std::memory_order_relaxed)}, {"max", incompleteBytesMax[player].load(std::memory_order_relaxed)}};
+		j["pendingGameTime"] = {{"last", pendingGameTimeLast[player].load(std::memory_order_relaxed)}, {"max", pendingGameTimeMax[player].load(std::memory_order_relaxed)}};
+		j["connection"] = std::move(connection);
+		players.push_back(std::move(j));
+	}
+
+	nlohmann::json root = nlohmann::json::object();
+	root["ver"] = 1;
+	root["rttLimits"] = latencyBucketLimits;
+	root["types"] = std::move(types);
+	root["players"] = std::move(players);
+	return root;
 }
 
 bool NETlogEntry(const char *str, UDWORD a, UDWORD b)
@@ -24,10 +24,18 @@
 #include "lib/framework/wzglobal.h"
 
 #include <stdint.h>
+#include <stddef.h>
+
+#include <nlohmann/json_fwd.hpp>
 
 bool NETstartLogging();
 bool NETstopLogging();
 WZ_DECL_NONNULL(1) bool NETlogEntry(const char *str, UDWORD a, UDWORD b);
 void NETlogPacket(uint8_t type, uint32_t size, bool received);
 
+// Telemetry, counted whether or not a log file is open, and reset by NETstartLogging(). The counters are relaxed atomics, so they can be read from any thread.
+void NETlogLatency(uint8_t player, uint32_t roundTripMs);                                        ///< Adds a ping round trip to the histogram of the player.
+void NETlogQueueDepth(uint8_t player, size_t incompleteBytes, size_t pendingGameTimeUpdates);    ///< Samples the receive queues of the player.
+nlohmann::json NETlogTelemetryJSON();                                                             ///< Per-message-type counts and bytes, and per-player latency histograms, queue depths and connection totals.
+
 #endif // _netlog_h
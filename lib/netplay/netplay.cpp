@@ -28,6 +28,7 @@
 #include "lib/framework/string_ext.h"
 #include "lib/framework/crc.h"
 #include "lib/framework/file.h"
+#include "lib/framework/math_ext.h"
 #include "lib/gamelib/gtime.h"
 #include "lib/exceptionhandler/dumpinfo.h"
 #include "src/console.h"
@@ -119,6 +120,7 @@ struct NETSTATS  // data regarding the last one second or so.
 	Statistic       rawBytes;               // Number of actual bytes, in about 1 sec.
 	Statistic       uncompressedBytes;      // Number of bytes sent, before compression, in about 1 sec.
 	Statistic       packets;                // Number of calls to writeAll, in about 1 sec.
+	Statistic       compressionTime;        // Microseconds spent compressing (sent) and decompressing (received), in about 1 sec.
 };
 
 struct NET_PLAYER_DATA
@@ -227,6 +229,16 @@ static GAMESTRUCT	gamestruct;
 
 static std::vector<WZFile> DownloadingWzFiles;
 
+// Interrupted downloads, which are continued instead of restarted if the same file is requested again, such as after reconnecting.
+struct PartialWzFile
+{
+	std::string filename;
+	Sha256 hash;
+	uint32_t size;
+	uint32_t pos;
+};
+static std::vector<PartialWzFile> PartialWzFiles;
+
 // update flags
 bool netPlayersUpdated;
 
@@ -251,7 +263,7 @@ struct TmpSocketInfo
 {
 	std::string ip;
 	std::chrono::steady_clock::time_point connectTime;
-	char buffer[10] = {'\0'};
+	char buffer[16] = {'\0'};
 	size_t usedBuffer = 0;
 	std::vector<uint8_t> connectChallenge;
 	enum class TmpConnectState
@@ -313,10 +325,10 @@ static int32_t          NetGameFlags[4] = { 0, 0, 0, 0 };
 char iptoconnect[PATH_MAX] = "\0"; // holds IP/hostname from command line
 bool cliConnectToIpAsSpectator = false; // for cli option
 
-static NETSTATS nStats              = {{0, 0}, {0, 0}, {0, 0}};
-static NETSTATS nStatsLastSec       = {{0, 0}, {0, 0}, {0, 0}};
-static NETSTATS nStatsSecondLastSec = {{0, 0}, {0, 0}, {0, 0}};
-static const NETSTATS nZeroStats    = {{0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStats              = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStatsLastSec       = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStatsSecondLastSec = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static const NETSTATS nZeroStats    = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
 static int nStatsLastUpdateTime = 0;
 
 unsigned NET_PlayerConnectionStatus[CONNECTIONSTATUS_NORMAL][MAX_CONNECTED_PLAYERS];
@@ -347,19 +359,70 @@ void NET_addDownloadingWZFile(WZFile&& newFile)
 	DownloadingWzFiles.push_back(std::move(newFile));
 }
 
-void NET_clearDownloadingWZFiles()
+// Keeps the data received so far of files which are being downloaded, to continue the downloads later.
+static void rememberPartialDownloads()
 {
-	// if we were in a middle of transferring a file, then close the file handle
 	for (auto &file : DownloadingWzFiles)
 	{
 		debug(LOG_NET, "closing aborted file");
 		file.closeFile();
 		ASSERT(!file.filename.empty(), "filename must not be empty");
-		PHYSFS_delete(file.filename.c_str()); 		// delete incomplete (map) file
+		if (file.pos == 0 || file.pos >= file.size)
+		{
+			PHYSFS_delete(file.filename.c_str()); 		// delete incomplete (map) file
+			continue;
+		}
+		PartialWzFiles.erase(std::remove_if(PartialWzFiles.begin(), PartialWzFiles.end(), [&](PartialWzFile const &partial) { return partial.filename == file.filename; }), PartialWzFiles.end());
+		PartialWzFiles.push_back({file.filename, file.hash, file.size, file.pos});
 	}
 	DownloadingWzFiles.clear();
 }
 
+static void deletePartialDownloads()
+{
+	for (auto &partial : PartialWzFiles)
+	{
+		PHYSFS_delete(partial.filename.c_str());
+	}
+	PartialWzFiles.clear();
+}
+
+WZFile NET_openDownloadWZFile(const std::string &filename, const Sha256 &hash)
+{
+	auto partial = std::find_if(PartialWzFiles.begin(), PartialWzFiles.end(), [&](PartialWzFile const &partial) { return partial.filename == filename; });
+	if (partial != PartialWzFiles.end())
+	{
+		PartialWzFile resumed = *partial;
+		PartialWzFiles.erase(partial);
+		PHYSFS_file *fileHandle = nullptr;
+		if (resumed.hash == hash && PHYSFS_exists(filename.c_str()) && (fileHandle = PHYSFS_openAppend(filename.c_str())) != nullptr)
+		{
+			if (PHYSFS_tell(fileHandle) == static_cast<PHYSFS_sint64>(resumed.pos))
+			{
+				debug(LOG_INFO, "Continuing download of %s at %" PRIu32 " of %" PRIu32 " bytes", filename.c_str(), resumed.pos, resumed.size);
+				WZFile file(fileHandle, filename, hash, resumed.size);
+				file.pos = resumed.pos;
+				return file;
+			}
+			PHYSFS_close(fileHandle);
+		}
+		debug(LOG_INFO, "Restarting download of %s, since the partial file changed", filename.c_str());
+	}
+
+	PHYSFS_file *fileHandle = PHYSFS_openWrite(filename.c_str());
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_ERROR, "Failed to open %s for writing: %s", filename.c_str(), WZ_PHYSFS_getLastError());
+	}
+	return WZFile(fileHandle, filename, hash);
+}
+
+void NET_clearDownloadingWZFiles()
+{
+	// if we were in a middle of transferring a file, then close the file handle, but keep what was received
+	rememberPartialDownloads();
+}
+
 NETPLAY::NETPLAY()
 {
 	players.resize(MAX_CONNECTED_PLAYERS);
@@ -715,7 +778,7 @@ void NET_InitPlayers(bool initTeams, bool initSpectator)
 
 	NetPlay.hostPlayer = NET_HOST_ONLY;	// right now, host starts always at index zero
 	NetPlay.playercount = 0;
-	DownloadingWzFiles.clear();
+	rememberPartialDownloads();
 	NET_waitingForIndexChangeAckSince = std::vector<optional<uint32_t>>(MAX_CONNECTED_PLAYERS, nullopt);
 	debug(LOG_NET, "Players initialized");
 }
@@ -1581,6 +1644,8 @@ int NETshutdown()
 	NetPlay.MOTD = nullptr;
 	NETdeleteQueue();
 	SOCKETshutdown();
+	rememberPartialDownloads();
+	deletePartialDownloads();
 
 	// Reset net usage statistics.
 	nStats = nZeroStats;
@@ -1685,9 +1750,15 @@ size_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal)
 	case NetStatisticRawBytes:          statsType = &NETSTATS::rawBytes;          break;
 	case NetStatisticUncompressedBytes: statsType = &NETSTATS::uncompressedBytes; break;
 	case NetStatisticPackets:           statsType = &NETSTATS::packets;           break;
+	case NetStatisticCompressionTime:   statsType = &NETSTATS::compressionTime;   break;
 	default: ASSERT(false, " "); return 0;
 	}
 
+	// The sockets time the compression themselves.
+	const SocketStatistics &socketTotals = socketTotalStatistics();
+	nStats.compressionTime.sent     = static_cast<size_t>(socketTotals.compressMicroseconds);
+	nStats.compressionTime.received = static_cast<size_t>(socketTotals.decompressMicroseconds);
+
 	int time = wzGetTicks();
 	if ((unsigned)(time - nStatsLastUpdateTime) >= (unsigned)GAME_TICKS_PER_SEC)
 	{
@@ -1703,6 +1774,28 @@ size_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal)
 	return nStatsLastSec.*statsType.*statisticType - nStatsSecondLastSec.*statsType.*statisticType;
 }
 
+// ////////////////////////////////////////////////////////////////////////
+// return totals of the connection to a player.
+size_t NETgetConnectionStatistic(uint32_t player, NetStatisticType type, bool sent)
+{
+	ASSERT_OR_RETURN(0, player < MAX_CONNECTED_PLAYERS, "Invalid player: %" PRIu32, player);
+	Socket *sock = NetPlay.isHost ? connected_bsocket[player] : (player == NetPlay.hostPlayer ? bsocket : nullptr);
+	if (sock == nullptr)
+	{
+		return 0;  // No direct connection to this player.
+	}
+
+	const SocketStatistics &stats = socketStatistics(*sock);
+	switch (type)
+	{
+	case NetStatisticRawBytes:          return sent ? stats.compressedBytesSent : stats.compressedBytesReceived;
+	case NetStatisticUncompressedBytes: return sent ? stats.uncompressedBytesSent : stats.uncompressedBytesReceived;
+	case NetStatisticPackets:           return sent ? stats.packetsSent : stats.packetsReceived;
+	case NetStatisticCompressionTime:   return static_cast<size_t>(sent ? stats.compressMicroseconds : stats.decompressMicroseconds);
+	default: ASSERT(false, " "); return 0;
+	}
+}
+
 static std::set<uint32_t> netSendPendingDisconnectPlayerIndexes;
 
 void NETsendProcessDelayedActions()
@@ -1762,6 +1855,8 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 
 	if (NetPlay.isHost)
 	{
+		// Serialised once, when there is a first recipient. Every recipient gets the same buffer.
+		std::shared_ptr<const std::vector<uint8_t>> rawData;
 		int firstPlayer = player == NET_ALL_PLAYERS ? 0                         : player;
 		int lastPlayer  = player == NET_ALL_PLAYERS ? MAX_CONNECTED_PLAYERS - 1 : player;
 		for (player = firstPlayer; player <= lastPlayer; ++player)
@@ -1769,17 +1864,14 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 			// We are the host, send directly to player.
 			if (sockets[player] != nullptr && player != queue.exclude)
 			{
-				uint8_t *rawData = message->rawDataDup();
 				if (!rawData)
 				{
-					debug(LOG_FATAL, "Failed to allocate raw data (message type: %" PRIu8 ", player: %d)", message->type, player);
-					abort();
+					rawData = message->rawDataShared();
 				}
-				ssize_t rawLen   = message->rawLen();
+				ssize_t rawLen   = rawData->size();
 				size_t compressedRawLen;
-				const auto writeResult = writeAll(*sockets[player], rawData, rawLen, &compressedRawLen);
+				const auto writeResult = writeAll(*sockets[player], rawData, &compressedRawLen);
 				const auto res = writeResult.value_or(SOCKET_ERROR);
-				delete[] rawData;  // Done with the data.
 
 				if (res == rawLen)
 				{
@@ -1807,12 +1899,11 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 		// We are a client, send directly to player, who happens to be the host.
 		if (bsocket)
 		{
-			uint8_t *rawData = message->rawDataDup();
-			ssize_t rawLen   = message->rawLen();
+			std::shared_ptr<const std::vector<uint8_t>> rawData = message->rawDataShared();
+			ssize_t rawLen   = rawData->size();
 			size_t compressedRawLen;
-			const auto writeResult = writeAll(*bsocket, rawData, rawLen, &compressedRawLen);
+			const auto writeResult = writeAll(*bsocket, rawData, &compressedRawLen);
 			const auto res = writeResult.value_or(SOCKET_ERROR);
-			delete[] rawData;  // Done with the data.
 
 			if (res == rawLen)
 			{
@@ -2257,6 +2348,7 @@ static inline bool NETFilterMessageWhileSwappingPlayer(uint8_t sender, uint8_t t
 	// client messages to be processed normally
 	case NET_FILE_REQUESTED:             ///< Player has requested a file (map/mod/?)
 	case NET_FILE_CANCELLED:             ///< Player cancelled a file request
+	case NET_FILE_ACK:                   ///< Player has received a file up to some position
 		return false; // process normally (do *not* filter)
 
 	// host-only messages
@@ -2387,6 +2479,7 @@ static bool NETprocessSystemMessage(NETQUEUE playerQueue, uint8_t *type)
 				      || message->type == NET_POSITIONREQUEST
 					  || message->type == NET_FACTIONREQUEST
 				      || message->type == NET_FILE_CANCELLED
+				      || message->type == NET_FILE_ACK
 					  || message->type == NET_DATA_CHECK
 				      || message->type == NET_JOIN
 				      || message->type == NET_PLAYERNAME_CHANGEREQUEST
@@ -2952,25 +3045,51 @@ bool NETrecvGame(NETQUEUE *queue, uint8_t *type)
 
 // ////////////////////////////////////////////////////////////////////////
 // File Transfer programs.
-/** Send file. It returns % of file sent when 100 it's complete. Call until it returns 100.
+/** Send file. It returns % of file sent when 100 it's complete. Call until it returns 100, and only while !NETfileTransferWindowFull().
 *  @TODO: more error checking (?) different file types (?)
 *          Maybe should close file handle, and seek each time?
 *
-*  @NOTE: MAX_FILE_TRANSFER_PACKET is set to 2k per packet since 7*2 = 14K which is pretty
-*         much our limit.  Don't screw with that without having a bigger buffer!
-*         NET_BUFFER_SIZE is at 16k.  (also remember text chat, plus all the other cruff)
+*  @NOTE: The receiver acknowledges each chunk with NET_FILE_ACK. The unacknowledged data is limited to a window of
+*         twice the measured throughput times the smallest round-trip time, so the transfer keeps the connection busy
+*         without queueing so much that other lobby messages have to wait for it. Chunks grow with the window, but stay
+*         well below MaxMsgSize.
 */
-#define MAX_FILE_TRANSFER_PACKET 2048
+#define FILE_TRANSFER_MIN_CHUNK 2048
+#define FILE_TRANSFER_MAX_CHUNK 8192
+#define FILE_TRANSFER_CHUNKS_PER_WINDOW 8
+#define FILE_TRANSFER_MIN_WINDOW (FILE_TRANSFER_CHUNKS_PER_WINDOW * FILE_TRANSFER_MIN_CHUNK)
+#define FILE_TRANSFER_INITIAL_WINDOW (64 * 1024)
+#define FILE_TRANSFER_MAX_WINDOW (1024 * 1024)
+
+static uint32_t fileTransferChunkSize(WZFile const &file)
+{
+	return clip<uint32_t>(file.window / FILE_TRANSFER_CHUNKS_PER_WINDOW, FILE_TRANSFER_MIN_CHUNK, FILE_TRANSFER_MAX_CHUNK);
+}
+
+bool NETfileTransferWindowFull(WZFile const &file)
+{
+	return file.window != 0 && file.pos - file.ackedPos >= file.window;
+}
+
 int NETsendFile(WZFile &file, unsigned player)
 {
 	ASSERT_OR_RETURN(100, NetPlay.isHost, "Trying to send a file and we are not the host!");
 	ASSERT_OR_RETURN(100, file.handle() != nullptr, "Null file handle");
 
-	uint8_t inBuff[MAX_FILE_TRANSFER_PACKET];
-	memset(inBuff, 0x0, sizeof(inBuff));
+	auto now = std::chrono::steady_clock::now();
+	if (file.window == 0)
+	{
+		// First chunk. The transfer may start in the middle of the file, if the receiver resumes a download.
+		file.window = FILE_TRANSFER_INITIAL_WINDOW;
+		file.ackedPos = file.pos;
+		file.rateStartPos = file.pos;
+		file.rateStartTime = now;
+	}
+
+	uint8_t inBuff[FILE_TRANSFER_MAX_CHUNK];
 
 	// read some bytes.
-	PHYSFS_sint64 readBytesResult = WZ_PHYSFS_readBytes(file.handle(), inBuff, MAX_FILE_TRANSFER_PACKET);
+	PHYSFS_sint64 readBytesResult = WZ_PHYSFS_readBytes(file.handle(), inBuff, fileTransferChunkSize(file));
 	if (readBytesResult < 0)
 	{
 		ASSERT(readBytesResult >= 0, "Error reading file.");
@@ -2988,6 +3107,12 @@ int NETsendFile(WZFile &file, unsigned player)
 	NETend();
 
 	file.pos += bytesToRead;  // update position!
+	if (file.probePos <= file.ackedPos)
+	{
+		// No chunk is being timed, so time this one.
+		file.probePos = file.pos;
+		file.probeTime = now;
+	}
 	if (file.pos == file.size)
 	{
 		file.closeFile(); // We are done sending to this client.
@@ -2996,6 +3121,53 @@ int NETsendFile(WZFile &file, unsigned player)
 	return static_cast<int>((uint64_t)file.pos * 100 / file.size);
 }
 
+// Receiver acknowledged writing a file up to some position, so the window can move on.
+void NETrecvFileAck(NETQUEUE queue)
+{
+	Sha256 hash;
+	hash.setZero();
+	uint32_t ackedPos = 0;
+
+	NETbeginDecode(queue, NET_FILE_ACK);
+	NETbin(hash.bytes, hash.Bytes);
+	NETuint32_t(&ackedPos);
+	NETend();
+
+	auto pFiles = NetPlay.players[queue.index].wzFiles;
+	ASSERT_OR_RETURN(, pFiles != nullptr, "Null wzFiles (player: %" PRIu8 ")", queue.index);
+	auto file = std::find_if(pFiles->begin(), pFiles->end(), [&](WZFile const &file) { return file.hash == hash; });
+	if (file == pFiles->end() || ackedPos <= file->ackedPos)
+	{
+		return;  // File has been sent completely, or was cancelled, or the acknowledgement is stale.
+	}
+	if (ackedPos > file->pos)
+	{
+		debug(LOG_NET, "Player %" PRIu8 " acknowledged file data that wasn't sent yet (%" PRIu32 " > %" PRIu32 ")", queue.index, ackedPos, file->pos);
+		return;
+	}
+
+	bool probeDone = file->probePos > file->ackedPos && ackedPos >= file->probePos;
+	file->ackedPos = ackedPos;
+	if (!probeDone)
+	{
+		return;
+	}
+
+	// Measure once per round-trip. The smallest round-trip time is used, since queued data makes later ones longer.
+	auto now = std::chrono::steady_clock::now();
+	file->minRoundTrip = std::min(file->minRoundTrip, now - file->probeTime);
+	double roundTripSeconds = std::chrono::duration<double>(file->minRoundTrip).count();
+	double elapsedSeconds = std::chrono::duration<double>(now - file->rateStartTime).count();
+	if (elapsedSeconds > 0)
+	{
+		double bytesPerSecond = (ackedPos - file->rateStartPos) / elapsedSeconds;
+		// While the window limits the throughput, this doubles the window each round-trip.
+		file->window = static_cast<uint32_t>(clip<double>(2 * bytesPerSecond * roundTripSeconds, FILE_TRANSFER_MIN_WINDOW, FILE_TRANSFER_MAX_WINDOW));
+	}
+	file->rateStartPos = ackedPos;
+	file->rateStartTime = now;
+}
+
 bool validateReceivedFile(const WZFile& file)
 {
 	PHYSFS_file *fileHandle = PHYSFS_openRead(file.filename.c_str());
@@ -3127,8 +3299,7 @@ int NETrecvFile(NETQUEUE queue)
 	uint32_t size = 0;
 	uint32_t pos = 0;
 	uint32_t bytesToRead = 0;
-	uint8_t buf[MAX_FILE_TRANSFER_PACKET];
-	memset(buf, 0x0, sizeof(buf));
+	uint8_t buf[FILE_TRANSFER_MAX_CHUNK];
 
 	//read incoming bytes.
 	NETbeginDecode(queue, NET_FILE_PAYLOAD);
@@ -3207,6 +3378,12 @@ int NETrecvFile(NETQUEUE queue)
 	uint32_t newPos = pos + bytesToRead;
 	file->pos = newPos;
 
+	// Let the host send more.
+	NETbeginEncode(NETnetQueue(NetPlay.hostPlayer), NET_FILE_ACK);
+	NETbin(hash.bytes, hash.Bytes);
+	NETuint32_t(&newPos);
+	NETend();
+
 	if (newPos >= size)  // last packet
 	{
 		if (!file->closeFile())
@@ -3223,6 +3400,8 @@ int NETrecvFile(NETQUEUE queue)
 		{
 			// Attach Quarantine / "downloaded" file attribute to file
 			markAsDownloadedFile(file->filename.c_str());
+			// The file was just hashed, so finding its hash again (to load the map or mod, or before requesting it again) is free.
+			cacheHashOfFile(file->filename.c_str(), file->hash);
 		}
 
 		DownloadingWzFiles.erase(file);
@@ -3823,6 +4002,21 @@ static void NEThostPromoteTempSocketToPermanentPlayerConnection(unsigned int tem
 	}
 }
 
+// New clients send NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR first. Clients of our own version follow
+// them with the socketSupportedCompressions() they have (any other version is rejected after the first part)
+static size_t initialConnectSize(const TmpSocketInfo &connectState)
+{
+	const size_t versionSize = sizeof(uint32_t) * 2;
+	if (connectState.usedBuffer < versionSize)
+	{
+		return versionSize;
+	}
+	uint32_t major, minor;
+	memcpy(&major, connectState.buffer, sizeof(uint32_t));
+	memcpy(&minor, connectState.buffer + sizeof(uint32_t), sizeof(uint32_t));
+	return NETisCorrectVersion(ntohl(major), ntohl(minor)) ? versionSize + sizeof(uint32_t) : versionSize;
+}
+
 // ////////////////////////////////////////////////////////////////////////
 // Host a game with a given name and player name. & 4 user game flags
 static void NETallowJoining()
@@ -3893,7 +4087,7 @@ static void NETallowJoining()
 			{
 				char *p_buffer = tmp_connectState[i].buffer;
 
-				const auto sizeReadResult = readNoInt(*tmp_socket[i], p_buffer + tmp_connectState[i].usedBuffer, 8 - tmp_connectState[i].usedBuffer);
+				const auto sizeReadResult = readNoInt(*tmp_socket[i], p_buffer + tmp_connectState[i].usedBuffer, initialConnectSize(tmp_connectState[i]) - tmp_connectState[i].usedBuffer);
 				if (sizeReadResult.has_value())
 				{
 					tmp_connectState[i].usedBuffer += sizeReadResult.value();
@@ -3908,7 +4102,7 @@ static void NETallowJoining()
 					NETaddSessionBanBadIP(tmp_connectState[i].ip);
 					connectFailed = true;
 				}
-				else if (tmp_connectState[i].usedBuffer >= 8)
+				else if (tmp_connectState[i].usedBuffer >= initialConnectSize(tmp_connectState[i]))
 				{
 					// New clients send NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR
 					// Check these numbers with our own.
@@ -3918,6 +4112,7 @@ static void NETallowJoining()
 					p_buffer += sizeof(int32_t);
 					memcpy(&minor, p_buffer, sizeof(uint32_t));
 					minor = ntohl(minor);
+					p_buffer += sizeof(int32_t);
 
 					if (major == 0 && minor == 0)
 					{
@@ -3948,10 +4143,14 @@ static void NETallowJoining()
 					}
 					else if (NETisCorrectVersion(major, minor))
 					{
-						result = htonl(ERROR_NOERROR);
-						memcpy(&tmp_connectState[i].buffer, &result, sizeof(result));
-						writeAll(*tmp_socket[i], &tmp_connectState[i].buffer, sizeof(result));
-						socketBeginCompression(*tmp_socket[i]);
+						// Pick the best compression the client supports too, and tell it which one
+						uint32_t clientCompressions = 0;
+						memcpy(&clientCompressions, p_buffer, sizeof(uint32_t));
+						SocketCompression compression = socketChooseCompression(ntohl(clientCompressions));
+						uint32_t response[2] = {htonl(ERROR_NOERROR), htonl(static_cast<uint32_t>(compression))};
+						memcpy(&tmp_connectState[i].buffer, response, sizeof(response));
+						writeAll(*tmp_socket[i], &tmp_connectState[i].buffer, sizeof(response));
+						socketBeginCompression(*tmp_socket[i], compression);
 
 						// Connection is successful.
 						connectFailed = false;
@@ -5079,6 +5278,7 @@ const char *messageTypeToString(unsigned messageType_)
 	case NET_TEAM_STRATEGY:				return "NET_TEAM_STRATEGY";
 	case NET_QUICK_CHAT_MSG:			return "NET_QUICK_CHAT_MSG";
 	case NET_HOST_CONFIG:				return "NET_HOST_CONFIG";
+	case NET_FILE_ACK:					return "NET_FILE_ACK";
 	case NET_MAX_TYPE:                  return "NET_MAX_TYPE";
 
 	// Game-state-related messages, must be processed by all clients at the same game time.
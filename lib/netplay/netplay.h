@@ -111,6 +111,7 @@ enum MESSAGE_TYPES
 	NET_TEAM_STRATEGY,				///< Player is sending an updated strategy notice to team members
 	NET_QUICK_CHAT_MSG,				///< Quick chat message
 	NET_HOST_CONFIG,				///< Host configuration sent both before the game has started (in lobby), and after the game has started
+	NET_FILE_ACK,					///< Player has received a file up to some position, so the host can send more
 	NET_MAX_TYPE,                   ///< Maximum+1 valid NET_ type, *MUST* be last.
 
 	// Game-state-related messages, must be processed by all clients at the same game time.
@@ -147,7 +148,8 @@ enum MESSAGE_TYPES
 
 enum SYNC_OPT_TYPES
 {
-	SYNC_OPT_FORMATION_SPEED_LIMITING = 1
+	SYNC_OPT_FORMATION_SPEED_LIMITING = 1,
+	SYNC_OPT_FLOW_FIELD_MOVEMENT = 2
 };
 
 #define SYNC_FLAG 0x10000000	//special flag used for logging. (Not sure what this is. Was added in trunk, NUM_GAME_PACKETS not in newnet.)
@@ -364,7 +366,9 @@ WZ_DECL_NONNULL(1, 2) bool NETrecvGame(NETQUEUE *queue, uint8_t *type);       //
 void NETflush();                                                              ///< Flushes any data stuck in compression buffers.
 
 int NETsendFile(WZFile &file, unsigned player);  ///< Send file chunk. Returns 100 when done.
+bool NETfileTransferWindowFull(WZFile const &file);  ///< True if NETsendFile() should wait for the receiver to acknowledge more data.
 int NETrecvFile(NETQUEUE queue);                 ///< Receive file chunk. Returns 100 when done.
+void NETrecvFileAck(NETQUEUE queue);             ///< Receive acknowledgement of file chunks.
 unsigned NETgetDownloadProgress(unsigned player);     ///< Returns 100 when done.
 
 int NETclose();					// close current game
@@ -377,8 +381,9 @@ void NETremRedirects();
 /// (NETrecvNet, in particular) when the operation is complete.
 void NETinitPortMapping();
 
-enum NetStatisticType {NetStatisticRawBytes, NetStatisticUncompressedBytes, NetStatisticPackets};
+enum NetStatisticType {NetStatisticRawBytes, NetStatisticUncompressedBytes, NetStatisticPackets, NetStatisticCompressionTime};
 size_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal = false);     // Return some statistic. Call regularly for good results.
+size_t NETgetConnectionStatistic(uint32_t player, NetStatisticType type, bool sent);  // Return the total of some statistic for the connection to player, or 0 if we aren't directly connected.
 
 void NETplayerKicked(UDWORD index);			// Cleanup after player has been kicked
 
@@ -482,6 +487,9 @@ std::vector<uint8_t> NET_getHumanPlayers(void);
 
 const std::vector<WZFile>& NET_getDownloadingWzFiles();
 void NET_addDownloadingWZFile(WZFile&& newFile);
+/// Opens filename for downloading the file with the given hash. Continues an interrupted download of the same file, if any, in which case
+/// the returned file's pos is where to request the file from. The returned file's handle is null on failure.
+WZFile NET_openDownloadWZFile(const std::string &filename, const Sha256 &hash);
 void NET_clearDownloadingWZFiles();
 
 bool NET_getLobbyDisabled();
@@ -30,6 +30,11 @@
 
 // See comments in netqueue.h.
 
+#define NET_QUEUE_MIN_RING_SIZE 16                 ///< Number of message slots allocated the first time a message is added.
+#define NET_QUEUE_MAX_RECYCLED_CAPACITY 4096       ///< Larger message buffers are freed instead of being kept for reuse.
+#define NET_QUEUE_MAX_RECYCLED_BYTES (64 * 1024)   ///< Message buffers are freed instead of being kept for reuse, once this much is kept.
+#define NET_QUEUE_MAX_IDLE_RING_SIZE 256           ///< A larger ring (grown by a burst of messages) is freed when the queue is empty.
+
 
 // Byte n is the final byte, iff it is less than 256-a[n].
 
@@ -171,6 +176,14 @@ void NetMessage::rawDataAppendToVector(std::vector<uint8_t> &output) const
 	output.insert(output.end(), data.begin(), data.end());
 }
 
+std::shared_ptr<const std::vector<uint8_t>> NetMessage::rawDataShared() const
+{
+	auto output = std::make_shared<std::vector<uint8_t>>();
+	output->reserve(rawLen());
+	rawDataAppendToVector(*output);
+	return output;
+}
+
 size_t NetMessage::rawLen() const
 {
 	return 1 + static_cast<size_t>(encodedlength_uint32_t(static_cast<uint32_t>(data.size()))) + data.size();
@@ -179,11 +192,44 @@ size_t NetMessage::rawLen() const
 NetQueue::NetQueue()
 	: canGetMessagesForNet(true)
 	, canGetMessages(true)
+	, firstPos(0)
+	, dataPos(0)
+	, messagePos(0)
+	, endPos(0)
+	, recycledBytes(0)
 	, pendingGameTimeUpdateMessages(0)
 	, bCurrentMessageWasDecrypted(false)
+{}
+
+NetMessage &NetQueue::pushSlot()
 {
-	dataPos = messages.end();
-	messagePos = messages.end();
+	if (endPos - firstPos == ring.size())
+	{
+		growRing();
+	}
+	NetMessage &slot = *ring[endPos++ & (ring.size() - 1)];
+	recycledBytes -= slot.data.capacity();  // No longer a kept buffer, once the new message is in it.
+	return slot;
+}
+
+void NetQueue::growRing()
+{
+	// Only called when the ring is full, so the new slots fill exactly the positions after the last message.
+	size_t oldSize = ring.size();
+	size_t newSize = std::max<size_t>(oldSize * 2, NET_QUEUE_MIN_RING_SIZE);
+	slabs.emplace_back(new NetMessage[newSize - oldSize]);
+	NetMessage *slab = slabs.back().get();
+
+	std::vector<NetMessage *> newRing(newSize, nullptr);
+	for (size_t n = firstPos; n != endPos; ++n)
+	{
+		newRing[n & (newSize - 1)] = ring[n & (oldSize - 1)];
+	}
+	for (size_t i = 0; i != newSize - oldSize; ++i)
+	{
+		newRing[(endPos + i) & (newSize - 1)] = &slab[i];
+	}
+	ring = std::move(newRing);
 }
 
 void NetQueue::writeRawData(const uint8_t *netData, size_t netLen)
@@ -214,8 +260,9 @@ void NetQueue::writeRawData(const uint8_t *netData, size_t netLen)
 			break;  // Don't have a whole message ready yet.
 		}
 
-		messages.push_front(NetMessage(type));
-		messages.front().data.assign(buffer.begin() + used + headerLen, buffer.begin() + used + headerLen + len);
+		NetMessage &message = pushSlot();
+		message.type = type;
+		message.data.assign(buffer.begin() + used + headerLen, buffer.begin() + used + headerLen + len);
 		if (type == GAME_GAME_TIME)
 		{
 			++pendingGameTimeUpdateMessages;
@@ -239,22 +286,13 @@ void NetQueue::setWillNeverGetMessagesForNet()
 
 unsigned NetQueue::numMessagesForNet() const
 {
-	unsigned count = 0;
-	if (canGetMessagesForNet)
-	{
-		for (List::iterator i = dataPos; i != messages.begin(); --i)
-		{
-			++count;
-		}
-	}
-
-	return count;
+	return canGetMessagesForNet ? static_cast<unsigned>(endPos - dataPos) : 0;
 }
 
 const NetMessage &NetQueue::getMessageForNet() const
 {
 	ASSERT(canGetMessagesForNet, "Wrong NetQueue type for getMessageForNet.");
-	ASSERT(dataPos != messages.begin(), "No message to get!");
+	ASSERT(dataPos != endPos, "No message to get!");
 
 	// Return the message.
 	return internal_getMessageForNet();
@@ -263,9 +301,9 @@ const NetMessage &NetQueue::getMessageForNet() const
 void NetQueue::popMessageForNet()
 {
 	ASSERT(canGetMessagesForNet, "Wrong NetQueue type for popMessageForNet.");
-	ASSERT(dataPos != messages.begin(), "No message to pop!");
+	ASSERT(dataPos != endPos, "No message to pop!");
 
-	if (messagePos != messages.begin() && internal_getMessageForNet().type == GAME_GAME_TIME)
+	if (messagePos != endPos && internal_getMessageForNet().type == GAME_GAME_TIME)
 	{
 		if (pendingGameTimeUpdateMessages > 0)
 		{
@@ -274,7 +312,7 @@ void NetQueue::popMessageForNet()
 	}
 
 	// Pop the message.
-	--dataPos;
+	++dataPos;
 
 	// Recycle old data.
 	popOldMessages();
@@ -286,7 +324,9 @@ void NetQueue::pushMessage(const NetMessage &message)
 	{
 		++pendingGameTimeUpdateMessages;
 	}
-	messages.push_front(message);
+	NetMessage &slot = pushSlot();
+	slot.type = message.type;
+	slot.data.assign(message.data.begin(), message.data.end());  // Reuses the buffer of the recycled slot, if large enough.
 }
 
 void NetQueue::setWillNeverGetMessages()
@@ -297,13 +337,13 @@ void NetQueue::setWillNeverGetMessages()
 bool NetQueue::haveMessage() const
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for haveMessage.");
-	return messagePos != messages.begin();
+	return messagePos != endPos;
 }
 
 const NetMessage &NetQueue::getMessage() const
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for getMessage.");
-	ASSERT(messagePos != messages.begin(), "No message to get!");
+	ASSERT(messagePos != endPos, "No message to get!");
 
 	// Return the message.
 	return internal_getConstMessage();
@@ -317,7 +357,7 @@ bool NetQueue::currentMessageWasDecrypted() const
 bool NetQueue::replaceCurrentWithDecrypted(NetMessage &&decryptedMessage)
 {
 	ASSERT_OR_RETURN(false, canGetMessages, "Wrong NetQueue type for getMessage.");
-	ASSERT_OR_RETURN(false, messagePos != messages.begin(), "No message to get!");
+	ASSERT_OR_RETURN(false, messagePos != endPos, "No message to get!");
 
 	NetMessage& currentMessage = internal_getMessage();
 	ASSERT_OR_RETURN(false, currentMessage.type == NET_SECURED_NET_MESSAGE, "Current message is not a secured message!");
@@ -330,9 +370,9 @@ bool NetQueue::replaceCurrentWithDecrypted(NetMessage &&decryptedMessage)
 void NetQueue::popMessage()
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for popMessage.");
-	ASSERT(messagePos != messages.begin(), "No message to pop!");
+	ASSERT(messagePos != endPos, "No message to pop!");
 
-	if (messagePos != messages.begin() && internal_getConstMessage().type == GAME_GAME_TIME)
+	if (messagePos != endPos && internal_getConstMessage().type == GAME_GAME_TIME)
 	{
 		if (pendingGameTimeUpdateMessages > 0)
 		{
@@ -341,7 +381,7 @@ void NetQueue::popMessage()
 	}
 
 	// Pop the message.
-	--messagePos;
+	++messagePos;
 	bCurrentMessageWasDecrypted = false;
 
 	// Recycle old data.
@@ -352,27 +392,35 @@ void NetQueue::popOldMessages()
 {
 	if (!canGetMessagesForNet)
 	{
-		dataPos = messages.begin();
+		dataPos = endPos;
 	}
 	if (!canGetMessages)
 	{
-		messagePos = messages.begin();
+		messagePos = endPos;
 	}
 
-	List::iterator i = messages.end();
-	while (i != dataPos && i != messagePos)
+	size_t newFirstPos = firstPos + std::min(dataPos - firstPos, messagePos - firstPos);
+	for (; firstPos != newFirstPos; ++firstPos)
 	{
-		--i;
+		// Keep the slot and its buffer for a later message.
+		NetMessage &message = *ring[firstPos & (ring.size() - 1)];
+		size_t capacity = message.data.capacity();
+		if (capacity > NET_QUEUE_MAX_RECYCLED_CAPACITY || recycledBytes + capacity > NET_QUEUE_MAX_RECYCLED_BYTES)
+		{
+			std::vector<uint8_t>().swap(message.data);
+		}
+		else
+		{
+			message.data.clear();
+			recycledBytes += capacity;
+		}
 	}
 
-	if (i == dataPos)
+	if (firstPos == endPos && ring.size() > NET_QUEUE_MAX_IDLE_RING_SIZE)
 	{
-		dataPos = messages.end();  // Old iterator will become invalid.
+		// No messages left to reference, so give back the slots of the burst. The ring grows again as needed.
+		std::vector<NetMessage *>().swap(ring);
+		slabs.clear();
+		recycledBytes = 0;
 	}
-	if (i == messagePos)
-	{
-		messagePos = messages.end();  // Old iterator will become invalid.
-	}
-
-	messages.erase(i, messages.end());
 }
@@ -27,6 +27,7 @@
 #include "lib/framework/frame.h"
 #include <vector>
 #include <list>
+#include <memory>
 #include <deque>
 #include <unordered_map>
 
@@ -49,6 +50,7 @@ public:
 	static bool tryFromRawData(const uint8_t* buffer, size_t bufferLen, NetMessage& output);
 	uint8_t *rawDataDup() const;  ///< Returns data compatible with NetQueue::writeRawData(). Must be delete[]d.
 	void rawDataAppendToVector(std::vector<uint8_t> &output) const;  ///< Appends data compatible with NetQueue::writeRawData() to the input vector.
+	std::shared_ptr<const std::vector<uint8_t>> rawDataShared() const;  ///< Returns data compatible with NetQueue::writeRawData(), which can be queued for many sockets without copying.
 	size_t rawLen() const;        ///< Returns the length of the return value of rawDataDup().
 	uint8_t type;
 	std::vector<uint8_t> data;
@@ -169,32 +171,32 @@ private:
 
 	inline const NetMessage &internal_getMessageForNet() const
 	{
-		// Return the message.
-		List::iterator i = dataPos;
-		--i;
-		return *i;
+		return *ring[dataPos & (ring.size() - 1)];
 	};
 
 	inline const NetMessage &internal_getConstMessage() const
 	{
-		// Return the message.
-		List::iterator i = messagePos;
-		--i;
-		return *i;
+		return *ring[messagePos & (ring.size() - 1)];
 	};
 
 	inline NetMessage &internal_getMessage()
 	{
-		// Return the message.
-		List::iterator i = messagePos;
-		--i;
-		return *i;
+		return *ring[messagePos & (ring.size() - 1)];
 	};
 
-	using List = std::list<NetMessage>;
-	List::iterator                dataPos;                             ///< Last message which was sent over the network.
-	List::iterator                messagePos;                          ///< Last message which was popped.
-	List                          messages;                            ///< List of messages. Messages are added to the front and read from the back.
+	NetMessage &pushSlot();                                            ///< Returns the slot of a new message at the end of the queue, growing the ring if it is full.
+	void growRing();                                                   ///< Doubles the size of the ring, adding a new slab of slots.
+
+	// Messages are numbered in the order they are added. Message n is stored in ring[n & (ring.size() - 1)], for firstPos <= n < endPos.
+	// The slots point into slabs, which are never moved, and only freed while the queue is empty, so references to messages stay valid while the ring grows,
+	// and recycled slots keep the buffers of their old messages, so most messages don't need any heap allocations.
+	std::vector<std::unique_ptr<NetMessage[]>> slabs;                  ///< Storage of the message slots.
+	std::vector<NetMessage *>     ring;                                ///< Ring of message slots. The size is always 0 or a power of 2.
+	size_t                        firstPos;                            ///< Oldest message which is still needed.
+	size_t                        dataPos;                             ///< Next message to send over the network.
+	size_t                        messagePos;                          ///< Next message to return from getMessage().
+	size_t                        endPos;                              ///< Next message to be added.
+	size_t                        recycledBytes;                       ///< Capacity of the buffers kept in the free slots, for reuse.
 	std::vector<uint8_t>          incompleteReceivedMessageData;       ///< Data from network which has not yet formed an entire message.
 	size_t                        pendingGameTimeUpdateMessages;       ///< Pending GAME_GAME_TIME messages added to this queue
 	bool						  bCurrentMessageWasDecrypted;
@@ -0,0 +1,342 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/**
+ * @file netrelay.cpp
+ *
+ * Spectator relay, see netrelay.h.
+ */
+
+#include "netrelay.h"
+
+// Records are collected for this long before being sent, so each spectator gets a few larger writes per second,
+// instead of one per message. Game time only advances in steps of GAME_TICKS_PER_UPDATE anyway.
+#define RELAY_FLUSH_INTERVAL std::chrono::milliseconds(50)
+#define RELAY_MAX_PENDING_SIZE (64 * 1024)
+// An hour of a busy game is a few megabytes, so this only stops a relay left running for days from growing without bound.
+#define RELAY_MAX_BACKLOG_SIZE (256 * 1024 * 1024)
+
+bool parseReplayRelayAddress(const std::string &address, std::string &host, unsigned &port)
+{
+	port = REPLAY_RELAY_DEFAULT_PORT;
+	std::string portString;
+	bool hasPort = false;
+	if (!address.empty() && address[0] == '[')
+	{
+		size_t end = address.find(']');
+		if (end == std::string::npos || (end + 1 != address.size() && address[end + 1] != ':'))
+		{
+			return false;
+		}
+		host = address.substr(1, end - 1);
+		hasPort = end + 1 != address.size();
+		if (hasPort)
+		{
+			portString = address.substr(end + 2);
+		}
+	}
+	else
+	{
+		size_t colon = address.find(':');
+		hasPort = colon != std::string::npos && address.find(':', colon + 1) == std::string::npos;  // More than one is a bare IPv6 address.
+		host = hasPort ? address.substr(0, colon) : address;
+		if (hasPort)
+		{
+			portString = address.substr(colon + 1);
+		}
+	}
+	if (host.empty())
+	{
+		return false;
+	}
+	if (hasPort)
+	{
+		char *end = nullptr;
+		unsigned long value = strtoul(portString.c_str(), &end, 10);
+		if (portString.empty() || *end != '\0' || value == 0 || value > 65535)
+		{
+			return false;
+		}
+		port = static_cast<unsigned>(value);
+	}
+	return true;
+}
+
+ReplayRelayServer::~ReplayRelayServer()
+{
+	close();
+}
+
+bool ReplayRelayServer::listen(unsigned port)
+{
+	ASSERT_OR_RETURN(false, listenSocket == nullptr, "Relay is already listening");
+
+	auto listenResult = socketListen(port);
+	if (!listenResult.has_value())
+	{
+		debug(LOG_ERROR, "Relay cannot listen on port %u: %s", port, listenResult.error().message().c_str());
+		return false;
+	}
+	listenSocket = listenResult.value();
+	spectatorSet = allocSocketSet();
+	lastFlushTime = std::chrono::steady_clock::now();
+	debug(LOG_INFO, "Relaying the game to spectators on port %u", this->port());
+	return true;
+}
+
+unsigned ReplayRelayServer::port() const
+{
+	return (listenSocket != nullptr) ? socketListenPort(*listenSocket) : 0;
+}
+
+void ReplayRelayServer::close()
+{
+	if (listenSocket == nullptr)
+	{
+		return;
+	}
+
+	flush();
+	debug(LOG_INFO, "Closing relay, disconnecting %zu spectators", spectators.size());
+	while (!spectators.empty())
+	{
+		dropSpectator(spectators.size() - 1);  // socketClose() still sends the queued data.
+	}
+	deleteSocketSet(spectatorSet);
+	spectatorSet = nullptr;
+	socketClose(listenSocket);
+	listenSocket = nullptr;
+	chunks.clear();
+	backlogSize = 0;
+	backlogDropped = false;
+	pending.clear();
+}
+
+void ReplayRelayServer::setHeader(const std::vector<uint8_t> &header)
+{
+	ASSERT_OR_RETURN(, chunks.empty() && pending.empty(), "Header must come first");
+	chunks.push_back(std::make_shared<const std::vector<uint8_t>>(header));
+	backlogSize += header.size();
+}
+
+void ReplayRelayServer::appendMessage(const NetMessage &message, uint8_t player)
+{
+	if (listenSocket == nullptr)
+	{
+		return;
+	}
+	pending.push_back(player);
+	message.rawDataAppendToVector(pending);
+}
+
+void ReplayRelayServer::update(bool flushNow)
+{
+	if (listenSocket == nullptr)
+	{
+		return;
+	}
+
+	// Spectators who connect late get everything sent so far. The chunks are shared, not copied.
+	while (Socket *newSpectator = socketAccept(listenSocket))
+	{
+		if (backlogDropped)
+		{
+			debug(LOG_INFO, "Turning away spectator %s, the start of the stream is no longer kept", getSocketTextAddress(*newSpectator));
+			socketClose(newSpectator);
+			continue;
+		}
+		bool ok = true;
+		for (const auto &chunk : chunks)
+		{
+			ok = ok && writeAll(*newSpectator, chunk).has_value();
+		}
+		if (!ok)
+		{
+			socketClose(newSpectator);
+			continue;
+		}
+		debug(LOG_INFO, "Spectator %s connected to relay", getSocketTextAddress(*newSpectator));
+		SocketSet_AddSocket(*spectatorSet, newSpectator);
+		spectators.push_back(newSpectator);
+	}
+
+	// Spectators don't send anything, but reading finds out which ones disconnected.
+	if (!spectators.empty() && checkSockets(*spectatorSet, 0) > 0)
+	{
+		for (size_t i = spectators.size(); i-- > 0;)
+		{
+			if (!socketReadReady(*spectators[i]))
+			{
+				continue;
+			}
+			uint8_t ignored[256];
+			if (!readNoInt(*spectators[i], ignored, sizeof(ignored)).has_value())
+			{
+				debug(LOG_INFO, "Spectator %s disconnected from relay", getSocketTextAddress(*spectators[i]));
+				dropSpectator(i);
+			}
+		}
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (!pending.empty() && (flushNow || pending.size() >= RELAY_MAX_PENDING_SIZE || now - lastFlushTime >= RELAY_FLUSH_INTERVAL))
+	{
+		flush();
+		lastFlushTime = now;
+	}
+}
+
+void ReplayRelayServer::flush()
+{
+	if (pending.empty())
+	{
+		return;
+	}
+
+	// One buffer for all spectators, like NETsend() does for broadcasts.
+	auto chunk = std::make_shared<const std::vector<uint8_t>>(std::move(pending));
+	pending = std::vector<uint8_t>();
+	if (!backlogDropped)
+	{
+		chunks.push_back(chunk);
+		backlogSize += chunk->size();
+		if (backlogSize > RELAY_MAX_BACKLOG_SIZE)
+		{
+			debug(LOG_WARNING, "Relayed stream is over %d MiB, no longer keeping it for spectators who connect late", RELAY_MAX_BACKLOG_SIZE / (1024 * 1024));
+			std::vector<std::shared_ptr<const std::vector<uint8_t>>>().swap(chunks);
+			backlogDropped = true;
+		}
+	}
+	for (size_t i = spectators.size(); i-- > 0;)
+	{
+		if (!writeAll(*spectators[i], chunk).has_value())
+		{
+			debug(LOG_INFO, "Failed to send to spectator %s, disconnecting", getSocketTextAddress(*spectators[i]));
+			dropSpectator(i);
+		}
+	}
+}
+
+void ReplayRelayServer::dropSpectator(size_t index)
+{
+	SocketSet_DelSocket(*spectatorSet, spectators[index]);
+	socketClose(spectators[index]);
+	spectators.erase(spectators.begin() + index);
+}
+
+ReplayRelayClient::~ReplayRelayClient()
+{
+	close();
+}
+
+bool ReplayRelayClient::connect(const char *host, unsigned port, unsigned timeout)
+{
+	ASSERT_OR_RETURN(false, socket == nullptr, "Already connected to a relay");
+
+	auto addressResult = resolveHost(host, port);
+	if (!addressResult.has_value())
+	{
+		debug(LOG_ERROR, "Cannot resolve relay %s: %s", host, addressResult.error().message().c_str());
+		return false;
+	}
+	auto openResult = socketOpen(addressResult.value(), timeout);
+	deleteSocketAddress(addressResult.value());
+	if (!openResult.has_value())
+	{
+		debug(LOG_ERROR, "Cannot connect to relay %s:%u: %s", host, port, openResult.error().message().c_str());
+		return false;
+	}
+	socket = openResult.value();
+	socketSet = allocSocketSet();
+	SocketSet_AddSocket(*socketSet, socket);
+	buffer.clear();
+	return true;
+}
+
+void ReplayRelayClient::close()
+{
+	if (socket == nullptr)
+	{
+		return;
+	}
+	SocketSet_DelSocket(*socketSet, socket);
+	deleteSocketSet(socketSet);
+	socketSet = nullptr;
+	socketClose(socket);
+	socket = nullptr;
+}
+
+bool ReplayRelayClient::readHeader(void *buf, size_t size, unsigned timeout)
+{
+	ASSERT_OR_RETURN(false, socket != nullptr, "Not connected to a relay");
+	auto readResult = readAll(*socket, buf, size, timeout);
+	return readResult.has_value() && static_cast<size_t>(readResult.value()) == size;
+}
+
+bool ReplayRelayClient::receive(std::vector<ReplayRelayRecord> &records)
+{
+	if (socket == nullptr)
+	{
+		return false;
+	}
+
+	bool open = true;
+	while (checkSockets(*socketSet, 0) > 0 && socketReadReady(*socket))
+	{
+		uint8_t data[16384];
+		auto readResult = readNoInt(*socket, data, sizeof(data));
+		if (!readResult.has_value())
+		{
+			open = false;
+			break;
+		}
+		if (readResult.value() <= 0)
+		{
+			break;
+		}
+		buffer.insert(buffer.end(), data, data + readResult.value());
+	}
+
+	// Each record is the player, followed by the message as NetMessage::rawDataAppendToVector() writes it.
+	size_t pos = 0;
+	while (buffer.size() - pos >= 3)
+	{
+		uint32_t len = 0;
+		bool moreBytes = true;
+		size_t headerLen = 2;
+		for (unsigned n = 0; moreBytes && pos + headerLen < buffer.size(); ++n, ++headerLen)
+		{
+			moreBytes = decode_uint32_t(buffer[pos + headerLen], len, n);
+		}
+		if (moreBytes || buffer.size() - pos - headerLen < len)
+		{
+			break;  // Rest of the record is still on its way.
+		}
+		ReplayRelayRecord record{buffer[pos], NetMessage(buffer[pos + 1])};
+		record.message.data.assign(buffer.begin() + pos + headerLen, buffer.begin() + pos + headerLen + len);
+		records.push_back(std::move(record));
+		pos += headerLen + len;
+	}
+	buffer.erase(buffer.begin(), buffer.begin() + pos);
+
+	if (!open)
+	{
+		close();
+	}
+	return open;
+}
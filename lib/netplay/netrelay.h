@@ -0,0 +1,103 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/**
+ * @file netrelay.h
+ *
+ * Spectator relay. A spectator process re-broadcasts the game messages it processes to any number of downstream
+ * spectators, so they cost the playing host nothing. The stream has the layout of a replay file: the replay header,
+ * followed by (player, message) records, ending with a REPLAY_ENDED record. Downstream spectators play it like a
+ * replay which is still being written.
+ */
+
+#ifndef _NET_RELAY_H_
+#define _NET_RELAY_H_
+
+#include "lib/framework/frame.h"
+#include "netqueue.h"
+#include "netsocket.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define REPLAY_RELAY_DEFAULT_PORT 2101
+
+/// Parses a relay address: "host", "host:port", "[IPv6 address]" or "[IPv6 address]:port". A bare IPv6 address is
+/// taken as the host, without a port. Returns false if the address is malformed.
+bool parseReplayRelayAddress(const std::string &address, std::string &host, unsigned &port);
+
+class ReplayRelayServer
+{
+public:
+	~ReplayRelayServer();
+
+	bool listen(unsigned port);
+	void close();  ///< Ends the stream, and disconnects the spectators after they got all of it.
+
+	void setHeader(const std::vector<uint8_t> &header);  ///< The replay header, which is sent first to each spectator.
+	void appendMessage(const NetMessage &message, uint8_t player);
+	void update(bool flushNow = false);  ///< Accepts spectators, and sends them the messages appended since the last flush.
+
+	size_t numSpectators() const
+	{
+		return spectators.size();
+	}
+	unsigned port() const;  ///< The port listened on (the one the system picked, if listening on port 0), or 0 if not listening.
+
+private:
+	void flush();
+	void dropSpectator(size_t index);
+
+	Socket *listenSocket = nullptr;
+	SocketSet *spectatorSet = nullptr;
+	std::vector<Socket *> spectators;
+	// Everything sent so far, starting with the header, for spectators who connect late. Kept in memory for the whole game,
+	// up to RELAY_MAX_BACKLOG_SIZE - after that it is freed, and later spectators are turned away.
+	std::vector<std::shared_ptr<const std::vector<uint8_t>>> chunks;
+	size_t backlogSize = 0;  ///< Total size of the chunks.
+	bool backlogDropped = false;  ///< The stream outgrew RELAY_MAX_BACKLOG_SIZE, so the chunks were freed.
+	std::vector<uint8_t> pending;  ///< Records which haven't been sent yet.
+	std::chrono::steady_clock::time_point lastFlushTime;
+};
+
+struct ReplayRelayRecord
+{
+	uint8_t player;
+	NetMessage message;
+};
+
+class ReplayRelayClient
+{
+public:
+	~ReplayRelayClient();
+
+	bool connect(const char *host, unsigned port, unsigned timeout);
+	void close();
+
+	bool readHeader(void *buf, size_t size, unsigned timeout);  ///< Blocks until size bytes of the header arrived.
+	bool receive(std::vector<ReplayRelayRecord> &records);  ///< Appends the records which arrived completely. Returns false once the relay closed the connection.
+
+private:
+	Socket *socket = nullptr;
+	SocketSet *socketSet = nullptr;
+	std::vector<uint8_t> buffer;  ///< Start of a record which hasn't arrived completely.
+};
+
+#endif // _NET_RELAY_H_
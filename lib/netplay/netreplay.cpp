@@ -42,18 +42,25 @@
 #endif
 
 #include <ctime>
+#include <functional>
 #include <memory>
 
 #include "netreplay.h"
 #include "netplay.h"
+#include "netrelay.h"
 
 static PHYSFS_file *replaySaveHandle = nullptr;
 static PHYSFS_file *replayLoadHandle = nullptr;
 
+static unsigned replayRelayPort = 0;
+static ReplayRelayServer replayRelayServer;
+static ReplayRelayClient replayRelayClient;
+
 static const uint32_t magicReplayNumber = 0x575A7270;  // "WZrp"
 static const uint32_t currentReplayFormatVer = 2;
 static const size_t DefaultReplayBufferSize = 32768;
 static const size_t MaxReplayBufferSize = 2 * 1024 * 1024;
+static const unsigned RELAY_CONNECT_TIMEOUT = 15000;
 
 typedef std::vector<uint8_t> SerializedNetMessagesBuffer;
 static moodycamel::BlockingReaderWriterQueue<SerializedNetMessagesBuffer> serializedBufferWriteQueue(256);
@@ -83,6 +90,54 @@ static int replaySaveThreadFunc(void *data)
 	return 0;
 }
 
+static void appendUBE32(std::vector<uint8_t> &buffer, uint32_t value)
+{
+	buffer.push_back(static_cast<uint8_t>(value >> 24));
+	buffer.push_back(static_cast<uint8_t>(value >> 16));
+	buffer.push_back(static_cast<uint8_t>(value >> 8));
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+// The header is the same for replay files and for the spectator relay.
+static bool buildReplayHeader(ReplayOptionsHandler const &optionsHandler, std::vector<uint8_t> &header)
+{
+	appendUBE32(header, magicReplayNumber);
+
+	// Save map name or map data and game settings and list of players in game and stuff.
+	nlohmann::json settings = nlohmann::json::object();
+
+	// Save "replay file format version"
+	settings["replayFormatVer"] = currentReplayFormatVer;
+
+	// Save Netcode version
+	settings["major"] = NETGetMajorVersion();
+	settings["minor"] = NETGetMinorVersion();
+
+	// Save desired info from optionsHandler
+	nlohmann::json gameOptions = nlohmann::json::object();
+	optionsHandler.saveOptions(gameOptions);
+	settings["gameOptions"] = gameOptions;
+
+	auto data = settings.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+	appendUBE32(header, static_cast<uint32_t>(data.size()));
+	header.insert(header.end(), data.begin(), data.end());
+
+	// Save extra map data (if present)
+	ReplayOptionsHandler::EmbeddedMapData embeddedMapData;
+	if (!optionsHandler.saveMap(embeddedMapData))
+	{
+		// Failed to save map data - just empty it out for now
+		embeddedMapData.mapBinaryData.clear();
+	}
+	appendUBE32(header, embeddedMapData.dataVersion);
+#if SIZE_MAX > UINT32_MAX
+	ASSERT_OR_RETURN(false, embeddedMapData.mapBinaryData.size() <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "Embedded map data is way too big");
+#endif
+	appendUBE32(header, static_cast<uint32_t>(embeddedMapData.mapBinaryData.size()));
+	header.insert(header.end(), embeddedMapData.mapBinaryData.begin(), embeddedMapData.mapBinaryData.end());
+	return true;
+}
+
 bool NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &optionsHandler, int maxReplaysSaved, bool appendPlayerToFilename)
 {
 	if (NETisReplay())
@@ -130,43 +185,14 @@ bool NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &o
 
 	WZ_PHYSFS_SETBUFFER(replaySaveHandle, 1024 * 32)//;
 
-	PHYSFS_writeSBE32(replaySaveHandle, magicReplayNumber);
-
-	// Save map name or map data and game settings and list of players in game and stuff.
-	nlohmann::json settings = nlohmann::json::object();
-
-	// Save "replay file format version"
-	settings["replayFormatVer"] = currentReplayFormatVer;
-
-	// Save Netcode version
-	settings["major"] = NETGetMajorVersion();
-	settings["minor"] = NETGetMinorVersion();
-
-	// Save desired info from optionsHandler
-	nlohmann::json gameOptions = nlohmann::json::object();
-	optionsHandler.saveOptions(gameOptions);
-	settings["gameOptions"] = gameOptions;
-
-	auto data = settings.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-	PHYSFS_writeUBE32(replaySaveHandle, data.size());
-	WZ_PHYSFS_writeBytes(replaySaveHandle, data.data(), data.size());
-
-	// Save extra map data (if present)
-	ReplayOptionsHandler::EmbeddedMapData embeddedMapData;
-	if (!optionsHandler.saveMap(embeddedMapData))
-	{
-		// Failed to save map data - just empty it out for now
-		embeddedMapData.mapBinaryData.clear();
-	}
-	PHYSFS_writeUBE32(replaySaveHandle, embeddedMapData.dataVersion);
-#if SIZE_MAX > UINT32_MAX
-	ASSERT_OR_RETURN(false, embeddedMapData.mapBinaryData.size() <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "Embedded map data is way too big");
-#endif
-	PHYSFS_writeUBE32(replaySaveHandle, static_cast<uint32_t>(embeddedMapData.mapBinaryData.size()));
-	if (!embeddedMapData.mapBinaryData.empty())
+	std::vector<uint8_t> header;
+	if (!buildReplayHeader(optionsHandler, header))
 	{
-		WZ_PHYSFS_writeBytes(replaySaveHandle, embeddedMapData.mapBinaryData.data(), static_cast<uint32_t>(embeddedMapData.mapBinaryData.size()));
+		PHYSFS_close(replaySaveHandle);
+		replaySaveHandle = nullptr;
+		return false;
 	}
+	WZ_PHYSFS_writeBytes(replaySaveHandle, header.data(), static_cast<uint32_t>(header.size()));
 
 	// determine best buffer size
 	size_t desiredBufferSize = optionsHandler.desiredBufferSize();
@@ -260,12 +286,14 @@ bool NETreplaySaveStop()
 
 void NETreplaySaveNetMessage(NetMessage const *message, uint8_t player)
 {
-	if (!replaySaveHandle)
+	if (message->type <= GAME_MIN_TYPE || message->type >= GAME_MAX_TYPE)
 	{
 		return;
 	}
 
-	if (message->type > GAME_MIN_TYPE && message->type < GAME_MAX_TYPE)
+	replayRelayServer.appendMessage(*message, player);
+
+	if (replaySaveHandle)
 	{
 		latestWriteBuffer.push_back(player);
 		message->rawDataAppendToVector(latestWriteBuffer);
@@ -279,39 +307,40 @@ void NETreplaySaveNetMessage(NetMessage const *message, uint8_t player)
 	}
 }
 
-bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer)
-{
-	auto onFail = [&](char const *reason) {
-		debug(LOG_ERROR, "Could not load replay file %s: %s", filename.c_str(), reason);
-		if (replayLoadHandle != nullptr)
-		{
-			PHYSFS_close(replayLoadHandle);
-			replayLoadHandle = nullptr;
-		}
-		return false;
-	};
+typedef std::function<bool (void *buf, size_t size)> ReplayHeaderReadFunc;
+typedef std::function<bool (size_t size)> ReplayHeaderSkipFunc;
 
-	replayLoadHandle = PHYSFS_openRead(filename.c_str());
-	if (replayLoadHandle == nullptr)
+static bool readReplayUBE32(ReplayHeaderReadFunc const &readBytes, uint32_t &value)
+{
+	uint8_t bytes[4];
+	if (!readBytes(bytes, sizeof(bytes)))
 	{
-		return onFail(WZ_PHYSFS_getLastError());
+		return false;
 	}
+	value = static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+	return true;
+}
 
-	int32_t replayNumber = 0;
-	PHYSFS_readSBE32(replayLoadHandle, &replayNumber);
-	if ((uint32_t)replayNumber != magicReplayNumber)
+// Reads the header written by buildReplayHeader(), from a replay file or from a spectator relay.
+static bool readReplayHeader(ReplayHeaderReadFunc const &readBytes, ReplayHeaderSkipFunc const &skipBytes, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer, std::string &failReason)
+{
+	uint32_t replayNumber = 0;
+	if (!readReplayUBE32(readBytes, replayNumber) || replayNumber != magicReplayNumber)
 	{
-		return onFail("bad header");
+		failReason = "bad header";
+		return false;
 	}
 
 	uint32_t dataSize = 0;
-	PHYSFS_readUBE32(replayLoadHandle, &dataSize);
 	std::string data;
-	data.resize(dataSize);
-	size_t dataRead = WZ_PHYSFS_readBytes(replayLoadHandle, &data[0], data.size());
-	if (dataRead != data.size())
+	if (readReplayUBE32(readBytes, dataSize))
 	{
-		return onFail("truncated header");
+		data.resize(dataSize);
+	}
+	if (data.empty() || !readBytes(&data[0], data.size()))
+	{
+		failReason = "truncated header";
+		return false;
 	}
 
 	// Restore map name or map data and game settings and list of players in game and stuff.
@@ -328,8 +357,8 @@ bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optio
 			mismatchVersionDescription += astringf(_("Replay Format Version: %u"), static_cast<unsigned>(replayFormatVer));
 			wzDisplayDialog(Dialog_Error, _("Replay File Format Unsupported"), mismatchVersionDescription.c_str());
 
-			std::string failLogStr = "Replay file format is newer than this version of Warzone 2100 can support: " + std::to_string(replayFormatVer);
-			return onFail(failLogStr.c_str());
+			failReason = "Replay file format is newer than this version of Warzone 2100 can support: " + std::to_string(replayFormatVer);
+			return false;
 		}
 
 		uint32_t replay_netcodeMajor = settings.at("major").get<uint32_t>();
@@ -343,33 +372,31 @@ bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optio
 		ReplayOptionsHandler::EmbeddedMapData embeddedMapData;
 		if (replayFormatVer >= 2)
 		{
-			PHYSFS_readUBE32(replayLoadHandle, &embeddedMapData.dataVersion);
 			uint32_t binaryDataSize = 0;
-			PHYSFS_readUBE32(replayLoadHandle, &binaryDataSize);
+			if (!readReplayUBE32(readBytes, embeddedMapData.dataVersion) || !readReplayUBE32(readBytes, binaryDataSize))
+			{
+				failReason = "truncated embedded map data";
+				return false;
+			}
 			if (binaryDataSize > 0)
 			{
 				if (binaryDataSize <= optionsHandler.maximumEmbeddedMapBufferSize())
 				{
 					embeddedMapData.mapBinaryData.resize(binaryDataSize);
-					PHYSFS_sint64 binaryDataRead = WZ_PHYSFS_readBytes(replayLoadHandle, embeddedMapData.mapBinaryData.data(), embeddedMapData.mapBinaryData.size());
-					if (binaryDataRead != binaryDataSize)
+					if (!readBytes(embeddedMapData.mapBinaryData.data(), embeddedMapData.mapBinaryData.size()))
 					{
-						return onFail("truncated embedded map data");
+						failReason = "truncated embedded map data";
+						return false;
 					}
 				}
 				else
 				{
 					// don't even bother trying to load this - it's too big
 					// just attempt to skip to where it claims the map data ends
-					PHYSFS_sint64 filePos = PHYSFS_tell(replayLoadHandle);
-					if (filePos < 0)
+					if (!skipBytes(binaryDataSize))
 					{
-						return onFail("error getting current file position");
-					}
-					PHYSFS_uint64 afterMapDataPos = filePos + binaryDataSize;
-					if (PHYSFS_seek(replayLoadHandle, afterMapDataPos) == 0)
-					{
-						return onFail("failed to seek after map data");
+						failReason = "failed to skip map data";
+						return false;
 					}
 				}
 			}
@@ -378,14 +405,49 @@ bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optio
 		// Load game options using optionsHandler
 		if (!optionsHandler.restoreOptions(settings.at("gameOptions"), std::move(embeddedMapData), replay_netcodeMajor, replay_netcodeMinor))
 		{
-			return onFail("invalid options");
+			failReason = "invalid options";
+			return false;
 		}
 	}
 	catch (const std::exception& e)
 	{
 		// Failed to parse or find a key in the json
-		std::string parseError = std::string("Error parsing info JSON (\"") + e.what() + "\")";
-		return onFail(parseError.c_str());
+		failReason = std::string("Error parsing info JSON (\"") + e.what() + "\")";
+		return false;
+	}
+
+	return true;
+}
+
+bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer)
+{
+	auto onFail = [&](char const *reason) {
+		debug(LOG_ERROR, "Could not load replay file %s: %s", filename.c_str(), reason);
+		if (replayLoadHandle != nullptr)
+		{
+			PHYSFS_close(replayLoadHandle);
+			replayLoadHandle = nullptr;
+		}
+		return false;
+	};
+
+	replayLoadHandle = PHYSFS_openRead(filename.c_str());
+	if (replayLoadHandle == nullptr)
+	{
+		return onFail(WZ_PHYSFS_getLastError());
+	}
+
+	auto readBytes = [](void *buf, size_t size) {
+		return WZ_PHYSFS_readBytes(replayLoadHandle, buf, static_cast<PHYSFS_uint32>(size)) == static_cast<PHYSFS_sint64>(size);
+	};
+	auto skipBytes = [](size_t size) {
+		PHYSFS_sint64 filePos = PHYSFS_tell(replayLoadHandle);
+		return filePos >= 0 && PHYSFS_seek(replayLoadHandle, static_cast<PHYSFS_uint64>(filePos) + size) != 0;
+	};
+	std::string failReason;
+	if (!readReplayHeader(readBytes, skipBytes, optionsHandler, output_replayFormatVer, failReason))
+	{
+		return onFail(failReason.c_str());
 	}
 
 	debug(LOG_INFO, "Started reading replay file \"%s\".", filename.c_str());
@@ -445,3 +507,78 @@ bool NETreplayLoadStop()
 
 	return true;
 }
+
+void NETsetReplayRelayPort(unsigned port)
+{
+	replayRelayPort = port;
+}
+
+unsigned NETgetReplayRelayPort()
+{
+	return replayRelayPort;
+}
+
+bool NETreplayRelayStart(ReplayOptionsHandler const &optionsHandler)
+{
+	if (replayRelayPort == 0)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> header;
+	if (!buildReplayHeader(optionsHandler, header) || !replayRelayServer.listen(replayRelayPort))
+	{
+		return false;
+	}
+	replayRelayServer.setHeader(header);
+	return true;
+}
+
+void NETreplayRelayUpdate()
+{
+	replayRelayServer.update();
+}
+
+void NETreplayRelayStop()
+{
+	// Like NETreplaySaveStop(), end the stream with a REPLAY_ENDED message from the host.
+	replayRelayServer.appendMessage(NetMessage(REPLAY_ENDED), NetPlay.hostPlayer);
+	replayRelayServer.close();
+}
+
+bool NETreplayRelayLoadStart(std::string const &host, unsigned port, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer)
+{
+	if (!replayRelayClient.connect(host.c_str(), port, RELAY_CONNECT_TIMEOUT))
+	{
+		return false;
+	}
+
+	// The header comes first, so wait for it like for a file. The game messages arrive while the game runs.
+	auto readBytes = [](void *buf, size_t size) {
+		return replayRelayClient.readHeader(buf, size, RELAY_CONNECT_TIMEOUT);
+	};
+	auto skipBytes = [](size_t size) {
+		std::vector<uint8_t> ignored(size);
+		return replayRelayClient.readHeader(ignored.data(), size, RELAY_CONNECT_TIMEOUT);
+	};
+	std::string failReason;
+	if (!readReplayHeader(readBytes, skipBytes, optionsHandler, output_replayFormatVer, failReason))
+	{
+		debug(LOG_ERROR, "Could not watch relay %s:%u: %s", host.c_str(), port, failReason.c_str());
+		replayRelayClient.close();
+		return false;
+	}
+
+	debug(LOG_INFO, "Started watching relay %s:%u.", host.c_str(), port);
+	return true;
+}
+
+bool NETreplayRelayLoadNetMessages(std::vector<ReplayRelayRecord> &records)
+{
+	return replayRelayClient.receive(records);
+}
+
+void NETreplayRelayLoadStop()
+{
+	replayRelayClient.close();
+}
@@ -23,6 +23,7 @@
 #include "lib/framework/frame.h"
 
 #include "netplay.h"
+#include "netrelay.h"
 
 
 bool NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &optionsHandler, int maxReplaysSaved, bool appendPlayerToFilename = false);
@@ -33,4 +34,15 @@ bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optio
 bool NETreplayLoadNetMessage(std::unique_ptr<NetMessage> &message, uint8_t &player);
 bool NETreplayLoadStop();
 
+// Spectator relay, see netrelay.h. Everything NETreplaySaveNetMessage() gets is also relayed.
+void NETsetReplayRelayPort(unsigned port);  ///< 0 disables the relay.
+unsigned NETgetReplayRelayPort();
+bool NETreplayRelayStart(ReplayOptionsHandler const &optionsHandler);
+void NETreplayRelayUpdate();
+void NETreplayRelayStop();
+
+bool NETreplayRelayLoadStart(std::string const &host, unsigned port, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer);
+bool NETreplayRelayLoadNetMessages(std::vector<ReplayRelayRecord> &records);  ///< Returns false once the relay closed the connection.
+void NETreplayRelayLoadStop();
+
 #endif // _NETREPLAY_H
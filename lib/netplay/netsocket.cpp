@@ -30,6 +30,8 @@
 
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <deque>
 #include <map>
 
 #if !defined(ZLIB_CONST)
@@ -37,6 +39,13 @@
 #endif
 #include <zlib.h>
 
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+# include <zstd.h>
+# include <zstd_errors.h>
+# define WZ_SOCKET_ZSTD_LEVEL 3        ///< zstd's default level, which typically compresses as well as zlib level 6 in much less CPU time.
+# define WZ_SOCKET_ZSTD_WINDOW_LOG 17  ///< 128 KiB, plenty for repeats in game messages, and it keeps the memory of each connection small.
+#endif
+
 #if defined(__clang__)
 	#pragma clang diagnostic ignored "-Wshorten-64-to-32" // FIXME!!
 #endif
@@ -47,6 +56,15 @@
 // Already included Winsock2.h which defines TCP_NODELAY
 #endif
 
+// On Linux, socket sets and the socket thread wait on epoll instead of select(), which rebuilds its fd sets
+// on every call and can't watch descriptors above FD_SETSIZE.
+#if defined(WZ_OS_LINUX)
+# include <poll.h>
+# include <sys/epoll.h>
+# define WZ_SOCKET_EPOLL
+# define SOCKET_THREAD_MAX_EVENTS 64
+#endif
+
 enum
 {
 	SOCK_CONNECTION,
@@ -78,17 +96,43 @@ struct Socket
 
 	bool isCompressed;
 	bool readDisconnected;  ///< True iff a call to recv() returned 0.
+#if defined(WZ_SOCKET_EPOLL)
+	bool edgeReadable = false;  ///< epoll reported data to read, and recv() hasn't come back short since. (The events are edge-triggered.)
+#endif
+	SocketCompression compression = SocketCompression::Zlib;  ///< Only meaningful if isCompressed.
 	z_stream zDeflate;
 	z_stream zInflate;
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+	ZSTD_CCtx *zstdCompress = nullptr;
+	ZSTD_DCtx *zstdDecompress = nullptr;
+	ZSTD_inBuffer zstdInput = {nullptr, 0, 0};  ///< Compressed data in zInflateInBuf, not decompressed yet.
+#endif
 	unsigned zDeflateInSize;
-	bool zInflateNeedInput;
-	std::vector<uint8_t> zDeflateOutBuf;
+	bool zInflateNeedInput;  ///< All data received was decompressed, whichever the codec.
+	std::vector<uint8_t> zDeflateOutBuf;  ///< Compressed data waiting for socketFlush(), whichever the codec.
 	std::vector<uint8_t> zInflateInBuf;
+
+	SocketStatistics statistics;
 };
 
 struct SocketSet
 {
 	std::vector<Socket *> fds;
+#if defined(WZ_SOCKET_EPOLL)
+	SocketSet(std::vector<Socket *> sockets = {}) : fds(std::move(sockets)) {}
+	SocketSet(const SocketSet &) = delete;  // Would close epollFd twice.
+	SocketSet &operator=(const SocketSet &) = delete;
+	~SocketSet()
+	{
+		if (epollFd != -1)
+		{
+			close(epollFd);
+		}
+	}
+
+	int epollFd = -1;  ///< Only sets made by allocSocketSet() have one, temporary sets are checked with poll().
+	mutable std::vector<struct epoll_event> events;
+#endif
 };
 
 
@@ -96,8 +140,28 @@ static WZ_MUTEX *socketThreadMutex;
 static WZ_SEMAPHORE *socketThreadSemaphore;
 static WZ_THREAD *socketThread = nullptr;
 static bool socketThreadQuit;
-typedef std::map<Socket *, std::vector<uint8_t>> SocketThreadWriteMap;
+/// Data queued for the socket thread to write. Shared data may be queued for other sockets too, and is never modified.
+struct SocketWriteChunk
+{
+	SocketWriteChunk(std::vector<uint8_t> &&data) : owned(std::move(data)) {}
+	SocketWriteChunk(std::shared_ptr<const std::vector<uint8_t>> data) : shared(std::move(data)) {}
+
+	const std::vector<uint8_t> &bytes() const
+	{
+		return shared ? *shared : owned;
+	}
+
+	std::shared_ptr<const std::vector<uint8_t>> shared;
+	std::vector<uint8_t> owned;
+	size_t offset = 0;  ///< Bytes already written.
+};
+typedef std::deque<SocketWriteChunk> SocketWriteQueue;
+typedef std::map<Socket *, SocketWriteQueue> SocketThreadWriteMap;
 static SocketThreadWriteMap socketThreadWrites;
+#if defined(WZ_SOCKET_EPOLL)
+static int socketThreadEpollFd = -1;
+static bool socketThreadEpoll = false;  ///< Whether the socket thread waits on socketThreadEpollFd, or falls back to select().
+#endif
 
 
 static void socketCloseNow(Socket *sock);
@@ -400,118 +464,192 @@ static bool connectionIsOpen(Socket *sock)
 	return true;
 }
 
-static int socketThreadFunction(void *)
+/// Stop writing to the socket, and close it if socketClose() was waiting for the writes. Call with socketThreadMutex locked.
+static void socketThreadWritesErase(SocketThreadWriteMap::iterator w)
 {
-	wzMutexLock(socketThreadMutex);
-	while (!socketThreadQuit)
+	Socket *sock = w->first;
+#if defined(WZ_SOCKET_EPOLL)
+	if (socketThreadEpoll)
 	{
-#if   defined(WZ_OS_UNIX)
-		SOCKET maxfd = INT_MIN;
-#elif defined(WZ_OS_WIN)
-		SOCKET maxfd = 0;
+		epoll_ctl(socketThreadEpollFd, EPOLL_CTL_DEL, sock->fd[SOCK_CONNECTION], nullptr);
+	}
 #endif
-		fd_set fds;
-		FD_ZERO(&fds);
-		size_t descriptorsToWaitOn = 0;
-		for (SocketThreadWriteMap::iterator i = socketThreadWrites.begin(); i != socketThreadWrites.end();)
+	socketThreadWrites.erase(w);
+	if (sock->deleteLater)
+	{
+		socketCloseNow(sock);
+	}
+}
+
+/// Get the queue of data the socket thread is writing to the socket, and make sure the socket thread is waiting for it. Call with socketThreadMutex locked.
+static SocketWriteQueue &socketThreadWriteQueue(Socket &sock)
+{
+	if (socketThreadWrites.empty())
+	{
+		wzSemaphorePost(socketThreadSemaphore);
+	}
+	SocketThreadWriteMap::iterator w = socketThreadWrites.find(&sock);
+	if (w == socketThreadWrites.end())
+	{
+		w = socketThreadWrites.emplace(&sock, SocketWriteQueue()).first;
+#if defined(WZ_SOCKET_EPOLL)
+		if (socketThreadEpoll)
 		{
-			if (!i->second.empty())
+			// Adding the socket reports it as writable right away, if there is room in its send buffer.
+			struct epoll_event event = {};
+			event.events = EPOLLOUT | EPOLLET;
+			event.data.ptr = &sock;
+			if (epoll_ctl(socketThreadEpollFd, EPOLL_CTL_ADD, sock.fd[SOCK_CONNECTION], &event) == SOCKET_ERROR)
 			{
-				SOCKET fd = i->first->fd[SOCK_CONNECTION];
-				maxfd = std::max(maxfd, fd);
-				ASSERT(!FD_ISSET(fd, &fds), "Duplicate file descriptor!");  // Shouldn't be possible, but blocking in send, after select says it won't block, shouldn't be possible either.
-				FD_SET(fd, &fds);
-				++descriptorsToWaitOn;
-				++i;
+				debug(LOG_ERROR, "Failed to watch socket %p for writing, falling back to select(): %s", static_cast<void *>(&sock), strSockError(getSockErr()));
+				socketThreadEpoll = false;
 			}
-			else
+		}
+#endif
+	}
+	return w->second;
+}
+
+/// Write as much of the queued data to the socket as it takes. Call with socketThreadMutex locked.
+static void socketThreadWrite(SocketThreadWriteMap::iterator w)
+{
+	Socket *sock = w->first;
+	SocketWriteQueue &writeQueue = w->second;
+	ASSERT(!writeQueue.empty(), "writeQueue[sock] must not be empty.");
+
+	bool wroteSome = false;
+	while (!writeQueue.empty())
+	{
+		SocketWriteChunk &chunk = writeQueue.front();
+		const std::vector<uint8_t> &data = chunk.bytes();
+
+		// Write data.
+		// FIXME SOMEHOW AAARGH This send() call can't block, but unless the socket is not set to blocking (setting the socket to nonblocking had better work, or else), does anyway (at least sometimes, when someone quits). Not reproducible except in public releases.
+		ssize_t retSent = send(sock->fd[SOCK_CONNECTION], reinterpret_cast<const char *>(data.data() + chunk.offset), data.size() - chunk.offset, MSG_NOSIGNAL);
+		if (retSent != SOCKET_ERROR)
+		{
+			// Skip as much data as written. Keep sending until the send buffer is full (EAGAIN), since with edge-triggered
+			// epoll the socket is only reported as writable again after that.
+			chunk.offset += retSent;
+			wroteSome = true;
+			if (chunk.offset == data.size())
 			{
-				ASSERT(false, "Empty buffer for pending socket writes"); // This shouldn't happen!
-				Socket *sock = i->first;
-				i = socketThreadWrites.erase(i);
-				if (sock->deleteLater)
-				{
-					socketCloseNow(sock);
-				}
+				writeQueue.pop_front();
 			}
+			continue;
 		}
-		struct timeval tv = {0, 50 * 1000};
 
-		// Check if we can write to any sockets.
-		int ret = -1;
-		if (descriptorsToWaitOn > 0)
+		switch (getSockErr())
 		{
-			wzMutexUnlock(socketThreadMutex);
-			ret = select(maxfd + 1, nullptr, &fds, nullptr, &tv);
-			wzMutexLock(socketThreadMutex);
+		case EAGAIN:
+#if defined(EWOULDBLOCK) && EAGAIN != EWOULDBLOCK
+		case EWOULDBLOCK:
+#endif
+			if (!wroteSome && !connectionIsOpen(sock))
+			{
+				debug(LOG_NET, "Socket error");
+				sock->writeErrorCode = make_network_error_code(getSockErr());
+				socketThreadWritesErase(w);  // Socket broken, don't try writing to it again.
+			}
+			return;
+		case EINTR:
+			continue;  // Interrupted before sending anything, so try again.
+#if defined(EPIPE)
+		case EPIPE:
+#endif
+		default:
+			sock->writeErrorCode = make_network_error_code(getSockErr());
+			socketThreadWritesErase(w);  // Socket broken, don't try writing to it again.
+			return;
 		}
+	}
+
+	socketThreadWritesErase(w);  // Nothing left to write, delete from pending list.
+}
+
+static int socketThreadFunction(void *)
+{
+	wzMutexLock(socketThreadMutex);
+	while (!socketThreadQuit)
+	{
+#if defined(WZ_SOCKET_EPOLL)
+		if (socketThreadEpoll)
+		{
+			// Sockets are watched from when data is queued for them until their queue is empty. The events are
+			// edge-triggered, so a socket is reported again only after a send() filled up its send buffer.
+			struct epoll_event events[SOCKET_THREAD_MAX_EVENTS];
+			int ret = -1;
+			if (!socketThreadWrites.empty())
+			{
+				wzMutexUnlock(socketThreadMutex);
+				ret = epoll_wait(socketThreadEpollFd, events, SOCKET_THREAD_MAX_EVENTS, 50);
+				wzMutexLock(socketThreadMutex);
+			}
 
-		// We can write to some sockets. (Ignore errors from select, we may have deleted the socket after unlocking the mutex, and before calling select.)
-		if (ret > 0)
+			for (int i = 0; i < ret; ++i)
+			{
+				// The queue may have been written out, and the socket closed, while the mutex was unlocked.
+				SocketThreadWriteMap::iterator w = socketThreadWrites.find(static_cast<Socket *>(events[i].data.ptr));
+				if (w != socketThreadWrites.end())
+				{
+					socketThreadWrite(w);
+				}
+			}
+		}
+		else
+#endif
 		{
+#if   defined(WZ_OS_UNIX)
+			SOCKET maxfd = INT_MIN;
+#elif defined(WZ_OS_WIN)
+			SOCKET maxfd = 0;
+#endif
+			fd_set fds;
+			FD_ZERO(&fds);
+			size_t descriptorsToWaitOn = 0;
 			for (SocketThreadWriteMap::iterator i = socketThreadWrites.begin(); i != socketThreadWrites.end();)
 			{
 				SocketThreadWriteMap::iterator w = i;
 				++i;
-
-				Socket *sock = w->first;
-				std::vector<uint8_t> &writeQueue = w->second;
-				ASSERT(!writeQueue.empty(), "writeQueue[sock] must not be empty.");
-
-				if (!FD_ISSET(sock->fd[SOCK_CONNECTION], &fds))
+				if (!w->second.empty())
 				{
-					continue;  // This socket is not ready for writing, or we don't have anything to write.
+					SOCKET fd = w->first->fd[SOCK_CONNECTION];
+					maxfd = std::max(maxfd, fd);
+					ASSERT(!FD_ISSET(fd, &fds), "Duplicate file descriptor!");  // Shouldn't be possible, but blocking in send, after select says it won't block, shouldn't be possible either.
+					FD_SET(fd, &fds);
+					++descriptorsToWaitOn;
 				}
-
-				// Write data.
-				// FIXME SOMEHOW AAARGH This send() call can't block, but unless the socket is not set to blocking (setting the socket to nonblocking had better work, or else), does anyway (at least sometimes, when someone quits). Not reproducible except in public releases.
-				ssize_t retSent = send(sock->fd[SOCK_CONNECTION], reinterpret_cast<char *>(&writeQueue[0]), writeQueue.size(), MSG_NOSIGNAL);
-				if (retSent != SOCKET_ERROR)
+				else
 				{
-					// Erase as much data as written.
-					writeQueue.erase(writeQueue.begin(), writeQueue.begin() + retSent);
-					if (writeQueue.empty())
-					{
-						socketThreadWrites.erase(w);  // Nothing left to write, delete from pending list.
-						if (sock->deleteLater)
-						{
-							socketCloseNow(sock);
-						}
-					}
+					ASSERT(false, "Empty buffer for pending socket writes"); // This shouldn't happen!
+					socketThreadWritesErase(w);
 				}
-				else
+			}
+			struct timeval tv = {0, 50 * 1000};
+
+			// Check if we can write to any sockets.
+			int ret = -1;
+			if (descriptorsToWaitOn > 0)
+			{
+				wzMutexUnlock(socketThreadMutex);
+				ret = select(maxfd + 1, nullptr, &fds, nullptr, &tv);
+				wzMutexLock(socketThreadMutex);
+			}
+
+			// We can write to some sockets. (Ignore errors from select, we may have deleted the socket after unlocking the mutex, and before calling select.)
+			if (ret > 0)
+			{
+				for (SocketThreadWriteMap::iterator i = socketThreadWrites.begin(); i != socketThreadWrites.end();)
 				{
-					switch (getSockErr())
+					SocketThreadWriteMap::iterator w = i;
+					++i;
+
+					if (!FD_ISSET(w->first->fd[SOCK_CONNECTION], &fds))
 					{
-					case EAGAIN:
-#if defined(EWOULDBLOCK) && EAGAIN != EWOULDBLOCK
-					case EWOULDBLOCK:
-#endif
-						if (!connectionIsOpen(sock))
-						{
-							debug(LOG_NET, "Socket error");
-							sock->writeErrorCode = make_network_error_code(getSockErr());
-							socketThreadWrites.erase(w);  // Socket broken, don't try writing to it again.
-							if (sock->deleteLater)
-							{
-								socketCloseNow(sock);
-							}
-							break;
-						}
-					case EINTR:
-						break;
-#if defined(EPIPE)
-					case EPIPE:
-#endif
-					default:
-						sock->writeErrorCode = make_network_error_code(getSockErr());
-						socketThreadWrites.erase(w);  // Socket broken, don't try writing to it again.
-						if (sock->deleteLater)
-						{
-							socketCloseNow(sock);
-						}
-						break;
+						continue;  // This socket is not ready for writing, or we don't have anything to write.
 					}
+
+					socketThreadWrite(w);
 				}
 			}
 		}
@@ -529,6 +667,56 @@ static int socketThreadFunction(void *)
 	return 42;  // Return value arbitrary and unused.
 }
 
+static SocketStatistics socketTotals;
+
+// Adds to the statistics of the socket, and to the totals of all sockets.
+static void countSocketStatistic(Socket& sock, size_t SocketStatistics::*statistic, size_t count)
+{
+	sock.statistics.*statistic += count;
+	socketTotals.*statistic += count;
+}
+
+static void countSocketTime(Socket& sock, uint64_t SocketStatistics::*statistic, std::chrono::steady_clock::time_point start)
+{
+	uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	sock.statistics.*statistic += microseconds;
+	socketTotals.*statistic += microseconds;
+}
+
+const SocketStatistics &socketStatistics(const Socket& sock)
+{
+	return sock.statistics;
+}
+
+const SocketStatistics &socketTotalStatistics()
+{
+	return socketTotals;
+}
+
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+/// Compresses data to zDeflateOutBuf. ZSTD_e_flush also outputs everything zstd held back so far.
+static void socketZstdCompress(Socket& sock, const void *buf, size_t size, ZSTD_EndDirective directive)
+{
+	auto compressStart = std::chrono::steady_clock::now();
+	ZSTD_inBuffer input = {buf, size, 0};
+	size_t remaining = 0;
+	do
+	{
+		size_t alreadyHave = sock.zDeflateOutBuf.size();
+		sock.zDeflateOutBuf.resize(alreadyHave + ZSTD_compressBound(input.size - input.pos));  // Enough to always do everything in one go.
+		ZSTD_outBuffer output = {&sock.zDeflateOutBuf[alreadyHave], sock.zDeflateOutBuf.size() - alreadyHave, 0};
+
+		remaining = ZSTD_compressStream2(sock.zstdCompress, &output, &input, directive);
+		ASSERT(!ZSTD_isError(remaining), "zstd compression failed: %s", ZSTD_getErrorName(remaining));
+
+		// Remove unused part of buffer.
+		sock.zDeflateOutBuf.resize(alreadyHave + output.pos);
+	}
+	while (!ZSTD_isError(remaining) && (directive == ZSTD_e_flush ? remaining != 0 : input.pos < input.size));
+	countSocketTime(sock, &SocketStatistics::compressMicroseconds, compressStart);
+}
+#endif
+
 /**
  * Similar to read(2) with the exception that this function won't be
  * interrupted by signals (EINTR).
@@ -560,14 +748,34 @@ net::result<ssize_t> readNoInt(Socket& sock, void *buf, size_t max_size, size_t
 				received = recv(sock.fd[SOCK_CONNECTION], (char *)&sock.zInflateInBuf[0], sock.zInflateInBuf.size(), 0);
 			}
 			while (received == SOCKET_ERROR && getSockErr() == EINTR);
+#if defined(WZ_SOCKET_EPOLL)
+			if (received < static_cast<ssize_t>(sock.zInflateInBuf.size()))
+			{
+				sock.edgeReadable = false;  // Read everything there was, wait for the next event.
+			}
+#endif
+			if (received == SOCKET_ERROR && (getSockErr() == EAGAIN || getSockErr() == EWOULDBLOCK))
+			{
+				return 0;  // Nothing to read after all.
+			}
 			if (received < 0)
 			{
 				return tl::make_unexpected(make_network_error_code(getSockErr()));
 			}
 
-			sock.zInflate.next_in = &sock.zInflateInBuf[0];
-			sock.zInflate.avail_in = received;
+			if (sock.compression == SocketCompression::Zlib)
+			{
+				sock.zInflate.next_in = &sock.zInflateInBuf[0];
+				sock.zInflate.avail_in = received;
+			}
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+			else
+			{
+				sock.zstdInput = {&sock.zInflateInBuf[0], static_cast<size_t>(received), 0};
+			}
+#endif
 			rawBytes = received;
+			countSocketStatistic(sock, &SocketStatistics::compressedBytesReceived, received);
 
 			if (received == 0)
 			{
@@ -579,36 +787,69 @@ net::result<ssize_t> readNoInt(Socket& sock, void *buf, size_t max_size, size_t
 			}
 		}
 
-		sock.zInflate.next_out = (Bytef *)buf;
-		sock.zInflate.avail_out = max_size;
-		int ret = inflate(&sock.zInflate, Z_NO_FLUSH);
-		ASSERT(ret != Z_STREAM_ERROR, "zlib inflate not working!");
-		char const *err = nullptr;
-		switch (ret)
+		size_t decompressed = 0;
+		auto inflateStart = std::chrono::steady_clock::now();
+		if (sock.compression == SocketCompression::Zlib)
 		{
-		case Z_NEED_DICT:  err = "Z_NEED_DICT";  break;
-		case Z_DATA_ERROR: err = "Z_DATA_ERROR"; break;
-		case Z_MEM_ERROR:  err = "Z_MEM_ERROR";  break;
+			sock.zInflate.next_out = (Bytef *)buf;
+			sock.zInflate.avail_out = max_size;
+			int ret = inflate(&sock.zInflate, Z_NO_FLUSH);
+			countSocketTime(sock, &SocketStatistics::decompressMicroseconds, inflateStart);
+			ASSERT(ret != Z_STREAM_ERROR, "zlib inflate not working!");
+			char const *err = nullptr;
+			switch (ret)
+			{
+			case Z_NEED_DICT:  err = "Z_NEED_DICT";  break;
+			case Z_DATA_ERROR: err = "Z_DATA_ERROR"; break;
+			case Z_MEM_ERROR:  err = "Z_MEM_ERROR";  break;
+			}
+			if (err != nullptr)
+			{
+				debug(LOG_ERROR, "Couldn't decompress data from socket. zlib error %s", err);
+				// Bad data!
+				return tl::make_unexpected(make_zlib_error_code(ret));
+			}
+
+			if (sock.zInflate.avail_out != 0)
+			{
+				sock.zInflateNeedInput = true;
+				ASSERT(sock.zInflate.avail_in == 0, "zlib not consuming all input!");
+			}
+			decompressed = max_size - sock.zInflate.avail_out;
 		}
-		if (err != nullptr)
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+		else
 		{
-			debug(LOG_ERROR, "Couldn't decompress data from socket. zlib error %s", err);
-			// Bad data!
-			return tl::make_unexpected(make_zlib_error_code(ret));
-		}
+			ZSTD_outBuffer output = {buf, max_size, 0};
+			size_t ret = ZSTD_decompressStream(sock.zstdDecompress, &output, &sock.zstdInput);
+			countSocketTime(sock, &SocketStatistics::decompressMicroseconds, inflateStart);
+			if (ZSTD_isError(ret))
+			{
+				debug(LOG_ERROR, "Couldn't decompress data from socket. zstd error %s", ZSTD_getErrorName(ret));
+				// Bad data!
+				return tl::make_unexpected(make_zstd_error_code(ZSTD_getErrorCode(ret)));
+			}
 
-		if (sock.zInflate.avail_out != 0)
-		{
-			sock.zInflateNeedInput = true;
-			ASSERT(sock.zInflate.avail_in == 0, "zlib not consuming all input!");
+			// With room left in the output, zstd has returned everything it could decode from the input.
+			if (output.pos < output.size && sock.zstdInput.pos == sock.zstdInput.size)
+			{
+				sock.zInflateNeedInput = true;
+			}
+			decompressed = output.pos;
 		}
+#endif
 
 		if (sock.readDisconnected)
 		{
 			return tl::make_unexpected(make_network_error_code(ECONNRESET));
 		}
 
-		return max_size - sock.zInflate.avail_out;  // Got some data, return how much.
+		if (decompressed > 0)
+		{
+			countSocketStatistic(sock, &SocketStatistics::uncompressedBytesReceived, decompressed);
+			countSocketStatistic(sock, &SocketStatistics::packetsReceived, 1);
+		}
+		return decompressed;  // Got some data, return how much.
 	}
 
 	ssize_t received;
@@ -623,12 +864,28 @@ net::result<ssize_t> readNoInt(Socket& sock, void *buf, size_t max_size, size_t
 	while (received == SOCKET_ERROR && getSockErr() == EINTR);
 
 	sock.ready = false;
+#if defined(WZ_SOCKET_EPOLL)
+	if (received < static_cast<ssize_t>(max_size))
+	{
+		sock.edgeReadable = false;  // Read everything there was, wait for the next event.
+	}
+#endif
 	if (sock.readDisconnected)
 	{
 		return tl::make_unexpected(make_network_error_code(ECONNRESET));
 	}
+	if (received == SOCKET_ERROR && (getSockErr() == EAGAIN || getSockErr() == EWOULDBLOCK))
+	{
+		return 0;  // Nothing to read after all.
+	}
 
 	rawBytes = received;
+	if (received > 0)
+	{
+		countSocketStatistic(sock, &SocketStatistics::compressedBytesReceived, received);
+		countSocketStatistic(sock, &SocketStatistics::uncompressedBytesReceived, received);
+		countSocketStatistic(sock, &SocketStatistics::packetsReceived, 1);
+	}
 	return received;
 }
 
@@ -657,18 +914,29 @@ net::result<ssize_t> writeAll(Socket& sock, const void *buf, size_t size, size_t
 
 	if (size > 0)
 	{
+		countSocketStatistic(sock, &SocketStatistics::uncompressedBytesSent, size);
+		countSocketStatistic(sock, &SocketStatistics::packetsSent, 1);
 		if (!sock.isCompressed)
 		{
+			countSocketStatistic(sock, &SocketStatistics::compressedBytesSent, size);
 			wzMutexLock(socketThreadMutex);
-			if (socketThreadWrites.empty())
+			SocketWriteQueue &writeQueue = socketThreadWriteQueue(sock);
+			if (writeQueue.empty() || writeQueue.back().shared)
 			{
-				wzSemaphorePost(socketThreadSemaphore);
+				writeQueue.emplace_back(std::vector<uint8_t>());
 			}
-			std::vector<uint8_t> &writeQueue = socketThreadWrites[&sock];
-			writeQueue.insert(writeQueue.end(), static_cast<char const *>(buf), static_cast<char const *>(buf) + size);
+			std::vector<uint8_t> &owned = writeQueue.back().owned;
+			owned.insert(owned.end(), static_cast<char const *>(buf), static_cast<char const *>(buf) + size);
 			wzMutexUnlock(socketThreadMutex);
 			rawBytes = size;
 		}
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+		else if (sock.compression == SocketCompression::Zstd)
+		{
+			sock.zDeflateInSize += size;
+			socketZstdCompress(sock, buf, size, ZSTD_e_continue);
+		}
+#endif
 		else
 		{
 		#if ZLIB_VERNUM < 0x1252
@@ -698,6 +966,7 @@ net::result<ssize_t> writeAll(Socket& sock, const void *buf, size_t size, size_t
 
 			sock.zDeflate.avail_in = size;
 			sock.zDeflateInSize += sock.zDeflate.avail_in;
+			auto deflateStart = std::chrono::steady_clock::now();
 			do
 			{
 				size_t alreadyHave = sock.zDeflateOutBuf.size();
@@ -712,6 +981,7 @@ net::result<ssize_t> writeAll(Socket& sock, const void *buf, size_t size, size_t
 				sock.zDeflateOutBuf.resize(sock.zDeflateOutBuf.size() - sock.zDeflate.avail_out);
 			}
 			while (sock.zDeflate.avail_out == 0);
+			countSocketTime(sock, &SocketStatistics::compressMicroseconds, deflateStart);
 
 			ASSERT(sock.zDeflate.avail_in == 0, "zlib didn't compress everything!");
 		}
@@ -720,6 +990,31 @@ net::result<ssize_t> writeAll(Socket& sock, const void *buf, size_t size, size_t
 	return size;
 }
 
+net::result<ssize_t> writeAll(Socket& sock, const std::shared_ptr<const std::vector<uint8_t>> &data, size_t *rawByteCount)
+{
+	ASSERT_OR_RETURN(tl::make_unexpected(make_network_error_code(EINVAL)), data != nullptr, "No data");
+
+	if (sock.isCompressed || sock.fd[SOCK_CONNECTION] == INVALID_SOCKET || sock.writeErrorCode.has_value() || data->empty())
+	{
+		// Compression reads the data right away, so there is nothing to keep a reference to.
+		return writeAll(sock, data->data(), data->size(), rawByteCount);
+	}
+
+	wzMutexLock(socketThreadMutex);
+	socketThreadWriteQueue(sock).emplace_back(data);
+	wzMutexUnlock(socketThreadMutex);
+
+	countSocketStatistic(sock, &SocketStatistics::uncompressedBytesSent, data->size());
+	countSocketStatistic(sock, &SocketStatistics::compressedBytesSent, data->size());
+	countSocketStatistic(sock, &SocketStatistics::packetsSent, 1);
+
+	if (rawByteCount != nullptr)
+	{
+		*rawByteCount = data->size();
+	}
+	return data->size();
+}
+
 void socketFlush(Socket& sock, uint8_t player, size_t *rawByteCount)
 {
 	size_t ignored;
@@ -733,36 +1028,45 @@ void socketFlush(Socket& sock, uint8_t player, size_t *rawByteCount)
 
 	ASSERT(!sock.writeErrorCode.has_value(), "Socket write error?? (Player: %" PRIu8 "", player);
 
-	// Flush data out of zlib compression state.
-	do
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+	if (sock.compression == SocketCompression::Zstd)
 	{
-		sock.zDeflate.next_in = (Bytef *)nullptr;
-		sock.zDeflate.avail_in = 0;
-		size_t alreadyHave = sock.zDeflateOutBuf.size();
-		sock.zDeflateOutBuf.resize(alreadyHave + 1000);  // 100 bytes would probably be enough to flush the rest in one go.
-		sock.zDeflate.next_out = (Bytef *)&sock.zDeflateOutBuf[alreadyHave];
-		sock.zDeflate.avail_out = sock.zDeflateOutBuf.size() - alreadyHave;
-
-		int ret = deflate(&sock.zDeflate, Z_PARTIAL_FLUSH);
-		ASSERT(ret != Z_STREAM_ERROR, "zlib compression failed!");
-
-		// Remove unused part of buffer.
-		sock.zDeflateOutBuf.resize(sock.zDeflateOutBuf.size() - sock.zDeflate.avail_out);
+		// Flush data out of zstd compression state.
+		socketZstdCompress(sock, nullptr, 0, ZSTD_e_flush);
+	}
+	else
+#endif
+	{
+		// Flush data out of zlib compression state.
+		auto deflateStart = std::chrono::steady_clock::now();
+		do
+		{
+			sock.zDeflate.next_in = (Bytef *)nullptr;
+			sock.zDeflate.avail_in = 0;
+			size_t alreadyHave = sock.zDeflateOutBuf.size();
+			sock.zDeflateOutBuf.resize(alreadyHave + 1000);  // 100 bytes would probably be enough to flush the rest in one go.
+			sock.zDeflate.next_out = (Bytef *)&sock.zDeflateOutBuf[alreadyHave];
+			sock.zDeflate.avail_out = sock.zDeflateOutBuf.size() - alreadyHave;
+
+			int ret = deflate(&sock.zDeflate, Z_PARTIAL_FLUSH);
+			ASSERT(ret != Z_STREAM_ERROR, "zlib compression failed!");
+
+			// Remove unused part of buffer.
+			sock.zDeflateOutBuf.resize(sock.zDeflateOutBuf.size() - sock.zDeflate.avail_out);
+		}
+		while (sock.zDeflate.avail_out == 0);
+		countSocketTime(sock, &SocketStatistics::compressMicroseconds, deflateStart);
 	}
-	while (sock.zDeflate.avail_out == 0);
 
 	if (sock.zDeflateOutBuf.empty())
 	{
 		return;  // No data to flush out.
 	}
 
+	countSocketStatistic(sock, &SocketStatistics::compressedBytesSent, sock.zDeflateOutBuf.size());
 	wzMutexLock(socketThreadMutex);
-	if (socketThreadWrites.empty())
-	{
-		wzSemaphorePost(socketThreadSemaphore);
-	}
-	std::vector<uint8_t> &writeQueue = socketThreadWrites[&sock];
-	writeQueue.insert(writeQueue.end(), sock.zDeflateOutBuf.begin(), sock.zDeflateOutBuf.end());
+	rawBytes = sock.zDeflateOutBuf.size();
+	socketThreadWriteQueue(sock).emplace_back(std::move(sock.zDeflateOutBuf));
 	wzMutexUnlock(socketThreadMutex);
 
 	// Primitive network logging, uncomment to use.
@@ -771,12 +1075,30 @@ void socketFlush(Socket& sock, uint8_t player, size_t *rawByteCount)
 	//printf("\n");
 
 	// Data sent, don't send again.
-	rawBytes = sock.zDeflateOutBuf.size();
 	sock.zDeflateInSize = 0;
 	sock.zDeflateOutBuf.clear();
 }
 
-void socketBeginCompression(Socket& sock)
+uint32_t socketSupportedCompressions()
+{
+	uint32_t supported = 1 << static_cast<uint32_t>(SocketCompression::Zlib);
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+	supported |= 1 << static_cast<uint32_t>(SocketCompression::Zstd);
+#endif
+	return supported;
+}
+
+SocketCompression socketChooseCompression(uint32_t peerCompressions)
+{
+	uint32_t common = socketSupportedCompressions() & peerCompressions;
+	if (common & (1 << static_cast<uint32_t>(SocketCompression::Zstd)))
+	{
+		return SocketCompression::Zstd;
+	}
+	return SocketCompression::Zlib;  // Every build has it.
+}
+
+void socketBeginCompression(Socket& sock, SocketCompression compression)
 {
 	if (sock.isCompressed)
 	{
@@ -785,21 +1107,39 @@ void socketBeginCompression(Socket& sock)
 
 	wzMutexLock(socketThreadMutex);
 
-	// Init deflate.
-	sock.zDeflate.zalloc = Z_NULL;
-	sock.zDeflate.zfree = Z_NULL;
-	sock.zDeflate.opaque = Z_NULL;
-	int ret = deflateInit(&sock.zDeflate, 6);
-	ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
-
-	sock.zInflate.zalloc = Z_NULL;
-	sock.zInflate.zfree = Z_NULL;
-	sock.zInflate.opaque = Z_NULL;
-	sock.zInflate.avail_in = 0;
-	sock.zInflate.next_in = Z_NULL;
-	ret = inflateInit(&sock.zInflate);
-	ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+	if (compression == SocketCompression::Zstd)
+	{
+		sock.zstdCompress = ZSTD_createCCtx();
+		sock.zstdDecompress = ZSTD_createDCtx();
+		ASSERT(sock.zstdCompress != nullptr && sock.zstdDecompress != nullptr, "Failed to create zstd contexts! Sockets won't work.");
+		ZSTD_CCtx_setParameter(sock.zstdCompress, ZSTD_c_compressionLevel, WZ_SOCKET_ZSTD_LEVEL);
+		ZSTD_CCtx_setParameter(sock.zstdCompress, ZSTD_c_windowLog, WZ_SOCKET_ZSTD_WINDOW_LOG);
+		sock.zstdInput = {nullptr, 0, 0};
+	}
+	else
+#endif
+	{
+		ASSERT(compression == SocketCompression::Zlib, "Compression %u isn't supported by this build, using zlib", static_cast<unsigned>(compression));
+		compression = SocketCompression::Zlib;
+
+		// Init deflate.
+		sock.zDeflate.zalloc = Z_NULL;
+		sock.zDeflate.zfree = Z_NULL;
+		sock.zDeflate.opaque = Z_NULL;
+		int ret = deflateInit(&sock.zDeflate, 6);
+		ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
+
+		sock.zInflate.zalloc = Z_NULL;
+		sock.zInflate.zfree = Z_NULL;
+		sock.zInflate.opaque = Z_NULL;
+		sock.zInflate.avail_in = 0;
+		sock.zInflate.next_in = Z_NULL;
+		ret = inflateInit(&sock.zInflate);
+		ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
+	}
 
+	sock.compression = compression;
 	sock.zInflateNeedInput = true;
 
 	sock.isCompressed = true;
@@ -823,14 +1163,32 @@ Socket::~Socket()
 {
 	if (isCompressed)
 	{
-		deflateEnd(&zDeflate);
-		deflateEnd(&zInflate);
+#if defined(WZ_NETPLAY_ZSTD_ENABLED)
+		if (compression == SocketCompression::Zstd)
+		{
+			ZSTD_freeCCtx(zstdCompress);
+			ZSTD_freeDCtx(zstdDecompress);
+		}
+		else
+#endif
+		{
+			deflateEnd(&zDeflate);
+			deflateEnd(&zInflate);
+		}
 	}
 }
 
 SocketSet *allocSocketSet()
 {
-	return new SocketSet;
+	SocketSet *set = new SocketSet;
+#if defined(WZ_SOCKET_EPOLL)
+	set->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->epollFd == -1)
+	{
+		debug(LOG_ERROR, "Failed to create epoll instance, falling back to poll(): %s", strSockError(getSockErr()));
+	}
+#endif
+	return set;
 }
 
 void deleteSocketSet(SocketSet *set)
@@ -857,6 +1215,22 @@ void SocketSet_AddSocket(SocketSet& set, Socket *socket)
 
 	set.fds.push_back(socket);
 	debug(LOG_NET, "Socket added: set->fds[%lu] = %p", (unsigned long)i, static_cast<void *>(socket));
+
+#if defined(WZ_SOCKET_EPOLL)
+	if (set.epollFd != -1)
+	{
+		// Adding the socket reports it as readable right away, if data already arrived.
+		struct epoll_event event = {};
+		event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		event.data.ptr = socket;
+		if (epoll_ctl(set.epollFd, EPOLL_CTL_ADD, socket->fd[SOCK_CONNECTION], &event) == SOCKET_ERROR)
+		{
+			debug(LOG_ERROR, "Failed to watch socket %p, falling back to poll(): %s", static_cast<void *>(socket), strSockError(getSockErr()));
+			close(set.epollFd);
+			set.epollFd = -1;
+		}
+	}
+#endif
 }
 
 /**
@@ -869,6 +1243,12 @@ void SocketSet_DelSocket(SocketSet& set, Socket *socket)
 	{
 		debug(LOG_NET, "Socket %p erased (set->fds[%lu])", static_cast<void *>(socket), (unsigned long)i);
 		set.fds.erase(set.fds.begin() + i);
+#if defined(WZ_SOCKET_EPOLL)
+		if (set.epollFd != -1)
+		{
+			epoll_ctl(set.epollFd, EPOLL_CTL_DEL, socket->fd[SOCK_CONNECTION], nullptr);
+		}
+#endif
 	}
 }
 
@@ -965,6 +1345,77 @@ static void socketBlockSIGPIPE(const SOCKET fd, bool block_sigpipe)
 #endif
 }
 
+#if defined(WZ_SOCKET_EPOLL)
+/// Collect the readiness events of a set made by allocSocketSet(). Only waits if none of its sockets have data left from earlier events.
+static int checkSocketsEpoll(const SocketSet& set, unsigned int timeout)
+{
+	bool pending = false;
+	for (const Socket *sock : set.fds)
+	{
+		pending = pending || sock->edgeReadable || (sock->isCompressed && !sock->zInflateNeedInput);
+	}
+
+	set.events.resize(set.fds.size());
+	int ret;
+	do
+	{
+		ret = epoll_wait(set.epollFd, set.events.data(), static_cast<int>(set.events.size()), pending ? 0 : static_cast<int>(timeout));
+	}
+	while (ret == SOCKET_ERROR && getSockErr() == EINTR);
+
+	if (ret == SOCKET_ERROR)
+	{
+		debug(LOG_ERROR, "epoll_wait failed: %s", strSockError(getSockErr()));
+		return SOCKET_ERROR;
+	}
+
+	for (int i = 0; i < ret; ++i)
+	{
+		// Errors and hangups count as readable too, so that the next read reports them.
+		static_cast<Socket *>(set.events[i].data.ptr)->edgeReadable = true;
+	}
+
+	int numReady = 0;
+	for (Socket *sock : set.fds)
+	{
+		sock->ready = sock->edgeReadable || (sock->isCompressed && !sock->zInflateNeedInput);
+		numReady += sock->ready ? 1 : 0;
+	}
+	return numReady;
+}
+
+/// Check a temporary set with poll(), which unlike select() isn't limited to descriptors below FD_SETSIZE.
+static int checkSocketsPoll(const SocketSet& set, unsigned int timeout)
+{
+	std::vector<struct pollfd> fds(set.fds.size());
+	for (size_t i = 0; i < set.fds.size(); ++i)
+	{
+		fds[i].fd = set.fds[i]->fd[SOCK_CONNECTION];
+		fds[i].events = POLLIN;
+	}
+
+	int ret;
+	do
+	{
+		ret = poll(fds.data(), fds.size(), static_cast<int>(timeout));
+	}
+	while (ret == SOCKET_ERROR && getSockErr() == EINTR);
+
+	if (ret == SOCKET_ERROR)
+	{
+		debug(LOG_ERROR, "poll failed: %s", strSockError(getSockErr()));
+		return SOCKET_ERROR;
+	}
+
+	for (size_t i = 0; i < set.fds.size(); ++i)
+	{
+		set.fds[i]->ready = fds[i].revents != 0;
+	}
+
+	return ret;
+}
+#endif
+
 int checkSockets(const SocketSet& set, unsigned int timeout)
 {
 	if (set.fds.empty())
@@ -972,10 +1423,11 @@ int checkSockets(const SocketSet& set, unsigned int timeout)
 		return 0;
 	}
 
-#if   defined(WZ_OS_UNIX)
-	SOCKET maxfd = INT_MIN;
-#elif defined(WZ_OS_WIN)
-	SOCKET maxfd = 0;
+#if defined(WZ_SOCKET_EPOLL)
+	if (set.epollFd != -1)
+	{
+		return checkSocketsEpoll(set, timeout);
+	}
 #endif
 
 	bool compressedReady = false;
@@ -988,8 +1440,6 @@ int checkSockets(const SocketSet& set, unsigned int timeout)
 			compressedReady = true;
 			break;
 		}
-
-		maxfd = std::max(maxfd, set.fds[i]->fd[SOCK_CONNECTION]);
 	}
 
 	if (compressedReady)
@@ -1005,6 +1455,19 @@ int checkSockets(const SocketSet& set, unsigned int timeout)
 		return ret;
 	}
 
+#if defined(WZ_SOCKET_EPOLL)
+	return checkSocketsPoll(set, timeout);
+#else
+#if   defined(WZ_OS_UNIX)
+	SOCKET maxfd = INT_MIN;
+#elif defined(WZ_OS_WIN)
+	SOCKET maxfd = 0;
+#endif
+	for (size_t i = 0; i < set.fds.size(); ++i)
+	{
+		maxfd = std::max(maxfd, set.fds[i]->fd[SOCK_CONNECTION]);
+	}
+
 	int ret;
 	fd_set fds;
 	do
@@ -1035,6 +1498,7 @@ int checkSockets(const SocketSet& set, unsigned int timeout)
 	}
 
 	return ret;
+#endif
 }
 
 /**
@@ -1088,6 +1552,12 @@ net::result<ssize_t> readAll(Socket& sock, void *buf, size_t size, unsigned int
 
 		ret = recv(sock.fd[SOCK_CONNECTION], &((char *)buf)[received], size - received, 0);
 		sock.ready = false;
+#if defined(WZ_SOCKET_EPOLL)
+		if (ret == SOCKET_ERROR ? getSockErr() != EINTR : ret < static_cast<ssize_t>(size - received))
+		{
+			sock.edgeReadable = false;  // Read everything there was, wait for the next event.
+		}
+#endif
 		if (ret == 0)
 		{
 			debug(LOG_NET, "Socket %" PRIuPTR"x disconnected.", static_cast<uintptr_t>(sock.fd[SOCK_CONNECTION]));
@@ -1487,6 +1957,11 @@ net::result<Socket*> socketListen(unsigned int port)
 #endif
 			conn->fd[SOCK_IPV4_LISTEN] = INVALID_SOCKET;
 		}
+		else if (port == 0)
+		{
+			// Listen on the same port with IPv6, the one the system picked for IPv4
+			addr6.sin6_port = htons(socketListenPort(*conn));
+		}
 	}
 
 	if (conn->fd[SOCK_IPV6_LISTEN] != INVALID_SOCKET)
@@ -1532,6 +2007,33 @@ net::result<Socket*> socketListen(unsigned int port)
 	return conn;
 }
 
+unsigned socketListenPort(const Socket& sock)
+{
+	for (SOCKET fd : {sock.fd[SOCK_IPV4_LISTEN], sock.fd[SOCK_IPV6_LISTEN]})
+	{
+		if (fd == INVALID_SOCKET)
+		{
+			continue;
+		}
+		struct sockaddr_storage addr;
+		socklen_t addr_len = sizeof(addr);
+		if (getsockname(fd, (struct sockaddr *)&addr, &addr_len) == SOCKET_ERROR)
+		{
+			debug(LOG_NET, "getsockname failed: %s", strSockError(getSockErr()));
+			continue;
+		}
+		if (addr.ss_family == AF_INET)
+		{
+			return ntohs(((const struct sockaddr_in *)&addr)->sin_port);
+		}
+		if (addr.ss_family == AF_INET6)
+		{
+			return ntohs(((const struct sockaddr_in6 *)&addr)->sin6_port);
+		}
+	}
+	return 0;
+}
+
 net::result<Socket*> socketOpenAny(const SocketAddress *addr, unsigned timeout)
 {
 	net::result<Socket*> res;
@@ -1711,9 +2213,19 @@ void SOCKETinit()
 	}
 #endif
 
+	socketTotals = SocketStatistics();
+
 	if (socketThread == nullptr)
 	{
 		socketThreadQuit = false;
+#if defined(WZ_SOCKET_EPOLL)
+		socketThreadEpollFd = epoll_create1(EPOLL_CLOEXEC);
+		socketThreadEpoll = socketThreadEpollFd != -1;
+		if (!socketThreadEpoll)
+		{
+			debug(LOG_ERROR, "Failed to create epoll instance, falling back to select(): %s", strSockError(getSockErr()));
+		}
+#endif
 		socketThreadMutex = wzMutexCreate();
 		socketThreadSemaphore = wzSemaphoreCreate(0);
 		socketThread = wzThreadCreate(socketThreadFunction, nullptr);
@@ -1734,6 +2246,14 @@ void SOCKETshutdown()
 		wzMutexDestroy(socketThreadMutex);
 		wzSemaphoreDestroy(socketThreadSemaphore);
 		socketThread = nullptr;
+#if defined(WZ_SOCKET_EPOLL)
+		if (socketThreadEpollFd != -1)
+		{
+			close(socketThreadEpollFd);
+			socketThreadEpollFd = -1;
+		}
+		socketThreadEpoll = false;
+#endif
 	}
 
 #if defined(WZ_OS_WIN)
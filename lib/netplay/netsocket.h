@@ -22,6 +22,8 @@
 #define _net_socket_h
 
 #include "lib/framework/types.h"
+#include <functional>
+#include <memory>
 #include <string>
 #include <system_error>
 #include <vector>
@@ -103,7 +105,8 @@ WZ_DECL_NONNULL(1) void deleteSocketAddress(SocketAddress *addr);       ///< Des
 
 // Sockets.
 net::result<Socket*> socketOpen(const SocketAddress *addr, unsigned timeout);        ///< Opens a Socket, using the first address in addr.
-net::result<Socket*> socketListen(unsigned int port);                                ///< Creates a listen-only Socket, which listens for incoming connections.
+net::result<Socket*> socketListen(unsigned int port);                                ///< Creates a listen-only Socket, which listens for incoming connections. Port 0 picks a free port.
+unsigned socketListenPort(const Socket& sock);                                       ///< Gets the port a listen-only Socket listens on, or 0 if unknown.
 WZ_DECL_NONNULL(1) Socket *socketAccept(Socket *sock);                  ///< Accepts an incoming Socket connection from a listening Socket.
 WZ_DECL_NONNULL(1) void socketClose(Socket *sock);                      ///< Destroys the Socket.
 net::result<Socket*> socketOpenAny(const SocketAddress *addr, unsigned timeout);     ///< Opens a Socket, using the first address that works in addr.
@@ -122,13 +125,37 @@ WZ_DECL_NONNULL(2)
 net::result<ssize_t> readAll(Socket& sock, void *buf, size_t size, unsigned timeout);///< Reads exactly size bytes from the Socket, or blocks until the timeout expires.
 WZ_DECL_NONNULL(2)
 net::result<ssize_t> writeAll(Socket& sock, const void *buf, size_t size, size_t *rawByteCount = nullptr);  ///< Nonblocking write of size bytes to the Socket. All bytes will be written asynchronously, by a separate thread. Raw count of bytes (after compression) returned in rawByteCount, which will often be 0 until the socket is flushed.
+net::result<ssize_t> writeAll(Socket& sock, const std::shared_ptr<const std::vector<uint8_t>> &data, size_t *rawByteCount = nullptr);  ///< Like writeAll() above, but uncompressed sockets queue a reference to the data instead of a copy, so one buffer can be sent to many sockets.
 
 bool socketSetTCPNoDelay(Socket& sock, bool nodelay); ///< nodelay = true disables the Nagle algorithm for TCP socket
 
 // Sockets, compressed.
-void socketBeginCompression(Socket& sock); ///< Makes future data sent compressed, and future data received expected to be compressed.
+/// Stream codecs of compressed sockets. Both ends of a connection must use the same one, see socketSupportedCompressions().
+enum class SocketCompression : uint32_t
+{
+	Zlib = 0,  ///< Supported by every build.
+	Zstd = 1,  ///< Only supported by builds with zstd. Needs less CPU time than zlib for the same or better ratio.
+};
+uint32_t socketSupportedCompressions();                             ///< Bit (1 << codec) is set for each SocketCompression this build supports.
+SocketCompression socketChooseCompression(uint32_t peerCompressions); ///< The best codec supported both by this build and by a peer, given the peer's socketSupportedCompressions().
+void socketBeginCompression(Socket& sock, SocketCompression compression = SocketCompression::Zlib); ///< Makes future data sent compressed, and future data received expected to be compressed, with the codec both ends agreed on.
 void socketFlush(Socket& sock, uint8_t player, size_t *rawByteCount = nullptr); ///< Actually sends the data written with writeAll. Only useful on compressed sockets. Note that flushing too often makes compression less effective. Raw count of bytes (after compression) returned in rawByteCount.
 
+// Socket statistics. Only updated by the thread calling readNoInt(), writeAll() and socketFlush().
+struct SocketStatistics
+{
+	size_t uncompressedBytesSent = 0;      ///< Bytes passed to writeAll().
+	size_t compressedBytesSent = 0;        ///< Bytes queued for the network. Equal to uncompressedBytesSent on uncompressed sockets.
+	size_t uncompressedBytesReceived = 0;  ///< Bytes returned by readNoInt().
+	size_t compressedBytesReceived = 0;    ///< Bytes read from the network. Equal to uncompressedBytesReceived on uncompressed sockets.
+	size_t packetsSent = 0;                ///< Calls to writeAll().
+	size_t packetsReceived = 0;            ///< Calls to readNoInt() which returned data.
+	uint64_t compressMicroseconds = 0;     ///< Time spent compressing data sent.
+	uint64_t decompressMicroseconds = 0;   ///< Time spent decompressing data received.
+};
+const SocketStatistics &socketStatistics(const Socket& sock);  ///< Statistics of the Socket, since it was opened.
+const SocketStatistics &socketTotalStatistics();               ///< Statistics of all Sockets since SOCKETinit(), including closed ones.
+
 // Socket sets.
 WZ_DECL_ALLOCATION SocketSet *allocSocketSet();                         ///< Constructs a SocketSet.
 WZ_DECL_NONNULL(1) void deleteSocketSet(SocketSet *set);                ///< Destroys the SocketSet.
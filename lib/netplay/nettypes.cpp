@@ -72,6 +72,7 @@ static bool bSecretMessageWrap = false;
 static std::array<std::unique_ptr<SessionKeys>, MAX_CONNECTED_PLAYERS> netSessionKeys;
 
 static bool bIsReplay = false;
+static bool bIsWatchingReplayRelay = false;
 
 static void NETsetPacketDir(PACKETDIR dir)
 {
@@ -456,6 +457,19 @@ size_t NETincompleteMessageDataBuffered(NETQUEUE queue)
 	return receiveQueue(queue)->currentIncompleteDataBuffered();
 }
 
+void NETsampleQueueDepths()
+{
+	for (uint8_t player = 0; player < MAX_CONNECTED_PLAYERS; ++player)
+	{
+		size_t incompleteBytes = netQueues[player] != nullptr ? netQueues[player]->receive.currentIncompleteDataBuffered() : 0;
+		size_t pendingGameTimeUpdates = gameQueues[player] != nullptr ? gameQueues[player]->numPendingGameTimeUpdateMessages() : 0;
+		if (netQueues[player] != nullptr || gameQueues[player] != nullptr)
+		{
+			NETlogQueueDepth(player, incompleteBytes, pendingGameTimeUpdates);
+		}
+	}
+}
+
 NetMessage const *NETgetMessage(NETQUEUE queue)
 {
 	return &receiveQueue(queue)->getMessage();
@@ -533,7 +547,8 @@ void NETbeginEncode(NETQUEUE queue, uint8_t type)
 	NETsetPacketDir(PACKET_ENCODE);
 
 	queueInfo = queue;
-	message = type;
+	message.type = type;
+	message.data.clear();  // Keeps the buffer of the previous message, so most messages are serialised without reallocating.
 	writer = MessageWriter(message);
 }
 
@@ -998,9 +1013,16 @@ void NETbytes(std::vector<uint8_t> *vec, unsigned maxLen)
 
 void NETbin(uint8_t *str, uint32_t len)
 {
-	for (unsigned i = 0; i < len; ++i)
+	// Same as queueing each byte, but copies them all at once, since file transfers send kilobytes at a time.
+	if (NETgetPacketDir() == PACKET_ENCODE)
 	{
-		queueAuto(str[i]);
+		writer.bytes(str, len);
+	}
+	else if (NETgetPacketDir() == PACKET_DECODE)
+	{
+		size_t available = reader.index < reader.message->data.size() ? reader.message->data.size() - reader.index : 0;
+		reader.bytes(str, len);
+		reader.index += len - std::min<size_t>(len, available);  // Reading past the end makes the reader invalid, as when reading each byte.
 	}
 }
 
@@ -1037,6 +1059,16 @@ void NETnetMessage(NetMessage const **msg)
 
 ReplayOptionsHandler::~ReplayOptionsHandler() { }
 
+static bool isValidReplayMessagePlayer(NetMessage const &replayMessage, uint8_t player)
+{
+	if ((player >= MAX_PLAYERS && player != NetPlay.hostPlayer) || gameQueues[player] == nullptr)
+	{
+		debug((replayMessage.type != GAME_GAME_TIME) ? LOG_ERROR : LOG_INFO, "Skipping message to player %d in replay.", player);
+		return false;
+	}
+	return true;
+}
+
 // TODO Call this function somewhere.
 bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHandler)
 {
@@ -1050,9 +1082,8 @@ bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHan
 	bool gotReplayEnded = false;
 	while (NETreplayLoadNetMessage(newMessage, player))
 	{
-		if ((player >= MAX_PLAYERS && player != NetPlay.hostPlayer) || gameQueues[player] == nullptr)
+		if (!isValidReplayMessagePlayer(*newMessage, player))
 		{
-			debug((newMessage->type != GAME_GAME_TIME) ? LOG_ERROR : LOG_INFO, "Skipping message to player %d in replay.", player);
 			continue;
 		}
 		if (newMessage->type == REPLAY_ENDED)
@@ -1077,6 +1108,57 @@ bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHan
 	return true;
 }
 
+bool NETwatchReplayRelay(std::string const &host, unsigned port, ReplayOptionsHandler& optionsHandler)
+{
+	uint32_t replayFormatVer = 0;
+	if (!NETreplayRelayLoadStart(host, port, optionsHandler, replayFormatVer))
+	{
+		return false;
+	}
+	// The messages are queued by NETpumpReplayRelay() while the game runs, so the game waits for them like for a player.
+	bIsReplay = true;
+	bIsWatchingReplayRelay = true;
+	return true;
+}
+
+void NETpumpReplayRelay()
+{
+	if (!bIsWatchingReplayRelay)
+	{
+		return;
+	}
+
+	std::vector<ReplayRelayRecord> records;
+	bool open = NETreplayRelayLoadNetMessages(records);
+	for (auto &record : records)
+	{
+		if (record.message.type == REPLAY_ENDED)
+		{
+			open = false;
+			break;
+		}
+		if (record.message.type <= GAME_MIN_TYPE || record.message.type >= GAME_MAX_TYPE || !isValidReplayMessagePlayer(record.message, record.player))
+		{
+			continue;
+		}
+		gameQueues[record.player]->pushMessage(record.message);
+	}
+
+	if (!open)
+	{
+		// Whether the relay ended the stream or went away, end the replay like NETloadReplay() does.
+		debug(LOG_INFO, "Spectator relay stream ended");
+		NETreplayRelayLoadStop();
+		bIsWatchingReplayRelay = false;
+		gameQueues[NetPlay.hostPlayer]->pushMessage(NetMessage(REPLAY_ENDED));
+	}
+}
+
+bool NETisWatchingReplayRelay()
+{
+	return bIsWatchingReplayRelay;
+}
+
 bool NETisReplay()
 {
 	return bIsReplay;
@@ -1091,5 +1173,10 @@ void NETshutdownReplay()
 		gameQueues[MAX_CONNECTED_PLAYERS] = nullptr;
 	}
 
+	if (bIsWatchingReplayRelay)
+	{
+		NETreplayRelayLoadStop();
+		bIsWatchingReplayRelay = false;
+	}
 	bIsReplay = false;
 }
@@ -72,6 +72,7 @@ void NETinsertRawData(NETQUEUE queue, uint8_t *data, size_t dataLen);  ///< Dump
 void NETinsertMessageFromNet(NETQUEUE queue, NetMessage const *message);     ///< Dump whole NetMessages into the queue.
 bool NETisMessageReady(NETQUEUE queue);       ///< Returns true if there is a complete message ready to deserialise in this queue.
 size_t NETincompleteMessageDataBuffered(NETQUEUE queue);
+void NETsampleQueueDepths();  ///< Samples the receive queue depths of all players for the net log telemetry.
 NetMessage const *NETgetMessage(NETQUEUE queue);///< Returns the current message in the queue which is ready to be deserialised. Do not delete the message.
 
 void NETinitQueue(NETQUEUE queue);             ///< Allocates the queue. Deletes the old queue, if there was one. Avoids a crash on NULL pointer deference when trying to use the queue.
@@ -231,6 +232,10 @@ public:
 };
 
 bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHandler);
+#define REPLAY_RELAY_PREFIX "relay:"  ///< Load "relay:<address>" to watch a spectator relay (see parseReplayRelayAddress).
+bool NETwatchReplayRelay(std::string const &host, unsigned port, ReplayOptionsHandler& optionsHandler);  ///< Plays the game a spectator relay streams, as a replay which is still being written.
+void NETpumpReplayRelay();  ///< Queues the game messages which arrived from the spectator relay.
+bool NETisWatchingReplayRelay();
 bool NETisReplay();
 void NETshutdownReplay();
 
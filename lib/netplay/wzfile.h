@@ -29,6 +29,7 @@
 
 #include <physfs.h>
 
+#include <chrono>
 #include <string>
 #include <memory>
 #include <stdint.h>
@@ -65,4 +66,14 @@ public:
 	Sha256 hash;
 	uint32_t size = 0;
 	uint32_t pos = 0;  // Current position, the range [0; currPos[ has been sent or received already.
+
+	// Sender only. Chunks are sent ahead of the receiver's acknowledgements, while the unacknowledged data fits in the
+	// window, which follows the measured throughput times the round-trip time. See NETsendFile() and NETrecvFileAck().
+	uint32_t ackedPos = 0;  // The range [0; ackedPos[ has been written by the receiver.
+	uint32_t window = 0;  // Maximum of pos - ackedPos in bytes, 0 until the first chunk is sent.
+	uint32_t probePos = 0;  // The round-trip time is the time until ackedPos reaches probePos.
+	std::chrono::steady_clock::time_point probeTime;
+	std::chrono::steady_clock::duration minRoundTrip = std::chrono::steady_clock::duration::max();
+	uint32_t rateStartPos = 0;  // The throughput is measured over the bytes acknowledged since rateStartTime.
+	std::chrono::steady_clock::time_point rateStartTime;
 };
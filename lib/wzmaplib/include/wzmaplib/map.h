@@ -140,8 +140,13 @@ public:
 	// - a WzMap::IOProvider
 	static std::shared_ptr<Map> loadFromPath(const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, uint32_t seed, std::shared_ptr<LoggingProtocol> logger = nullptr, std::shared_ptr<IOProvider> mapIO = std::make_shared<StdIOProvider>());
 
-	// Export a map to a specified folder path in a specified output format (version)
-	static bool exportMapToPath(Map& map, const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, OutputFormat format, std::shared_ptr<LoggingProtocol> logger = nullptr, std::shared_ptr<IOProvider> mapIO = std::make_shared<StdIOProvider>());
+	// Export a map to a specified folder path in a specified output format (version), optionally also writing:
+	// - a binary map cache (game.wzmc), which loadFromPath prefers over the other map files for as long as they don't change
+	static bool exportMapToPath(Map& map, const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, OutputFormat format, std::shared_ptr<LoggingProtocol> logger = nullptr, std::shared_ptr<IOProvider> mapIO = std::make_shared<StdIOProvider>(), bool includeMapCache = false);
+
+	// Write a binary map cache (game.wzmc) into the folder of a map loaded from map files (not script-generated)
+	// loadFromPath then loads the map from it for as long as the map files don't change
+	bool writeMapCacheToMapFolder();
 
 	// High-level data loading functions
 
@@ -267,6 +272,13 @@ private:
 	};
 
 	std::unordered_map<MapFile, LoadedFileVersion, MapFileHash> m_fileVersions;
+
+private:
+	// Binary map cache (see map_cache.cpp)
+	bool writeMapCache(const std::string& mapFolderPath, LoadedFormat sourceFormat, IOProvider& mapIO, LoggingProtocol* pCustomLogger);
+	bool loadMapCache(const std::vector<char>& fileData, const std::string& filename, LoggingProtocol* pCustomLogger);
+
+	optional<LoadedFormat> m_mapCacheSourceFormat; // the format of the map files the loaded map cache was made from
 };
 
 } // namespace WzMap
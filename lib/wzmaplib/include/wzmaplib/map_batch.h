@@ -0,0 +1,141 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cinttypes>
+
+#include "map.h"
+#include "map_stats.h"
+#include "map_preview.h"
+
+namespace WzMap {
+
+// MARK: - Batch processing of map stats + previews (ex. for a map browser)
+
+// A CRC of everything a map's stats and preview are calculated from (the map data, terrain types, structures, droids and features)
+// Script-generated maps give a different CRC for each seed
+uint32_t crcSumMapContents(Map& map, uint32_t crc = 0);
+
+// A CRC of the map files of a map folder, and of what loading them depends on (the map type, max players and, for
+// script-generated maps, the seed) - the files are read but not parsed, so this is much quicker than crcSumMapContents
+uint32_t crcSumMapFiles(const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, uint32_t seed, IOProvider& mapIO, uint32_t crc = 0);
+
+// A CRC of everything a map preview is drawn with (including the player colors of players -1 (scavengers) to mapMaxPlayers - 1)
+uint32_t crcSumPreviewColorScheme(const MapPreviewColorScheme& colorScheme, uint32_t mapMaxPlayers, uint32_t crc = 0);
+
+struct MapInfo
+{
+	optional<MapStats> stats; // nullopt if the stats weren't requested (or calculating them failed)
+	std::shared_ptr<const MapPreviewImage> preview; // nullptr if no preview was requested (or generating it failed)
+};
+
+// A thread-safe cache of map stats + previews, keyed by the CRCs of the map contents, the stats configuration and the preview color scheme
+// (so a changed map, stats configuration or color scheme never gets a stale entry)
+// It also records which map contents CRC the map files with a given crcSumMapFiles CRC load as, so processMapFromPath and
+// processMapBatch find the entries of unchanged maps without loading (parsing) them
+class MapInfoCache
+{
+public:
+	struct Key
+	{
+		uint32_t mapCRC = 0;
+		uint32_t mapMaxPlayers = 0;
+		uint32_t statsConfigCRC = 0;
+		uint32_t previewColorsCRC = 0; // 0 if no preview
+
+		bool operator==(const Key& other) const
+		{
+			return mapCRC == other.mapCRC && mapMaxPlayers == other.mapMaxPlayers && statsConfigCRC == other.statsConfigCRC && previewColorsCRC == other.previewColorsCRC;
+		}
+	};
+
+public:
+	optional<MapInfo> lookup(const Key& key) const;
+	void insert(const Key& key, const MapInfo& info);
+	optional<uint32_t> lookupMapCRC(uint32_t mapFilesCRC) const;
+	void insertMapCRC(uint32_t mapFilesCRC, uint32_t mapCRC);
+	size_t size() const;
+	void clear();
+
+	// Remove the entries that weren't looked up or inserted since the cache was created, loaded or last pruned
+	// (ex. of maps that were deleted or changed since the cache file was saved) - returns the number of entries removed
+	size_t pruneUnused();
+
+	// Load / save the cache file (ex. as pre-generated by the wzmapcache tool)
+	// loadFromFile adds the entries of the file to the cache
+	bool loadFromFile(const std::string& filename, IOProvider& mapIO, LoggingProtocol* pCustomLogger = nullptr);
+	bool saveToFile(const std::string& filename, IOProvider& mapIO, LoggingProtocol* pCustomLogger = nullptr) const;
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+	struct Entry
+	{
+		MapInfo info;
+		mutable bool used = false;
+	};
+	struct MapCRCEntry
+	{
+		uint32_t mapCRC = 0;
+		mutable bool used = false;
+	};
+	mutable std::mutex m_mutex;
+	std::unordered_map<Key, Entry, KeyHash> m_entries;
+	std::unordered_map<uint32_t, MapCRCEntry> m_mapCRCs; // by crcSumMapFiles CRC
+};
+
+struct MapBatchItem
+{
+	std::string mapFolderPath;
+	MapType mapType = MapType::SKIRMISH;
+	uint32_t mapMaxPlayers = 8;
+	uint32_t seed = 0; // only used for script-generated maps
+	std::shared_ptr<IOProvider> mapIO; // nullptr to use a StdIOProvider (must be safe to use from several threads at once)
+	const MapPreviewColorScheme* previewColorScheme = nullptr; // nullptr to skip generating a preview (must outlive the processMapBatch call)
+	bool calculateStats = true; // false to skip calculating the stats, if only the preview is needed (a cached entry may still have them)
+};
+
+struct MapBatchResult
+{
+	bool loaded = false; // false if the map failed to load
+	uint32_t mapCRC = 0;
+	MapInfo info;
+	bool fromCache = false;
+};
+
+// Get the stats (and, optionally, the preview) of one loaded map, from the cache if it has them (if a cache is supplied)
+MapBatchResult processMap(Map& map, uint32_t mapMaxPlayers, const MapPreviewColorScheme* previewColorScheme, const MapStatsConfiguration& statsConfig, MapInfoCache* cache = nullptr, LoggingProtocol* pCustomLogger = nullptr);
+
+// Get the stats (and, optionally, the preview) of one map folder - if the cache has them, without loading the map
+MapBatchResult processMapFromPath(const MapBatchItem& item, const MapStatsConfiguration& statsConfig, MapInfoCache* cache = nullptr, std::shared_ptr<LoggingProtocol> logger = nullptr);
+
+// Load many maps and get their stats (and, optionally, previews) on a pool of numThreads threads (0 for one per hardware thread)
+// Returns one result per item, in the same order
+// NOTE: The logger, the IOProviders and the color schemes' playerColorProviders are used from several threads at once
+std::vector<MapBatchResult> processMapBatch(const std::vector<MapBatchItem>& items, const MapStatsConfiguration& statsConfig, MapInfoCache* cache = nullptr, unsigned numThreads = 0, std::shared_ptr<LoggingProtocol> logger = nullptr);
+
+} // namespace WzMap
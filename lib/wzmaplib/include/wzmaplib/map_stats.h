@@ -178,6 +178,9 @@ namespace WzMap {
 	public:
 		bool isStructExpansionModule(const std::string& struct_id) const;
 
+		// A CRC of the whole configuration - changes whenever any of the above would give different map stats
+		uint32_t crcSum(uint32_t crc) const;
+
 	private:
 		// [STRUCT SIZES]:
 		typedef std::unordered_map<std::string, StructureSize> StructSizesMap;
@@ -1940,10 +1940,21 @@ std::shared_ptr<Map> Map::loadFromPath(const std::string& mapFolderPath, MapType
 
 	// Otherwise, construct a lazy-loading Map
 	std::shared_ptr<Map> pMap = std::shared_ptr<Map>(new Map(mapFolderPath, mapType, mapMaxPlayers, std::move(logger), std::move(mapIO)));
+
+	// If there is a binary map cache, load everything from it at once
+	std::string mapCachePath = pMap->m_mapIO->pathJoin(mapFolderPath, "game.wzmc");
+	if (pMap->m_mapIO->loadFullFile(mapCachePath, fileData))
+	{
+		debug(pMap->m_logger.get(), LOG_INFO, "Loading: %s", mapCachePath.c_str());
+		if (!pMap->loadMapCache(fileData, mapCachePath, pMap->m_logger.get()))
+		{
+			debug(pMap->m_logger.get(), LOG_WARNING, "Ignoring map cache: %s", mapCachePath.c_str());
+		}
+	}
 	return pMap;
 }
 
-bool Map::exportMapToPath(Map& map, const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, OutputFormat format, std::shared_ptr<LoggingProtocol> logger, std::shared_ptr<IOProvider> mapIO)
+bool Map::exportMapToPath(Map& map, const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, OutputFormat format, std::shared_ptr<LoggingProtocol> logger, std::shared_ptr<IOProvider> mapIO, bool includeMapCache)
 {
 	if (!mapIO)
 	{
@@ -2011,9 +2022,48 @@ bool Map::exportMapToPath(Map& map, const std::string& mapFolderPath, MapType ma
 		return false;
 	}
 
+	if (includeMapCache)
+	{
+		// The cache records the format of the files just written, so loadedMapFormat() stays the same whichever gets loaded
+		LoadedFormat writtenFormat = LoadedFormat::JSON_v2;
+		switch (format)
+		{
+			case OutputFormat::VER1_BINARY_OLD:
+				writtenFormat = LoadedFormat::BINARY_OLD;
+				break;
+			case OutputFormat::VER2:
+				writtenFormat = LoadedFormat::JSON_v1;
+				break;
+			case OutputFormat::VER3:
+				writtenFormat = LoadedFormat::JSON_v2;
+				break;
+		}
+		if (!map.writeMapCache(mapFolderPath, writtenFormat, *(mapIO.get()), logger.get()))
+		{
+			debug(logger.get(), LOG_ERROR, "Failed to write map cache to path: %s", mapFolderPath.c_str());
+			return false;
+		}
+	}
+
 	return true;
 }
 
+bool Map::writeMapCacheToMapFolder()
+{
+	if (m_wasScriptGenerated || !m_mapIO)
+	{
+		debug(m_logger.get(), LOG_ERROR, "Only maps loaded from map files can have a map cache: %s", m_mapFolderPath.c_str());
+		return false;
+	}
+	auto format = loadedMapFormat();
+	if (!format.has_value())
+	{
+		debug(m_logger.get(), LOG_ERROR, "Failed to load map: %s", m_mapFolderPath.c_str());
+		return false;
+	}
+	return writeMapCache(m_mapFolderPath, format.value(), *m_mapIO, m_logger.get());
+}
+
 // Get the map data
 // Returns nullptr if constructed for loading and the loading failed
 std::shared_ptr<MapData> Map::mapData()
@@ -2130,8 +2180,8 @@ uint32_t MapData::crcSumMapTiles(uint32_t crc)
 {
 	for (auto &o : mMapTiles)
 	{
-		crc = crcSumU16(crc, &o.height, 1);
-		crc = crcSumU16(crc, &o.texture, 1);
+		const uint16_t tile[2] = {o.height, o.texture};
+		crc = crcSumU16(crc, tile, 2);  // one 4-byte step, instead of two 2-byte ones
 	}
 	return crc;
 }
@@ -2214,6 +2264,10 @@ optional<Map::LoadedFormat> Map::loadedMapFormat()
 	{
 		return Map::LoadedFormat::SCRIPT_GENERATED;
 	}
+	if (m_mapCacheSourceFormat.has_value())
+	{
+		return m_mapCacheSourceFormat;
+	}
 
 	auto getFileVersion = [this](MapFile file) -> optional<LoadedFileVersion>
 	{
@@ -2364,6 +2418,8 @@ std::unordered_set<std::string> Map::expectedFileNames(optional<LoadedFormat> fo
 	{
 		format.reset();
 	}
+	// the optional binary map cache, which may accompany any format
+	results.insert("game.wzmc");
 	if (!format.has_value())
 	{
 		// ancient .ini files
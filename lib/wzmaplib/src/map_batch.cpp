@@ -0,0 +1,670 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "../include/wzmaplib/map_batch.h"
+#include "map_internal.h"
+#include "map_crc.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+// MARK: - Map info cache file
+//
+// A little-endian file of cache entries:
+//
+//   Header:   char[4] "wzmi", u32 cache file version, u32 number of entries
+//   Entry:    u32 mapCRC, mapMaxPlayers, statsConfigCRC, previewColorsCRC
+//             u32 flags (MAP_INFO_HAS_STATS, MAP_INFO_HAS_PREVIEW)
+//   Stats:    the u32 fields of MapStats (see mapStatsCounts()), u32 bits of MapStats::playerBalance (see mapStatsFlags()),
+//             u32 number of players with HQs, each: { u32 player, u32 number of HQs, each: { u32 x, u32 y } }
+//   Preview:  u32 width, height, channels, u32 number of HQ positions, each: { u32 player, u32 x, u32 y },
+//             u32 size of the image data, then the image data
+//   Map CRCs: u32 number of map CRCs, each: { u32 mapFilesCRC, u32 mapCRC }
+//
+// Bump MAP_INFO_CACHE_VERSION whenever MapStats or MapPreviewImage change - files of other versions are ignored.
+
+#define MAP_INFO_CACHE_VERSION 2
+
+#define MAP_INFO_HAS_STATS 0x01
+#define MAP_INFO_HAS_PREVIEW 0x02
+
+namespace WzMap {
+
+static void appendULE32(std::vector<char>& buffer, uint32_t value)
+{
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		buffer.push_back(static_cast<char>((value >> shift) & 0xFF));
+	}
+}
+
+class MapInfoCacheReader
+{
+public:
+	MapInfoCacheReader(const std::vector<char>& data)
+	: m_data(data)
+	{ }
+
+	bool readULE32(uint32_t& value)
+	{
+		if (m_data.size() - m_pos < 4)
+		{
+			return false;
+		}
+		const uint8_t *p = reinterpret_cast<const uint8_t *>(m_data.data() + m_pos);
+		value = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+		m_pos += 4;
+		return true;
+	}
+
+	bool readSLE32(int32_t& value)
+	{
+		uint32_t u = 0;
+		if (!readULE32(u))
+		{
+			return false;
+		}
+		value = static_cast<int32_t>(u);
+		return true;
+	}
+
+	bool readBytes(std::vector<uint8_t>& bytes, size_t count)
+	{
+		if (m_data.size() - m_pos < count)
+		{
+			return false;
+		}
+		bytes.assign(m_data.begin() + m_pos, m_data.begin() + m_pos + count);
+		m_pos += count;
+		return true;
+	}
+
+	// A count of items which take at least minItemSize bytes each - rejects counts the rest of the file cannot hold
+	bool readCount(uint32_t& count, size_t minItemSize)
+	{
+		return readULE32(count) && count <= (m_data.size() - m_pos) / minItemSize;
+	}
+
+private:
+	const std::vector<char>& m_data;
+	size_t m_pos = 0;
+};
+
+static std::vector<uint32_t*> mapStatsCounts(MapStats& stats)
+{
+	auto& counts = stats.perPlayerCounts;
+	std::vector<uint32_t*> result = { &stats.mapWidth, &stats.mapHeight, &stats.scavengerUnits, &stats.scavengerStructs, &stats.scavengerFactories, &stats.scavengerResourceExtractors, &stats.oilWellsTotal };
+	for (auto* pMinMax : { &counts.unitsPerPlayer, &counts.structuresPerPlayer, &counts.resourceExtractorsPerPlayer, &counts.powerGeneratorsPerPlayer, &counts.powerGeneratorModulesPerPlayer, &counts.regFactoriesPerPlayer, &counts.regFactoryModulesPerPlayer, &counts.vtolFactoriesPerPlayer, &counts.cyborgFactoriesPerPlayer, &counts.researchCentersPerPlayer, &counts.researchCenterModulesPerPlayer, &counts.defenseStructuresPerPlayer })
+	{
+		result.push_back(&pMinMax->min);
+		result.push_back(&pMinMax->max);
+	}
+	return result;
+}
+
+static std::vector<bool*> mapStatsFlags(MapStats& stats)
+{
+	auto& balance = stats.playerBalance;
+	return { &balance.units, &balance.structures, &balance.resourceExtractors, &balance.powerGenerators, &balance.factories, &balance.regFactories, &balance.vtolFactories, &balance.cyborgFactories, &balance.researchCenters, &balance.defenseStructures };
+}
+
+static void appendMapStats(std::vector<char>& buffer, MapStats stats)
+{
+	for (uint32_t* pCount : mapStatsCounts(stats))
+	{
+		appendULE32(buffer, *pCount);
+	}
+	uint32_t flagBits = 0;
+	auto flags = mapStatsFlags(stats);
+	for (size_t i = 0; i < flags.size(); ++i)
+	{
+		flagBits |= (*flags[i] ? 1u : 0u) << i;
+	}
+	appendULE32(buffer, flagBits);
+	appendULE32(buffer, static_cast<uint32_t>(stats.playerHQPositions.size()));
+	for (const auto& it : stats.playerHQPositions)
+	{
+		appendULE32(buffer, static_cast<uint32_t>(static_cast<int32_t>(it.first)));
+		appendULE32(buffer, static_cast<uint32_t>(it.second.size()));
+		for (const auto& pos : it.second)
+		{
+			appendULE32(buffer, static_cast<uint32_t>(pos.first));
+			appendULE32(buffer, static_cast<uint32_t>(pos.second));
+		}
+	}
+}
+
+static bool readMapStats(MapInfoCacheReader& reader, MapStats& stats)
+{
+	for (uint32_t* pCount : mapStatsCounts(stats))
+	{
+		if (!reader.readULE32(*pCount))
+		{
+			return false;
+		}
+	}
+	uint32_t flagBits = 0;
+	if (!reader.readULE32(flagBits))
+	{
+		return false;
+	}
+	auto flags = mapStatsFlags(stats);
+	for (size_t i = 0; i < flags.size(); ++i)
+	{
+		*flags[i] = (flagBits & (1u << i)) != 0;
+	}
+	uint32_t numPlayers = 0;
+	if (!reader.readCount(numPlayers, 8))
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < numPlayers; ++i)
+	{
+		int32_t player = 0;
+		uint32_t numPositions = 0;
+		if (!reader.readSLE32(player) || !reader.readCount(numPositions, 8))
+		{
+			return false;
+		}
+		auto& positions = stats.playerHQPositions[static_cast<int8_t>(player)];
+		for (uint32_t p = 0; p < numPositions; ++p)
+		{
+			std::pair<int32_t, int32_t> pos;
+			if (!reader.readSLE32(pos.first) || !reader.readSLE32(pos.second))
+			{
+				return false;
+			}
+			positions.push_back(pos);
+		}
+	}
+	return true;
+}
+
+static void appendMapPreview(std::vector<char>& buffer, const MapPreviewImage& preview)
+{
+	appendULE32(buffer, preview.width);
+	appendULE32(buffer, preview.height);
+	appendULE32(buffer, preview.channels);
+	appendULE32(buffer, static_cast<uint32_t>(preview.playerHQPosition.size()));
+	for (const auto& it : preview.playerHQPosition)
+	{
+		appendULE32(buffer, static_cast<uint32_t>(static_cast<int32_t>(it.first)));
+		appendULE32(buffer, static_cast<uint32_t>(it.second.first));
+		appendULE32(buffer, static_cast<uint32_t>(it.second.second));
+	}
+	appendULE32(buffer, static_cast<uint32_t>(preview.imageData.size()));
+	buffer.insert(buffer.end(), preview.imageData.begin(), preview.imageData.end());
+}
+
+static bool readMapPreview(MapInfoCacheReader& reader, MapPreviewImage& preview)
+{
+	uint32_t numHQs = 0;
+	if (!reader.readULE32(preview.width) || !reader.readULE32(preview.height) || !reader.readULE32(preview.channels) || !reader.readCount(numHQs, 12))
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < numHQs; ++i)
+	{
+		int32_t player = 0;
+		std::pair<int32_t, int32_t> pos;
+		if (!reader.readSLE32(player) || !reader.readSLE32(pos.first) || !reader.readSLE32(pos.second))
+		{
+			return false;
+		}
+		preview.playerHQPosition[static_cast<int8_t>(player)] = pos;
+	}
+	uint32_t dataSize = 0;
+	if (!reader.readULE32(dataSize) || dataSize != static_cast<uint64_t>(preview.width) * preview.height * preview.channels)
+	{
+		return false;
+	}
+	return reader.readBytes(preview.imageData, dataSize);
+}
+
+// MARK: - MapInfoCache
+
+size_t MapInfoCache::KeyHash::operator()(const Key& key) const
+{
+	uint64_t hash = key.mapCRC;
+	hash = hash * 31 + key.mapMaxPlayers;
+	hash = hash * 31 + key.statsConfigCRC;
+	hash = hash * 31 + key.previewColorsCRC;
+	return std::hash<uint64_t>()(hash);
+}
+
+optional<MapInfo> MapInfoCache::lookup(const Key& key) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto it = m_entries.find(key);
+	if (it == m_entries.end())
+	{
+		return nullopt;
+	}
+	it->second.used = true;
+	return it->second.info;
+}
+
+void MapInfoCache::insert(const Key& key, const MapInfo& info)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto& entry = m_entries[key];
+	optional<MapStats> previousStats = std::move(entry.info.stats);
+	entry.info = info;
+	if (!entry.info.stats.has_value())
+	{
+		entry.info.stats = std::move(previousStats); // an entry made without stats keeps those of the entry it replaces
+	}
+	entry.used = true;
+}
+
+optional<uint32_t> MapInfoCache::lookupMapCRC(uint32_t mapFilesCRC) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto it = m_mapCRCs.find(mapFilesCRC);
+	if (it == m_mapCRCs.end())
+	{
+		return nullopt;
+	}
+	it->second.used = true;
+	return it->second.mapCRC;
+}
+
+void MapInfoCache::insertMapCRC(uint32_t mapFilesCRC, uint32_t mapCRC)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto& entry = m_mapCRCs[mapFilesCRC];
+	entry.mapCRC = mapCRC;
+	entry.used = true;
+}
+
+size_t MapInfoCache::size() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_entries.size();
+}
+
+void MapInfoCache::clear()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_entries.clear();
+	m_mapCRCs.clear();
+}
+
+template<typename Entries>
+static size_t pruneUnusedEntries(Entries& entries)
+{
+	size_t numRemoved = 0;
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (!it->second.used)
+		{
+			it = entries.erase(it);
+			++numRemoved;
+			continue;
+		}
+		it->second.used = false;
+		++it;
+	}
+	return numRemoved;
+}
+
+size_t MapInfoCache::pruneUnused()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	pruneUnusedEntries(m_mapCRCs);
+	return pruneUnusedEntries(m_entries);
+}
+
+bool MapInfoCache::loadFromFile(const std::string& filename, IOProvider& mapIO, LoggingProtocol* pCustomLogger /*= nullptr*/)
+{
+	std::vector<char> fileData;
+	if (!mapIO.loadFullFile(filename, fileData))
+	{
+		debug(pCustomLogger, LOG_INFO_VERBOSE, "No map info cache: %s", filename.c_str());
+		return false;
+	}
+
+	MapInfoCacheReader reader(fileData);
+	std::vector<uint8_t> magic;
+	uint32_t version = 0;
+	uint32_t numEntries = 0;
+	if (!reader.readBytes(magic, 4) || memcmp(magic.data(), "wzmi", 4) != 0 || !reader.readULE32(version) || !reader.readCount(numEntries, 20))
+	{
+		debug(pCustomLogger, LOG_ERROR, "Not a map info cache: %s", filename.c_str());
+		return false;
+	}
+	if (version != MAP_INFO_CACHE_VERSION)
+	{
+		debug(pCustomLogger, LOG_INFO, "Ignoring map info cache of version %" PRIu32 ": %s", version, filename.c_str());
+		return false;
+	}
+
+	std::vector<std::pair<Key, MapInfo>> entries;
+	for (uint32_t i = 0; i < numEntries; ++i)
+	{
+		Key key;
+		uint32_t flags = 0;
+		if (!reader.readULE32(key.mapCRC) || !reader.readULE32(key.mapMaxPlayers) || !reader.readULE32(key.statsConfigCRC) || !reader.readULE32(key.previewColorsCRC) || !reader.readULE32(flags))
+		{
+			debug(pCustomLogger, LOG_ERROR, "Truncated map info cache: %s", filename.c_str());
+			return false;
+		}
+		MapInfo info;
+		if (flags & MAP_INFO_HAS_STATS)
+		{
+			MapStats stats;
+			if (!readMapStats(reader, stats))
+			{
+				debug(pCustomLogger, LOG_ERROR, "Invalid map stats in map info cache: %s", filename.c_str());
+				return false;
+			}
+			info.stats = std::move(stats);
+		}
+		if (flags & MAP_INFO_HAS_PREVIEW)
+		{
+			auto preview = std::make_shared<MapPreviewImage>();
+			if (!readMapPreview(reader, *preview))
+			{
+				debug(pCustomLogger, LOG_ERROR, "Invalid map preview in map info cache: %s", filename.c_str());
+				return false;
+			}
+			info.preview = std::move(preview);
+		}
+		entries.emplace_back(key, std::move(info));
+	}
+	uint32_t numMapCRCs = 0;
+	if (!reader.readCount(numMapCRCs, 8))
+	{
+		debug(pCustomLogger, LOG_ERROR, "Truncated map info cache: %s", filename.c_str());
+		return false;
+	}
+	std::vector<std::pair<uint32_t, uint32_t>> mapCRCs(numMapCRCs);
+	for (auto& mapCRC : mapCRCs) // readCount made sure the file holds them all
+	{
+		reader.readULE32(mapCRC.first);
+		reader.readULE32(mapCRC.second);
+	}
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (auto& entry : entries)
+	{
+		m_entries[entry.first].info = std::move(entry.second);
+	}
+	for (const auto& mapCRC : mapCRCs)
+	{
+		m_mapCRCs[mapCRC.first].mapCRC = mapCRC.second;
+	}
+	return true;
+}
+
+bool MapInfoCache::saveToFile(const std::string& filename, IOProvider& mapIO, LoggingProtocol* pCustomLogger /*= nullptr*/) const
+{
+	std::vector<char> buffer = { 'w', 'z', 'm', 'i' };
+	appendULE32(buffer, MAP_INFO_CACHE_VERSION);
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		appendULE32(buffer, static_cast<uint32_t>(m_entries.size()));
+		for (const auto& it : m_entries)
+		{
+			const Key& key = it.first;
+			const MapInfo& info = it.second.info;
+			appendULE32(buffer, key.mapCRC);
+			appendULE32(buffer, key.mapMaxPlayers);
+			appendULE32(buffer, key.statsConfigCRC);
+			appendULE32(buffer, key.previewColorsCRC);
+			appendULE32(buffer, (info.stats.has_value() ? MAP_INFO_HAS_STATS : 0) | (info.preview ? MAP_INFO_HAS_PREVIEW : 0));
+			if (info.stats.has_value())
+			{
+				appendMapStats(buffer, info.stats.value());
+			}
+			if (info.preview)
+			{
+				appendMapPreview(buffer, *info.preview);
+			}
+		}
+		appendULE32(buffer, static_cast<uint32_t>(m_mapCRCs.size()));
+		for (const auto& it : m_mapCRCs)
+		{
+			appendULE32(buffer, it.first);
+			appendULE32(buffer, it.second.mapCRC);
+		}
+	}
+
+	if (buffer.size() > static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+	{
+		debug(pCustomLogger, LOG_ERROR, "Map info cache is too large to write: %s", filename.c_str());
+		return false;
+	}
+	if (!mapIO.writeFullFile(filename, buffer.data(), static_cast<uint32_t>(buffer.size())))
+	{
+		debug(pCustomLogger, LOG_ERROR, "Failed to write map info cache: %s", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+// MARK: - CRCs
+
+uint32_t crcSumMapContents(Map& map, uint32_t crc /*= 0*/)
+{
+	auto pMapData = map.mapData();
+	if (pMapData)
+	{
+		crc = crcSumU32(crc, &pMapData->width, 1);
+		crc = crcSumU32(crc, &pMapData->height, 1);
+	}
+	crc = map.crcSumMapTiles(crc);
+	crc = map.crcSumStructures(crc);
+	crc = map.crcSumDroids(crc);
+	crc = map.crcSumFeatures(crc);
+	auto pTerrainTypes = map.mapTerrainTypes();
+	if (pTerrainTypes)
+	{
+		for (auto terrainType : pTerrainTypes->terrainTypes)
+		{
+			uint16_t value = static_cast<uint16_t>(terrainType);
+			crc = crcSumU16(crc, &value, 1);
+		}
+	}
+	return crc;
+}
+
+uint32_t crcSumMapFiles(const std::string& mapFolderPath, MapType mapType, uint32_t mapMaxPlayers, uint32_t seed, IOProvider& mapIO, uint32_t crc /*= 0*/)
+{
+	auto files = crcSumMapFolderFiles(mapFolderPath, mapIO);
+	const uint32_t loadParameters[4] = { files.crc, static_cast<uint32_t>(mapType), mapMaxPlayers, (files.hasMapScript) ? seed : 0 };
+	return crcSumU32(crc, loadParameters, 4);
+}
+
+static uint32_t crcSumColor(uint32_t crc, const MapPreviewColor& color)
+{
+	const uint8_t rgba[4] = { color.r, color.g, color.b, color.a };
+	return crcSum(crc, rgba, sizeof(rgba));
+}
+
+uint32_t crcSumPreviewColorScheme(const MapPreviewColorScheme& colorScheme, uint32_t mapMaxPlayers, uint32_t crc /*= 0*/)
+{
+	const TilesetColorScheme& tileset = colorScheme.tilesetColors;
+	for (const auto* pColor : { &tileset.plCliffL, &tileset.plCliffH, &tileset.plWater, &tileset.plRoadL, &tileset.plRoadH, &tileset.plGroundL, &tileset.plGroundH, &colorScheme.hqColor, &colorScheme.oilResourceColor, &colorScheme.oilBarrelColor })
+	{
+		crc = crcSumColor(crc, *pColor);
+	}
+	const uint8_t drawOptions[3] = { colorScheme.drawOptions.drawTerrain, colorScheme.drawOptions.drawStructures, colorScheme.drawOptions.drawOil };
+	crc = crcSum(crc, drawOptions, sizeof(drawOptions));
+
+	MapPlayerColorProvider defaultPlayerColorProvider;
+	MapPlayerColorProvider* pPlayerColorProvider = colorScheme.playerColorProvider ? colorScheme.playerColorProvider.get() : &defaultPlayerColorProvider;
+	for (int32_t player = -1; player < static_cast<int32_t>(std::min<uint32_t>(mapMaxPlayers, std::numeric_limits<int8_t>::max())); ++player)
+	{
+		crc = crcSumColor(crc, pPlayerColorProvider->getPlayerColor(static_cast<int8_t>(player)));
+	}
+	return crc;
+}
+
+// MARK: - Batch processing
+
+static MapInfoCache::Key mapInfoCacheKey(uint32_t mapCRC, uint32_t mapMaxPlayers, uint32_t statsConfigCRC, const MapPreviewColorScheme* previewColorScheme)
+{
+	MapInfoCache::Key key;
+	key.mapCRC = mapCRC;
+	key.mapMaxPlayers = mapMaxPlayers;
+	key.statsConfigCRC = statsConfigCRC;
+	key.previewColorsCRC = (previewColorScheme) ? crcSumPreviewColorScheme(*previewColorScheme, mapMaxPlayers) : 0;
+	return key;
+}
+
+// Entries with and without stats share a key, so an entry is only good enough if it has the stats when they are needed
+static optional<MapInfo> lookupMapInfo(const MapInfoCache& cache, const MapInfoCache::Key& key, bool calculateStats)
+{
+	auto cachedInfo = cache.lookup(key);
+	if (cachedInfo.has_value() && calculateStats && !cachedInfo.value().stats.has_value())
+	{
+		return nullopt;
+	}
+	return cachedInfo;
+}
+
+static MapBatchResult processMapImpl(Map& map, uint32_t mapMaxPlayers, const MapPreviewColorScheme* previewColorScheme, bool calculateStats, const MapStatsConfiguration& statsConfig, uint32_t statsConfigCRC, MapInfoCache* cache, LoggingProtocol* pCustomLogger)
+{
+	MapBatchResult result;
+	if (!map.mapData())
+	{
+		debug(pCustomLogger, LOG_ERROR, "Failed to load map data from: %s", map.mapFolderPath().c_str());
+		return result;
+	}
+	result.loaded = true;
+	result.mapCRC = crcSumMapContents(map);
+
+	MapInfoCache::Key key = mapInfoCacheKey(result.mapCRC, mapMaxPlayers, statsConfigCRC, previewColorScheme);
+	if (cache)
+	{
+		auto cachedInfo = lookupMapInfo(*cache, key, calculateStats);
+		if (cachedInfo.has_value())
+		{
+			result.info = std::move(cachedInfo.value());
+			result.fromCache = true;
+			return result;
+		}
+	}
+
+	if (calculateStats)
+	{
+		result.info.stats = map.calculateMapStats(mapMaxPlayers, statsConfig);
+	}
+	if (previewColorScheme)
+	{
+		result.info.preview = generate2DMapPreview(map, *previewColorScheme, statsConfig, pCustomLogger);
+	}
+	// failures are not cached, so they are retried (and logged) the next time
+	if (cache && (!calculateStats || result.info.stats.has_value()) && (!previewColorScheme || result.info.preview))
+	{
+		cache->insert(key, result.info);
+	}
+	return result;
+}
+
+MapBatchResult processMap(Map& map, uint32_t mapMaxPlayers, const MapPreviewColorScheme* previewColorScheme, const MapStatsConfiguration& statsConfig, MapInfoCache* cache /*= nullptr*/, LoggingProtocol* pCustomLogger /*= nullptr*/)
+{
+	return processMapImpl(map, mapMaxPlayers, previewColorScheme, true, statsConfig, statsConfig.crcSum(0), cache, pCustomLogger);
+}
+
+static MapBatchResult processMapFromPathImpl(const MapBatchItem& item, const MapStatsConfiguration& statsConfig, uint32_t statsConfigCRC, MapInfoCache* cache, const std::shared_ptr<LoggingProtocol>& logger)
+{
+	std::shared_ptr<IOProvider> mapIO = (item.mapIO) ? item.mapIO : std::make_shared<StdIOProvider>();
+
+	// The map files of a map the cache has seen are looked up by their raw CRC, which is much cheaper than loading the map
+	// for its contents CRC - the entry itself is still found by (and checked against) the contents CRC it had
+	optional<uint32_t> mapFilesCRC;
+	if (cache)
+	{
+		mapFilesCRC = crcSumMapFiles(item.mapFolderPath, item.mapType, item.mapMaxPlayers, item.seed, *mapIO);
+		auto mapCRC = cache->lookupMapCRC(mapFilesCRC.value());
+		if (mapCRC.has_value())
+		{
+			auto cachedInfo = lookupMapInfo(*cache, mapInfoCacheKey(mapCRC.value(), item.mapMaxPlayers, statsConfigCRC, item.previewColorScheme), item.calculateStats);
+			if (cachedInfo.has_value())
+			{
+				MapBatchResult result;
+				result.loaded = true;
+				result.mapCRC = mapCRC.value();
+				result.info = std::move(cachedInfo.value());
+				result.fromCache = true;
+				return result;
+			}
+		}
+	}
+
+	auto map = Map::loadFromPath(item.mapFolderPath, item.mapType, item.mapMaxPlayers, item.seed, logger, mapIO);
+	if (!map)
+	{
+		debug(logger.get(), LOG_ERROR, "Failed to load map: %s", item.mapFolderPath.c_str());
+		return MapBatchResult();
+	}
+	MapBatchResult result = processMapImpl(*map, item.mapMaxPlayers, item.previewColorScheme, item.calculateStats, statsConfig, statsConfigCRC, cache, logger.get());
+	if (cache && result.loaded)
+	{
+		cache->insertMapCRC(mapFilesCRC.value(), result.mapCRC);
+	}
+	return result;
+}
+
+MapBatchResult processMapFromPath(const MapBatchItem& item, const MapStatsConfiguration& statsConfig, MapInfoCache* cache /*= nullptr*/, std::shared_ptr<LoggingProtocol> logger /*= nullptr*/)
+{
+	return processMapFromPathImpl(item, statsConfig, statsConfig.crcSum(0), cache, logger);
+}
+
+std::vector<MapBatchResult> processMapBatch(const std::vector<MapBatchItem>& items, const MapStatsConfiguration& statsConfig, MapInfoCache* cache /*= nullptr*/, unsigned numThreads /*= 0*/, std::shared_ptr<LoggingProtocol> logger /*= nullptr*/)
+{
+	std::vector<MapBatchResult> results(items.size());
+	if (items.empty())
+	{
+		return results;
+	}
+	const uint32_t statsConfigCRC = statsConfig.crcSum(0);
+
+	// Each thread takes the next unprocessed item, so a few slow (ex. large or script-generated) maps don't hold up the rest
+	std::atomic<size_t> nextItem(0);
+	auto processItems = [&]() {
+		for (size_t i = nextItem++; i < items.size(); i = nextItem++)
+		{
+			results[i] = processMapFromPathImpl(items[i], statsConfig, statsConfigCRC, cache, logger);
+		}
+	};
+
+	if (numThreads == 0)
+	{
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	numThreads = static_cast<unsigned>(std::min<size_t>(numThreads, items.size()));
+	std::vector<std::thread> threads;
+	for (unsigned t = 1; t < numThreads; ++t)
+	{
+		threads.emplace_back(processItems);
+	}
+	processItems(); // the calling thread is one of the pool
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	return results;
+}
+
+} // namespace WzMap
@@ -0,0 +1,392 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "../include/wzmaplib/map.h"
+#include "map_internal.h"
+#include "map_crc.h"
+#include <cinttypes>
+#include <cstring>
+#include <limits>
+
+// MARK: - Binary map cache (game.wzmc)
+//
+// Everything a Map holds, in one little-endian file of fixed-layout tables, so loading it is a single file read
+// and (on little-endian machines) a single copy of the tile table. All tables start on a 4-byte boundary.
+// The header records the size and CRC of the map files the cache was made from, and the cache is only used while they
+// still match - checking that means reading the map files, but not parsing them, which is what takes the time.
+//
+//   Header (64 bytes):
+//     char[4]  "wzmc"
+//     u32      cache version
+//     u32      width, height
+//     u32      number of gateways, terrain types, structures, droids, features
+//     u32      size of the string table
+//     u8       format of the map files the cache was made from (Map::LoadedFormat)
+//     u8[3]    reserved (0)
+//     u32      total size of the map files the cache was made from
+//     u32      CRC of their names, sizes and contents (see crcSumMapFolderFiles)
+//     u8[12]   reserved (0)
+//   Tiles:          width * height * { u16 height, u16 texture } - the layout of MapData::MapTile
+//   Gateways:       { u8 x1, y1, x2, y2 }
+//   Terrain types:  u16 each, padded to 4 bytes
+//   Objects:        structures, then droids, then features, MAP_CACHE_OBJECT_SIZE bytes each:
+//                   { u32 name offset, u32 x, u32 y, u32 id, u16 direction, s8 player, u8 flags, u8 modules, u8[3] reserved }
+//   String table:   the object names, each terminated by a 0 byte
+
+#define MAP_CACHE_VERSION 2
+#define MAP_CACHE_HEADER_SIZE 64
+#define MAP_CACHE_OBJECT_SIZE 24
+
+#define MAP_CACHE_OBJECT_HAS_ID 0x01
+#define MAP_CACHE_OBJECT_HAS_PLAYER 0x02
+
+namespace WzMap {
+
+static_assert(sizeof(MapData::MapTile) == 4 && offsetof(MapData::MapTile, height) == 0 && offsetof(MapData::MapTile, texture) == 2, "The tile table is copied directly into MapData::mMapTiles");
+
+static bool isLittleEndian()
+{
+	const uint16_t one = 1;
+	uint8_t firstByte;
+	memcpy(&firstByte, &one, 1);
+	return firstByte == 1;
+}
+
+static void appendULE16(std::vector<char>& buffer, uint16_t value)
+{
+	buffer.push_back(static_cast<char>(value & 0xFF));
+	buffer.push_back(static_cast<char>(value >> 8));
+}
+
+static void appendULE32(std::vector<char>& buffer, uint32_t value)
+{
+	appendULE16(buffer, static_cast<uint16_t>(value & 0xFFFF));
+	appendULE16(buffer, static_cast<uint16_t>(value >> 16));
+}
+
+static uint16_t readULE16(const char *pData)
+{
+	const uint8_t *p = reinterpret_cast<const uint8_t *>(pData);
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readULE32(const char *pData)
+{
+	return static_cast<uint32_t>(readULE16(pData)) | (static_cast<uint32_t>(readULE16(pData + 2)) << 16);
+}
+
+static size_t paddedTo4(size_t size)
+{
+	return (size + 3) & ~static_cast<size_t>(3);
+}
+
+template<typename T>
+static void appendObject(std::vector<char>& buffer, std::vector<char>& stringTable, const T& obj, optional<uint32_t> id, optional<int8_t> player, uint8_t modules)
+{
+	appendULE32(buffer, static_cast<uint32_t>(stringTable.size()));
+	stringTable.insert(stringTable.end(), obj.name.begin(), obj.name.end());
+	stringTable.push_back('\0');
+	appendULE32(buffer, obj.position.x);
+	appendULE32(buffer, obj.position.y);
+	appendULE32(buffer, id.value_or(0));
+	appendULE16(buffer, obj.direction);
+	buffer.push_back(static_cast<char>(player.value_or(0)));
+	buffer.push_back(static_cast<char>((id.has_value() ? MAP_CACHE_OBJECT_HAS_ID : 0) | (player.has_value() ? MAP_CACHE_OBJECT_HAS_PLAYER : 0)));
+	buffer.push_back(static_cast<char>(modules));
+	buffer.insert(buffer.end(), 3, '\0');
+}
+
+struct MapCacheObject
+{
+	const char *name;
+	WorldPos position;
+	uint16_t direction;
+	optional<uint32_t> id;
+	optional<int8_t> player;
+	uint8_t modules;
+};
+
+static MapCacheObject readObject(const char *pObject, const char *pStringTable)
+{
+	MapCacheObject obj;
+	obj.name = pStringTable + readULE32(pObject);
+	obj.position.x = readULE32(pObject + 4);
+	obj.position.y = readULE32(pObject + 8);
+	uint32_t id = readULE32(pObject + 12);
+	obj.direction = readULE16(pObject + 16);
+	int8_t player = static_cast<int8_t>(pObject[18]);
+	uint8_t flags = static_cast<uint8_t>(pObject[19]);
+	obj.modules = static_cast<uint8_t>(pObject[20]);
+	if (flags & MAP_CACHE_OBJECT_HAS_ID)
+	{
+		obj.id = id;
+	}
+	if (flags & MAP_CACHE_OBJECT_HAS_PLAYER)
+	{
+		obj.player = player;
+	}
+	return obj;
+}
+
+bool Map::writeMapCache(const std::string& mapFolderPath, LoadedFormat sourceFormat, IOProvider& mapIO, LoggingProtocol* pCustomLogger)
+{
+	std::string filename = mapIO.pathJoin(mapFolderPath, "game.wzmc");
+	auto pMapData = mapData();
+	auto pTerrainTypes = mapTerrainTypes();
+	auto pStructures = mapStructures();
+	auto pDroids = mapDroids();
+	auto pFeatures = mapFeatures();
+	if (!pMapData || !pTerrainTypes || !pStructures || !pDroids || !pFeatures)
+	{
+		debug(pCustomLogger, LOG_ERROR, "Failed to load / retrieve the map data for: %s", filename.c_str());
+		return false;
+	}
+	if (pMapData->mMapTiles.size() != static_cast<size_t>(pMapData->width) * pMapData->height)
+	{
+		debug(pCustomLogger, LOG_ERROR, "Map width x height (%" PRIu32 " x %" PRIu32 ") != number of map tiles (%zu)", pMapData->width, pMapData->height, pMapData->mMapTiles.size());
+		return false;
+	}
+
+	size_t numObjects = pStructures->size() + pDroids->size() + pFeatures->size();
+	std::vector<char> buffer;
+	buffer.reserve(MAP_CACHE_HEADER_SIZE + pMapData->mMapTiles.size() * sizeof(MapData::MapTile) + pMapData->mGateways.size() * 4 + pTerrainTypes->terrainTypes.size() * 2 + numObjects * MAP_CACHE_OBJECT_SIZE + 4);
+	std::vector<char> stringTable;
+
+	// Header (the string table size is filled in at the end)
+	buffer.insert(buffer.end(), {'w', 'z', 'm', 'c'});
+	appendULE32(buffer, MAP_CACHE_VERSION);
+	appendULE32(buffer, pMapData->width);
+	appendULE32(buffer, pMapData->height);
+	appendULE32(buffer, static_cast<uint32_t>(pMapData->mGateways.size()));
+	appendULE32(buffer, static_cast<uint32_t>(pTerrainTypes->terrainTypes.size()));
+	appendULE32(buffer, static_cast<uint32_t>(pStructures->size()));
+	appendULE32(buffer, static_cast<uint32_t>(pDroids->size()));
+	appendULE32(buffer, static_cast<uint32_t>(pFeatures->size()));
+	size_t stringTableSizePos = buffer.size();
+	appendULE32(buffer, 0);
+	buffer.push_back(static_cast<char>(sourceFormat));
+	buffer.resize(44, '\0');
+	auto sourceFiles = crcSumMapFolderFiles(mapFolderPath, mapIO);
+	appendULE32(buffer, sourceFiles.totalSize);
+	appendULE32(buffer, sourceFiles.crc);
+	buffer.resize(MAP_CACHE_HEADER_SIZE, '\0');
+
+	for (const auto& tile : pMapData->mMapTiles)
+	{
+		appendULE16(buffer, tile.height);
+		appendULE16(buffer, tile.texture);
+	}
+	for (const auto& gw : pMapData->mGateways)
+	{
+		buffer.insert(buffer.end(), {static_cast<char>(gw.x1), static_cast<char>(gw.y1), static_cast<char>(gw.x2), static_cast<char>(gw.y2)});
+	}
+	for (auto terrainType : pTerrainTypes->terrainTypes)
+	{
+		appendULE16(buffer, static_cast<uint16_t>(terrainType));
+	}
+	buffer.resize(paddedTo4(buffer.size()), '\0');
+	for (const auto& structure : *pStructures)
+	{
+		appendObject(buffer, stringTable, structure, structure.id, optional<int8_t>(structure.player), structure.modules);
+	}
+	for (const auto& droid : *pDroids)
+	{
+		appendObject(buffer, stringTable, droid, droid.id, optional<int8_t>(droid.player), 0);
+	}
+	for (const auto& feature : *pFeatures)
+	{
+		appendObject(buffer, stringTable, feature, feature.id, feature.player, 0);
+	}
+
+	std::vector<char> stringTableSize;
+	appendULE32(stringTableSize, static_cast<uint32_t>(stringTable.size()));
+	std::copy(stringTableSize.begin(), stringTableSize.end(), buffer.begin() + stringTableSizePos);
+	buffer.insert(buffer.end(), stringTable.begin(), stringTable.end());
+
+	if (buffer.size() > static_cast<size_t>(std::numeric_limits<uint32_t>::max()) || !mapIO.writeFullFile(filename, buffer.data(), static_cast<uint32_t>(buffer.size())))
+	{
+		debug(pCustomLogger, LOG_ERROR, "Failed to write map cache: %s", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool Map::loadMapCache(const std::vector<char>& fileData, const std::string& filename, LoggingProtocol* pCustomLogger)
+{
+	const char *path = filename.c_str();
+	if (fileData.size() < MAP_CACHE_HEADER_SIZE || memcmp(fileData.data(), "wzmc", 4) != 0)
+	{
+		debug(pCustomLogger, LOG_ERROR, "Bad header in %s", path);
+		return false;
+	}
+	const char *pHeader = fileData.data();
+	uint32_t cacheVersion = readULE32(pHeader + 4);
+	if (cacheVersion != MAP_CACHE_VERSION)
+	{
+		// Not an error, the cache is simply ignored and the map files are loaded instead
+		debug(pCustomLogger, LOG_INFO, "%s: Unsupported map cache version %" PRIu32 "", path, cacheVersion);
+		return false;
+	}
+	uint32_t width = readULE32(pHeader + 8);
+	uint32_t height = readULE32(pHeader + 12);
+	uint32_t numGateways = readULE32(pHeader + 16);
+	uint32_t numTerrainTypes = readULE32(pHeader + 20);
+	uint32_t numStructures = readULE32(pHeader + 24);
+	uint32_t numDroids = readULE32(pHeader + 28);
+	uint32_t numFeatures = readULE32(pHeader + 32);
+	uint32_t stringTableSize = readULE32(pHeader + 36);
+	uint8_t sourceFormat = static_cast<uint8_t>(pHeader[40]);
+	uint32_t sourceFilesSize = readULE32(pHeader + 44);
+	uint32_t sourceFilesCRC = readULE32(pHeader + 48);
+
+	if ((uint64_t)width * height > MAP_MAXAREA || width <= 1 || height <= 1)
+	{
+		debug(pCustomLogger, LOG_ERROR, "%s: Bad map size: %" PRIu32 " x %" PRIu32 "", path, width, height);
+		return false;
+	}
+	if (sourceFormat > static_cast<uint8_t>(LoadedFormat::JSON_v2) || sourceFormat == static_cast<uint8_t>(LoadedFormat::SCRIPT_GENERATED))
+	{
+		debug(pCustomLogger, LOG_ERROR, "%s: Bad source map format: %u", path, static_cast<unsigned>(sourceFormat));
+		return false;
+	}
+
+	// Check the map files haven't changed since the cache was made (if they have, they are loaded instead)
+	if (m_mapIO)
+	{
+		auto sourceFiles = crcSumMapFolderFiles(m_mapFolderPath, *m_mapIO);
+		if (sourceFiles.totalSize != sourceFilesSize || sourceFiles.crc != sourceFilesCRC)
+		{
+			debug(pCustomLogger, LOG_INFO, "%s: Out of date, the map files have changed since it was written", path);
+			return false;
+		}
+	}
+
+	// Check the file has exactly the size the header claims, so every table below can be read without further checks
+	uint64_t tilesPos = MAP_CACHE_HEADER_SIZE;
+	uint64_t gatewaysPos = tilesPos + (uint64_t)width * height * sizeof(MapData::MapTile);
+	uint64_t terrainTypesPos = gatewaysPos + (uint64_t)numGateways * 4;
+	uint64_t objectsPos = paddedTo4(static_cast<size_t>(terrainTypesPos + (uint64_t)numTerrainTypes * 2));
+	uint64_t stringTablePos = objectsPos + ((uint64_t)numStructures + numDroids + numFeatures) * MAP_CACHE_OBJECT_SIZE;
+	if (stringTablePos + stringTableSize != fileData.size() || (stringTableSize > 0 && fileData.back() != '\0'))
+	{
+		debug(pCustomLogger, LOG_ERROR, "%s: Truncated or corrupt map cache", path);
+		return false;
+	}
+
+	auto pMapData = std::make_shared<MapData>();
+	pMapData->width = width;
+	pMapData->height = height;
+	pMapData->mMapTiles.resize(static_cast<size_t>(width) * height);
+	if (isLittleEndian())
+	{
+		memcpy(pMapData->mMapTiles.data(), fileData.data() + tilesPos, pMapData->mMapTiles.size() * sizeof(MapData::MapTile));
+	}
+	else
+	{
+		for (size_t i = 0; i < pMapData->mMapTiles.size(); ++i)
+		{
+			pMapData->mMapTiles[i].height = readULE16(fileData.data() + tilesPos + i * 4);
+			pMapData->mMapTiles[i].texture = readULE16(fileData.data() + tilesPos + i * 4 + 2);
+		}
+	}
+	for (const auto& tile : pMapData->mMapTiles)
+	{
+		if (tile.height > TILE_MAX_HEIGHT)
+		{
+			debug(pCustomLogger, LOG_ERROR, "%s: Tile height (%" PRIu16 ") exceeds TILE_MAX_HEIGHT (%zu)", path, tile.height, static_cast<size_t>(TILE_MAX_HEIGHT));
+			return false;
+		}
+	}
+	pMapData->mGateways.resize(numGateways);
+	for (uint32_t i = 0; i < numGateways; ++i)
+	{
+		const uint8_t *pGateway = reinterpret_cast<const uint8_t *>(fileData.data() + gatewaysPos + i * 4);
+		pMapData->mGateways[i] = MapData::Gateway{pGateway[0], pGateway[1], pGateway[2], pGateway[3]};
+	}
+
+	auto pTerrainTypes = std::make_shared<TerrainTypeData>();
+	pTerrainTypes->terrainTypes.reserve(numTerrainTypes);
+	for (uint32_t i = 0; i < numTerrainTypes; ++i)
+	{
+		uint16_t terrainType = readULE16(fileData.data() + terrainTypesPos + i * 2);
+		if (terrainType > static_cast<uint16_t>(TER_MAX))
+		{
+			debug(pCustomLogger, LOG_ERROR, "%s: Terrain type %" PRIu16 " out of range", path, terrainType);
+			return false;
+		}
+		pTerrainTypes->terrainTypes.push_back(static_cast<TYPE_OF_TERRAIN>(terrainType));
+	}
+
+	const char *pStringTable = fileData.data() + stringTablePos;
+	const char *pObject = fileData.data() + objectsPos;
+	uint32_t numObjects = numStructures + numDroids + numFeatures;
+	for (uint32_t i = 0; i < numObjects; ++i)
+	{
+		if (readULE32(pObject + i * MAP_CACHE_OBJECT_SIZE) >= stringTableSize)
+		{
+			debug(pCustomLogger, LOG_ERROR, "%s: Bad object name", path);
+			return false;
+		}
+	}
+
+	auto pStructures = std::make_shared<std::vector<Structure>>(numStructures);
+	for (auto& structure : *pStructures)
+	{
+		auto obj = readObject(pObject, pStringTable);
+		pObject += MAP_CACHE_OBJECT_SIZE;
+		structure.name = obj.name;
+		structure.position = obj.position;
+		structure.direction = obj.direction;
+		structure.id = obj.id;
+		structure.player = obj.player.value_or(0);
+		structure.modules = obj.modules;
+	}
+	auto pDroids = std::make_shared<std::vector<Droid>>(numDroids);
+	for (auto& droid : *pDroids)
+	{
+		auto obj = readObject(pObject, pStringTable);
+		pObject += MAP_CACHE_OBJECT_SIZE;
+		droid.name = obj.name;
+		droid.position = obj.position;
+		droid.direction = obj.direction;
+		droid.id = obj.id;
+		droid.player = obj.player.value_or(0);
+	}
+	auto pFeatures = std::make_shared<std::vector<Feature>>(numFeatures);
+	for (auto& feature : *pFeatures)
+	{
+		auto obj = readObject(pObject, pStringTable);
+		pObject += MAP_CACHE_OBJECT_SIZE;
+		feature.name = obj.name;
+		feature.position = obj.position;
+		feature.direction = obj.direction;
+		feature.id = obj.id;
+		feature.player = obj.player;
+	}
+
+	m_mapData = std::move(pMapData);
+	m_terrainTypes = std::move(pTerrainTypes);
+	m_structures = std::move(pStructures);
+	m_droids = std::move(pDroids);
+	m_features = std::move(pFeatures);
+	m_mapCacheSourceFormat = static_cast<LoadedFormat>(sourceFormat);
+	return true;
+}
+
+} // namespace WzMap
@@ -22,10 +22,12 @@
 
 #include <cstddef>
 #include <cinttypes>
+#include <string>
 
 namespace WzMap {
 
 struct WorldPos;
+class IOProvider;
 
 uint32_t crcSum(uint32_t crc, const void *data, size_t dataLen);
 uint32_t crcSumU16(uint32_t crc, const uint16_t *data, size_t dataLen);
@@ -33,4 +35,14 @@ uint32_t crcSumI16(uint32_t crc, const int16_t *data, size_t dataLen);
 uint32_t crcSumU32(uint32_t crc, const uint32_t *data, size_t dataLen);
 uint32_t crcSumWorldPos(uint32_t crc, const WorldPos *data, size_t dataLen);
 
+// The CRC of the map files in a map folder (any of Map::expectedFileNames but game.wzmc, in a fixed order) - their names,
+// sizes and contents, read but not parsed - and their total size
+struct MapFolderFilesCRC
+{
+	uint32_t crc = 0;
+	uint32_t totalSize = 0;
+	bool hasMapScript = false; // game.js, so the map contents also depend on the seed
+};
+MapFolderFilesCRC crcSumMapFolderFiles(const std::string& mapFolderPath, IOProvider& mapIO);
+
 } // namespace WZMap
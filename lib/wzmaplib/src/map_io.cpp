@@ -496,13 +496,17 @@ bool StdIOProvider::loadFullFile(const std::string& filename, std::vector<char>&
 	do {
 		data.resize(data.size() + chunkSize);
 		bytesRead = pStream->readBytes(&(data[readPos]), chunkSize);
+		if (bytesRead.has_value())
+		{
+			readPos += bytesRead.value();
+		}
 	} while (bytesRead.has_value() && bytesRead.value() == chunkSize);
 	if (!bytesRead.has_value())
 	{
 		// failed reading
 		return false;
 	}
-	data.resize(readPos + bytesRead.value()); // truncate to exact length read
+	data.resize(readPos); // truncate to exact length read
 	fileData = std::move(data);
 	return true;
 }
@@ -26,6 +26,7 @@
 #include <cinttypes>
 #include <limits>
 #include <cassert>
+#include <mutex>
 
 #define MAX_PLAYERS         11                 ///< Maximum number of players in the game.
 
@@ -699,6 +700,8 @@ static int runMapScript_InterruptHandler(JSRuntime *rt, void *opaque)
 	return (secondsElapsed >= MAX_MAPSCRIPT_RUNTIME_SECONDS);
 }
 
+// Maps may be loaded on several threads at once (see processMapBatch), so the leak handler's logger is guarded
+static std::mutex runtimeFreeMutex;
 static LoggingProtocol* pRuntimeFree_CustomLogger = nullptr;
 static void QJSRuntimeFree_LeakHandler_Warning(const char* msg)
 {
@@ -718,6 +721,7 @@ std::shared_ptr<Map> runMapScript(const std::vector<char>& fileBuffer, const std
 		return nullptr;
 	}
 	auto free_runtime_ref = gsl::finally([rt, pCustomLogger] {
+		std::lock_guard<std::mutex> guard(runtimeFreeMutex);
 		pRuntimeFree_CustomLogger = pCustomLogger;
 		JS_FreeRuntime2(rt, QJSRuntimeFree_LeakHandler_Warning);
 		pRuntimeFree_CustomLogger = nullptr;
@@ -21,6 +21,7 @@
 #include "../include/wzmaplib/map.h"
 #include "map_internal.h"
 #include "map_jsonhelpers.h"
+#include "map_crc.h"
 
 #include <vector>
 #include <unordered_map>
@@ -679,6 +680,42 @@ optional<MapStatsConfiguration::StructureSize> MapStatsConfiguration::getStructu
 	return it->second;
 }
 
+static uint32_t crcSumNames(uint32_t crc, const std::unordered_set<std::string>& names)
+{
+	// sorted, so equal sets always give the same CRC
+	std::vector<std::string> sortedNames(names.begin(), names.end());
+	std::sort(sortedNames.begin(), sortedNames.end());
+	uint32_t count = static_cast<uint32_t>(sortedNames.size());
+	crc = crcSumU32(crc, &count, 1);
+	for (const auto& name : sortedNames)
+	{
+		crc = crcSum(crc, name.c_str(), name.size() + 1);
+	}
+	return crc;
+}
+
+uint32_t MapStatsConfiguration::crcSum(uint32_t crc) const
+{
+	for (const auto* pNames : { &constructorDroids, &resourceExtractors, &powerGenerators, &factories, &vtolFactories, &cyborgFactories, &researchCenters, &hqStructs, &defenseStructs, &factoryModules, &researchModules, &powerModules, &oilResources, &oilDrums })
+	{
+		crc = crcSumNames(crc, *pNames);
+	}
+	std::vector<std::string> sortedStructs;
+	for (const auto& it : structSizes)
+	{
+		sortedStructs.push_back(it.first);
+	}
+	std::sort(sortedStructs.begin(), sortedStructs.end());
+	for (const auto& structName : sortedStructs)
+	{
+		const auto& size = structSizes.at(structName);
+		crc = WzMap::crcSum(crc, structName.c_str(), structName.size() + 1);
+		crc = crcSumU32(crc, &size.baseWidth, 1);
+		crc = crcSumU32(crc, &size.baseBreadth, 1);
+	}
+	return crc;
+}
+
 bool MapStatsConfiguration::isStructExpansionModule(const std::string& struct_id) const
 {
 	return powerModules.count(struct_id)
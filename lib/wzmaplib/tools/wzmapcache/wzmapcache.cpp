@@ -0,0 +1,285 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+// wzmapcache: pre-generates a map info cache (map stats + previews) for a set of maps, using WzMap::processMapBatch
+// (and, optionally, a binary map cache - game.wzmc - in each map folder, so the maps load without parsing the map files)
+//
+// Usage: wzmapcache [options] <cache file> <map folder | folder of map folders>...
+
+#include <wzmaplib/map_batch.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static void printUsage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [options] <cache file> <map folder | folder of map folders>...\n", argv0);
+	fprintf(stderr, "Adds the stats and previews of the maps to the cache file (creating it if needed).\n\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  --players N         Maximum players of maps whose folder name doesn't start with \"<N>c-\" (default: 8)\n");
+	fprintf(stderr, "  --tileset NAME      Preview colors: arizona (default), urban or rockies\n");
+	fprintf(stderr, "  --map-type TYPE     Map type to load the maps and calculate their stats as: skirmish (default), campaign or savegame\n");
+	fprintf(stderr, "  --no-preview        Only calculate map stats\n");
+	fprintf(stderr, "  --prune             Remove the cache entries of maps not processed this time (ex. deleted or changed maps)\n");
+	fprintf(stderr, "  --threads N         Number of threads (default: one per hardware thread)\n");
+	fprintf(stderr, "  --write-map-caches  Also write a binary map cache (game.wzmc) into each map folder (except for script-generated maps)\n");
+}
+
+// Only warnings and errors, one line each (called from all of processMapBatch's threads - a single fprintf keeps lines whole)
+class WzMapCacheLogger : public WzMap::LoggingProtocol
+{
+public:
+	virtual void printLog(LoggingProtocol::LogLevel level, const char *function, int line, const char *str) override
+	{
+		if (level < LoggingProtocol::LogLevel::Warning)
+		{
+			return;
+		}
+		fprintf(stderr, "[%s:%d] %s\n", function, line, str);
+	}
+};
+
+static bool hasFile(WzMap::IOProvider& mapIO, const std::string& folder, const char *fileName)
+{
+	bool found = false;
+	mapIO.enumerateFiles(folder, [&](const char *file) {
+		found = mapIO.pathBaseName(file) == fileName;
+		return !found;
+	});
+	return found;
+}
+
+static bool isMapFolder(WzMap::IOProvider& mapIO, const std::string& folder)
+{
+	bool found = false;
+	mapIO.enumerateFiles(folder, [&](const char *file) {
+		std::string fileName = mapIO.pathBaseName(file);
+		found = fileName == "game.map" || fileName == "game.js" || fileName == "game.wzmc";
+		return !found;
+	});
+	return found;
+}
+
+// Map folders are named like "4c-Rush" - the maximum number of players, followed by "c-"
+static uint32_t maxPlayersFromFolderName(const std::string& folderName, uint32_t defaultMaxPlayers)
+{
+	char *pEnd = nullptr;
+	unsigned long players = strtoul(folderName.c_str(), &pEnd, 10);
+	if (pEnd == folderName.c_str() || strncmp(pEnd, "c-", 2) != 0 || players == 0 || players > 255)
+	{
+		return defaultMaxPlayers;
+	}
+	return static_cast<uint32_t>(players);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t defaultMaxPlayers = 8;
+	unsigned numThreads = 0;
+	bool generatePreviews = true;
+	bool writeMapCaches = false;
+	bool prune = false;
+	WzMap::MapType mapType = WzMap::MapType::SKIRMISH;
+	WzMap::MapPreviewColorScheme previewColorScheme;
+	previewColorScheme.tilesetColors = WzMap::TilesetColorScheme::TilesetArizona();
+	previewColorScheme.hqColor = {255, 0, 255, 255};
+	previewColorScheme.oilResourceColor = {255, 255, 0, 255};
+	previewColorScheme.oilBarrelColor = {128, 192, 0, 255};
+
+	int arg = 1;
+	for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; ++arg)
+	{
+		std::string option = argv[arg];
+		bool hasValue = arg + 1 < argc;
+		if (option == "--players" && hasValue)
+		{
+			defaultMaxPlayers = static_cast<uint32_t>(atoi(argv[++arg]));
+		}
+		else if (option == "--threads" && hasValue)
+		{
+			numThreads = static_cast<unsigned>(atoi(argv[++arg]));
+		}
+		else if (option == "--tileset" && hasValue)
+		{
+			std::string tileset = argv[++arg];
+			if (tileset == "arizona")
+			{
+				previewColorScheme.tilesetColors = WzMap::TilesetColorScheme::TilesetArizona();
+			}
+			else if (tileset == "urban")
+			{
+				previewColorScheme.tilesetColors = WzMap::TilesetColorScheme::TilesetUrban();
+			}
+			else if (tileset == "rockies")
+			{
+				previewColorScheme.tilesetColors = WzMap::TilesetColorScheme::TilesetRockies();
+			}
+			else
+			{
+				fprintf(stderr, "Unknown tileset: %s\n", tileset.c_str());
+				return 1;
+			}
+		}
+		else if (option == "--map-type" && hasValue)
+		{
+			std::string type = argv[++arg];
+			if (type == "skirmish")
+			{
+				mapType = WzMap::MapType::SKIRMISH;
+			}
+			else if (type == "campaign")
+			{
+				mapType = WzMap::MapType::CAMPAIGN;
+			}
+			else if (type == "savegame")
+			{
+				mapType = WzMap::MapType::SAVEGAME;
+			}
+			else
+			{
+				fprintf(stderr, "Unknown map type: %s\n", type.c_str());
+				return 1;
+			}
+		}
+		else if (option == "--no-preview")
+		{
+			generatePreviews = false;
+		}
+		else if (option == "--prune")
+		{
+			prune = true;
+		}
+		else if (option == "--write-map-caches")
+		{
+			writeMapCaches = true;
+		}
+		else
+		{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (argc - arg < 2 || defaultMaxPlayers == 0)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+	std::string cacheFile = argv[arg++];
+
+	auto mapIO = std::make_shared<WzMap::StdIOProvider>();
+	auto logger = std::make_shared<WzMapCacheLogger>();
+	std::vector<WzMap::MapBatchItem> items;
+	auto addMap = [&](const std::string& folder) {
+		WzMap::MapBatchItem item;
+		item.mapFolderPath = folder;
+		item.mapType = mapType;
+		item.mapMaxPlayers = maxPlayersFromFolderName(mapIO->pathBaseName(folder), defaultMaxPlayers);
+		item.mapIO = mapIO;
+		item.previewColorScheme = (generatePreviews) ? &previewColorScheme : nullptr;
+		items.push_back(item);
+	};
+	for (; arg < argc; ++arg)
+	{
+		std::string folder = argv[arg];
+		while (folder.size() > 1 && folder.back() == '/')
+		{
+			folder.pop_back();
+		}
+		if (isMapFolder(*mapIO, folder))
+		{
+			addMap(folder);
+			continue;
+		}
+		mapIO->enumerateFolders(folder, [&](const char *subfolder) {
+			std::string mapFolder = mapIO->pathJoin(folder, mapIO->pathBaseName(subfolder));
+			if (isMapFolder(*mapIO, mapFolder))
+			{
+				addMap(mapFolder);
+			}
+			return true;
+		});
+	}
+	if (items.empty())
+	{
+		fprintf(stderr, "No maps found\n");
+		return 1;
+	}
+
+	size_t numFailed = 0;
+	if (writeMapCaches)
+	{
+		size_t numWritten = 0;
+		for (const auto& item : items)
+		{
+			if (hasFile(*mapIO, item.mapFolderPath, "game.js"))
+			{
+				continue; // generated anew for every seed, nothing to cache
+			}
+			auto map = WzMap::Map::loadFromPath(item.mapFolderPath, item.mapType, item.mapMaxPlayers, item.seed, logger, mapIO);
+			if (!map || !map->writeMapCacheToMapFolder())
+			{
+				fprintf(stderr, "Failed to write map cache: %s\n", item.mapFolderPath.c_str());
+				++numFailed;
+				continue;
+			}
+			++numWritten;
+		}
+		printf("Wrote %zu map caches\n", numWritten);
+	}
+
+	WzMap::MapInfoCache cache;
+	cache.loadFromFile(cacheFile, *mapIO, logger.get());
+
+	auto startTime = std::chrono::steady_clock::now();
+	auto results = WzMap::processMapBatch(items, WzMap::MapStatsConfiguration(mapType), &cache, numThreads, logger);
+	auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+	size_t numFromCache = 0;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (!results[i].loaded || !results[i].info.stats.has_value())
+		{
+			fprintf(stderr, "Failed: %s\n", items[i].mapFolderPath.c_str());
+			++numFailed;
+		}
+		else if (results[i].fromCache)
+		{
+			++numFromCache;
+		}
+	}
+	printf("Processed %zu maps in %lld ms (%zu already cached, %zu failed)\n", items.size(), static_cast<long long>(elapsedMs), numFromCache, numFailed);
+
+	size_t numPruned = 0;
+	if (prune)
+	{
+		numPruned = cache.pruneUnused();
+		printf("Pruned %zu entries\n", numPruned);
+	}
+	bool cacheChanged = numFromCache != items.size() || numPruned > 0;
+	if (cacheChanged && !cache.saveToFile(cacheFile, *mapIO, logger.get()))
+	{
+		return 1;
+	}
+	printf("%s: %zu entries\n", cacheFile.c_str(), cache.size());
+	return (numFailed > 0) ? 1 : 0;
+}
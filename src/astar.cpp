@@ -598,6 +598,127 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 	return retval;
 }
 
+const uint8_t PathFlowField::NONE;
+
+bool PathFlowField::isReachable(Vector2i tile) const
+{
+	if (tile == destTile)
+	{
+		return true;
+	}
+	return tile.x >= 0 && tile.y >= 0 && tile.x < width && tile.y < height && dir[tile.x + tile.y * width] != NONE;
+}
+
+Vector2i PathFlowField::nextTile(Vector2i tile) const
+{
+	if (tile == destTile || !isReachable(tile))
+	{
+		return tile;
+	}
+	return tile + aDirOffset[dir[tile.x + tile.y * width]];
+}
+
+void fpathFlowFieldExecute(PathFlowField &field, PATHJOB const &job)
+{
+	const PathNonblockingArea dstIgnore(job.dstStructure);
+	PathBlockingMap const &blockingMap = *job.blockingMap;
+	auto isBlocked = [&](int x, int y) {
+		if (dstIgnore.isNonblocking(x, y))
+		{
+			return false;
+		}
+		return x < 0 || y < 0 || x >= mapWidth || y >= mapHeight || blockingMap.map[x + y * mapWidth];
+	};
+	auto isDangerous = [&](int x, int y) {
+		return !blockingMap.dangerMap.empty() && blockingMap.dangerMap[x + y * mapWidth];
+	};
+
+	field.destTile = Vector2i(map_coord(job.destX), map_coord(job.destY));
+	field.width = mapWidth;
+	field.height = mapHeight;
+	field.dir.assign(static_cast<size_t>(mapWidth) * static_cast<size_t>(mapHeight), PathFlowField::NONE);
+	ASSERT_OR_RETURN(, worldOnMap(job.destX, job.destY), "Flow field destination (%d, %d) not on map!", job.destX, job.destY);
+
+	// Dijkstra from the destination, over the whole reachable map. Ties are broken by PathNode ordering, so the result is the same everywhere.
+	std::vector<unsigned> dist(field.dir.size(), UINT32_MAX);
+	std::vector<PathNode> nodes;
+	PathNode start;
+	start.p = PathCoord(field.destTile.x, field.destTile.y);
+	start.dist = start.est = 0;
+	dist[start.p.x + start.p.y * mapWidth] = 0;
+	nodes.push_back(start);
+
+	while (!nodes.empty())
+	{
+		PathNode node = fpathTakeNode(nodes);
+		if (node.dist != dist[node.p.x + node.p.y * mapWidth])
+		{
+			continue;  // Already found a shorter way here.
+		}
+
+		for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
+		{
+			int x = node.p.x + aDirOffset[dir].x;
+			int y = node.p.y + aDirOffset[dir].y;
+
+			// Same rules as fpathAStarExplore, we cannot cut corners.
+			if (dir % 2 != 0 && !dstIgnore.isNonblocking(node.p.x, node.p.y) && !dstIgnore.isNonblocking(x, y))
+			{
+				if (isBlocked(node.p.x + aDirOffset[(dir + 1) % 8].x, node.p.y + aDirOffset[(dir + 1) % 8].y) ||
+				    isBlocked(node.p.x + aDirOffset[(dir + 7) % 8].x, node.p.y + aDirOffset[(dir + 7) % 8].y))
+				{
+					continue;
+				}
+			}
+			if (isBlocked(x, y))
+			{
+				continue;
+			}
+
+			PathNode next;
+			next.p = PathCoord(x, y);
+			next.dist = node.dist + fpathEstimate(node.p, next.p) * (isDangerous(x, y) ? 5 : 1);
+			next.est = next.dist;
+			if (next.dist >= dist[x + y * mapWidth])
+			{
+				continue;
+			}
+			dist[x + y * mapWidth] = next.dist;
+			field.dir[x + y * mapWidth] = (dir + 4) % 8;  // Back towards node.
+			nodes.push_back(next);
+			std::push_heap(nodes.begin(), nodes.end());
+		}
+	}
+}
+
+ASR_RETVAL fpathFlowFieldRoute(MOVE_CONTROL *psMove, PathFlowField const &field, PATHJOB const &job)
+{
+	Vector2i tile(map_coord(job.origX), map_coord(job.origY));
+	if (!field.isReachable(tile))
+	{
+		return ASR_FAILED;
+	}
+
+	// Only keep the tiles where the direction changes.
+	psMove->asPath.clear();
+	Vector2i prevStep(0, 0);
+	while (tile != field.destTile)
+	{
+		ASSERT_OR_RETURN(ASR_FAILED, psMove->asPath.size() < static_cast<size_t>(field.width) * static_cast<size_t>(field.height), "Flow field got in a loop.");
+		Vector2i next = field.nextTile(tile);
+		if (next - tile != prevStep && tile != Vector2i(map_coord(job.origX), map_coord(job.origY)))
+		{
+			psMove->asPath.push_back(world_coord(tile) + Vector2i(TILE_UNITS / 2, TILE_UNITS / 2));
+		}
+		prevStep = next - tile;
+		tile = next;
+	}
+	psMove->asPath.push_back(Vector2i(job.destX, job.destY));
+	psMove->destination = psMove->asPath.back();
+
+	return ASR_OK;
+}
+
 void fpathSetBlockingMap(PATHJOB *psJob)
 {
 	if (fpathCurrentGameTime != gameTime)
@@ -40,6 +40,39 @@ enum ASR_RETVAL
  */
 ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob);
 
+/** Directions leading from every reachable map tile to a common destination tile.
+ *  Shared by all droids in a group moving to the same place.
+ *
+ *  @ingroup pathfinding
+ */
+struct PathFlowField
+{
+	static const uint8_t NONE = 0xFF;
+
+	/// Returns true if tile is the destination, or has a way to get there.
+	bool isReachable(Vector2i tile) const;
+	/// Returns the tile to go to next on the way from tile to the destination. Returns tile itself if at the destination, or not reachable.
+	Vector2i nextTile(Vector2i tile) const;
+
+	Vector2i destTile = Vector2i(0, 0);
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> dir;               ///< Direction to the next tile, index into aDirOffset, or NONE.
+};
+
+/** Fill a flow field leading to the destination of psJob. Run only from path thread.
+ *
+ *  @ingroup pathfinding
+ */
+void fpathFlowFieldExecute(PathFlowField &field, PATHJOB const &job);
+
+/** Follow a flow field from the origin of psJob to make a path.
+ *
+ *  @return ASR_FAILED if the origin is not reachable in the flow field.
+ *  @ingroup pathfinding
+ */
+ASR_RETVAL fpathFlowFieldRoute(MOVE_CONTROL *psMove, PathFlowField const &field, PATHJOB const &job);
+
 /// Call from main thread.
 /// Sets psJob->blockingMap for later use by pathfinding thread, generating the required map if not already generated.
 void fpathSetBlockingMap(PATHJOB *psJob);
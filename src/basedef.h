@@ -27,6 +27,7 @@
 #include <bitset>
 
 #include "lib/framework/vector.h"
+#include "lib/framework/pooled_allocator.h"
 #include "displaydef.h"
 #include "statsdef.h"
 #include "weapondef.h"
@@ -105,7 +106,7 @@ struct BASE_OBJECT : public SIMPLE_OBJECT
 	UDWORD              body;                       ///< Hit points with lame name
 	UDWORD              periodicalDamageStart;                  ///< When the object entered the fire
 	UDWORD              periodicalDamage;                 ///< How much damage has been done since the object entered the fire
-	std::vector<TILEPOS> watchedTiles;              ///< Variable size array of watched tiles, empty for features
+	wz::pooled_vector<TILEPOS> watchedTiles;        ///< Variable size array of watched tiles, empty for features
 
 	// DISPLAY-ONLY (*NOT* for game state calculations)
 	UDWORD              timeAnimationStarted;       ///< Animation start time, zero for do not animate
@@ -47,272 +47,170 @@
 // someone needs to take a good look at the radius calculation
 #define SCALE_DEPTH (FP12_MULTIPLIER*7)
 
-struct BUCKET_TAG
+#define BUCKET_RADIX_MIN_TAGS	64	// sort smaller lists with std::sort
+
+/*
+ * Render sort keys, sorted in ascending order:
+ *
+ *  63..62  pass: state sorted objects, then depth sorted objects back to front, then particles
+ *  61..30  texture page (state sorted), or INT32_MAX - depth (depth sorted)
+ *  29..27  render type, since each type is drawn by its own code
+ *  26..0   mesh, so instances of the same mesh are queued together
+ */
+enum BUCKET_PASS
 {
-	bool operator <(BUCKET_TAG const &b) const
-	{
-		return actualZ > b.actualZ;    // Sort in reverse z order.
-	}
+	BUCKET_PASS_STATE_SORTED,
+	BUCKET_PASS_DEPTH_SORTED,
+	BUCKET_PASS_PARTICLES,
+};
 
+struct BUCKET_TAG
+{
+	uint64_t        sortKey;    //render order, see bucketSortKey()
 	RENDER_TYPE     objectType; //type of object held
 	void           *pObject;    //pointer to the object
-	int32_t         actualZ;
 };
 
 static std::vector<BUCKET_TAG> bucketArray;
+static std::vector<BUCKET_TAG> bucketSortBuffer;
 
-static SDWORD bucketCalculateZ(RENDER_TYPE objectType, void *pObject, const glm::mat4 &perspectiveViewMatrix)
+static uint64_t bucketSortKey(BUCKET_PASS pass, uint32_t order, RENDER_TYPE objectType, const iIMDShape *pie)
 {
-	SDWORD				z = 0, radius;
-	Vector2i				pixel(0, 0);
-	Vector3i				position(0, 0, 0);
-	UDWORD				droidSize;
-	DROID				*psDroid;
-	BODY_STATS			*psBStats;
-	SIMPLE_OBJECT		*psSimpObj;
-	const iIMDShape		*pImd;
-	Spacetime               spacetime;
+	uint64_t mesh = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pie) >> 4) & 0x7FFFFFF;
+	return static_cast<uint64_t>(pass) << 62 | static_cast<uint64_t>(order) << 30 | static_cast<uint64_t>(objectType & 0x7) << 27 | mesh;
+}
+
+static uint32_t bucketTexpageOrder(const iIMDShape *pie)
+{
+	return static_cast<uint32_t>(std::min<size_t>(pie->getTextures().texpage, UINT32_MAX));
+}
+
+/// The sphere an object is clipped against, and what to add to its projected depth
+struct BUCKET_BOUNDS
+{
+	Vector3i        position = Vector3i(0, 0, 0);
+	int32_t         radius = 0;
+	int32_t         depthBias = 0;
+	bool            clip = true;    //clip against the screen edges, using radius
+};
+
+/// Get the bounds of an object. Returns false if the object is never drawn.
+static bool bucketObjectBounds(RENDER_TYPE objectType, void *pObject, BUCKET_BOUNDS &bounds)
+{
+	SIMPLE_OBJECT *psSimpObj;
 
 	switch (objectType)
 	{
 	case RENDER_PARTICLE:
-		position.x = static_cast<int>(((ATPART *)pObject)->position.x);
-		position.y = static_cast<int>(((ATPART *)pObject)->position.y);
-		position.z = static_cast<int>(((ATPART *)pObject)->position.z);
-
-		position.x = position.x;
-		position.z = -(position.z);
-
+		bounds.position.x = static_cast<int>(((ATPART *)pObject)->position.x);
+		bounds.position.y = static_cast<int>(((ATPART *)pObject)->position.y);
+		bounds.position.z = -static_cast<int>(((ATPART *)pObject)->position.z);
+		//particle use the image radius
+		bounds.radius = ((ATPART *)pObject)->imd->radius;
 		/* 16 below is HACK!!! */
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel) - 16;
-		if (z > 0)
-		{
-			//particle use the image radius
-			radius = ((ATPART *)pObject)->imd->radius;
-			radius *= SCALE_DEPTH;
-			radius /= z;
-			if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-			    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-			{
-				z = -1;
-			}
-		}
-		break;
+		bounds.depthBias = -16;
+		return true;
 	case RENDER_PROJECTILE:
 		if (((PROJECTILE *)pObject)->psWStats->weaponSubClass == WSC_FLAME ||
 		    ((PROJECTILE *)pObject)->psWStats->weaponSubClass == WSC_COMMAND ||
 		    ((PROJECTILE *)pObject)->psWStats->weaponSubClass == WSC_EMP)
 		{
 			/* We don't do projectiles from these guys, cos there's an effect instead */
-			z = -1;
+			return false;
 		}
-		else
-		{
-
-			//the weapon stats holds the reference to which graphic to use
-			pImd = ((PROJECTILE *)pObject)->psWStats->pInFlightGraphic->displayModel();
-
-			psSimpObj = (SIMPLE_OBJECT *) pObject;
-			position.x = psSimpObj->pos.x;
-			position.z = -(psSimpObj->pos.y);
-
-			position.y = psSimpObj->pos.z;
-
-			z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel);
-
-			if (z > 0)
-			{
-				//particle use the image radius
-				radius = pImd->radius;
-				radius *= SCALE_DEPTH;
-				radius /= z;
-				if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-				    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-				{
-					z = -1;
-				}
-			}
-		}
-		break;
+		psSimpObj = (SIMPLE_OBJECT *) pObject;
+		bounds.position = Vector3i(psSimpObj->pos.x, psSimpObj->pos.z, -(psSimpObj->pos.y));
+		//the weapon stats holds the reference to which graphic to use
+		bounds.radius = ((PROJECTILE *)pObject)->psWStats->pInFlightGraphic->displayModel()->radius;
+		return true;
 	case RENDER_STRUCTURE://not depth sorted
 		psSimpObj = (SIMPLE_OBJECT *) pObject;
-		position.x = psSimpObj->pos.x;
-		position.z = -(psSimpObj->pos.y);
-
-		if ((objectType == RENDER_STRUCTURE) &&
-		    ((((STRUCTURE *)pObject)->pStructureType->type == REF_DEFENSE) ||
-		     (((STRUCTURE *)pObject)->pStructureType->type == REF_WALL) ||
-		     (((STRUCTURE *)pObject)->pStructureType->type == REF_WALLCORNER)))
-		{
-			position.y = psSimpObj->pos.z + 64;
-			radius = ((STRUCTURE *)pObject)->sDisplay.imd->radius; //walls guntowers and tank traps clip tightly
-		}
-		else
+		bounds.position = Vector3i(psSimpObj->pos.x, psSimpObj->pos.z, -(psSimpObj->pos.y));
+		if ((((STRUCTURE *)pObject)->pStructureType->type == REF_DEFENSE) ||
+		    (((STRUCTURE *)pObject)->pStructureType->type == REF_WALL) ||
+		    (((STRUCTURE *)pObject)->pStructureType->type == REF_WALLCORNER))
 		{
-			position.y = psSimpObj->pos.z;
-			radius = (((STRUCTURE *)pObject)->sDisplay.imd->radius);
+			bounds.position.y += 64; //walls guntowers and tank traps clip tightly
 		}
-
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel);
-
-		if (z > 0)
-		{
-			//particle use the image radius
-			radius *= SCALE_DEPTH;
-			radius /= z;
-			if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-			    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-			{
-				z = -1;
-			}
-		}
-		break;
+		bounds.radius = ((STRUCTURE *)pObject)->sDisplay.imd->radius;
+		return true;
 	case RENDER_FEATURE://not depth sorted
 		psSimpObj = (SIMPLE_OBJECT *) pObject;
-		position.x = psSimpObj->pos.x;
-		position.z = -(psSimpObj->pos.y);
-
-		position.y = psSimpObj->pos.z + 2;
-
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel);
-
-		if (z > 0)
-		{
-			//particle use the image radius
-			radius = ((FEATURE *)pObject)->sDisplay.imd->radius;
-			radius *= SCALE_DEPTH;
-			radius /= z;
-			if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-			    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-			{
-				z = -1;
-			}
-		}
-		break;
+		bounds.position = Vector3i(psSimpObj->pos.x, psSimpObj->pos.z + 2, -(psSimpObj->pos.y));
+		bounds.radius = ((FEATURE *)pObject)->sDisplay.imd->radius;
+		return true;
 	case RENDER_DROID:
-		psDroid = (DROID *) pObject;
-
 		psSimpObj = (SIMPLE_OBJECT *) pObject;
-		position.x = psSimpObj->pos.x;
-		position.z = -(psSimpObj->pos.y);
-		position.y = psSimpObj->pos.z;
-
-		psBStats = psDroid->getBodyStats();
-		droidSize = psBStats->pIMD->radius;
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel) - (droidSize * 2);
-
-		if (z > 0)
-		{
-			//particle use the image radius
-			radius = droidSize;
-			radius *= SCALE_DEPTH;
-			radius /= z;
-			if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-			    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-			{
-				z = -1;
-			}
-		}
-		break;
+		bounds.position = Vector3i(psSimpObj->pos.x, psSimpObj->pos.z, -(psSimpObj->pos.y));
+		bounds.radius = ((DROID *)pObject)->getBodyStats()->pIMD->radius;
+		bounds.depthBias = -(bounds.radius * 2);
+		return true;
 	case RENDER_PROXMSG:
 		if (((PROXIMITY_DISPLAY *)pObject)->type == POS_PROXDATA)
 		{
-			const PROXIMITY_DISPLAY *ptr = (PROXIMITY_DISPLAY *)pObject;
-			position.x = ((VIEW_PROXIMITY *)ptr->psMessage->pViewData->pData)->x;
-#if defined( _MSC_VER )
-	#pragma warning( push )
-	#pragma warning( disable : 4146 ) // warning C4146: unary minus operator applied to unsigned type, result still unsigned
-#endif
-			position.z = -(((VIEW_PROXIMITY *)ptr->psMessage->pViewData->pData)->y);
-#if defined( _MSC_VER )
-	#pragma warning( pop )
-#endif
-			position.y = ((VIEW_PROXIMITY *)ptr->psMessage->pViewData->pData)->z;
+			const VIEW_PROXIMITY *pViewProximity = (VIEW_PROXIMITY *)((PROXIMITY_DISPLAY *)pObject)->psMessage->pViewData->pData;
+			bounds.position = Vector3i(pViewProximity->x, pViewProximity->z, -static_cast<int>(pViewProximity->y));
 		}
 		else if (((PROXIMITY_DISPLAY *)pObject)->type == POS_PROXOBJ)
 		{
-			const PROXIMITY_DISPLAY *ptr = (PROXIMITY_DISPLAY *)pObject;
-			position.x = ptr->psMessage->psObj->pos.x;
-			position.z = -(ptr->psMessage->psObj->pos.y);
-			position.y = ptr->psMessage->psObj->pos.z;
-		}
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel);
-
-		if (z > 0)
-		{
-			//particle use the image radius
-			pImd = getDisplayImdFromIndex(MI_BLIP_ENEMY);//use MI_BLIP_ENEMY as all are same radius
-			radius = pImd->radius;
-			radius *= SCALE_DEPTH;
-			radius /= z;
-			if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-			    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-			{
-				z = -1;
-			}
+			const BASE_OBJECT *psObj = ((PROXIMITY_DISPLAY *)pObject)->psMessage->psObj;
+			bounds.position = Vector3i(psObj->pos.x, psObj->pos.z, -(psObj->pos.y));
 		}
-		break;
+		//use MI_BLIP_ENEMY as all are same radius
+		bounds.radius = getDisplayImdFromIndex(MI_BLIP_ENEMY)->radius;
+		return true;
 	case RENDER_EFFECT:
-		position.x = static_cast<int>(((EFFECT *)pObject)->position.x);
-		position.z = static_cast<int>(-(((EFFECT *)pObject)->position.z));
-		position.y = static_cast<int>(((EFFECT *)pObject)->position.y);
-
+		bounds.position.x = static_cast<int>(((EFFECT *)pObject)->position.x);
+		bounds.position.y = static_cast<int>(((EFFECT *)pObject)->position.y);
+		bounds.position.z = static_cast<int>(-(((EFFECT *)pObject)->position.z));
 		/* 16 below is HACK!!! */
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel) - 16;
-
-		if (z > 0)
+		bounds.depthBias = -16;
+		if (((EFFECT *)pObject)->imd != nullptr)
 		{
-			//particle use the image radius
-			pImd = ((EFFECT *)pObject)->imd;
-			if (pImd != nullptr)
-			{
-				radius = pImd->radius;
-				radius *= SCALE_DEPTH;
-				radius /= z;
-				if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-				    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-				{
-					z = -1;
-				}
-			}
+			bounds.radius = ((EFFECT *)pObject)->imd->radius;
 		}
-
-		break;
-
+		else
+		{
+			bounds.clip = false;
+		}
+		return true;
 	case RENDER_DELIVPOINT:
-		position.x = ((FLAG_POSITION *)pObject)->coords.x;
-		position.z = -(((FLAG_POSITION *)pObject)->coords.y);
-		position.y = ((FLAG_POSITION *)pObject)->coords.z;
+		bounds.position.x = ((FLAG_POSITION *)pObject)->coords.x;
+		bounds.position.y = ((FLAG_POSITION *)pObject)->coords.z;
+		bounds.position.z = -(((FLAG_POSITION *)pObject)->coords.y);
+		bounds.radius = pAssemblyPointIMDs[((FLAG_POSITION *)pObject)->factoryType][((FLAG_POSITION *)pObject)->factoryInc]->radius;
+		return true;
+	}
+	return false;
+}
 
-		z = pie_RotateProjectWithPerspective(&position, perspectiveViewMatrix, &pixel);
+/// Projected depth of an object, or -1 if it is off screen
+static SDWORD bucketCalculateZ(RENDER_TYPE objectType, void *pObject, const glm::mat4 &perspectiveViewMatrix)
+{
+	BUCKET_BOUNDS bounds;
+	if (!bucketObjectBounds(objectType, pObject, bounds))
+	{
+		return -1;
+	}
 
-		if (z > 0)
+	Vector2i pixel(0, 0);
+	SDWORD z = pie_RotateProjectWithPerspective(&bounds.position, perspectiveViewMatrix, &pixel) + bounds.depthBias;
+	if (z > 0 && bounds.clip)
+	{
+		SDWORD radius = bounds.radius * SCALE_DEPTH / z;
+		if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
+		    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
 		{
-			//particle use the image radius
-			radius = pAssemblyPointIMDs[((FLAG_POSITION *)pObject)->factoryType][((FLAG_POSITION *)pObject)->factoryInc]->radius;
-			radius *= SCALE_DEPTH;
-			radius /= z;
-			if ((pixel.x + radius < CLIP_LEFT) || (pixel.x - radius > CLIP_RIGHT)
-			    || (pixel.y + radius < CLIP_TOP) || (pixel.y - radius > CLIP_BOTTOM))
-			{
-				z = -1;
-			}
+			z = -1;
 		}
-
-		break;
-
-	default:
-		break;
 	}
-
 	return z;
 }
 
 /* add an object to the current render list */
 void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4 &perspectiveViewMatrix)
 {
-	const iIMDShape *pie;
-	BUCKET_TAG	newTag;
+	const iIMDShape *pie = nullptr;
 	int32_t		z = bucketCalculateZ(objectType, pObject, perspectiveViewMatrix);
 
 	if (z < 0)
@@ -327,9 +225,12 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 		return;
 	}
 
+	BUCKET_PASS pass = BUCKET_PASS_STATE_SORTED;
+	uint32_t order = 0;
 	switch (objectType)
 	{
 	case RENDER_EFFECT:
+		pie = ((EFFECT *)pObject)->imd;
 		switch (((EFFECT *)pObject)->group)
 		{
 		case EFFECT_EXPLOSION:
@@ -337,57 +238,105 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 		case EFFECT_SMOKE:
 		case EFFECT_FIREWORK:
 			// Use calculated Z
+			pass = BUCKET_PASS_DEPTH_SORTED;
+			order = static_cast<uint32_t>(INT32_MAX - z);
 			break;
 
 		case EFFECT_WAYPOINT:
-			pie = ((EFFECT *)pObject)->imd;
-			z = INT32_MAX - pie->getTextures().texpage;
+			order = bucketTexpageOrder(pie);
 			break;
 
 		default:
-			z = INT32_MAX - 42;
+			order = 42;
 			break;
 		}
 		break;
 	case RENDER_DROID:
 		pie = BODY_IMD(((DROID *)pObject), 0)->displayModel();
-		z = INT32_MAX - pie->getTextures().texpage;
+		order = bucketTexpageOrder(pie);
 		break;
 	case RENDER_STRUCTURE:
 		pie = ((STRUCTURE *)pObject)->sDisplay.imd->displayModel();
-		z = INT32_MAX - pie->getTextures().texpage;
+		order = bucketTexpageOrder(pie);
 		break;
 	case RENDER_FEATURE:
 		pie = ((FEATURE *)pObject)->sDisplay.imd->displayModel();
-		z = INT32_MAX - pie->getTextures().texpage;
+		order = bucketTexpageOrder(pie);
 		break;
 	case RENDER_DELIVPOINT:
 		pie = pAssemblyPointIMDs[((FLAG_POSITION *)pObject)->
 		                         factoryType][((FLAG_POSITION *)pObject)->factoryInc]->displayModel();
-		z = INT32_MAX - pie->getTextures().texpage;
+		order = bucketTexpageOrder(pie);
 		break;
 	case RENDER_PARTICLE:
-		z = 0;
+		pass = BUCKET_PASS_PARTICLES;
+		pie = ((ATPART *)pObject)->imd->displayModel();
 		break;
 	default:
 		// Use calculated Z
+		pass = BUCKET_PASS_DEPTH_SORTED;
+		order = static_cast<uint32_t>(INT32_MAX - z);
 		break;
 	}
 
-	//put the object data into the tag
-	newTag.objectType = objectType;
-	newTag.pObject = pObject;
-	newTag.actualZ = z;
-
 	//add tag to bucketArray
-	bucketArray.push_back(newTag);
+	bucketArray.push_back({bucketSortKey(pass, order, objectType, pie), objectType, pObject});
+}
+
+/// Sort bucketArray by sort key with a stable LSD radix sort, 8 bits at a time.
+/// Digits which are the same in all keys (most of them, in practice) are skipped.
+static void bucketSortCurrentList()
+{
+	const size_t count = bucketArray.size();
+	if (count < BUCKET_RADIX_MIN_TAGS)
+	{
+		std::sort(bucketArray.begin(), bucketArray.end(), [](const BUCKET_TAG &a, const BUCKET_TAG &b) { return a.sortKey < b.sortKey; });
+		return;
+	}
+
+	uint32_t histograms[8][256] = {};
+	for (const BUCKET_TAG &tag : bucketArray)
+	{
+		for (unsigned digit = 0; digit < 8; ++digit)
+		{
+			++histograms[digit][(tag.sortKey >> (digit * 8)) & 0xFF];
+		}
+	}
+
+	bucketSortBuffer.resize(count);
+	BUCKET_TAG *src = bucketArray.data();
+	BUCKET_TAG *dst = bucketSortBuffer.data();
+	for (unsigned digit = 0; digit < 8; ++digit)
+	{
+		uint32_t *histogram = histograms[digit];
+		if (histogram[(src[0].sortKey >> (digit * 8)) & 0xFF] == count)
+		{
+			continue;
+		}
+		uint32_t offset = 0;
+		for (unsigned i = 0; i < 256; ++i)
+		{
+			uint32_t bucketCount = histogram[i];
+			histogram[i] = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			dst[histogram[(src[i].sortKey >> (digit * 8)) & 0xFF]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
+	if (src != bucketArray.data())
+	{
+		bucketArray.swap(bucketSortBuffer);
+	}
 }
 
 /* render Objects in list */
 void bucketRenderCurrentList(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
 {
 	WZ_PROFILE_SCOPE(bucketRenderCurrentList);
-	std::sort(bucketArray.begin(), bucketArray.end());
+	bucketSortCurrentList();
 
 	for (auto thisTag = bucketArray.cbegin(); thisTag != bucketArray.cend(); ++thisTag)
 	{
@@ -28,12 +28,15 @@
 #include "lib/framework/string_ext.h"
 #include "lib/ivis_opengl/screen.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
+#include "lib/netplay/netrelay.h"
 #include "lib/ivis_opengl/pieclip.h"
 #include "lib/ivis_opengl/png_util.h"
 
 #include "levels.h"
 #include "clparse.h"
 #include "display3d.h"
+#include "droid.h"
 #include "frontend.h"
 #include "keybind.h"
 #include "loadsave.h"
@@ -317,6 +320,7 @@ typedef enum
 	CLI_LOADSKIRMISH,
 	CLI_LOADCAMPAIGN,
 	CLI_LOADREPLAY,
+	CLI_WATCHRELAY,
 	CLI_WINDOW,
 	CLI_VERSION,
 	CLI_RESOLUTION,
@@ -349,6 +353,7 @@ typedef enum
 	CLI_WZ_CRASH_RPT,
 	CLI_WZ_DEBUG_CRASH_HANDLER,
 	CLI_STREAMER_SPECTATOR,
+	CLI_SPECTATOR_RELAY,
 	CLI_LOBBY_SLASHCOMMANDS,
 	CLI_ADD_LOBBY_ADMINHASH,
 	CLI_ADD_LOBBY_ADMINPUBLICKEY,
@@ -361,6 +366,7 @@ typedef enum
 	CLI_GAMETIMELIMITMINUTES,
 	CLI_CONVERT_SPECULAR_MAP,
 	CLI_DEBUG_VERBOSE_SYNCLOG_OUTPUT,
+	CLI_DEBUG_VALIDATE_DERIVED_STATS,
 	CLI_ALLOW_VULKAN_IMPLICIT_LAYERS,
 	CLI_HOST_CHAT_CONFIG,
 	CLI_HOST_ASYNC_JOIN_APPROVAL,
@@ -399,6 +405,7 @@ static const struct poptOption *getOptionsTable()
 		{ "loadskirmish", POPT_ARG_STRING, CLI_LOADSKIRMISH, N_("Load a saved skirmish game"),     N_("savegame") },
 		{ "loadcampaign", POPT_ARG_STRING, CLI_LOADCAMPAIGN, N_("Load a saved campaign game"),     N_("savegame") },
 		{ "loadreplay", POPT_ARG_STRING, CLI_LOADREPLAY, N_("Load a replay"),     N_("replay file") },
+		{ "watch-relay", POPT_ARG_STRING, CLI_WATCHRELAY, N_("Watch a game streamed by a spectator relay"), N_("host[:port] or [IPv6 address][:port]") },
 		{ "window", POPT_ARG_NONE, CLI_WINDOW,     N_("Play in windowed mode"),             nullptr },
 		{ "version", POPT_ARG_NONE, CLI_VERSION,    N_("Show version information and exit"), nullptr },
 		{ "resolution", POPT_ARG_STRING, CLI_RESOLUTION, N_("Set the resolution to use"),         N_("WIDTHxHEIGHT") },
@@ -442,6 +449,7 @@ static const struct poptOption *getOptionsTable()
 		{ "wz-crash-rpt", POPT_ARG_NONE, CLI_WZ_CRASH_RPT, nullptr, nullptr },
 		{ "wz-debug-crash-handler", POPT_ARG_NONE, CLI_WZ_DEBUG_CRASH_HANDLER, nullptr, nullptr },
 		{ "spectator-min-ui", POPT_ARG_NONE, CLI_STREAMER_SPECTATOR, nullptr, nullptr},
+		{ "spectator-relay", POPT_ARG_STRING, CLI_SPECTATOR_RELAY, N_("Relay the game to other spectators on the given port"), N_("port") },
 		{ "enablelobbyslashcmd", POPT_ARG_NONE, CLI_LOBBY_SLASHCOMMANDS, N_("Enable lobby slash commands (for connecting clients)"), nullptr},
 		{ "addlobbyadminhash", POPT_ARG_STRING, CLI_ADD_LOBBY_ADMINHASH, N_("Add a lobby admin identity hash (for slash commands)"), _("hash string")},
 		{ "addlobbyadminpublickey", POPT_ARG_STRING, CLI_ADD_LOBBY_ADMINPUBLICKEY, N_("Add a lobby admin public key (for slash commands)"), N_("b64-pub-key")},
@@ -454,6 +462,7 @@ static const struct poptOption *getOptionsTable()
 		{ "gametimelimit", POPT_ARG_STRING, CLI_GAMETIMELIMITMINUTES, N_("Multiplayer game time limit (in minutes)"), N_("number of minutes")},
 		{ "convert-specular-map", POPT_ARG_STRING, CLI_CONVERT_SPECULAR_MAP, N_("Convert a specular-map .png to a luma, single-channel, grayscale .png (and exit)"), "inputpath/filename.png:outputpath/filename.png" },
 		{ "debug-verbose-sync-logs-until", POPT_ARG_STRING, CLI_DEBUG_VERBOSE_SYNCLOG_OUTPUT, nullptr, nullptr },
+		{ "debug-validate-derived-stats", POPT_ARG_NONE, CLI_DEBUG_VALIDATE_DERIVED_STATS, nullptr, nullptr },
 		{ "allow-vulkan-implicit-layers", POPT_ARG_NONE, CLI_ALLOW_VULKAN_IMPLICIT_LAYERS, N_("Allow Vulkan implicit layers (that may be default-disabled due to potential crashes or bugs)"), nullptr },
 		{ "host-chat-config", POPT_ARG_STRING, CLI_HOST_CHAT_CONFIG, N_("Set the default hosting chat configuration / permissions"), "[allow,quickchat]" },
 		{ "async-join-approve", POPT_ARG_NONE, CLI_HOST_ASYNC_JOIN_APPROVAL, N_("Enable async join approval (for connecting clients)"), nullptr },
@@ -961,6 +970,29 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			SetGameMode(GS_SAVEGAMELOAD);
 			break;
 		}
+		case CLI_WATCHRELAY:
+		{
+			// retrieve the relay address, and load it like a replay
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr)
+			{
+				qFatal("No relay host given");
+			}
+			std::string relayHost;
+			unsigned relayPort = 0;
+			if (!parseReplayRelayAddress(token, relayHost, relayPort))
+			{
+				qFatal("Bad relay address: %s (use host, host:port, [IPv6 address] or [IPv6 address]:port)", token);
+			}
+			snprintf(saveGameName, sizeof(saveGameName), "%s%s", REPLAY_RELAY_PREFIX, token);
+			setHostLaunch(HostLaunch::LoadReplay);
+			sstrcpy(sRequestResult, saveGameName);
+			SPinit(LEVEL_TYPE::SKIRMISH);
+			bMultiPlayer = true;
+			game.maxPlayers = 4; //DEFAULTSKIRMISHMAPMAXPLAYERS;
+			SetGameMode(GS_SAVEGAMELOAD);
+			break;
+		}
 		case CLI_CONTINUE:
 			if (findLastSave())
 			{
@@ -1125,6 +1157,16 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			wz_streamer_spectator_mode = true;
 			break;
 
+		case CLI_SPECTATOR_RELAY:
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr || atoi(token) <= 0 || atoi(token) > 65535)
+			{
+				qFatal("Bad spectator relay port");
+			}
+			NETsetReplayRelayPort(atoi(token));
+			debug(LOG_INFO, "Games will be relayed to spectators on port [%d]", atoi(token));
+			break;
+
 		case CLI_LOBBY_SLASHCOMMANDS:
 			wz_lobby_slashcommands = true;
 			break;
@@ -1317,6 +1359,10 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			NET_setDebuggingModeVerboseOutputAllSyncLogs(atoi(token));
 			break;
 
+		case CLI_DEBUG_VALIDATE_DERIVED_STATS:
+			droidSetDerivedStatsValidation(true);
+			break;
+
 		case CLI_ALLOW_VULKAN_IMPLICIT_LAYERS:
 			war_runtimeOnlySetAllowVulkanImplicitLayers(true);
 			break;
@@ -874,12 +874,10 @@ void displayComponentButtonObject(DROID *psDroid, const Vector3i *Rotation, cons
 
 /* Assumes matrix context is already set */
 // multiple turrets display removed the pointless mountRotation
-void displayComponentObject(DROID *psDroid, const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
+bool prepareComponentObject(DROID *psDroid, const glm::mat4 &perspectiveViewMatrix, Spacetime &st, glm::mat4 &modelMatrix)
 {
 	Vector3i position, rotation;
-	Spacetime st = interpolateObjectSpacetime(psDroid, graphicsTime);
-
-	leftFirst = angleDelta(playerPos.r.y - st.rot.direction) <= 0;
+	st = interpolateObjectSpacetime(psDroid, graphicsTime);
 
 	/* Get the real position */
 	position.x = st.pos.x;
@@ -898,18 +896,34 @@ void displayComponentObject(DROID *psDroid, const glm::mat4 &viewMatrix, const g
 
 	/* Translate origin */
 	/* Rotate for droid */
-	glm::mat4 modelMatrix = glm::translate(glm::vec3(position)) *
+	modelMatrix = glm::translate(glm::vec3(position)) *
 		glm::rotate(UNDEG(rotation.y), glm::vec3(0.f, 1.f, 0.f)) *
 		glm::rotate(UNDEG(rotation.x), glm::vec3(1.f, 0.f, 0.f)) *
 		glm::rotate(UNDEG(rotation.z), glm::vec3(0.f, 0.f, 1.f));
 
+	// now check if the projected circle is within the screen boundaries
+	return clipDroidOnScreen(psDroid, perspectiveViewMatrix * modelMatrix);
+}
+
+void displayComponentObject(DROID *psDroid, const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
+{
+	Spacetime st;
+	glm::mat4 modelMatrix;
+	bool onScreen = prepareComponentObject(psDroid, perspectiveViewMatrix, st, modelMatrix);
+	displayComponentObject(psDroid, st, modelMatrix, onScreen, viewMatrix, perspectiveViewMatrix);
+}
+
+void displayComponentObject(DROID *psDroid, const Spacetime &st, glm::mat4 modelMatrix, bool onScreen, const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
+{
+	leftFirst = angleDelta(playerPos.r.y - st.rot.direction) <= 0;
+
 	if (psDroid->timeLastHit - graphicsTime < ELEC_DAMAGE_DURATION && psDroid->lastHitWeapon == WSC_ELECTRONIC)
 	{
 		modelMatrix *= objectShimmy((BASE_OBJECT *) psDroid);
+		onScreen = clipDroidOnScreen(psDroid, perspectiveViewMatrix * modelMatrix);
 	}
 
-	// now check if the projected circle is within the screen boundaries
-	if(!clipDroidOnScreen(psDroid, perspectiveViewMatrix * modelMatrix))
+	if (!onScreen)
 	{
 		return;
 	}
@@ -71,6 +71,10 @@ void displayResearchButton(BASE_STATS *Stat, const Vector3i *Rotation, const Vec
 void displayComponentButtonTemplate(DROID_TEMPLATE *psTemplate, const Vector3i *Rotation, const Vector3i *Position, int scale);
 void displayComponentButtonObject(DROID *psDroid, const Vector3i *Rotation, const Vector3i *Position, int scale);
 void displayComponentObject(DROID *psDroid, const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix);
+/// Work out where a droid is drawn this frame, and whether it is on screen. Only reads the droid, so it can run on another thread.
+bool prepareComponentObject(DROID *psDroid, const glm::mat4 &perspectiveViewMatrix, Spacetime &st, glm::mat4 &modelMatrix);
+/// Draw a droid placed by prepareComponentObject().
+void displayComponentObject(DROID *psDroid, const Spacetime &st, glm::mat4 modelMatrix, bool onScreen, const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix);
 
 void compPersonToBits(DROID *psDroid);
 
@@ -51,6 +51,10 @@
 #endif
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/matrix_interpolation.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "loop.h"
 #include "atmos.h"
@@ -109,6 +113,7 @@ static void	drawDragBox();
 static void	calcFlagPosScreenCoords(SDWORD *pX, SDWORD *pY, SDWORD *pR, const glm::mat4 &perspectiveViewModelMatrix);
 static void	drawTiles(iView *player, LightingData& lightData, LightMap& lightmap, ILightingManager& lightManager);
 static void	display3DProjectiles(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix);
+bool quickClipXYToMaximumTilesFromCurrentPosition(SDWORD x, SDWORD y);
 static void	drawDroidAndStructureSelections();
 static void	drawDroidSelections();
 static void	drawStructureSelections();
@@ -1304,6 +1309,211 @@ glm::mat4 getBiasedShadowMapMVPMatrix(glm::mat4 lightOrthoMatrix, const glm::mat
 	return biasMatrix * shadowMatrix;
 }
 
+#define SHADOW_CACHE_MOVE_TOLERANCE	(TILE_UNITS / 8)	// camera movement (in world units) a cached cascade tolerates
+#define SHADOW_CACHE_TURN_TOLERANCE	(DEG(1) / 2)		// camera rotation a cached cascade tolerates
+#define SHADOW_CACHE_ZOOM_TOLERANCE	8.f					// change of the camera distance a cached cascade tolerates
+
+/// A shadow cascade as it was last rendered, and the view it was rendered for
+struct CachedShadowCascade
+{
+	Cascade cascade;
+	Vector3i cameraPosition;
+	Vector3i cameraRotation;
+	float cameraDistance = 0.f;
+	glm::vec3 lightInvDir = glm::vec3(0.f);
+	unsigned int age = 0;	// frames since the cascade was rendered
+	bool valid = false;
+};
+
+static CachedShadowCascade cachedShadowCascades[WZ_MAX_SHADOW_CASCADES];
+static int cachedShadowMapSize = 0;
+static size_t cachedNumShadowCascades = 0;
+
+/// Forget all cached shadow cascades, so that they are all rendered next frame
+static void invalidateShadowCascadeCache()
+{
+	for (auto &cached : cachedShadowCascades)
+	{
+		cached.valid = false;
+	}
+}
+
+/// Decide whether shadow cascade `idx` needs to be rendered this frame. If not, `cascade` is replaced by the cached one,
+/// so that the shadow lookups match the depth map contents left over from the frame it was rendered in.
+/// The nearest cascade holds the shadows of everything moving close to the camera, so it is always rendered. Further
+/// cascades cover a large area at a low resolution, where a few frames of delay in the shadows of moving objects
+/// can't be seen: they are only rendered when the camera or the sun moved, or every 2^idx frames.
+static bool shadowCascadeNeedsRender(size_t idx, const iView *player, const glm::vec3 &lightInvDir, Cascade &cascade)
+{
+	CachedShadowCascade &cached = cachedShadowCascades[idx];
+	++cached.age;
+	bool render = idx == 0
+	           || !cached.valid
+	           || cached.age >= (1u << idx)
+	           || lightInvDir != cached.lightInvDir
+	           || std::abs(distance - cached.cameraDistance) > SHADOW_CACHE_ZOOM_TOLERANCE
+	           || std::abs(player->p.x - cached.cameraPosition.x) > SHADOW_CACHE_MOVE_TOLERANCE
+	           || std::abs(player->p.y - cached.cameraPosition.y) > SHADOW_CACHE_MOVE_TOLERANCE
+	           || std::abs(player->p.z - cached.cameraPosition.z) > SHADOW_CACHE_MOVE_TOLERANCE
+	           || std::abs(angleDelta(player->r.x - cached.cameraRotation.x)) > SHADOW_CACHE_TURN_TOLERANCE
+	           || std::abs(angleDelta(player->r.y - cached.cameraRotation.y)) > SHADOW_CACHE_TURN_TOLERANCE
+	           || std::abs(angleDelta(player->r.z - cached.cameraRotation.z)) > SHADOW_CACHE_TURN_TOLERANCE;
+	if (!render)
+	{
+		cascade = cached.cascade;
+		return false;
+	}
+
+	cached.cascade = cascade;
+	cached.cameraPosition = player->p;
+	cached.cameraRotation = player->r;
+	cached.cameraDistance = distance;
+	cached.lightInvDir = lightInvDir;
+	cached.age = 0;
+	cached.valid = true;
+	return true;
+}
+
+#define DROID_PLACEMENT_MIN_PARALLEL	64	// fewer droids than this are placed on the main thread
+
+/// A droid to draw this frame, and where, worked out by prepareComponentObject()
+struct DroidPlacement
+{
+	DROID *psDroid = nullptr;
+	Spacetime st;
+	glm::mat4 modelMatrix = glm::mat4(1.f);
+	bool onScreen = false;
+};
+
+/**
+ * Places the droids of a frame (interpolation, model matrices and clipping) on a
+ * worker thread, while the main thread prepares the terrain, effects and static
+ * objects of the same frame. The droids to draw are listed on the main thread
+ * when the frame starts, and nothing changes them until the main thread collects
+ * the placements, so the worker only reads state which is fixed for the frame.
+ */
+class DroidPlacementWorker
+{
+public:
+	~DroidPlacementWorker()
+	{
+		stop();
+	}
+
+	/// List the droids to draw, and start placing them.
+	void begin(const glm::mat4 &perspectiveViewMatrix)
+	{
+		WZ_PROFILE_SCOPE(DroidPlacementWorker_begin);
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this] { return !working; });
+
+		placements.clear();
+		viewProjection = perspectiveViewMatrix;
+		for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+		{
+			for (DROID *psDroid : apsDroidLists[player])
+			{
+				addDroid(psDroid);
+			}
+		}
+		// Walk through destroyed objects.
+		for (BASE_OBJECT *psObj : psDestroyedObj)
+		{
+			addDroid(castDroid(psObj));
+		}
+
+		if (placements.size() < DROID_PLACEMENT_MIN_PARALLEL || std::thread::hardware_concurrency() < 2)
+		{
+			placeAll();
+			return;
+		}
+		if (!thread.joinable())
+		{
+			thread = std::thread(&DroidPlacementWorker::run, this);
+		}
+		working = true;
+		cond.notify_all();
+	}
+
+	/// Wait for the droids listed by begin() to be placed.
+	const std::vector<DroidPlacement> &finish()
+	{
+		WZ_PROFILE_SCOPE(DroidPlacementWorker_finish);
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this] { return !working; });
+		return placements;
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		cond.notify_all();
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+		stopping = false;
+		working = false;
+		placements.clear();
+	}
+
+private:
+	void addDroid(DROID *psDroid)
+	{
+		if (!psDroid || (psDroid->died != 0 && psDroid->died < graphicsTime)
+		    || !quickClipXYToMaximumTilesFromCurrentPosition(psDroid->pos.x, psDroid->pos.y))
+		{
+			return;
+		}
+
+		/* No point in adding it if you can't see it? */
+		if (psDroid->visibleForLocalDisplay())
+		{
+			placements.emplace_back();
+			placements.back().psDroid = psDroid;
+		}
+	}
+
+	void placeAll()
+	{
+		for (DroidPlacement &placement : placements)
+		{
+			placement.onScreen = prepareComponentObject(placement.psDroid, viewProjection, placement.st, placement.modelMatrix);
+		}
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			cond.wait(lock, [this] { return stopping || working; });
+			if (stopping)
+			{
+				return;
+			}
+			lock.unlock();
+			placeAll();
+			lock.lock();
+			working = false;
+			cond.notify_all();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable cond;  ///< Signalled when work is started or done, or when stopping
+	bool working = false;          ///< The worker is placing the droids
+	bool stopping = false;
+	glm::mat4 viewProjection = glm::mat4(1.f);
+	std::vector<DroidPlacement> placements;
+	std::thread thread;
+};
+
+static DroidPlacementWorker droidPlacementWorker;
+
 /// Draw the terrain and all droids, missiles and other objects on it
 static void drawTiles(iView *player, LightingData& lightData, LightMap& lightmap, ILightingManager& lightManager)
 {
@@ -1436,6 +1646,9 @@ static void drawTiles(iView *player, LightingData& lightData, LightMap& lightmap
 
 	wzPerfEnd(PERF_START_FRAME);
 
+	// Place the droids on a worker thread while the terrain, effects and static objects are prepared
+	droidPlacementWorker.begin(perspectiveViewMatrix);
+
 	pie_StartMeshes();
 
 	/* This is done here as effects can light the terrain - pause mode problems though */
@@ -1460,6 +1673,7 @@ static void drawTiles(iView *player, LightingData& lightData, LightMap& lightmap
 	/* ---------------------------------------------------------------- */
 	/* Calculate & batch all mesh / object instances to be drawn        */
 	/* ---------------------------------------------------------------- */
+	findStaticObjectsInView();
 	displayStaticObjects(viewMatrix, perspectiveViewMatrix); // may be bucket render implemented
 	displayFeatures(viewMatrix, perspectiveViewMatrix);
 	displayDynamicObjects(viewMatrix, perspectiveViewMatrix); // may be bucket render implemented
@@ -1491,6 +1705,18 @@ static void drawTiles(iView *player, LightingData& lightData, LightMap& lightmap
 	// shadow/depth-mapping passes
 	ShadowCascadesInfo shadowCascadesInfo;
 	shadowCascadesInfo.shadowMapSize = gfx_api::context::get().getDepthPassDimensions(0); // Note: Currently assumes that every depth pass has the same dimensions
+	if (currShadowMode != ShadowMode::Shadow_Mapping || shadowCascadesInfo.shadowMapSize != cachedShadowMapSize || numShadowCascades != cachedNumShadowCascades)
+	{
+		// The depth maps were recreated (or will be, when shadow mapping is switched back on)
+		invalidateShadowCascadeCache();
+		cachedShadowMapSize = shadowCascadesInfo.shadowMapSize;
+		cachedNumShadowCascades = numShadowCascades;
+	}
+	bool renderShadowCascade[WZ_MAX_SHADOW_CASCADES] = {false};
+	for (size_t i = 0; i < std::min<size_t>(shadowCascades.size(), WZ_MAX_SHADOW_CASCADES); ++i)
+	{
+		renderShadowCascade[i] = shadowCascadeNeedsRender(i, player, lightInvDir, shadowCascades[i]);
+	}
 	for (size_t i = 0; i < std::min<size_t>(shadowCascades.size(), WZ_MAX_SHADOW_CASCADES); ++i)
 	{
 		shadowCascadesInfo.shadowMVPMatrix[i] = getBiasedShadowMapMVPMatrix(shadowCascades[i].projectionMatrix, shadowCascades[i].viewMatrix);
@@ -1502,6 +1728,10 @@ static void drawTiles(iView *player, LightingData& lightData, LightMap& lightmap
 		WZ_PROFILE_SCOPE(ShadowMapping);
 		for (size_t i = 0; i < numShadowCascades; ++i)
 		{
+			if (!renderShadowCascade[i])
+			{
+				continue; // keep the depth map from the frame the cached cascade was rendered in
+			}
 			gfx_api::context::get().beginDepthPass(i);
 			pie_DrawAllMeshes(currentGameFrame, shadowCascades[i].projectionMatrix, shadowCascades[i].viewMatrix, shadowCascadesInfo, true);
 			gfx_api::context::get().endCurrentDepthPass();
@@ -1639,6 +1869,7 @@ void shutdown3DView()
 	droidText = WzText();
 
 	batchedObjectStatusRenderer.clear(); // NOTE: *NOT* reset() - see shutdown3DView_FullReset below for why
+	droidPlacementWorker.stop();
 }
 
 void shutdown3DView_FullReset()
@@ -1992,6 +2223,48 @@ void	renderProjectile(PROJECTILE *psCurr, const glm::mat4 &viewMatrix, const glm
 	}
 }
 
+/// Structures and features standing on the tiles around the camera, found by findStaticObjectsInView()
+static std::vector<BASE_OBJECT *> staticObjectsInView;
+
+/**
+ * Find the structures and features which may be on screen, through the objects
+ * referenced by the map tiles around the camera. This avoids walking the object
+ * lists, which hold every tree, boulder and wall section on the map.
+ */
+static void findStaticObjectsInView()
+{
+	WZ_PROFILE_SCOPE(findStaticObjectsInView);
+	staticObjectsInView.clear();
+
+	// All tiles clipXY() can accept (with a tile to spare for rounding), plus two more tiles to the left and
+	// above, since clipStructureOnScreen() accepts structures up to two tiles beyond a visible tile for shadows.
+	const int centreX = map_coord(playerPos.p.x);
+	const int centreY = map_coord(playerPos.p.z);
+	const int minX = std::max(centreX - visibleTiles.x / 2 - 5, 0);
+	const int minY = std::max(centreY - visibleTiles.y / 2 - 5, 0);
+	const int maxX = std::min(centreX + visibleTiles.x / 2 + 3, mapWidth - 1);
+	const int maxY = std::min(centreY + visibleTiles.y / 2 + 3, mapHeight - 1);
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		const BASE_OBJECT *psPrevious = nullptr;
+		for (int x = minX; x <= maxX; ++x)
+		{
+			BASE_OBJECT *psObj = mapTile(x, y)->psObject;
+			// Objects spanning several tiles are seen once per tile, skip the repeats along the row here
+			if (psObj != nullptr && psObj != psPrevious)
+			{
+				staticObjectsInView.push_back(psObj);
+			}
+			psPrevious = psObj;
+		}
+	}
+
+	// Remove the remaining repeats, and keep the drawing order stable from frame to frame
+	std::sort(staticObjectsInView.begin(), staticObjectsInView.end(), [](const BASE_OBJECT *a, const BASE_OBJECT *b) { return a->id < b->id; });
+	staticObjectsInView.erase(std::unique(staticObjectsInView.begin(), staticObjectsInView.end()), staticObjectsInView.end());
+}
+
 /// Draw the buildings
 static void displayStaticObjects(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
 {
@@ -1999,26 +2272,22 @@ static void displayStaticObjects(const glm::mat4 &viewMatrix, const glm::mat4 &p
 	// to solve the flickering edges of baseplates
 //	pie_SetDepthOffset(-1.0f);
 
-	/* Go through all the players */
-	for (unsigned aPlayer = 0; aPlayer < MAX_PLAYERS; ++aPlayer)
+	/* Go through the buildings around the camera */
+	for (BASE_OBJECT* obj : staticObjectsInView)
 	{
-		/* Now go all buildings for that player */
-		for (BASE_OBJECT* obj : apsStructLists[aPlayer])
+		/* Worth rendering the structure? Destroyed ones are drawn from the destroyed objects below. */
+		if (obj->type != OBJ_STRUCTURE || obj->died != 0)
 		{
-			/* Worth rendering the structure? */
-			if (obj->type != OBJ_STRUCTURE || (obj->died != 0 && obj->died < graphicsTime))
-			{
-				continue;
-			}
-			STRUCTURE *psStructure = castStructure(obj);
-
-			if (!clipStructureOnScreen(psStructure))
-			{
-				continue;
-			}
+			continue;
+		}
+		STRUCTURE *psStructure = castStructure(obj);
 
-			renderStructure(psStructure, viewMatrix, perspectiveViewMatrix);
+		if (!clipStructureOnScreen(psStructure))
+		{
+			continue;
 		}
+
+		renderStructure(psStructure, viewMatrix, perspectiveViewMatrix);
 	}
 
 	// Walk through destroyed objects.
@@ -2278,13 +2547,11 @@ static void displayDelivPoints(const glm::mat4& viewMatrix, const glm::mat4 &per
 static void displayFeatures(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
 {
 	WZ_PROFILE_SCOPE(displayFeatures);
-	// player can only be 0 for the features.
-
-	/* Go through all the features */
-	for (BASE_OBJECT* obj : apsFeatureLists[0])
+	/* Go through the features around the camera */
+	for (BASE_OBJECT* obj : staticObjectsInView)
 	{
 		if (obj->type == OBJ_FEATURE
-			&& (obj->died == 0 || obj->died > graphicsTime)
+			&& obj->died == 0
 			&& clipXY(obj->pos.x, obj->pos.y))
 		{
 			FEATURE* psFeature = castFeature(obj);
@@ -2354,40 +2621,10 @@ static void displayProximityMsgs(const glm::mat4& viewMatrix, const glm::mat4 &p
 static void displayDynamicObjects(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
 {
 	WZ_PROFILE_SCOPE(displayDynamicObjects);
-	/* Need to go through all the droid lists */
-	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
-	{
-		for (DROID* psDroid : apsDroidLists[player])
-		{
-			if (!psDroid || (psDroid->died != 0 && psDroid->died < graphicsTime)
-			    || !quickClipXYToMaximumTilesFromCurrentPosition(psDroid->pos.x, psDroid->pos.y))
-			{
-				continue;
-			}
-
-			/* No point in adding it if you can't see it? */
-			if (psDroid->visibleForLocalDisplay())
-			{
-				displayComponentObject(psDroid, viewMatrix, perspectiveViewMatrix);
-			}
-		}
-	}
-
-	// Walk through destroyed objects.
-	for (const auto& obj : psDestroyedObj)
+	/* Need to go through the droids placed by droidPlacementWorker */
+	for (const DroidPlacement &placement : droidPlacementWorker.finish())
 	{
-		DROID* psDroid = castDroid(obj);
-		if (!psDroid || (obj->died != 0 && obj->died < graphicsTime)
-			|| !quickClipXYToMaximumTilesFromCurrentPosition(obj->pos.x, obj->pos.y))
-		{
-			continue;
-		}
-
-		/* No point in adding it if you can't see it? */
-		if (psDroid->visibleForLocalDisplay())
-		{
-			displayComponentObject(psDroid, viewMatrix, perspectiveViewMatrix);
-		}
+		displayComponentObject(placement.psDroid, placement.st, placement.modelMatrix, placement.onScreen, viewMatrix, perspectiveViewMatrix);
 	}
 }
 
@@ -29,6 +29,9 @@
 #include "lib/framework/strres.h"
 #include "lib/framework/object_list_iteration.h"
 
+#include <array>
+#include <unordered_map>
+
 #include "lib/gamelib/gtime.h"
 #include "lib/ivis_opengl/piematrix.h"
 #include "lib/ivis_opengl/ivisdef.h"
@@ -82,6 +85,27 @@
 // store the experience of recently recycled droids
 static std::priority_queue<int> recycled_experience[MAX_PLAYERS];
 
+/// Key of a droid design for the derived stats cache: the component parts followed by the non-empty weapon slots.
+typedef std::array<uint32_t, DROID_MAXCOMP + MAX_WEAPONS> DerivedStatsKey;
+
+struct DerivedStatsKeyHash
+{
+	size_t operator()(DerivedStatsKey const &key) const
+	{
+		size_t hash = 0;
+		for (uint32_t part : key)
+		{
+			hash = hash * 31 + part;
+		}
+		return hash;
+	}
+};
+
+// upgraded stats of each droid design, per player - cleared whenever the upgrades of that player change
+static std::unordered_map<DerivedStatsKey, DROID_DERIVED_STATS, DerivedStatsKeyHash> derivedStatsCache[MAX_PLAYERS];
+// recompute cached stats on every lookup and assert that they still match
+static bool derivedStatsValidation = false;
+
 /** Height the transporter hovers at above the terrain. */
 #define TRANSPORTER_HOVER_HEIGHT	10
 
@@ -96,7 +120,6 @@ static void groupConsoleInformOfCreation(UDWORD groupNumber);
 static void groupConsoleInformOfCentering(UDWORD groupNumber);
 static void groupConsoleInformOfRemoval();
 static void droidUpdateDroidSelfRepair(DROID *psRepairDroid);
-static UDWORD calcDroidBaseBody(DROID *psDroid);
 
 int getTopExperience(int player)
 {
@@ -140,13 +163,12 @@ static void droidBodyUpgrade(DROID *psDroid)
 {
 	const int factor = 10000; // use big numbers to scare away rounding errors
 	int prev = psDroid->originalBody;
-	psDroid->originalBody = calcDroidBaseBody(psDroid);
+	DROID_DERIVED_STATS stats = droidDerivedStats(psDroid);
+	psDroid->originalBody = stats.body;
 	int increase = psDroid->originalBody * factor / prev;
 	psDroid->body = MIN(psDroid->originalBody, (psDroid->body * increase) / factor + 1);
-	DROID_TEMPLATE sTemplate;
-	templateSetParts(psDroid, &sTemplate);
 	// update engine too
-	psDroid->baseSpeed = calcDroidBaseSpeed(&sTemplate, psDroid->weight, psDroid->player);
+	psDroid->baseSpeed = stats.baseSpeed;
 	if (psDroid->isTransporter())
 	{
 		for (DROID *psCurr : psDroid->psGroup->psList)
@@ -167,6 +189,7 @@ bool droidInit()
 		recycled_experience[i] = std::priority_queue <int>(); // clear it
 	}
 	psLastDroidHit = nullptr;
+	droidInvalidateDerivedStats(-1);
 
 	moveInit();
 
@@ -1574,12 +1597,6 @@ UDWORD calcTemplateBody(const DROID_TEMPLATE *psTemplate, UBYTE player)
 	return calcBody(psTemplate, player);
 }
 
-// Calculate the base body points of a droid with upgrades
-static UDWORD calcDroidBaseBody(DROID *psDroid)
-{
-	return calcBody(psDroid, psDroid->player);
-}
-
 
 /* Calculate the base speed of a droid from it's template */
 UDWORD calcDroidBaseSpeed(const DROID_TEMPLATE *psTemplate, UDWORD weight, UBYTE player)
@@ -1675,6 +1692,87 @@ UDWORD calcDroidPower(const DROID *psDroid)
 	return calcPower(psDroid);
 }
 
+static DerivedStatsKey derivedStatsKey(const uint8_t (&asParts)[DROID_MAXCOMP], int numWeaps, const uint32_t (&asWeaps)[MAX_WEAPONS])
+{
+	DerivedStatsKey key = {};
+	std::copy(asParts, asParts + DROID_MAXCOMP, key.begin());
+	int slot = DROID_MAXCOMP;
+	for (int i = 0; i < numWeaps; ++i)
+	{
+		if (asWeaps[i] > 0)
+		{
+			key[slot++] = asWeaps[i];
+		}
+	}
+	return key;
+}
+
+static DROID_DERIVED_STATS calcDerivedStats(const DROID_TEMPLATE *psTemplate, int player)
+{
+	DROID_DERIVED_STATS stats;
+	ASSERT_PLAYER_OR_RETURN(stats, player);
+	stats.body = calcBody(psTemplate, player);
+	stats.weight = calcDroidWeight(psTemplate);
+	stats.baseSpeed = calcDroidBaseSpeed(psTemplate, stats.weight, player);
+	return stats;
+}
+
+static void validateDerivedStats(DROID_DERIVED_STATS const &cached, const DROID_TEMPLATE *psTemplate, int player)
+{
+	DROID_DERIVED_STATS current = calcDerivedStats(psTemplate, player);
+	ASSERT(cached.body == current.body && cached.weight == current.weight && cached.baseSpeed == current.baseSpeed,
+	       "Stale derived stats for player %d body %s: body %u/%u, weight %u/%u, speed %u/%u",
+	       player, psTemplate->getBodyStats()->id.toUtf8().c_str(), cached.body, current.body, cached.weight, current.weight,
+	       cached.baseSpeed, current.baseSpeed);
+}
+
+DROID_DERIVED_STATS droidDerivedStats(const DROID *psDroid)
+{
+	ASSERT_NOT_NULLPTR_OR_RETURN(DROID_DERIVED_STATS(), psDroid);
+	const int player = psDroid->player;
+	ASSERT_PLAYER_OR_RETURN(DROID_DERIVED_STATS(), player);
+	FilterDroidWeaps f = {psDroid->numWeaps, psDroid->asWeaps};
+	DerivedStatsKey key = derivedStatsKey(psDroid->asBits, f.numWeaps, f.asWeaps);
+	auto it = derivedStatsCache[player].find(key);
+	if (it != derivedStatsCache[player].end() && !derivedStatsValidation)
+	{
+		return it->second;
+	}
+	DROID_TEMPLATE sTemplate;
+	templateSetParts(psDroid, &sTemplate);
+	// compact the weapon slots, like calcUpgradeSum does for droids
+	sTemplate.numWeaps = f.numWeaps;
+	std::fill(std::copy(f.asWeaps, f.asWeaps + f.numWeaps, sTemplate.asWeaps), sTemplate.asWeaps + MAX_WEAPONS, 0);
+	if (it == derivedStatsCache[player].end())
+	{
+		it = derivedStatsCache[player].emplace(key, calcDerivedStats(&sTemplate, player)).first;
+	}
+	else
+	{
+		validateDerivedStats(it->second, &sTemplate, player);
+	}
+	return it->second;
+}
+
+void droidInvalidateDerivedStats(int player)
+{
+	if (player < 0)
+	{
+		for (auto &cache : derivedStatsCache)
+		{
+			cache.clear();
+		}
+		return;
+	}
+	ASSERT_PLAYER_OR_RETURN(, player);
+	derivedStatsCache[player].clear();
+}
+
+void droidSetDerivedStatsValidation(bool enabled)
+{
+	derivedStatsValidation = enabled;
+}
+
 //Builds an instance of a Droid - the x/y passed in are in world coords.
 DROID *reallyBuildDroid(const DROID_TEMPLATE *pTemplate, Position pos, UDWORD player, bool onMission, Rotation rot, uint32_t id)
 {
@@ -1725,17 +1823,18 @@ DROID *reallyBuildDroid(const DROID_TEMPLATE *pTemplate, Position pos, UDWORD pl
 	droid.kills = 0;
 
 	droidSetBits(pTemplate, &droid);
+	DROID_DERIVED_STATS stats = droidDerivedStats(&droid);
 
 	//calculate the droids total weight
-	droid.weight = calcDroidWeight(pTemplate);
+	droid.weight = stats.weight;
 
 	// Initialise the movement stuff
-	droid.baseSpeed = calcDroidBaseSpeed(pTemplate, droid.weight, (UBYTE)player);
+	droid.baseSpeed = stats.baseSpeed;
 
 	initDroidMovement(&droid);
 
 	//allocate 'easy-access' data!
-	droid.body = calcDroidBaseBody(&droid); // includes upgrades
+	droid.body = stats.body; // includes upgrades
 	ASSERT(droid.body > 0, "Invalid number of hitpoints");
 	droid.originalBody = droid.body;
 
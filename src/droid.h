@@ -112,6 +112,21 @@ UDWORD calcTemplateBuild(const DROID_TEMPLATE *psTemplate);
 /* Calculate the power points required to build/maintain the droid */
 UDWORD calcTemplatePower(const DROID_TEMPLATE *psTemplate);
 
+/// Upgraded stats of a droid design, cached per player until the upgrades of that player change.
+struct DROID_DERIVED_STATS
+{
+	uint32_t body = 0;                          ///< Body points including upgrades, as calcTemplateBody
+	uint32_t weight = 0;                        ///< As calcDroidWeight
+	uint32_t baseSpeed = 0;                     ///< As calcDroidBaseSpeed
+};
+
+/// Look up the upgraded stats of a droid's design, computing them on first use.
+DROID_DERIVED_STATS droidDerivedStats(const DROID *psDroid);
+/// Forget the cached stats of a player (or all players, if player is negative). Must be called whenever upgrades change.
+void droidInvalidateDerivedStats(int player);
+/// If enabled, every cache hit is recomputed and asserted to match the cached value.
+void droidSetDerivedStatsValidation(bool enabled);
+
 /* Do damage to a droid */
 int32_t droidDamage(DROID *psDroid, unsigned damage, WEAPON_CLASS weaponClass, WEAPON_SUBCLASS weaponSubClass, unsigned impactTime, bool isDamagePerSecond, int minDamage, bool empRadiusHit);
 
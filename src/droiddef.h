@@ -26,6 +26,8 @@
 
 #include <vector>
 
+#include "lib/framework/pooled_allocator.h"
+
 #include "stringdef.h"
 #include "actiondef.h"
 #include "basedef.h"
@@ -51,7 +53,7 @@
 //defines how many times to perform the iteration on looking for a blank location
 #define LOOK_FOR_EMPTY_TILE		20
 
-typedef std::vector<DROID_ORDER_DATA> OrderList;
+typedef wz::pooled_vector<DROID_ORDER_DATA> OrderList;
 
 struct DROID_TEMPLATE : public BASE_STATS
 {
@@ -24,6 +24,7 @@
  *
  */
 
+#include <algorithm>
 #include <future>
 #include <unordered_map>
 
@@ -53,6 +54,7 @@ struct PATHRESULT
 	MOVE_CONTROL	sMove;		///< New movement values for the droid.
 	FPATH_RETVAL	retval;		///< Result value from path-finding.
 	Vector2i        originalDest;   ///< Used to check if the pathfinding job is to the right destination.
+	std::shared_ptr<PathFlowField const> flowField;  ///< Flow field shared with the rest of the group, if any.
 };
 
 
@@ -64,11 +66,18 @@ using packagedPathJob = wz::packaged_task<PATHRESULT()>;
 static std::list<packagedPathJob>    pathJobs;
 static std::unordered_map<uint32_t, wz::future<PATHRESULT>> pathResults;
 
+/// Jobs which may share a flow field with other droids going to the same place. Grouped and queued by fpathUpdate().
+static std::vector<PATHJOB> flowFieldCandidateJobs;
+
+/// Minimum number of droids going to the same place in the same tick, for them to share a flow field instead of each getting their own route.
+#define FPATH_FLOWFIELD_MIN_GROUP 10
+
 static bool             waitingForResult = false;
 static uint32_t         waitingForResultId;
 static WZ_SEMAPHORE     *waitingForResultSemaphore = nullptr;
 
 static PATHRESULT fpathExecute(PATHJOB psJob);
+static PATHRESULT fpathFlowFieldJobExecute(PATHJOB const &job, std::shared_ptr<PathFlowField> const &field);
 
 
 /** This runs in a separate thread */
@@ -141,17 +150,79 @@ void fpathShutdown()
 		wzSemaphoreDestroy(waitingForResultSemaphore);
 		waitingForResultSemaphore = nullptr;
 	}
+	flowFieldCandidateJobs.clear();
 	fpathHardTableReset();
 }
 
 
+/** Add a job to the path-finding thread's queue. */
+static void fpathQueueJob(unsigned id, packagedPathJob &&task)
+{
+	pathResults[id] = task.get_future();
+
+	// Add to end of list
+	wzMutexLock(fpathMutex);
+	bool isFirstJob = pathJobs.empty();
+	pathJobs.push_back(std::move(task));
+	wzMutexUnlock(fpathMutex);
+
+	if (isFirstJob)
+	{
+		wzSemaphorePost(fpathSemaphore);  // Wake up processing thread.
+	}
+}
+
+/** Returns true if both jobs can follow the same flow field. */
+static bool fpathSameFlowField(PATHJOB const &a, PATHJOB const &b)
+{
+	return a.blockingMap == b.blockingMap
+	    && map_coord(a.destX) == map_coord(b.destX) && map_coord(a.destY) == map_coord(b.destY)
+	    && !a.dstStructure.valid() && !b.dstStructure.valid();
+}
+
 /**
  *	Updates the pathfinding system.
  *	@ingroup pathfinding
  */
 void fpathUpdate()
 {
-	// Nothing now
+	// Queue the flow field candidates, in the order they were requested. Large groups going to the same place share
+	// one flow field, computed by the first of their jobs. Other candidates get an ordinary route.
+	std::vector<PATHJOB> candidates = std::move(flowFieldCandidateJobs);
+	flowFieldCandidateJobs.clear();
+	std::vector<bool> queued(candidates.size(), false);
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		if (queued[i])
+		{
+			continue;
+		}
+
+		std::vector<size_t> group;
+		for (size_t j = i; j < candidates.size(); ++j)
+		{
+			if (!queued[j] && fpathSameFlowField(candidates[i], candidates[j]))
+			{
+				group.push_back(j);
+			}
+		}
+
+		std::shared_ptr<PathFlowField> field = group.size() >= FPATH_FLOWFIELD_MIN_GROUP ? std::make_shared<PathFlowField>() : nullptr;
+		syncDebug("fpathUpdate: %d droids to (%d, %d), flowField = %d", (int)group.size(), map_coord(candidates[i].destX), map_coord(candidates[i].destY), field != nullptr);
+		for (size_t j : group)
+		{
+			PATHJOB const &job = candidates[j];
+			queued[j] = true;
+			if (field)
+			{
+				fpathQueueJob(job.droidID, packagedPathJob([job, field]() { return fpathFlowFieldJobExecute(job, field); }));
+			}
+			else
+			{
+				fpathQueueJob(job.droidID, packagedPathJob([job]() { return fpathExecute(job); }));
+			}
+		}
+	}
 }
 
 
@@ -305,16 +376,20 @@ static void fpathSetMove(MOVE_CONTROL *psMoveCntl, SDWORD targetX, SDWORD target
 void fpathSetDirectRoute(DROID *psDroid, SDWORD targetX, SDWORD targetY)
 {
 	fpathSetMove(&psDroid->sMove, targetX, targetY);
+	psDroid->sMove.flowField.reset();
 }
 
 
 void fpathRemoveDroidData(int id)
 {
 	pathResults.erase(id);
+	flowFieldCandidateJobs.erase(std::remove_if(flowFieldCandidateJobs.begin(), flowFieldCandidateJobs.end(), [id](PATHJOB const &job) {
+		return job.droidID == (UDWORD)id;
+	}), flowFieldCandidateJobs.end());
 }
 
 static FPATH_RETVAL fpathRoute(MOVE_CONTROL *psMove, unsigned id, int startX, int startY, int tX, int tY, PROPULSION_TYPE propulsionType,
-                               DROID_TYPE droidType, FPATH_MOVETYPE moveType, int owner, bool acceptNearest, StructureBounds const &dstStructure)
+                               DROID_TYPE droidType, FPATH_MOVETYPE moveType, int owner, bool acceptNearest, StructureBounds const &dstStructure, bool flowField = false)
 {
 	objTrace(id, "called(*,id=%d,sx=%d,sy=%d,ex=%d,ey=%d,prop=%d,type=%d,move=%d,owner=%d)", id, startX, startY, tX, tY, (int)propulsionType, (int)droidType, (int)moveType, owner);
 
@@ -340,6 +415,18 @@ static FPATH_RETVAL fpathRoute(MOVE_CONTROL *psMove, unsigned id, int startX, in
 	{
 		objTrace(id, "Checking if we have a path yet");
 
+		auto const candidate = std::find_if(flowFieldCandidateJobs.begin(), flowFieldCandidateJobs.end(), [id](PATHJOB const &job) {
+			return job.droidID == id;
+		});
+		if (candidate != flowFieldCandidateJobs.end())
+		{
+			if (candidate->destX == tX && candidate->destY == tY)
+			{
+				return FPR_WAIT;  // Not queued yet, fpathUpdate() will do that.
+			}
+			goto queuePathfinding;  // Destination changed before the job got queued.
+		}
+
 		auto const I = pathResults.find(id);
 		ASSERT_OR_RETURN(FPR_FAILED, I != pathResults.end(), "Missing path result promise");
 		PATHRESULT result = I->second.get();
@@ -351,6 +438,7 @@ static FPATH_RETVAL fpathRoute(MOVE_CONTROL *psMove, unsigned id, int startX, in
 		psMove->pathIndex = 0;
 		psMove->Status = MOVENAVIGATE;
 		psMove->asPath = result.sMove.asPath;
+		psMove->flowField = result.flowField;
 		FPATH_RETVAL retval = result.retval;
 		ASSERT(retval != FPR_OK || psMove->asPath.size() > 0, "Ok result but no path after copy");
 
@@ -390,28 +478,25 @@ queuePathfinding:
 	// job or result for each droid in the system at any time.
 	fpathRemoveDroidData(id);
 
-	packagedPathJob task([job]() { return fpathExecute(job); });
-	pathResults[id] = task.get_future();
-
-	// Add to end of list
-	wzMutexLock(fpathMutex);
-	bool isFirstJob = pathJobs.empty();
-	pathJobs.push_back(std::move(task));
-	wzMutexUnlock(fpathMutex);
-
-	if (isFirstJob)
+	if (flowField)
 	{
-		wzSemaphorePost(fpathSemaphore);  // Wake up processing thread.
+		// Wait for fpathUpdate(), to see if there are enough droids going the same way to share a flow field.
+		flowFieldCandidateJobs.push_back(job);
+		objTrace(id, "Waiting for a flow field to (%d, %d)", tX, tY);
+		syncDebug("fpathRoute(..., %d, %d, %d, %d, %d, %d, %d, %d, %d) = FPR_WAIT (flow field)", id, startX, startY, tX, tY, propulsionType, droidType, moveType, owner);
+		return FPR_WAIT;
 	}
 
-	objTrace(id, "Queued up a path-finding request to (%d, %d), at least %d items earlier in queue", tX, tY, isFirstJob);
+	fpathQueueJob(id, packagedPathJob([job]() { return fpathExecute(job); }));
+
+	objTrace(id, "Queued up a path-finding request to (%d, %d)", tX, tY);
 	syncDebug("fpathRoute(..., %d, %d, %d, %d, %d, %d, %d, %d, %d) = FPR_WAIT", id, startX, startY, tX, tY, propulsionType, droidType, moveType, owner);
 	return FPR_WAIT;	// wait while polling result queue
 }
 
 
 // Find a route for an DROID to a location in world coordinates
-FPATH_RETVAL fpathDroidRoute(DROID *psDroid, SDWORD tX, SDWORD tY, FPATH_MOVETYPE moveType)
+FPATH_RETVAL fpathDroidRoute(DROID *psDroid, SDWORD tX, SDWORD tY, FPATH_MOVETYPE moveType, bool flowField)
 {
 	bool acceptNearest;
 	PROPULSION_STATS *psPropStats = psDroid->getPropulsionStats();
@@ -451,8 +536,10 @@ FPATH_RETVAL fpathDroidRoute(DROID *psDroid, SDWORD tX, SDWORD tY, FPATH_MOVETYP
 		acceptNearest = true;
 		break;
 	}
+	// Flow fields are only for plain moves across the map, where the whole group wants to reach the same place.
+	flowField = flowField && moveType == FMT_MOVE && !dstStructure.valid() && psPropStats->propulsionType != PROPULSION_TYPE_LIFT;
 	return fpathRoute(&psDroid->sMove, psDroid->id, startPos.x, startPos.y, endPos.x, endPos.y, psPropStats->propulsionType,
-	                  psDroid->droidType, moveType, psDroid->player, acceptNearest, dstStructure);
+	                  psDroid->droidType, moveType, psDroid->player, acceptNearest, dstStructure, flowField);
 }
 
 // Run only from path thread
@@ -502,6 +589,31 @@ PATHRESULT fpathExecute(PATHJOB job)
 	return result;
 }
 
+// Run only from path thread
+static PATHRESULT fpathFlowFieldJobExecute(PATHJOB const &job, std::shared_ptr<PathFlowField> const &field)
+{
+	if (field->dir.empty())
+	{
+		// First droid of the group, so make the flow field. The rest of the group's jobs come after this one, on the same thread.
+		WZ_PROFILE_SCOPE(fpathFlowField);
+		fpathFlowFieldExecute(*field, job);
+	}
+
+	PATHRESULT result;
+	result.droidID = job.droidID;
+	result.originalDest = Vector2i(job.destX, job.destY);
+	if (fpathFlowFieldRoute(&result.sMove, *field, job) != ASR_OK)
+	{
+		// Not on the same island as the destination, so find the nearest route the usual way.
+		objTrace(job.droidID, "Flow field does not reach origin, using normal route");
+		return fpathExecute(job);
+	}
+	objTrace(job.droidID, "Got flow field route of length %d", (int)result.sMove.asPath.size());
+	result.retval = FPR_OK;
+	result.flowField = field;
+	return result;
+}
+
 /** Find the length of the job queue. Function is thread-safe. */
 static size_t fpathJobQueueLength()
 {
@@ -77,8 +77,11 @@ void fpathShutdown();
 void fpathUpdate();
 
 /** Find a route for a droid to a location.
+ *
+ *  If flowField is set, the droid may share a flow field with other droids asking for the same destination
+ *  in the same tick, instead of getting its own route. The result is then only available after the next fpathUpdate().
  */
-FPATH_RETVAL fpathDroidRoute(DROID *psDroid, SDWORD targetX, SDWORD targetY, FPATH_MOVETYPE moveType);
+FPATH_RETVAL fpathDroidRoute(DROID *psDroid, SDWORD targetX, SDWORD targetY, FPATH_MOVETYPE moveType, bool flowField = false);
 
 /// Returns true iff the parameters have equivalent behaviour in fpathBaseBlockingTile.
 bool fpathIsEquivalentBlocking(PROPULSION_TYPE propulsion1, int player1, FPATH_MOVETYPE moveType1,
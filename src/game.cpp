@@ -42,6 +42,7 @@
 #include "lib/ivis_opengl/piepalette.h"
 #include "lib/ivis_opengl/textdraw.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netrelay.h"
 #include "lib/sound/audio.h"
 #include "lib/sound/audio_id.h"
 #include "modding.h"
@@ -2299,7 +2300,25 @@ bool loadGameInit(const char *fileName)
 {
 	ASSERT_OR_RETURN(false, fileName != nullptr, "fileName is null??");
 
-	if (strEndsWith(fileName, ".wzrp"))
+	if (strncmp(fileName, REPLAY_RELAY_PREFIX, strlen(REPLAY_RELAY_PREFIX)) == 0)
+	{
+		SetGameMode(GS_TITLE_SCREEN); // same hack as for replay files below
+
+		// "relay:<address>" - watch the game a spectator relay streams, as a live replay
+		std::string host;
+		unsigned port = 0;
+		ASSERT_OR_RETURN(false, parseReplayRelayAddress(fileName + strlen(REPLAY_RELAY_PREFIX), host, port), "Bad relay address: %s", fileName);
+		WZGameReplayOptionsHandler optionsHandler;
+		if (!NETwatchReplayRelay(host, port, optionsHandler))
+		{
+			return false;
+		}
+
+		bMultiPlayer = true;
+		bMultiMessages = true;
+		changeTitleMode(STARTGAME);
+	}
+	else if (strEndsWith(fileName, ".wzrp"))
 	{
 		SetGameMode(GS_TITLE_SCREEN); // hack - the caller sets this to GS_NORMAL but we actually want to proceed with normal startGameLoop
 
@@ -7497,6 +7516,7 @@ void loadFixupResearchPendingStates()
 			}
 		}
 	}
+	researchAvailabilityInvalidate();
 }
 
 // -----------------------------------------------------------------------------------------
@@ -7567,6 +7587,7 @@ bool loadSaveResearch(const char *pFileName)
 		}
 		ini.endGroup();
 	}
+	researchAvailabilityInvalidate();
 	return true;
 }
 
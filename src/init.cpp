@@ -72,6 +72,7 @@
 #include "loadsave.h"
 #include "loop.h"
 #include "mapgrid.h"
+#include "mapindexcache.h"
 #include "mechanics.h"
 #include "miscimd.h"
 #include "mission.h"
@@ -105,6 +106,7 @@
 
 #include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
 #include <array>
 
 static void initMiscVars();
@@ -588,6 +590,9 @@ bool rebuildSearchPath(searchPathMode mode, bool force, const char *current_map,
 		|| lastCommand.lastTerrainShaderQuality != currentTerrainShaderQuality
 		|| (use_override_mods && override_mod_list != getModList()))
 	{
+		// The map index revalidation reads the map archives through the search path, and PhysFS can't unmount a
+		// search path entry while a file in it is open (its entries are checked again by the next buildMapList())
+		mapIndexStopRevalidation();
 		if (mode != mod_clean)
 		{
 			rebuildSearchPath(mod_clean, false);
@@ -847,8 +852,9 @@ public:
 typedef std::vector<MapFileListPath> MapFileList;
 static MapFileList listMapFiles()
 {
-	MapFileList ret, filtered;
+	MapFileList ret, filtered, rejected;
 	std::vector<std::string> oldSearchPath;
+	std::unordered_set<std::string> archives;
 
 	WZ_PHYSFS_enumerateFiles("maps", [&](const char *i) -> bool {
 		std::string wzfile = i;
@@ -859,9 +865,26 @@ static MapFileList listMapFiles()
 
 		std::string realFileName_platformIndependent = std::string("maps") + "/" + i;
 		std::string realFileName_platformDependent = std::string("maps") + PHYSFS_getDirSeparator() + i;
+		archives.insert(realFileName_platformIndependent);
+
+		// Archives in the map index were already checked
+		MapIndexEntry entry;
+		if (mapIndexFind(realFileName_platformIndependent, entry))
+		{
+			if (entry.accepted)
+			{
+				filtered.push_back(MapFileListPath(realFileName_platformIndependent, realFileName_platformDependent));
+			}
+			return true; // continue
+		}
 		ret.push_back(MapFileListPath(realFileName_platformIndependent, realFileName_platformDependent));
 		return true; // continue
 	});
+	mapIndexPrune(archives);
+	if (ret.empty())
+	{
+		return filtered;
+	}
 
 	// save our current search path(s)
 	debug(LOG_WZ, "Map search paths:");
@@ -925,6 +948,10 @@ static MapFileList listMapFiles()
 			{
 				filtered.push_back(realFileName);
 			}
+			else
+			{
+				rejected.push_back(realFileName);
+			}
 			WZ_PHYSFS_unmount(realFilePathAndName.c_str());
 		}
 		else
@@ -941,6 +968,11 @@ static MapFileList listMapFiles()
 	debug(LOG_WZ, "Search paths restored");
 	printSearchPath();
 
+	for (const auto &realFileName : rejected)
+	{
+		mapIndexStore(realFileName.platformIndependent, MapIndexEntry());
+	}
+
 	return filtered;
 }
 
@@ -1194,6 +1226,42 @@ bool setSpecialInMemoryMap(std::vector<uint8_t>&& mapArchiveData)
 }
 #endif
 
+// Add a map archive from the map index, without mounting it
+static bool addIndexedMap(const std::string &realFileName, const MapIndexEntry &entry)
+{
+	if (!entry.containsMap)
+	{
+		debug(LOG_WZ, "Skipping invalid map file (from the map index): %s", realFileName.c_str());
+		return true;
+	}
+	if (!levAddDataSetsFromJSON(entry.levels, realFileName.c_str()))
+	{
+		return false;
+	}
+	WZ_Maps.insert(WZMapInfo_Map::value_type(realFileName, WZmapInfo(entry.isMapMod, entry.isRandom)));
+	return true;
+}
+
+// Record what processMap() found in a map archive in the map index
+static void storeIndexedMap(const std::string &realFileName, bool containsMap)
+{
+	MapIndexEntry entry;
+	entry.accepted = true;
+	entry.containsMap = containsMap;
+	if (containsMap)
+	{
+		auto it = WZ_Maps.find(realFileName);
+		if (it == WZ_Maps.end() || !levDataSetsToJSON(realFileName.c_str(), entry.levels))
+		{
+			mapIndexRemove(realFileName);
+			return;
+		}
+		entry.isMapMod = it->second.isMapMod;
+		entry.isRandom = it->second.isRandom;
+	}
+	mapIndexStore(realFileName, std::move(entry));
+}
+
 bool buildMapList(bool campaignOnly)
 {
 	if (!loadLevFile("gamedesc.lev", mod_campaign, false, nullptr))
@@ -1214,9 +1282,19 @@ bool buildMapList(bool campaignOnly)
 	{
 		return true;
 	}
+	mapIndexStopRevalidation();
+	mapIndexLoad();
 	MapFileList realFileNames = listMapFiles();
+	std::vector<std::string> indexedArchives;
 	for (auto &realFileName : realFileNames)
 	{
+		MapIndexEntry entry;
+		if (mapIndexFind(realFileName.platformIndependent, entry) && addIndexedMap(realFileName.platformIndependent, entry))
+		{
+			indexedArchives.push_back(realFileName.platformIndependent);
+			continue;
+		}
+
 		const char * pRealDirStr = PHYSFS_getRealDir(realFileName.platformIndependent.c_str());
 		if (!pRealDirStr)
 		{
@@ -1231,7 +1309,8 @@ bool buildMapList(bool campaignOnly)
 			continue; // skip
 		}
 
-		if (!processMap(realFilePathAndName.c_str(), realFileName.platformIndependent.c_str(), "WZMap"))
+		bool containsMap = processMap(realFilePathAndName.c_str(), realFileName.platformIndependent.c_str(), "WZMap");
+		if (!containsMap)
 		{
 			// Failed to enumerate contents - corrupt map archive
 			debug(LOG_ERROR, "Failed to enumerate - corrupt / invalid map file: %s", realFilePathAndName.c_str());
@@ -1241,8 +1320,13 @@ bool buildMapList(bool campaignOnly)
 		{
 			debug(LOG_ERROR, "Could not unmount %s, %s", realFilePathAndName.c_str(), WZ_PHYSFS_getLastError());
 		}
+
+		storeIndexedMap(realFileName.platformIndependent, containsMap);
 	}
 
+	mapIndexSave();
+	mapIndexRevalidate(std::move(indexedArchives));
+
 	return true;
 }
 
@@ -1347,6 +1431,7 @@ void systemShutdown()
 	}
 
 	debug(LOG_MAIN, "shutting down graphics subsystem");
+	mapIndexShutdown();
 	levShutDown();
 	notificationsShutDown();
 	widgShutDown();
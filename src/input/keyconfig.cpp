@@ -49,6 +49,7 @@ static void initializeKeyFunctions(std::vector<KeyFunctionInfo>& entries)
 	entries.emplace_back(KeyFunctionInfo(InputContext::GAMEPLAY,            KeyMappingType::ASSIGNABLE,  kf_ToggleEnergyBars,                                           "ToggleEnergyBars",             N_("Toggle Damage Bars On/Off"),                    {{ KeyMappingSlot::PRIMARY, { KEY_CODE::KEY_F9                                      } }}));
 	entries.emplace_back(KeyFunctionInfo(InputContext::BACKGROUND,          KeyMappingType::FIXED,       kf_ScreenDump,                                                 "ScreenDump",                   N_("Take Screen Shot"),                             {{ KeyMappingSlot::PRIMARY, { KEY_CODE::KEY_F10                                     } }}));
 	entries.emplace_back(KeyFunctionInfo(InputContext::GAMEPLAY,            KeyMappingType::ASSIGNABLE,  kf_ToggleFormationSpeedLimiting,                               "ToggleFormationSpeedLimiting", N_("Toggle Formation Speed Limiting"),              {{ KeyMappingSlot::PRIMARY, { KEY_CODE::KEY_F11                                     } }}));
+	entries.emplace_back(KeyFunctionInfo(InputContext::GAMEPLAY,            KeyMappingType::ASSIGNABLE,  kf_ToggleFlowFieldMovement,                                    "ToggleFlowFieldMovement",      N_("Toggle Flow Field Group Movement"),             {}));
 	entries.emplace_back(KeyFunctionInfo(InputContext::GAMEPLAY,            KeyMappingType::ASSIGNABLE,  kf_MoveToLastMessagePos,                                       "MoveToLastMessagePos",         N_("View Location of Previous Message"),            {{ KeyMappingSlot::PRIMARY, { KEY_CODE::KEY_F12                                     } }}));
 	entries.emplace_back(KeyFunctionInfo(InputContext::GAMEPLAY,            KeyMappingType::ASSIGNABLE,  kf_ToggleSensorDisplay,                                        "ToggleSensorDisplay",          N_("Toggle Sensor display"),                        {{ KeyMappingSlot::PRIMARY, { KEY_CODE::KEY_LSHIFT,     KEY_CODE::KEY_F12           } }}));
 	// ASSIGN GROUPS
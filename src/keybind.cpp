@@ -691,13 +691,15 @@ void	kf_FrameRate()
 	                          frameRate(), loopPieCount, loopPolyCount);
 	if (runningMultiplayer())
 	{
-		CONPRINTF("NETWORK:  Bytes: s-%zu r-%zu  Uncompressed Bytes: s-%zu r-%zu  Packets: s-%zu r-%zu",
+		CONPRINTF("NETWORK:  Bytes: s-%zu r-%zu  Uncompressed Bytes: s-%zu r-%zu  Packets: s-%zu r-%zu  Compression us: s-%zu r-%zu",
 		                          NETgetStatistic(NetStatisticRawBytes, true),
 		                          NETgetStatistic(NetStatisticRawBytes, false),
 		                          NETgetStatistic(NetStatisticUncompressedBytes, true),
 		                          NETgetStatistic(NetStatisticUncompressedBytes, false),
 		                          NETgetStatistic(NetStatisticPackets, true),
-		                          NETgetStatistic(NetStatisticPackets, false));
+		                          NETgetStatistic(NetStatisticPackets, false),
+		                          NETgetStatistic(NetStatisticCompressionTime, true),
+		                          NETgetStatistic(NetStatisticCompressionTime, false));
 	}
 	gameStats = !gameStats;
 	CONPRINTF("Built: %s %s", getCompileDate(), __TIME__);
@@ -2204,6 +2206,23 @@ void kf_ToggleFormationSpeedLimiting()
 	}
 }
 
+// --------------------------------------------------------------------------
+void kf_ToggleFlowFieldMovement()
+{
+	bool resultingValue = false;
+	if (moveToggleFlowFieldMovement(selectedPlayer, &resultingValue))
+	{
+		if (resultingValue)
+		{
+			addConsoleMessage(_("Flow field group movement ON"),LEFT_JUSTIFY, SYSTEM_MESSAGE);
+		}
+		else
+		{
+			addConsoleMessage(_("Flow field group movement OFF"),LEFT_JUSTIFY, SYSTEM_MESSAGE);
+		}
+	}
+}
+
 // --------------------------------------------------------------------------
 void	kf_RightOrderMenu()
 {
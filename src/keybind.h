@@ -124,6 +124,7 @@ extern bool bAllowOtherKeyPresses;
 
 void kf_TriggerRayCast();
 void kf_ToggleFormationSpeedLimiting();
+void kf_ToggleFlowFieldMovement();
 void kf_ToggleSensorDisplay();
 void kf_JumpToResourceExtractor();
 MappableFunction kf_JumpToUnits(const DROID_TYPE droidType);
@@ -24,6 +24,8 @@
  *
  */
 
+#include <nlohmann/json.hpp> // Must come before WZ includes
+
 #include <ctype.h>
 #include <string.h>
 
@@ -694,6 +696,96 @@ bool levParse(const char *buffer, size_t size, searchPathMode pathMode, bool ign
 }
 
 
+bool levDataSetsToJSON(char const *realFileName, nlohmann::json &dataSets)
+{
+	dataSets = nlohmann::json::array();
+	for (auto psLevel : psLevels)
+	{
+		if (psLevel->realFileName == nullptr || strcmp(psLevel->realFileName, realFileName) != 0)
+		{
+			continue;
+		}
+		// cam changes modify another dataset, and base datasets from other map files may not be loaded in the same order
+		if (psLevel->type == LEVEL_TYPE::LDS_CAMCHANGE || (psLevel->psBaseData != nullptr && psLevel->psBaseData->realFileName != nullptr))
+		{
+			return false;
+		}
+
+		nlohmann::json dataSet = nlohmann::json::object();
+		dataSet["type"] = static_cast<int>(psLevel->type);
+		dataSet["players"] = psLevel->players;
+		dataSet["game"] = psLevel->game;
+		dataSet["name"] = psLevel->pName;
+		dataSet["dataDir"] = static_cast<int>(psLevel->dataDir);
+		dataSet["dataFiles"] = psLevel->apDataFiles;
+		if (psLevel->psBaseData != nullptr)
+		{
+			dataSet["baseData"] = psLevel->psBaseData->pName;
+		}
+		if (psLevel->customMountPoint != nullptr)
+		{
+			dataSet["mountPoint"] = psLevel->customMountPoint;
+		}
+		dataSets.push_back(std::move(dataSet));
+	}
+	return true;
+}
+
+bool levAddDataSetsFromJSON(nlohmann::json const &dataSets, char const *realFileName)
+{
+	ASSERT_OR_RETURN(false, dataSets.is_array(), "Expected an array of datasets for %s", realFileName);
+
+	LEVEL_LIST added;
+	try
+	{
+		for (auto const &dataSet : dataSets)
+		{
+			LEVEL_DATASET *psDataSet = new LEVEL_DATASET();
+			added.push_back(psDataSet);
+
+			psDataSet->type = static_cast<LEVEL_TYPE>(dataSet.at("type").get<int>());
+			psDataSet->players = dataSet.at("players").get<SWORD>();
+			psDataSet->game = dataSet.at("game").get<SWORD>();
+			psDataSet->pName = dataSet.at("name").get<std::string>();
+			psDataSet->dataDir = static_cast<searchPathMode>(dataSet.at("dataDir").get<int>());
+			auto const &dataFiles = dataSet.at("dataFiles");
+			for (size_t i = 0; i < LEVEL_MAXFILES && i < dataFiles.size(); ++i)
+			{
+				psDataSet->apDataFiles[i] = dataFiles.at(i).get<std::string>();
+			}
+			auto baseData = dataSet.find("baseData");
+			if (baseData != dataSet.end())
+			{
+				psDataSet->psBaseData = levFindDataSet(baseData->get<std::string>().c_str());
+				if (psDataSet->psBaseData == nullptr)
+				{
+					debug(LOG_WZ, "Unknown base dataset for %s", realFileName);
+					throw std::runtime_error("unknown base dataset");
+				}
+			}
+			auto mountPoint = dataSet.find("mountPoint");
+			if (mountPoint != dataSet.end())
+			{
+				psDataSet->customMountPoint = strdup(mountPoint->get<std::string>().c_str());
+			}
+			psDataSet->realFileName = strdup(realFileName);
+			psDataSet->realFileHash.setZero();  // The hash is only calculated on demand
+		}
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_WZ, "Invalid cached datasets for %s: %s", realFileName, e.what());
+		for (auto toDelete : added)
+		{
+			freeLevel(toDelete);
+		}
+		return false;
+	}
+
+	psLevels.insert(psLevels.end(), added.begin(), added.end());
+	return true;
+}
+
 // free the data for the current mission
 bool levReleaseMissionData()
 {
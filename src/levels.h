@@ -107,6 +107,11 @@ LEVEL_DATASET *levFindDataSetByRealFileName(char const *realFileName, Sha256 con
 bool levRemoveDataSetByRealFileName(char const *realFileName, Sha256 const *hash);
 bool levSetFileHashByRealFileName(char const *realFileName, Sha256 const &hash);
 
+// describe / restore the datasets loaded from a map file, for the map index cache
+// levDataSetsToJSON returns false if the datasets can't be restored on their own (e.g. they depend on another map file)
+bool levDataSetsToJSON(char const *realFileName, nlohmann::json &dataSets);
+bool levAddDataSetsFromJSON(nlohmann::json const &dataSets, char const *realFileName);
+
 // free the currently loaded dataset
 bool levReleaseAll();
 
@@ -76,6 +76,7 @@
 #include "mapgrid.h"
 #include "edit3d.h"
 #include "fpath.h"
+#include "move.h"
 #include "cmddroid.h"
 #include "keybind.h"
 #include "wrappers.h"
@@ -543,6 +544,9 @@ static void gameStateUpdate()
 	// update the command droids
 	cmdDroidUpdate();
 
+	// Find what's near each moving droid, once for all of the movement code.
+	moveGatherNeighbours();
+
 	for (unsigned i = 0; i < MAX_PLAYERS; i++)
 	{
 		//update the current power available for a player
@@ -64,6 +64,7 @@
 
 #include "lib/sound/playlist.h"
 #include "lib/gamelib/gtime.h"
+#include "lib/ivis_opengl/imd.h"
 #include "lib/ivis_opengl/pieblitfunc.h"
 #include "lib/ivis_opengl/piestate.h"
 #include "lib/ivis_opengl/piepalette.h"
@@ -1043,6 +1044,12 @@ static void startGameLoop()
 				WZGameReplayOptionsHandler replayOptions;
 				NETreplaySaveStart((currentGameMode == ActivitySink::GameMode::MULTIPLAYER) ? "multiplay" : "skirmish", replayOptions, war_getMaxReplaysSaved(), (currentGameMode == ActivitySink::GameMode::MULTIPLAYER));
 			}
+			// relay the game to downstream spectators
+			if (NETgetReplayRelayPort() != 0)
+			{
+				WZGameReplayOptionsHandler relayOptions;
+				NETreplayRelayStart(relayOptions);
+			}
 			break;
 		}
 		default:
@@ -1050,7 +1057,7 @@ static void startGameLoop()
 	}
 
 	setMaxFastForwardTicks(WZ_DEFAULT_MAX_FASTFORWARD_TICKS, true); // default value / spectator "catch-up" behavior
-	if (NETisReplay())
+	if (NETisReplay() && !NETisWatchingReplayRelay())
 	{
 		if (!headlessGameMode() && !autogame_enabled())
 		{
@@ -1074,6 +1081,7 @@ static void stopGameLoop()
 {
 	clearInfoMessages(); // clear CONPRINTF messages before each new game/mission
 
+	NETreplayRelayStop();
 	NETreplaySaveStop();
 	NETshutdownReplay();
 
@@ -2081,6 +2089,9 @@ int realmain(int argc, char *argv[])
 	// Find out where to find the data
 	scanDataDirs();
 
+	// Drop the oldest entries of the parsed model cache before any models are loaded
+	modelCachePrune();
+
 	// Now we check the mods to see if they exist or not (specified on the command line)
 	// FIX ME: I know this is a bit hackish, but better than nothing for now?
 	{
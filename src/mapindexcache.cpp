@@ -0,0 +1,285 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file
+ *  On-disk index of the map archives in the maps folder.
+ */
+
+#include "mapindexcache.h"
+
+#include "lib/framework/file.h"
+#include "lib/framework/physfs_ext.h"
+#include "lib/framework/wzapp.h"
+#include "version.h"
+
+#include <atomic>
+#include <unordered_map>
+
+#define MAP_INDEX_CACHE_DIR "cache"
+#define MAP_INDEX_CACHE_VERSION 1
+#define MAP_INDEX_TAIL_SIZE (64 * 1024)
+
+static const char mapIndexPath[] = MAP_INDEX_CACHE_DIR "/mapindex.json";
+
+static std::unordered_map<std::string, MapIndexEntry> mapIndex;
+static bool mapIndexLoaded = false;
+static bool mapIndexDirty = false;
+
+static wz::thread revalidationThread;
+static bool revalidationRunning = false;
+static std::atomic<bool> revalidationStop(false);
+
+static bool statArchive(const std::string &archive, uint64_t &size, int64_t &modTime)
+{
+	PHYSFS_Stat metaData;
+	if (PHYSFS_stat(archive.c_str(), &metaData) == 0 || metaData.filesize < 0)
+	{
+		return false;
+	}
+	size = static_cast<uint64_t>(metaData.filesize);
+	modTime = metaData.modtime;
+	return true;
+}
+
+// CRC of the last bytes of the archive, which hold the zip central directory (the list of files and their CRCs)
+static bool archiveTailCrc(const std::string &archive, uint32_t &crc)
+{
+	PHYSFS_file *fileHandle = PHYSFS_openRead(archive.c_str());
+	if (fileHandle == nullptr)
+	{
+		return false;
+	}
+	PHYSFS_sint64 length = PHYSFS_fileLength(fileHandle);
+	if (length < 0)
+	{
+		PHYSFS_close(fileHandle);
+		return false;
+	}
+	PHYSFS_uint64 tailSize = std::min<PHYSFS_uint64>(static_cast<PHYSFS_uint64>(length), MAP_INDEX_TAIL_SIZE);
+	std::vector<uint8_t> tail(static_cast<size_t>(tailSize));
+	bool success = PHYSFS_seek(fileHandle, static_cast<PHYSFS_uint64>(length) - tailSize) != 0
+	            && WZ_PHYSFS_readBytes(fileHandle, tail.data(), static_cast<PHYSFS_uint32>(tailSize)) == static_cast<PHYSFS_sint64>(tailSize);
+	PHYSFS_close(fileHandle);
+	if (success)
+	{
+		crc = wz::crc_update(wz::crc_init(), tail.data(), tail.size());
+	}
+	return success;
+}
+
+void mapIndexLoad()
+{
+	if (mapIndexLoaded)
+	{
+		return;
+	}
+	mapIndexLoaded = true;
+	mapIndexDirty = false;
+	mapIndex.clear();
+
+	if (!PHYSFS_exists(mapIndexPath))
+	{
+		return;
+	}
+	char *pBuffer = nullptr;
+	UDWORD size = 0;
+	if (!loadFile(mapIndexPath, &pBuffer, &size, false))
+	{
+		return;
+	}
+	try
+	{
+		nlohmann::json root = nlohmann::json::parse(pBuffer, pBuffer + size);
+		if (root.at("version").get<int>() != MAP_INDEX_CACHE_VERSION || root.at("wzVersion").get<std::string>() != version_getVersionString())
+		{
+			debug(LOG_WZ, "Ignoring map index of another version");
+			free(pBuffer);
+			return;
+		}
+		for (const auto &it : root.at("archives").items())
+		{
+			const nlohmann::json &value = it.value();
+			MapIndexEntry entry;
+			entry.size = value.at("size").get<uint64_t>();
+			entry.modTime = value.at("modTime").get<int64_t>();
+			entry.tailCrc = value.at("tailCrc").get<uint32_t>();
+			entry.accepted = value.at("accepted").get<bool>();
+			entry.containsMap = value.at("containsMap").get<bool>();
+			entry.isMapMod = value.at("isMapMod").get<bool>();
+			entry.isRandom = value.at("isRandom").get<bool>();
+			entry.levels = value.at("levels");
+			mapIndex[it.key()] = std::move(entry);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_WARNING, "Ignoring invalid map index: %s", e.what());
+		mapIndex.clear();
+	}
+	free(pBuffer);
+	debug(LOG_WZ, "Loaded map index with %zu archives", mapIndex.size());
+}
+
+void mapIndexSave()
+{
+	if (!mapIndexLoaded || !mapIndexDirty)
+	{
+		return;
+	}
+
+	nlohmann::json archives = nlohmann::json::object();
+	for (const auto &it : mapIndex)
+	{
+		const MapIndexEntry &entry = it.second;
+		nlohmann::json value = nlohmann::json::object();
+		value["size"] = entry.size;
+		value["modTime"] = entry.modTime;
+		value["tailCrc"] = entry.tailCrc;
+		value["accepted"] = entry.accepted;
+		value["containsMap"] = entry.containsMap;
+		value["isMapMod"] = entry.isMapMod;
+		value["isRandom"] = entry.isRandom;
+		value["levels"] = entry.levels;
+		archives[it.first] = std::move(value);
+	}
+	nlohmann::json root = nlohmann::json::object();
+	root["version"] = MAP_INDEX_CACHE_VERSION;
+	root["wzVersion"] = version_getVersionString();
+	root["archives"] = std::move(archives);
+
+	if (!WZ_PHYSFS_isDirectory(MAP_INDEX_CACHE_DIR) && PHYSFS_mkdir(MAP_INDEX_CACHE_DIR) == 0)
+	{
+		debug(LOG_WARNING, "Failed to create cache folder");
+		return;
+	}
+	std::string output = root.dump();
+	if (saveFile(mapIndexPath, output.c_str(), static_cast<UDWORD>(output.size())))
+	{
+		mapIndexDirty = false;
+	}
+}
+
+void mapIndexShutdown()
+{
+	mapIndexStopRevalidation();
+	mapIndex.clear();
+	mapIndexLoaded = false;
+	mapIndexDirty = false;
+}
+
+bool mapIndexFind(const std::string &archive, MapIndexEntry &entry)
+{
+	auto it = mapIndex.find(archive);
+	if (it == mapIndex.end())
+	{
+		return false;
+	}
+	uint64_t size;
+	int64_t modTime;
+	if (!statArchive(archive, size, modTime) || size != it->second.size || modTime != it->second.modTime)
+	{
+		return false;
+	}
+	entry = it->second;
+	return true;
+}
+
+void mapIndexStore(const std::string &archive, MapIndexEntry entry)
+{
+	if (!statArchive(archive, entry.size, entry.modTime) || !archiveTailCrc(archive, entry.tailCrc))
+	{
+		mapIndexRemove(archive);
+		return;
+	}
+	mapIndex[archive] = std::move(entry);
+	mapIndexDirty = true;
+}
+
+void mapIndexRemove(const std::string &archive)
+{
+	if (mapIndex.erase(archive) != 0)
+	{
+		mapIndexDirty = true;
+	}
+}
+
+void mapIndexPrune(const std::unordered_set<std::string> &archives)
+{
+	for (auto it = mapIndex.begin(); it != mapIndex.end();)
+	{
+		if (archives.count(it->first) == 0)
+		{
+			it = mapIndex.erase(it);
+			mapIndexDirty = true;
+			continue;
+		}
+		++it;
+	}
+}
+
+void mapIndexRevalidate(std::vector<std::string> archives)
+{
+	mapIndexStopRevalidation();
+
+	std::vector<std::pair<std::string, uint32_t>> toCheck;
+	for (auto &archive : archives)
+	{
+		auto it = mapIndex.find(archive);
+		if (it != mapIndex.end())
+		{
+			toCheck.emplace_back(std::move(archive), it->second.tailCrc);
+		}
+	}
+	if (toCheck.empty())
+	{
+		return;
+	}
+
+	revalidationStop = false;
+	revalidationRunning = true;
+	revalidationThread = wz::thread([toCheck]() {
+		for (const auto &check : toCheck)
+		{
+			if (revalidationStop)
+			{
+				return;
+			}
+			uint32_t crc;
+			if (!archiveTailCrc(check.first, crc) || crc == check.second)
+			{
+				continue;  // unreadable archives are reported when they are next mounted
+			}
+			std::string archive = check.first;
+			wzAsyncExecOnMainThread([archive]{
+				debug(LOG_WZ, "Map archive changed, will be rescanned: %s", archive.c_str());
+				mapIndexRemove(archive);
+				mapIndexSave();
+			});
+		}
+	});
+}
+
+void mapIndexStopRevalidation()
+{
+	if (revalidationRunning)
+	{
+		revalidationStop = true;
+		revalidationThread.join();
+		revalidationRunning = false;
+	}
+}
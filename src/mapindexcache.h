@@ -0,0 +1,70 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2024  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file
+ *  On-disk index of the map archives in the maps folder, so that building the
+ *  map list only has to mount archives which are new or have changed.
+ */
+
+#ifndef __INCLUDED_SRC_MAPINDEXCACHE_H__
+#define __INCLUDED_SRC_MAPINDEXCACHE_H__
+
+#include <nlohmann/json.hpp> // Must come before WZ includes
+
+#include "lib/framework/frame.h"
+
+#include <string>
+#include <unordered_set>
+
+/// What building the map list found in one map archive
+struct MapIndexEntry
+{
+	uint64_t size = 0;         ///< Archive size, part of the key
+	int64_t modTime = 0;       ///< Archive modification time, part of the key
+	uint32_t tailCrc = 0;      ///< CRC of the end of the archive (the zip central directory), checked by the background revalidation
+	bool accepted = false;     ///< Passed the checks against corrupt archives and map packs
+	bool containsMap = false;  ///< A map was found and added to the level list
+	bool isMapMod = false;
+	bool isRandom = false;
+	nlohmann::json levels;     ///< The level datasets of the map, see levDataSetsToJSON()
+};
+
+/// Load the index from the cache folder, if it hasn't been loaded yet.
+void mapIndexLoad();
+/// Save the index to the cache folder, if it was changed.
+void mapIndexSave();
+/// Stop the background revalidation, and forget the index.
+void mapIndexShutdown();
+
+/// Stat the archive (in PhysFS notation), and find its entry if the size and modification time still match.
+bool mapIndexFind(const std::string &archive, MapIndexEntry &entry);
+/// Add or replace the entry for an archive. The size, modification time and tail CRC are filled in here.
+void mapIndexStore(const std::string &archive, MapIndexEntry entry);
+/// Forget an archive whose contents can't be restored from the index.
+void mapIndexRemove(const std::string &archive);
+/// Forget archives which are no longer in the maps folder.
+void mapIndexPrune(const std::unordered_set<std::string> &archives);
+
+/// Check the entries of the given archives on a background thread, dropping the ones whose contents changed
+/// without changing their size or modification time, so that they get rescanned by the next map list build.
+/// Reads the archives through the search path, so rebuildSearchPath() stops it before unmounting anything.
+void mapIndexRevalidate(std::vector<std::string> archives);
+/// Wait for a running background revalidation to stop.
+void mapIndexStopRevalidation();
+
+#endif // __INCLUDED_SRC_MAPINDEXCACHE_H__
@@ -329,10 +329,9 @@ std::vector<Sha256> const &getModHashList()
 
 std::string getModFilename(Sha256 const &hash)
 {
-	for (auto const &mod : loaded_mods)
+	for (auto &mod : loaded_mods)
 	{
-		Sha256 foundHash = findHashOfFile(mod.filename.c_str());
-		if (foundHash == hash)
+		if (mod.getHash() == hash)
 		{
 			return mod.filename;
 		}
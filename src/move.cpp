@@ -58,6 +58,8 @@
 #include "campaigninfo.h"
 #include "qtscript.h"
 
+#include <unordered_map>
+
 /* max and min vtol heights above terrain */
 #define	VTOL_HEIGHT_MIN				250
 #define	VTOL_HEIGHT_LEVEL			300
@@ -101,19 +103,34 @@
 #define EXTRA_BITS                              8
 #define EXTRA_PRECISION                         (1 << EXTRA_BITS)
 
+// distance to look for oil drums and artefacts to pick up
+#define DROIDDIST		((TILE_UNITS*5)/2)
+
+// Radius of the neighbour sets gathered once per tick by moveGatherNeighbours(). Must cover the
+// largest radius used by the local avoidance functions, plus NEIGHBOUR_SLACK for the distance the
+// droid may move before the neighbours are used.
+static constexpr int NEIGHBOUR_SLACK = TILE_UNITS;
+static constexpr uint32_t NEIGHBOUR_RADIUS = std::max(std::max(OBJ_MAXRADIUS, AVOID_DIST), DROIDDIST) + NEIGHBOUR_SLACK;
+
+// How many tiles ahead to look in a flow field, when steering by it
+#define FLOWFIELD_LOOKAHEAD	5
+
 static std::vector<bool> playerFormationSpeedLimiting = std::vector<bool>(MAX_PLAYERS, false);
+static std::vector<bool> playerFlowFieldMovement = std::vector<bool>(MAX_PLAYERS, false);
 
 void moveInit()
 {
-	// Initialize formation speed limiting to off for all players
+	// Initialize formation speed limiting and flow field movement to off for all players
 	playerFormationSpeedLimiting.resize(MAX_PLAYERS);
+	playerFlowFieldMovement.resize(MAX_PLAYERS);
 	for (size_t i = 0; i < playerFormationSpeedLimiting.size(); ++i)
 	{
 		playerFormationSpeedLimiting[i] = false;
+		playerFlowFieldMovement[i] = false;
 	}
 }
 
-bool moveSetFormationSpeedLimiting(uint32_t player, bool enabled)
+static bool moveSendSyncOptChange(uint32_t player, uint8_t optType, bool enabled)
 {
 	ASSERT_OR_RETURN(false, player < MAX_PLAYERS, "Invalid player: %u", player);
 	if (myResponsibility(player))
@@ -121,12 +138,11 @@ bool moveSetFormationSpeedLimiting(uint32_t player, bool enabled)
 		// always send a net message! (must be synchronized!)
 		ASSERT_OR_RETURN(false, player < static_cast<uint32_t>(std::numeric_limits<uint8_t>::max()), "player exceeds expected bounds?");
 		auto currentPlayer = static_cast<uint8_t>(player);
-		uint8_t optType = SYNC_OPT_FORMATION_SPEED_LIMITING;
 		uint8_t value = (enabled) ? 1 : 0;
 		NETbeginEncode(NETgameQueue(currentPlayer), GAME_SYNC_OPT_CHANGE);
 		NETuint8_t(&currentPlayer);		// player
 		NETuint8_t(&optType);
-		NETuint8_t(&value);				// formation speed limiting value
+		NETuint8_t(&value);				// option value
 		return NETend();
 	}
 	else
@@ -135,6 +151,11 @@ bool moveSetFormationSpeedLimiting(uint32_t player, bool enabled)
 	}
 }
 
+bool moveSetFormationSpeedLimiting(uint32_t player, bool enabled)
+{
+	return moveSendSyncOptChange(player, SYNC_OPT_FORMATION_SPEED_LIMITING, enabled);
+}
+
 bool moveToggleFormationSpeedLimiting(uint32_t player, bool *pBoolResultingValue)
 {
 	ASSERT_OR_RETURN(false, player < MAX_PLAYERS, "Invalid player: %u", player);
@@ -156,6 +177,32 @@ bool moveFormationSpeedLimitingOn(uint32_t player)
 	return playerFormationSpeedLimiting[player];
 }
 
+bool moveSetFlowFieldMovement(uint32_t player, bool enabled)
+{
+	return moveSendSyncOptChange(player, SYNC_OPT_FLOW_FIELD_MOVEMENT, enabled);
+}
+
+bool moveToggleFlowFieldMovement(uint32_t player, bool *pBoolResultingValue)
+{
+	ASSERT_OR_RETURN(false, player < MAX_PLAYERS, "Invalid player: %u", player);
+	ASSERT_OR_RETURN(false, myResponsibility(player), "Cannot change for player: %u", player);
+	bool newValue = !moveFlowFieldMovementOn(player);
+	if (moveSetFlowFieldMovement(player, newValue))
+	{
+		if (pBoolResultingValue)
+		{
+			*pBoolResultingValue = newValue;
+		}
+		return true;
+	}
+	return false;
+}
+
+bool moveFlowFieldMovementOn(uint32_t player)
+{
+	return playerFlowFieldMovement[player];
+}
+
 bool recvSyncOptChange(NETQUEUE queue)
 {
 	uint8_t player;
@@ -183,6 +230,10 @@ bool recvSyncOptChange(NETQUEUE queue)
 			debug(LOG_WZ, "Received formation speed limiting change for player: %d, from: %d", player, queue.index);
 			playerFormationSpeedLimiting[player] = (value != 0);
 			break;
+		case SYNC_OPT_FLOW_FIELD_MOVEMENT:
+			debug(LOG_WZ, "Received flow field movement change for player: %d, from: %d", player, queue.index);
+			playerFlowFieldMovement[player] = (value != 0);
+			break;
 		default:
 			debug(LOG_WARNING, "Sync opt change for player: %d, invalid sync opt type: %d", player, optType);
 			syncDebug("Invalid sync opt type: %d", optType);
@@ -240,7 +291,9 @@ static bool moveDroidToBase(DROID *psDroid, UDWORD x, UDWORD y, bool bFormation,
 	}
 	else
 	{
-		retVal = fpathDroidRoute(psDroid, x, y, moveType);
+		// Groups moving together may share a flow field, if the player wants.
+		bool flowField = moveFlowFieldMovementOn(psDroid->player) && psDroid->order.type == DORDER_MOVE && !psDroid->isTransporter();
+		retVal = fpathDroidRoute(psDroid, x, y, moveType, flowField);
 	}
 
 	if (retVal == FPR_OK)
@@ -599,11 +652,10 @@ static bool moveBlockingTileCallback(Vector2i pos, int32_t dist, void *data_)
 	return !data->blocking;
 }
 
-// Returns -1 - distance if the direct path to the waypoint is blocked, otherwise returns the distance to the waypoint.
-static int32_t moveDirectPathToWaypoint(DROID *psDroid, unsigned positionIndex)
+// Returns -1 - distance if the direct path to dst is blocked, otherwise returns the distance to dst.
+static int32_t moveDirectPathToPoint(DROID *psDroid, Vector2i dst)
 {
 	Vector2i src(psDroid->pos.xy());
-	Vector2i dst = psDroid->sMove.asPath[positionIndex];
 	Vector2i delta = dst - src;
 	int32_t dist = iHypot(delta);
 	BLOCKING_CALLBACK_DATA data;
@@ -615,6 +667,12 @@ static int32_t moveDirectPathToWaypoint(DROID *psDroid, unsigned positionIndex)
 	return data.blocking ? -1 - dist : dist;
 }
 
+// Returns -1 - distance if the direct path to the waypoint is blocked, otherwise returns the distance to the waypoint.
+static int32_t moveDirectPathToWaypoint(DROID *psDroid, unsigned positionIndex)
+{
+	return moveDirectPathToPoint(psDroid, psDroid->sMove.asPath[positionIndex]);
+}
+
 // Returns true if still able to find the path.
 static bool moveBestTarget(DROID *psDroid)
 {
@@ -657,6 +715,40 @@ static bool moveBestTarget(DROID *psDroid)
 	return true;
 }
 
+// Steer by the flow field instead of the waypoints, heading for the furthest tile ahead which can be reached directly.
+// Returns false if the droid is somewhere the flow field doesn't cover, or can't reach even the next tile directly.
+static bool moveFlowFieldTarget(DROID *psDroid)
+{
+	PathFlowField const &field = *psDroid->sMove.flowField;
+	Vector2i tile = map_coord(psDroid->pos.xy());
+	if (!field.isReachable(tile) || psDroid->sMove.asPath.empty())
+	{
+		return false;
+	}
+
+	Vector2i target = psDroid->sMove.destination;  // Only kept if already on the destination tile.
+	for (int i = 0; i < FLOWFIELD_LOOKAHEAD && tile != field.destTile; ++i)
+	{
+		tile = field.nextTile(tile);
+		Vector2i ahead = tile == field.destTile ? psDroid->sMove.destination : world_coord(tile) + Vector2i(TILE_UNITS / 2, TILE_UNITS / 2);
+		if (moveDirectPathToPoint(psDroid, ahead) < 0)
+		{
+			if (i == 0)
+			{
+				return false;  // Blocked right away (cut a corner, or pushed off course), so follow the waypoints instead.
+			}
+			break;  // Can't see that far ahead, stay on the flow field.
+		}
+		target = ahead;
+	}
+
+	// The destination is always the last waypoint, so only count as being on the last leg when heading straight for it.
+	psDroid->sMove.pathIndex = (int)psDroid->sMove.asPath.size() - (target == psDroid->sMove.destination ? 0 : 1);
+	psDroid->sMove.src = psDroid->pos.xy();
+	psDroid->sMove.target = target;
+	return true;
+}
+
 /* Get the next target point from the route */
 static bool moveNextTarget(DROID *psDroid)
 {
@@ -739,6 +831,92 @@ static SDWORD moveObjRadius(const BASE_OBJECT *psObj)
 }
 
 
+/// Neighbour sets for the droids moving this tick, so that the local avoidance functions don't each
+/// need to query the grid separately.
+struct MoveNeighbourCache
+{
+	struct Entry
+	{
+		Vector2i origin;     ///< Position of the droid when the neighbours were gathered.
+		size_t first;        ///< Index of the first neighbour in objects.
+		size_t count;        ///< Number of neighbours.
+	};
+
+	uint32_t time = UINT32_MAX;  ///< gameTime at which the cache was filled.
+	std::vector<BASE_OBJECT *> objects;
+	std::unordered_map<DROID const *, Entry> entries;
+
+	void reset()
+	{
+		time = gameTime;
+		objects.clear();
+		entries.clear();
+	}
+
+	Entry const &gather(DROID const *psDroid)
+	{
+		GridList const &gridList = gridStartIterate(psDroid->pos.x, psDroid->pos.y, NEIGHBOUR_RADIUS);
+		Entry &entry = entries[psDroid];
+		entry.origin = psDroid->pos.xy();
+		entry.first = objects.size();
+		entry.count = gridList.size();
+		objects.insert(objects.end(), gridList.begin(), gridList.end());
+		return entry;
+	}
+};
+static MoveNeighbourCache moveNeighbourCache;
+
+void moveGatherNeighbours()
+{
+	moveNeighbourCache.reset();
+
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		for (DROID const *psDroid : apsDroidLists[player])
+		{
+			if (psDroid->died || (psDroid->sMove.Status == MOVEINACTIVE && psDroid->sMove.speed == 0))
+			{
+				continue;  // Droids which start moving during the tick gather their neighbours on demand.
+			}
+			moveNeighbourCache.gather(psDroid);
+		}
+	}
+}
+
+/// Find all objects within radius of the droid, using the neighbours gathered this tick if possible.
+/// Like gridStartIterate(psDroid->pos.x, psDroid->pos.y, radius), and gives the objects in the same order.
+static void moveGetNeighbours(DROID const *psDroid, uint32_t radius, GridList &gridList)
+{
+	ASSERT(radius + NEIGHBOUR_SLACK <= NEIGHBOUR_RADIUS, "Neighbour radius %u too large", (unsigned)radius);
+
+	if (moveNeighbourCache.time != gameTime)
+	{
+		moveNeighbourCache.reset();
+	}
+
+	auto it = moveNeighbourCache.entries.find(psDroid);
+	MoveNeighbourCache::Entry const *entry = it != moveNeighbourCache.entries.end() ? &it->second : nullptr;
+	Vector2i moved = entry != nullptr ? psDroid->pos.xy() - entry->origin : Vector2i(0, 0);
+	// Euclidean, not per axis: a diagonal move of NEIGHBOUR_SLACK on both axes would leave objects within radius outside the gathered ones.
+	if (entry == nullptr || (int64_t)moved.x * moved.x + (int64_t)moved.y * moved.y > (int64_t)NEIGHBOUR_SLACK * NEIGHBOUR_SLACK)
+	{
+		// Not gathered yet, or moved too far since (teleported, or very fast), so gather again from here.
+		entry = &moveNeighbourCache.gather(psDroid);
+	}
+
+	gridList.clear();
+	for (size_t i = entry->first; i < entry->first + entry->count; ++i)
+	{
+		BASE_OBJECT *psObj = moveNeighbourCache.objects[i];
+		int64_t xdiff = psObj->pos.x - psDroid->pos.x;
+		int64_t ydiff = psObj->pos.y - psDroid->pos.y;
+		if (xdiff * xdiff + ydiff * ydiff <= (int64_t)radius * radius)
+		{
+			gridList.push_back(psObj);
+		}
+	}
+}
+
 // see if a Droid has run over a person
 static void moveCheckSquished(DROID *psDroid, int32_t emx, int32_t emy)
 {
@@ -748,7 +926,7 @@ static void moveCheckSquished(DROID *psDroid, int32_t emx, int32_t emy)
 	const int32_t   my = gameTimeAdjustedAverage(emy, EXTRA_PRECISION);
 
 	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(psDroid->pos.x, psDroid->pos.y, OBJ_MAXRADIUS);
+	moveGetNeighbours(psDroid, OBJ_MAXRADIUS, gridList);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		BASE_OBJECT *psObj = *gi;
@@ -1192,7 +1370,7 @@ static void moveCalcDroidSlide(DROID *psDroid, int *pmx, int *pmy)
 	droidR = moveObjRadius((BASE_OBJECT *)psDroid);
 	BASE_OBJECT *psObst = nullptr;
 	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(psDroid->pos.x, psDroid->pos.y, OBJ_MAXRADIUS);
+	moveGetNeighbours(psDroid, OBJ_MAXRADIUS, gridList);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		BASE_OBJECT *psObj = *gi;
@@ -1317,7 +1495,7 @@ static Vector2i moveGetObstacleVector(DROID *psDroid, Vector2i dest)
 
 	// scan the neighbours for obstacles
 	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(psDroid->pos.x, psDroid->pos.y, AVOID_DIST);
+	moveGetNeighbours(psDroid, AVOID_DIST, gridList);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		if (*gi == psDroid)
@@ -2188,10 +2366,9 @@ static void checkLocalFeatures(DROID *psDroid)
 	}
 
 	// scan the neighbours
-#define DROIDDIST ((TILE_UNITS*5)/2)
 	constexpr int MAX_PICKUP_DISTANCE = (TILE_UNITS / 2);
 	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(psDroid->pos.x, psDroid->pos.y, DROIDDIST);
+	moveGetNeighbours(psDroid, DROIDDIST, gridList);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		BASE_OBJECT *psObj = *gi;
@@ -2267,6 +2444,7 @@ void moveUpdateDroid(DROID *psDroid)
 	switch (psDroid->sMove.Status)
 	{
 	case MOVEINACTIVE:
+		psDroid->sMove.flowField.reset();
 		if (psDroid->animationEvent == ANIM_EVENT_ACTIVE)
 		{
 			resetObjectAnimationState(psDroid);
@@ -2348,8 +2526,12 @@ void moveUpdateDroid(DROID *psDroid)
 			debug(LOG_WARNING, "No path to follow, but psDroid->sMove.Status = %d", psDroid->sMove.Status);
 		}
 
-		// Get the best control point.
-		if (psDroid->sMove.asPath.size() == 0 || !moveBestTarget(psDroid))
+		// Get the best control point, from the flow field if following one.
+		if (psDroid->sMove.flowField && !moveFlowFieldTarget(psDroid))
+		{
+			psDroid->sMove.flowField.reset();  // Wandered off the flow field, so follow the waypoints instead.
+		}
+		if (!psDroid->sMove.flowField && (psDroid->sMove.asPath.size() == 0 || !moveBestTarget(psDroid)))
 		{
 			// Got stuck somewhere, can't find the path.
 			moveDroidTo(psDroid, psDroid->sMove.destination.x, psDroid->sMove.destination.y);
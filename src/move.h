@@ -49,6 +49,9 @@ void moveReallyStopDroid(DROID *psDroid);
 /* Get a droid to do a frame's worth of moving */
 void moveUpdateDroid(DROID *psDroid);
 
+/* Gather the neighbours of all moving droids for this tick's local avoidance. Call after gridReset(). */
+void moveGatherNeighbours();
+
 SDWORD moveCalcDroidSpeed(DROID *psDroid);
 
 /* update body and turret to local slope */
@@ -62,6 +65,9 @@ const char *moveDescription(MOVE_STATUS status);
 bool moveSetFormationSpeedLimiting(uint32_t player, bool enabled);
 bool moveToggleFormationSpeedLimiting(uint32_t player, bool *pBoolResultingValue);
 bool moveFormationSpeedLimitingOn(uint32_t player);
+bool moveSetFlowFieldMovement(uint32_t player, bool enabled);
+bool moveToggleFlowFieldMovement(uint32_t player, bool *pBoolResultingValue);
+bool moveFlowFieldMovementOn(uint32_t player);
 bool recvSyncOptChange(NETQUEUE queue);
 
 void moveInit();
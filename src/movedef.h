@@ -25,10 +25,14 @@
 #define __INCLUDED_MOVEDEF_H__
 
 #include "lib/framework/vector.h"
+#include "lib/framework/pooled_allocator.h"
 #include "formationdef.h"
 
+#include <memory>
 #include <vector>
 
+struct PathFlowField;
+
 enum MOVE_STATUS
 {
 	MOVEINACTIVE,
@@ -46,7 +50,8 @@ struct MOVE_CONTROL
 {
 	MOVE_STATUS Status = MOVEINACTIVE;    ///< Inactive, Navigating or moving point to point status
 	int pathIndex = 0;                    ///< Position in asPath
-	std::vector<Vector2i> asPath;         ///< Pointer to list of block X,Y map coordinates.
+	wz::pooled_vector<Vector2i> asPath;   ///< Pointer to list of block X,Y map coordinates.
+	std::shared_ptr<PathFlowField const> flowField;  ///< If set, steer by this instead of following asPath exactly.
 
 	Vector2i destination = Vector2i(0, 0);                 ///< World coordinates of movement destination
 	Vector2i src = Vector2i(0, 0);
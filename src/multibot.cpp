@@ -46,6 +46,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
 
 
 enum SubType
@@ -507,48 +508,58 @@ static void NETQueuedDroidInfo(QueuedDroidInfo *info)
 // Actually send the droid info.
 void sendQueuedDroidInfo()
 {
-	// Given an order type, we bring all other orders of the same type together
-	// WHILE KEEPING their relative order!! This is important because 
-	// sending all MOVE and then all HOLD_POSITION is clearly not the same as 
-	// sending all HOLD_POSITION and then MOVE
-	// yes, we need an ordered map here, not std::sort
-	static std::map<DROID_ORDER, std::vector<QueuedDroidInfo> > orderedMap; // static to avoid allocations
-	orderedMap.clear();
-	for (auto &info: queuedOrders)
-	{
-		orderedMap[info.order].push_back(info);
-	}
-	std::vector<QueuedDroidInfo>::iterator eqBegin, eqEnd;
-	for (auto &pair: orderedMap)
-	{
-		auto qOrders = pair.second;
-		for (eqBegin = qOrders.begin(); eqBegin != qOrders.end(); eqBegin = eqEnd)
+	// Group the orders which differ only by the droid ID, so each group is sent as one order and a list of droid IDs.
+	// An order may only join a group which is sent after all earlier orders for the same droid, since
+	// sending all MOVE and then all HOLD_POSITION is clearly not the same as sending all HOLD_POSITION and then MOVE.
+	static std::vector<std::vector<QueuedDroidInfo>> groups;  // static to avoid allocations
+	static std::unordered_map<uint32_t, size_t> lastGroupOfDroid;
+	size_t numGroups = 0;
+	lastGroupOfDroid.clear();
+	for (auto const &info : queuedOrders)
+	{
+		auto lastGroup = lastGroupOfDroid.find(info.droidId);
+		size_t group = lastGroup != lastGroupOfDroid.end() ? lastGroup->second : 0;
+		while (group < numGroups && groups[group].front().orderCompare(info) != 0)
 		{
-			// Find end of range of orders which differ only by the droid ID.
-			for (eqEnd = eqBegin + 1; eqEnd != qOrders.end() && eqEnd->orderCompare(*eqBegin) == 0; ++eqEnd)
-			{}
+			++group;
+		}
+		if (group == numGroups)
+		{
+			if (groups.size() == numGroups)
+			{
+				groups.emplace_back();
+			}
+			groups[numGroups++].clear();
+		}
+		groups[group].push_back(info);
+		lastGroupOfDroid[info.droidId] = group;
+	}
 
-			NETbeginEncode(NETgameQueue(selectedPlayer), GAME_DROIDINFO);
-			NETQueuedDroidInfo(&*eqBegin);
+	for (size_t group = 0; group < numGroups; ++group)
+	{
+		auto &qOrders = groups[group];
 
-			uint32_t num = eqEnd - eqBegin;
-			NETuint32_t(&num);
+		// Sort by droid ID, so the deltas between the droid IDs are small, and encode to 1 or 2 bytes instead of 5 when they would be negative.
+		std::stable_sort(qOrders.begin(), qOrders.end());
 
-			uint32_t prevDroidId = 0;
-			for (unsigned n = 0; n < num; ++n)
-			{
-				uint32_t droidId = (eqBegin + n)->droidId;
+		NETbeginEncode(NETgameQueue(selectedPlayer), GAME_DROIDINFO);
+		NETQueuedDroidInfo(&qOrders.front());
 
-				// Encode deltas between droid IDs, since the deltas are smaller than the actual droid IDs, and will encode to less bytes on average.
-				uint32_t deltaDroidId = droidId - prevDroidId;
-				NETuint32_t(&deltaDroidId);
+		uint32_t num = static_cast<uint32_t>(qOrders.size());
+		NETuint32_t(&num);
 
-				prevDroidId = droidId;
-			}
-			NETend();
+		uint32_t prevDroidId = 0;
+		for (auto const &info : qOrders)
+		{
+			// Encode deltas between droid IDs, since the deltas are smaller than the actual droid IDs, and will encode to less bytes on average.
+			uint32_t deltaDroidId = info.droidId - prevDroidId;
+			NETuint32_t(&deltaDroidId);
+
+			prevDroidId = info.droidId;
 		}
-		qOrders.clear();
-	}	
+		NETend();
+	}
+
 	// Sent the orders. Don't send them again.
 	queuedOrders.clear();
 }
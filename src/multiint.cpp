@@ -37,6 +37,7 @@
 #include "lib/framework/physfs_ext.h"
 
 #include <wzmaplib/map_preview.h>
+#include <wzmaplib/map_batch.h>
 
 /* Includes direct access to render library */
 #include "lib/ivis_opengl/bitimage.h"
@@ -129,6 +130,7 @@
 #include "3rdparty/gsl_finally.h"
 
 #define MAP_PREVIEW_DISPLAY_TIME 2500	// number of milliseconds to show map in preview
+#define MAP_PREVIEW_CACHE_MAX_ENTRIES 16	// previews kept for maps (and player colours) shown before
 #define LOBBY_DISABLED_TAG       "lobbyDisabled"
 #define KICK_REASON_TAG          "kickReason"
 #define SLOTTYPE_TAG_PREFIX      "slotType"
@@ -743,15 +745,7 @@ void loadMapPreview(bool hideInterface)
 		aFileName = aFileName.substr(0, std::max<size_t>(lastPeriodPos, (size_t)1));
 	}
 
-	// load the map data
 	aFileName += "/";
-	auto data = WzMap::Map::loadFromPath(aFileName, WzMap::MapType::SKIRMISH, psLevel->players, rand(), std::make_shared<WzMapDebugLogger>(), std::make_shared<WzMapPhysFSIO>());
-	if (!data)
-	{
-		debug(LOG_ERROR, "Failed to load map from path: %s", aFileName.c_str());
-		loadEmptyMapPreview();
-		return;
-	}
 
 	WzMap::MapPreviewColorScheme previewColorScheme;
 	previewColorScheme.hqColor = PIELIGHT_to_MapPreviewColor(WZCOL_MAP_PREVIEW_HQ);
@@ -782,8 +776,30 @@ void loadMapPreview(bool hideInterface)
 		playerpos[i] = Vector2i(0x77777777, 0x77777777);
 	}
 
-	std::unique_ptr<WzMap::LoggingProtocol> generatePreviewLogger(new WzMapDebugLogger());
-	auto mapPreviewResult = WzMap::generate2DMapPreview(*data, previewColorScheme, WzMap::MapStatsConfiguration(WzMap::MapType::SKIRMISH), generatePreviewLogger.get());
+	// load the map data (unless the preview of an unchanged map, with the same colours, was generated before)
+	static WzMap::MapInfoCache previewCache;
+	if (previewCache.size() > MAP_PREVIEW_CACHE_MAX_ENTRIES)
+	{
+		previewCache.clear();
+	}
+	WzMap::MapBatchItem mapItem;
+	mapItem.mapFolderPath = aFileName;
+	mapItem.mapType = WzMap::MapType::SKIRMISH;
+	mapItem.mapMaxPlayers = psLevel->players;
+	mapItem.seed = rand();
+	mapItem.mapIO = std::make_shared<WzMapPhysFSIO>();
+	mapItem.previewColorScheme = &previewColorScheme;
+	mapItem.calculateStats = false; // only the preview is shown
+	// script-generated maps get a new random seed every time, so their previews are never found in the cache
+	WzMap::MapInfoCache *cache = PHYSFS_exists((aFileName + "game.js").c_str()) ? nullptr : &previewCache;
+	auto mapResult = WzMap::processMapFromPath(mapItem, WzMap::MapStatsConfiguration(WzMap::MapType::SKIRMISH), cache, std::make_shared<WzMapDebugLogger>());
+	if (!mapResult.loaded)
+	{
+		debug(LOG_ERROR, "Failed to load map from path: %s", aFileName.c_str());
+		loadEmptyMapPreview();
+		return;
+	}
+	auto mapPreviewResult = mapResult.info.preview;
 	if (!mapPreviewResult)
 	{
 		// Failed to generate map preview
@@ -809,10 +825,10 @@ void loadMapPreview(bool hideInterface)
 	}
 	ASSERT(mapPreviewResult->width <= BACKDROP_HACK_WIDTH, "mapData width somehow exceeds backdrop width?");
 	memset(backdropData, 0, sizeof(char) * BACKDROP_HACK_WIDTH * BACKDROP_HACK_HEIGHT * 3); //dunno about background color
-	unsigned char *imageData = mapPreviewResult->imageData.data();
+	const unsigned char *imageData = mapPreviewResult->imageData.data();
 	for (int y = 0; y < mapPreviewResult->height; ++y)
 	{
-		unsigned char *pSrc = imageData + (3 * (y * mapPreviewResult->width));
+		const unsigned char *pSrc = imageData + (3 * (y * mapPreviewResult->width));
 		unsigned char *pDst = backdropData + (3 * (y * BACKDROP_HACK_WIDTH));
 		memcpy(pDst, pSrc, std::min<size_t>(mapPreviewResult->width, BACKDROP_HACK_WIDTH) * 3);
 	}
@@ -7135,6 +7151,11 @@ void WzMultiplayerOptionsTitleUI::frontendMultiMessages(bool running)
 			}
 			break;
 
+		case NET_FILE_ACK:
+			ASSERT_HOST_ONLY(break);
+			NETrecvFileAck(queue);
+			break;
+
 		case NET_OPTIONS:					// incoming options file.
 		{
 			if (NetPlay.hostPlayer != queue.index)
@@ -382,7 +382,7 @@ bool recvOptions(NETQUEUE queue)
 		}
 		else if (findHashOfFile(filename) != hash)
 		{
-			debug(LOG_INFO, "Overwriting old incomplete or corrupt file %s", filename);
+			debug(LOG_INFO, "Replacing or continuing old incomplete or corrupt file %s", filename);
 		}
 		else
 		{
@@ -390,18 +390,19 @@ bool recvOptions(NETQUEUE queue)
 			return FileRequestResult::FileExists;  // Have the file already.
 		}
 
-		PHYSFS_file *pFileHandle = PHYSFS_openWrite(filename);
-		if (pFileHandle == nullptr)
+		WZFile file = NET_openDownloadWZFile(filename, hash);
+		if (file.handle() == nullptr)
 		{
-			debug(LOG_ERROR, "Failed to open %s for writing: %s", filename, WZ_PHYSFS_getLastError());
 			return FileRequestResult::FailedToOpenFileForWriting;
 		}
+		uint32_t resumePos = file.pos;
 
-		NET_addDownloadingWZFile(WZFile(pFileHandle, filename, hash));
+		NET_addDownloadingWZFile(std::move(file));
 
 		// Request the map/mod from the host
 		NETbeginEncode(NETnetQueue(NetPlay.hostPlayer), NET_FILE_REQUESTED);
 		NETbin(hash.bytes, hash.Bytes);
+		NETuint32_t(&resumePos);  // start byte
 		NETend();
 
 		return FileRequestResult::StartingDownload;  // Starting download now.
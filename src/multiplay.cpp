@@ -69,6 +69,7 @@
 
 #include "template.h"
 #include "lib/netplay/netplay.h"								// the netplay library.
+#include "lib/netplay/netreplay.h"
 #include "modding.h"
 #include "multiplay.h"								// warzone net stuff.
 #include "multijoin.h"								// player management stuff.
@@ -465,6 +466,7 @@ bool multiPlayerLoop()
 		}
 		if (NetPlay.bComms)
 		{
+			NETsampleQueueDepths();
 			sendPing();
 		}
 		if (NetPlay.isHost && NetPlay.bComms)
@@ -1282,6 +1284,9 @@ bool recvMessage()
 	NETQUEUE queue;
 	uint8_t type;
 
+	NETpumpReplayRelay();
+	NETreplayRelayUpdate();
+
 	while (NETrecvNet(&queue, &type) || NETrecvGame(&queue, &type))          // for all incoming messages.
 	{
 		bool processedMessage1 = false;
@@ -2126,8 +2131,10 @@ bool recvMapFileRequested(NETQUEUE queue)
 
 	Sha256 hash;
 	hash.setZero();
+	uint32_t resumePos = 0;
 	NETbeginDecode(queue, NET_FILE_REQUESTED);
 	NETbin(hash.bytes, hash.Bytes);
+	NETuint32_t(&resumePos);  // start byte, if the player already has part of the file
 	NETend();
 
 	auto files = NetPlay.players[player].wzFiles;
@@ -2186,10 +2193,17 @@ bool recvMapFileRequested(NETQUEUE queue)
 	ASSERT_OR_RETURN(false, fileSize_64 >= 0, "Filesize < 0; can't be determined");
 	uint32_t fileSize_u32 = (uint32_t)fileSize_64;
 	ASSERT_OR_RETURN(false, fileSize_u32 <= MAX_NET_TRANSFERRABLE_FILE_SIZE, "Filesize is too large; (size: %" PRIu32")", fileSize_u32);
+	if (resumePos != 0 && (resumePos >= fileSize_u32 || !PHYSFS_seek(pFileHandle, resumePos)))
+	{
+		debug(LOG_INFO, "Player %u can't continue download at %" PRIu32 " of %" PRIu32 " bytes.", player, resumePos, fileSize_u32);
+		PHYSFS_close(pFileHandle);
+		return false;
+	}
 
 	// Schedule file to be sent.
-	debug(LOG_INFO, "File is valid, sending [directory: %s] %s to client %u", WZ_PHYSFS_getRealDir_String(filename.c_str()).c_str(), filename.c_str(), player);
+	debug(LOG_INFO, "File is valid, sending [directory: %s] %s to client %u, starting at %" PRIu32, WZ_PHYSFS_getRealDir_String(filename.c_str()).c_str(), filename.c_str(), player, resumePos);
 	files->emplace_back(pFileHandle, filename, hash, fileSize_u32);
+	files->back().pos = resumePos;
 
 	return true;
 }
@@ -2225,12 +2239,16 @@ void sendMap()
 		{
 			int done = 0;
 			file_startTime = std::chrono::high_resolution_clock::now();
-			do
+			// Nothing is sent while the window is full, until the receiver acknowledges more of the file.
+			while (!NETfileTransferWindowFull(file))
 			{
 				done = NETsendFile(file, i);
 				file_currentDuration = std::chrono::duration_cast<microDuration>(std::chrono::high_resolution_clock::now() - file_startTime);
+				if (done == 100 || file_currentDuration.count() >= maxMicroSecondsPerFile)
+				{
+					break;
+				}
 			}
-			while (done < 100 && (file_currentDuration.count() < maxMicroSecondsPerFile));
 			if (done == 100)
 			{
 				netPlayersUpdated = true;  // Remove download icon from player.
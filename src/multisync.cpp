@@ -325,6 +325,7 @@ bool recvPing(NETQUEUE queue)
 
 		// Work out how long it took them to respond
 		ingame.PingTimes[sender] = (realTime - PingSend[sender]) / 2;
+		NETlogLatency(sender, realTime - PingSend[sender]);
 
 		if (!ingame.VerifiedIdentity[sender])
 		{
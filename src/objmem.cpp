@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "lib/framework/frame.h"
+#include "lib/framework/pooled_allocator.h"
 #include "objects.h"
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/sync_debug.h"
@@ -344,6 +345,14 @@ void objmemUpdate()
 			triggerEventDestroyed(*it++);
 		}
 	}
+
+	// The order lists, paths and watched tiles of destroyed objects are now back in the pool, give any excess back to the heap
+	wz::PoolAllocatorStatistics containerStats = wz::poolAllocatorTrim();
+	if (containerStats.heapAllocations != 0 || containerStats.pooledAllocations != 0)
+	{
+		debug(LOG_MEMORY, "Object containers at %u: %" PRIu64 " heap allocations, %" PRIu64 " reused, %zu bytes pooled",
+		      gameTime, containerStats.heapAllocations, containerStats.pooledAllocations, containerStats.bytesPooled);
+	}
 }
 
 uint32_t generateNewObjectId()
@@ -25,6 +25,7 @@
  */
 #include <string.h>
 #include <map>
+#include <set>
 
 #include "lib/framework/frame.h"
 #include "lib/netplay/sync_debug.h"
@@ -92,6 +93,18 @@ static bool checkResearchName(RESEARCH *psRes, UDWORD numStats);
 
 //flag that indicates whether the player can self repair
 static UBYTE bSelfRepair[MAX_PLAYERS];
+
+// Index of the research graph, so that listing available research only looks at topics which could be available,
+// rather than checking the pre-requisites of every topic. Rebuilt lazily after loading, updated as topics complete.
+struct ResearchAvailability
+{
+	std::vector<uint16_t> missingPR;    ///< Number of pre-requisites not yet completed, per topic
+	std::vector<bool> completed;        ///< Topics already subtracted from the missingPR of their dependents
+	std::set<uint16_t> candidates;      ///< Uncompleted topics that are possible, started, cancelled or have all their pre-requisites
+};
+static std::vector<std::vector<uint16_t>> researchDependents;  ///< For each topic, the topics which have it as a pre-requisite
+static ResearchAvailability researchAvailability[MAX_PLAYERS];
+static bool researchAvailabilityValid = false;
 static void replaceDroidComponent(DroidList& pList, UDWORD oldType, UDWORD oldCompInc,
                                   UDWORD newCompInc);
 static void replaceStructureComponent(StructureList& pList, UDWORD oldType, UDWORD oldCompInc,
@@ -113,6 +126,7 @@ bool researchInitVars()
 	cachedStatsObject = nlohmann::json(nullptr);
 	cachedPerPlayerUpgrades.clear();
 	playerUpgradeCounts = std::vector<PlayerUpgradeCounts>(MAX_PLAYERS);
+	researchAvailabilityInvalidate();
 
 	for (int i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -593,9 +607,118 @@ bool loadResearch(WzConfig &ini)
 		researchUpgradeCalcMode = ResearchUpgradeCalculationMode::Compat;
 	}
 
+	researchAvailabilityInvalidate();
+
 	return true;
 }
 
+static void updateResearchCandidate(ResearchAvailability &avail, UDWORD player, uint16_t inc)
+{
+	PLAYER_RESEARCH const *psPlayerRes = &asPlayerResList[player][inc];
+	bool candidate = !avail.completed[inc]
+	                 && (IsResearchPossible(psPlayerRes)
+	                     || (psPlayerRes->ResearchStatus & RESBITS_ALL) != 0
+	                     || (!asResearch[inc].pPRList.empty() && avail.missingPR[inc] == 0));
+	if (candidate)
+	{
+		avail.candidates.insert(inc);
+	}
+	else
+	{
+		avail.candidates.erase(inc);
+	}
+}
+
+static void rebuildResearchAvailability()
+{
+	researchDependents.assign(asResearch.size(), std::vector<uint16_t>());
+	for (RESEARCH const &research : asResearch)
+	{
+		for (uint16_t prereq : research.pPRList)
+		{
+			researchDependents[prereq].push_back(research.index);
+		}
+	}
+
+	for (UDWORD player = 0; player < MAX_PLAYERS; ++player)
+	{
+		ResearchAvailability &avail = researchAvailability[player];
+		avail.missingPR.assign(asResearch.size(), 0);
+		avail.completed.assign(asResearch.size(), false);
+		avail.candidates.clear();
+		if (asPlayerResList[player].size() < asResearch.size())
+		{
+			continue;
+		}
+		for (size_t inc = 0; inc < asResearch.size(); ++inc)
+		{
+			avail.completed[inc] = IsResearchCompleted(&asPlayerResList[player][inc]);
+		}
+		for (size_t inc = 0; inc < asResearch.size(); ++inc)
+		{
+			for (uint16_t prereq : asResearch[inc].pPRList)
+			{
+				avail.missingPR[inc] += !avail.completed[prereq];
+			}
+			updateResearchCandidate(avail, player, inc);
+		}
+	}
+	researchAvailabilityValid = true;
+}
+
+static ResearchAvailability &getResearchAvailability(UDWORD player)
+{
+	if (!researchAvailabilityValid)
+	{
+		rebuildResearchAvailability();
+	}
+	return researchAvailability[player];
+}
+
+static std::vector<uint16_t> const &getResearchDependents(size_t inc)
+{
+	if (!researchAvailabilityValid)
+	{
+		rebuildResearchAvailability();
+	}
+	return researchDependents[inc];
+}
+
+// Called when a topic has been completed, to make its dependents available once all their pre-requisites are done.
+static void researchAvailabilityCompleted(UDWORD player, uint16_t inc)
+{
+	if (!researchAvailabilityValid)
+	{
+		return;  // Will be rebuilt from the research state when next needed.
+	}
+	ResearchAvailability &avail = researchAvailability[player];
+	if (avail.completed[inc])
+	{
+		return;
+	}
+	avail.completed[inc] = true;
+	avail.candidates.erase(inc);
+	for (uint16_t dependent : researchDependents[inc])
+	{
+		--avail.missingPR[dependent];
+		updateResearchCandidate(avail, player, dependent);
+	}
+}
+
+void researchAvailabilityChanged(UDWORD player, UWORD inc)
+{
+	if (!researchAvailabilityValid || player >= MAX_PLAYERS || inc >= asResearch.size())
+	{
+		return;
+	}
+	updateResearchCandidate(researchAvailability[player], player, inc);
+}
+
+void researchAvailabilityInvalidate()
+{
+	researchAvailabilityValid = false;
+}
+
 bool researchAvailable(int inc, UDWORD playerID, QUEUE_MODE mode)
 {
 	if (playerID >= MAX_PLAYERS)
@@ -612,8 +735,8 @@ bool researchAvailable(int inc, UDWORD playerID, QUEUE_MODE mode)
 		IsResearchStartedFunc = IsResearchStarted;
 	}
 
-	UDWORD				incPR, incS;
-	bool				bPRFound, bStructFound;
+	UDWORD				incS;
+	bool				bStructFound;
 
 	// if its a cancelled topic - add to list
 	if (IsResearchCancelledFunc(&asPlayerResList[playerID][inc]))
@@ -663,17 +786,7 @@ bool researchAvailable(int inc, UDWORD playerID, QUEUE_MODE mode)
 		}
 
 		// check for pre-requisites
-		bPRFound = true;
-		for (incPR = 0; incPR < asResearch[inc].pPRList.size(); incPR++)
-		{
-			if (IsResearchCompleted(&(asPlayerResList[playerID][asResearch[inc].pPRList[incPR]])) == 0)
-			{
-				// if haven't pre-requisite - quit checking rest
-				bPRFound = false;
-				break;
-			}
-		}
-		if (!bPRFound)
+		if (getResearchAvailability(playerID).missingPR[inc] != 0)
 		{
 			// if haven't pre-requisites, skip the rest of the checks
 			return false;
@@ -719,11 +832,34 @@ There can only be 'limit' number of entries
 std::vector<uint16_t> fillResearchList(UDWORD playerID, nonstd::optional<UWORD> topic, UWORD limit)
 {
 	std::vector<uint16_t> list;
+	if (playerID >= MAX_PLAYERS)
+	{
+		return list;
+	}
 
-	for (auto inc = 0; inc < asResearch.size(); inc++)
+	// Only the candidate topics can be available, so don't bother checking the others
+	std::set<uint16_t> const &candidates = getResearchAvailability(playerID).candidates;
+	auto addTopic = [&]() {
+		list.push_back(topic.value());
+		topic = nonstd::nullopt;
+		return list.size() == limit;
+	};
+	for (uint16_t inc : candidates)
 	{
 		// if the inc matches the 'topic' - automatically add to the list
-		if ((topic.has_value() && inc == topic.value()) || researchAvailable(inc, playerID, ModeQueue))
+		if (topic.has_value() && topic.value() <= inc)
+		{
+			bool isTopic = topic.value() == inc;
+			if (addTopic())
+			{
+				return list;
+			}
+			if (isTopic)
+			{
+				continue;
+			}
+		}
+		if (researchAvailable(inc, playerID, ModeQueue))
 		{
 			list.push_back(inc);
 			if (list.size() == limit)
@@ -732,10 +868,31 @@ std::vector<uint16_t> fillResearchList(UDWORD playerID, nonstd::optional<UWORD>
 			}
 		}
 	}
+	if (topic.has_value() && topic.value() < asResearch.size())
+	{
+		addTopic();
+	}
 
 	return list;
 }
 
+std::vector<uint16_t> listAvailableResearch(UDWORD playerID, QUEUE_MODE mode)
+{
+	std::vector<uint16_t> list;
+	if (playerID >= MAX_PLAYERS)
+	{
+		return list;
+	}
+	for (uint16_t inc : getResearchAvailability(playerID).candidates)
+	{
+		if (researchAvailable(inc, playerID, mode))
+		{
+			list.push_back(inc);
+		}
+	}
+	return list;
+}
+
 class internal_execution_context_base : public wzapi::execution_context_base
 {
 public:
@@ -1079,6 +1236,7 @@ void researchResult(UDWORD researchIndex, UBYTE player, bool bDisplay, STRUCTURE
 	syncDebug("researchResult(%u, %u, …)", researchIndex, player);
 
 	MakeResearchCompleted(&asPlayerResList[player][researchIndex]);
+	researchAvailabilityCompleted(player, researchIndex);
 
 	//check for structures to be made available
 	for (unsigned short pStructureResult : pResearch->pStructureResults)
@@ -1174,6 +1332,7 @@ void researchResult(UDWORD researchIndex, UBYTE player, bool bDisplay, STRUCTURE
 	}
 
 	eventResearchedHandleUpgrades(pResearch, psResearchFacility, player);
+	droidInvalidateDerivedStats(player);
 
 	triggerEventResearched(pResearch, psResearchFacility, player);
 }
@@ -1201,6 +1360,7 @@ void ResearchRelease()
 		p.clear();
 	}
 	playerUpgradeCounts = std::vector<PlayerUpgradeCounts>(MAX_PLAYERS);
+	researchAvailabilityInvalidate();
 }
 
 /*puts research facility on hold*/
@@ -1631,6 +1791,7 @@ bool enableResearch(RESEARCH *psResearch, UDWORD player)
 
 	//found, so set the flag
 	MakeResearchPossible(&asPlayerResList[player][inc]);
+	researchAvailabilityChanged(player, inc);
 
 	if (player == selectedPlayer)
 	{
@@ -1906,15 +2067,9 @@ static void RecursivelyDisableResearchByID(size_t index)
 		DisableResearch(&asPlayerResList[player][index]);
 	}
 
-	for (size_t inc = 0; inc < asResearch.size(); inc++)
+	for (uint16_t inc : getResearchDependents(index))
 	{
-		for (size_t prereq = 0; prereq < asResearch[inc].pPRList.size(); prereq++)
-		{
-			if (asResearch[inc].pPRList[prereq] == index)
-			{
-				RecursivelyDisableResearchByID(inc);
-			}
-		}
+		RecursivelyDisableResearchByID(inc);
 	}
 }
 
@@ -104,6 +104,14 @@ bool loadResearch(WzConfig &ini);
   instant. Returns the number to research*/
 std::vector<uint16_t> fillResearchList(UDWORD playerID, nonstd::optional<UWORD> topic, UWORD limit);
 
+/// List all the topics that researchAvailable() accepts for the player, in index order.
+std::vector<uint16_t> listAvailableResearch(UDWORD playerID, QUEUE_MODE mode);
+
+/// Must be called after making a topic possible (or otherwise changing its status) outside of this file.
+void researchAvailabilityChanged(UDWORD player, UWORD inc);
+/// Forget the research availability index, to rebuild it from the research state when next needed. Call after loading research states.
+void researchAvailabilityInvalidate();
+
 /* process the results of a completed research topic */
 void researchResult(UDWORD researchIndex, UBYTE player, bool bDisplay, STRUCTURE *psResearchFacility, bool bTrigger);
 
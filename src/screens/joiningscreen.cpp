@@ -792,7 +792,7 @@ private:
 	NetQueuePair *tmpJoiningQueuePair = nullptr;
 	char initialAckBuffer[10] = {'\0'};
 	size_t usedInitialAckBuffer = 0;
-	const size_t expectedInitialAckSize = sizeof(uint32_t);
+	size_t expectedInitialAckSize() const;
 
 	std::chrono::steady_clock::time_point timeStarted;
 	const std::chrono::milliseconds minimumTimeBeforeAutoClose = std::chrono::milliseconds(300);
@@ -1166,8 +1166,8 @@ void WzJoiningGameScreen_HandlerRoot::processOpenConnectionResult(size_t connect
 		socketSetTCPNoDelay(*client_transient_socket, true);
 	}
 
-	// Send initial connection data: NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR
-	char buffer[sizeof(int32_t) * 2] = { 0 };
+	// Send initial connection data: NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR, and the compressions we support
+	char buffer[sizeof(int32_t) * 3] = { 0 };
 	char *p_buffer = buffer;
 	auto pushu32 = [&](uint32_t value) {
 		uint32_t swapped = htonl(value);
@@ -1176,6 +1176,7 @@ void WzJoiningGameScreen_HandlerRoot::processOpenConnectionResult(size_t connect
 	};
 	pushu32(NETGetMajorVersion());
 	pushu32(NETGetMinorVersion());
+	pushu32(socketSupportedCompressions());
 
 	const auto writeResult = writeAll(*client_transient_socket, buffer, sizeof(buffer));
 	if (!writeResult.has_value())
@@ -1299,6 +1300,18 @@ void WzJoiningGameScreen_HandlerRoot::closeConnectionAttempt()
 	usedInitialAckBuffer = 0;
 }
 
+// The host answers with an error code, followed by the SocketCompression it chose if there was no error
+size_t WzJoiningGameScreen_HandlerRoot::expectedInitialAckSize() const
+{
+	uint32_t result = ERROR_CONNECTION;
+	if (usedInitialAckBuffer >= sizeof(result))
+	{
+		memcpy(&result, initialAckBuffer, sizeof(result));
+		result = ntohl(result);
+	}
+	return (result == ERROR_NOERROR) ? sizeof(uint32_t) * 2 : sizeof(uint32_t);
+}
+
 void WzJoiningGameScreen_HandlerRoot::processJoining()
 {
 	if (currentJoiningState == JoiningState::Success)
@@ -1355,13 +1368,13 @@ void WzJoiningGameScreen_HandlerRoot::processJoining()
 			}
 
 			char *p_buffer = initialAckBuffer;
-			const auto readResult = readNoInt(*client_transient_socket, p_buffer + usedInitialAckBuffer, expectedInitialAckSize - usedInitialAckBuffer);
+			const auto readResult = readNoInt(*client_transient_socket, p_buffer + usedInitialAckBuffer, expectedInitialAckSize() - usedInitialAckBuffer);
 			if (readResult.has_value())
 			{
 				usedInitialAckBuffer += static_cast<size_t>(readResult.value());
 			}
 
-			if (usedInitialAckBuffer >= expectedInitialAckSize)
+			if (usedInitialAckBuffer >= expectedInitialAckSize())
 			{
 				uint32_t result = ERROR_CONNECTION;
 				memcpy(&result, initialAckBuffer, sizeof(result));
@@ -1386,8 +1399,20 @@ void WzJoiningGameScreen_HandlerRoot::processJoining()
 					return;
 				}
 
+				// the host picked one of the compressions we sent
+				uint32_t compression = 0;
+				memcpy(&compression, initialAckBuffer + sizeof(uint32_t), sizeof(compression));
+				compression = ntohl(compression);
+				if (compression >= 32 || (socketSupportedCompressions() & (1u << compression)) == 0)
+				{
+					debug(LOG_ERROR, "Host chose an unsupported compression: %" PRIu32, compression);
+					closeConnectionAttempt();
+					handleFailure(FailureDetails::makeFromLobbyError(ERROR_CONNECTION));
+					return;
+				}
+
 				// transition to net message mode (enable compression, wait for messages)
-				socketBeginCompression(*client_transient_socket);
+				socketBeginCompression(*client_transient_socket, static_cast<SocketCompression>(compression));
 				currentJoiningState = JoiningState::ProcessingJoinMessages;
 				// permit fall-through to currentJoiningState == JoiningState::ProcessingJoinMessage case below
 			}
@@ -1068,6 +1068,12 @@ int cmdInputThreadFunc(void *)
 				wz_command_interface_output_room_status_json();
 			});
 		}
+		else if(!strncmpl(line, "netstats"))
+		{
+			wzAsyncExecOnMainThread([] {
+				wz_command_interface_output_netstats_json();
+			});
+		}
 		else if(!strncmpl(line, "shutdown now"))
 		{
 			inexit = true;
@@ -1524,6 +1530,18 @@ static void WzCmdInterfaceDumpHumanPlayerVarsImpl(uint32_t player, bool gameHasF
 	}
 }
 
+void wz_command_interface_output_netstats_json()
+{
+	if (!wz_command_interface_enabled())
+	{
+		return;
+	}
+
+	std::string statsJSONStr = std::string("__WZNETSTATS__") + NETlogTelemetryJSON().dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "__ENDWZNETSTATS__";
+	statsJSONStr.append("\n");
+	wz_command_interface_output_str(statsJSONStr.c_str());
+}
+
 void wz_command_interface_output_room_status_json()
 {
 	if (!wz_command_interface_enabled())
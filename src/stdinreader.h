@@ -47,3 +47,4 @@ void wz_command_interface_output(const char *str, ...) WZ_DECL_FORMAT(printf, 1,
 void wz_command_interface_output_str(const char *str);
 
 void wz_command_interface_output_room_status_json();
+void wz_command_interface_output_netstats_json();
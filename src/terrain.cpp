@@ -64,7 +64,11 @@
 
 #include "profiling.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
 
 // TODO: Fix and remove after merging terrain rendering changes
 #if defined(__clang__)
@@ -159,8 +163,6 @@ static int xSectors, ySectors;
 /// Did we initialise the terrain renderer yet?
 static bool terrainInitialised = false;
 
-static std::vector<gfx_api::TerrainDecalVertex> terrainDecalVertexUpdateBuffer;
-
 /// Helper to specify the offset in a VBO
 #define BUFFER_OFFSET(i) (reinterpret_cast<char *>(i))
 
@@ -662,53 +664,203 @@ static void setSectorDecalVertex_SinglePass(int x, int y, gfx_api::TerrainDecalV
 	}
 }
 
-/**
- * Update the sector for when the terrain is changed.
- */
-static void updateSectorGeometry(int x, int y)
+#define TERRAIN_BUILD_THREADS	3					// maximum number of worker threads generating sector geometry
+#define TERRAIN_UPLOAD_BUDGET	(2 * 1024 * 1024)	// bytes of sector geometry uploaded per frame
+
+/// The geometry of a dirty sector, generated off the render thread and waiting to be uploaded
+struct SectorStaging
 {
-	TerrainVertex *geometry;
-	WaterVertex *water;
-	DecalVertex *decaldata;
+	int x = 0;
+	int y = 0;
+	std::vector<TerrainVertex> geometry;
+	std::vector<WaterVertex> water;
+	std::vector<DecalVertex> decals;
+	std::vector<gfx_api::TerrainDecalVertex> terrainDecals;
 	int geometrySize = 0;
 	int waterSize = 0;
 	int decalSize = 0;
+	int terrainDecalSize = 0;
+};
+
+/// Staging buffers, reused between frames to avoid repeated allocations
+static std::vector<SectorStaging> sectorStaging;
+
+/// The number of bytes updateSectorGeometry() uploads for a sector
+static size_t sectorUploadSize(const Sector &sector)
+{
+	size_t size = sizeof(TerrainVertex) * sector.geometrySize + sizeof(WaterVertex) * sector.waterSize;
+	if (terrainShaderType == TerrainShaderType::FALLBACK)
+	{
+		return size + sizeof(DecalVertex) * std::max(sector.decalSize, 0);
+	}
+	return size + sizeof(gfx_api::TerrainDecalVertex) * sector.terrainAndDecalSize;
+}
+
+/**
+ * Generate the geometry of a sector into its staging buffers.
+ * Only reads the map and the sector table, so several sectors can be generated at once.
+ */
+static void generateSectorGeometry(SectorStaging &staging)
+{
+	const Sector &sector = sectors[staging.x * ySectors + staging.y];
+
+	staging.geometrySize = 0;
+	staging.waterSize = 0;
+	staging.geometry.resize(sector.geometrySize);
+	staging.water.resize(sector.waterSize);
+	setSectorGeometry(staging.x, staging.y, staging.geometry.data(), staging.water.data(), &staging.geometrySize, &staging.waterSize);
+
+	staging.decalSize = 0;
+	staging.terrainDecalSize = 0;
+	if (terrainShaderType == TerrainShaderType::FALLBACK)
+	{
+		if (sector.decalSize > 0)
+		{
+			staging.decals.resize(sector.decalSize);
+			setSectorDecals(staging.x, staging.y, staging.decals.data(), &staging.decalSize);
+		}
+	}
+	else
+	{
+		staging.terrainDecals.resize(sector.terrainAndDecalSize);
+		setSectorDecalVertex_SinglePass(staging.x, staging.y, staging.terrainDecals.data(), &staging.terrainDecalSize);
+	}
+}
+
+/**
+ * Generates the geometry of dirty sectors on worker threads, with the calling
+ * thread helping out. The caller blocks until all sectors are done, so the map
+ * can't change while the workers read it. The threads are started on first use
+ * and kept until the terrain is shut down.
+ */
+class SectorBuilder
+{
+public:
+	~SectorBuilder()
+	{
+		stop();
+	}
+
+	/// Generate the first `count` entries of `staging`.
+	void build(std::vector<SectorStaging> &staging, size_t count)
+	{
+		if (count > 1 && threads.empty())
+		{
+			start();
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		jobs = &staging;
+		numJobs = count;
+		nextJob = 0;
+		finishedJobs = 0;
+		workCond.notify_all();
+		runJobs(lock);
+		doneCond.wait(lock, [this] { return finishedJobs == numJobs; });
+		jobs = nullptr;
+		numJobs = 0;
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		workCond.notify_all();
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+		threads.clear();
+		stopping = false;
+	}
+
+private:
+	void start()
+	{
+		size_t numThreads = std::min<size_t>(TERRAIN_BUILD_THREADS, std::max(std::thread::hardware_concurrency(), 2u) - 1);
+		for (size_t i = 0; i < numThreads; ++i)
+		{
+			threads.emplace_back(&SectorBuilder::workerLoop, this);
+		}
+	}
+
+	void runJobs(std::unique_lock<std::mutex> &lock)
+	{
+		while (jobs != nullptr && nextJob < numJobs)
+		{
+			SectorStaging &staging = (*jobs)[nextJob++];
+			lock.unlock();
+			generateSectorGeometry(staging);
+			lock.lock();
+			if (++finishedJobs == numJobs)
+			{
+				doneCond.notify_all();
+			}
+		}
+	}
+
+	void workerLoop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			workCond.wait(lock, [this] { return stopping || (jobs != nullptr && nextJob < numJobs); });
+			if (stopping)
+			{
+				return;
+			}
+			runJobs(lock);
+		}
+	}
 
-	geometry = new TerrainVertex[sectors[x * ySectors + y].geometrySize];
-	water = (WaterVertex *)malloc(sizeof(WaterVertex) * sectors[x * ySectors + y].waterSize);
+	std::mutex mutex;
+	std::condition_variable workCond;    ///< Signalled when there are sectors to generate, or when stopping
+	std::condition_variable doneCond;    ///< Signalled when the last sector has been generated
+	std::vector<SectorStaging> *jobs = nullptr;
+	size_t numJobs = 0;
+	size_t nextJob = 0;
+	size_t finishedJobs = 0;
+	bool stopping = false;
+	std::vector<std::thread> threads;
+};
 
-	setSectorGeometry(x, y, geometry, water, &geometrySize, &waterSize);
-	ASSERT(geometrySize == sectors[x * ySectors + y].geometrySize, "something went seriously wrong updating the terrain");
-	ASSERT(waterSize    == sectors[x * ySectors + y].waterSize   , "something went seriously wrong updating the terrain");
+static SectorBuilder sectorBuilder;
 
-	geometryVBO->update(sizeof(TerrainVertex)*sectors[x * ySectors + y].geometryOffset,
-							sizeof(TerrainVertex)*sectors[x * ySectors + y].geometrySize, geometry,
+/**
+ * Upload the generated geometry of a sector, for when the terrain is changed.
+ */
+static void updateSectorGeometry(const SectorStaging &staging)
+{
+	const Sector &sector = sectors[staging.x * ySectors + staging.y];
+
+	ASSERT(staging.geometrySize == sector.geometrySize, "something went seriously wrong updating the terrain");
+	ASSERT(staging.waterSize    == sector.waterSize   , "something went seriously wrong updating the terrain");
+
+	geometryVBO->update(sizeof(TerrainVertex)*sector.geometryOffset,
+							sizeof(TerrainVertex)*sector.geometrySize, staging.geometry.data(),
 							gfx_api::buffer::update_flag::non_overlapping_updates_promise);
-	waterVBO->update(sizeof(WaterVertex)*sectors[x * ySectors + y].waterOffset,
-					 sizeof(WaterVertex)*sectors[x * ySectors + y].waterSize, water,
+	waterVBO->update(sizeof(WaterVertex)*sector.waterOffset,
+					 sizeof(WaterVertex)*sector.waterSize, staging.water.data(),
 					 gfx_api::buffer::update_flag::non_overlapping_updates_promise);
 
-	delete[] geometry;
-	free(water);
-
 	if (terrainShaderType == TerrainShaderType::FALLBACK)
 	{
-		if (sectors[x * ySectors + y].decalSize <= 0)
+		if (sector.decalSize <= 0)
 		{
 			// Nothing to do here, and glBufferSubData(GL_ARRAY_BUFFER, 0, 0, *) crashes in my graphics driver. Probably shouldn't crash...
 			return;
 		}
 
-		decaldata = (DecalVertex *)malloc(sizeof(DecalVertex) * sectors[x * ySectors + y].decalSize);
-		setSectorDecals(x, y, decaldata, &decalSize);
-		ASSERT(decalSize == sectors[x * ySectors + y].decalSize   , "the amount of decals has changed");
+		ASSERT(staging.decalSize == sector.decalSize   , "the amount of decals has changed");
 
-		if (decalSize > 0)
+		if (staging.decalSize > 0)
 		{
 			if (decalVBO)
 			{
-				decalVBO->update(sizeof(DecalVertex)*sectors[x * ySectors + y].decalOffset,
-								 sizeof(DecalVertex)*sectors[x * ySectors + y].decalSize, decaldata,
+				decalVBO->update(sizeof(DecalVertex)*sector.decalOffset,
+								 sizeof(DecalVertex)*sector.decalSize, staging.decals.data(),
 								 gfx_api::buffer::update_flag::non_overlapping_updates_promise);
 			}
 			else
@@ -718,24 +870,60 @@ static void updateSectorGeometry(int x, int y)
 				ASSERT(false, "Didn't have decals, but now we do. Unsupported.");
 			}
 		}
-
-		free(decaldata);
 	}
 	else
 	{
-		terrainDecalVertexUpdateBuffer.resize(sectors[x * ySectors + y].terrainAndDecalSize); // reuse a buffer to avoid repeated allocations if possible
-		int terrainDecalSize = 0;
-		setSectorDecalVertex_SinglePass(x, y, terrainDecalVertexUpdateBuffer.data(), &terrainDecalSize);
-		ASSERT(terrainDecalSize == sectors[x * ySectors + y].terrainAndDecalSize, "Sizes don't match!");
-		terrainDecalVBO->update(sizeof(gfx_api::TerrainDecalVertex)*sectors[x * ySectors + y].terrainAndDecalOffset,
-							 sizeof(gfx_api::TerrainDecalVertex)*sectors[x * ySectors + y].terrainAndDecalSize, terrainDecalVertexUpdateBuffer.data(),
+		ASSERT(staging.terrainDecalSize == sector.terrainAndDecalSize, "Sizes don't match!");
+		terrainDecalVBO->update(sizeof(gfx_api::TerrainDecalVertex)*sector.terrainAndDecalOffset,
+							 sizeof(gfx_api::TerrainDecalVertex)*sector.terrainAndDecalSize, staging.terrainDecals.data(),
 							 gfx_api::buffer::update_flag::non_overlapping_updates_promise);
 	}
 }
 
+/**
+ * Rebuild dirty sectors in draw range, nearest first. Sectors past the per-frame
+ * upload budget stay dirty and are rebuilt over the next frames, so changing the
+ * whole map doesn't stall a single frame.
+ */
+static void rebuildDirtySectors(std::vector<std::pair<float, int>> &dirtySectors)
+{
+	WZ_PROFILE_SCOPE(rebuildDirtySectors);
+	std::sort(dirtySectors.begin(), dirtySectors.end());
+
+	size_t count = 0;
+	size_t uploadSize = 0;
+	for (const auto &dirtySector : dirtySectors)
+	{
+		size_t size = sectorUploadSize(sectors[dirtySector.second]);
+		if (count > 0 && uploadSize + size > TERRAIN_UPLOAD_BUDGET)
+		{
+			break;
+		}
+		uploadSize += size;
+		++count;
+	}
+
+	if (sectorStaging.size() < count)
+	{
+		sectorStaging.resize(count);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		sectorStaging[i].x = dirtySectors[i].second / ySectors;
+		sectorStaging[i].y = dirtySectors[i].second % ySectors;
+	}
+	sectorBuilder.build(sectorStaging, count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		updateSectorGeometry(sectorStaging[i]);
+		sectors[dirtySectors[i].second].dirty = false;
+	}
+}
+
 /**
  * Mark all tiles that are influenced by this grid point as dirty.
- * Dirty sectors will later get updated by updateSectorGeometry.
+ * Dirty sectors will later get updated by rebuildDirtySectors.
  */
 void markTileDirty(int i, int j)
 {
@@ -1568,6 +1756,9 @@ void shutdownTerrain()
 	delete terrainDecalVBO;
 	terrainDecalVBO = nullptr;
 
+	sectorBuilder.stop();
+	sectorStaging.clear();
+
 	for (int x = 0; x < xSectors; x++)
 	{
 		for (int y = 0; y < ySectors; y++)
@@ -1681,6 +1872,9 @@ static void updateLightMap(const LightMap& lightmap)
 
 static void cullTerrain()
 {
+	static std::vector<std::pair<float, int>> dirtySectors;
+	dirtySectors.clear();
+
 	for (int x = 0; x < xSectors; x++)
 	{
 		for (int y = 0; y < ySectors; y++)
@@ -1698,12 +1892,16 @@ static void cullTerrain()
 				sectors[x * ySectors + y].draw = true;
 				if (sectors[x * ySectors + y].dirty)
 				{
-					updateSectorGeometry(x, y);
-					sectors[x * ySectors + y].dirty = false;
+					dirtySectors.emplace_back(distance, x * ySectors + y);
 				}
 			}
 		}
 	}
+
+	if (!dirtySectors.empty())
+	{
+		rebuildDirtySectors(dirtySectors);
+	}
 }
 
 static void drawDepthOnly(const glm::mat4 &ModelViewProjection, const glm::vec4 &paramsXLight, const glm::vec4 &paramsYLight, bool withOffset)
@@ -1234,12 +1234,11 @@ wzapi::researchResults wzapi::enumResearch(WZAPI_NO_PARAMS)
 	researchResults result;
 	int player = context.player();
 	SCRIPT_ASSERT_PLAYER({}, context, player);
-	for (int i = 0; i < asResearch.size(); i++)
+	for (uint16_t i : listAvailableResearch(player, ModeQueue))
 	{
-		RESEARCH *psResearch = &asResearch[i];
-		if (!IsResearchCompleted(&asPlayerResList[player][i]) && researchAvailable(i, player, ModeQueue))
+		if (!IsResearchCompleted(&asPlayerResList[player][i]))
 		{
-			result.resList.push_back(psResearch);
+			result.resList.push_back(&asResearch[i]);
 		}
 	}
 	result.player = player;
@@ -3476,6 +3475,10 @@ bool wzapi::setUpgradeStats(WZAPI_BASE_PARAMS(int player, const std::string& nam
 {
 	int value = json_variant(newValue).toInt();
 	syncDebug("stats[p%d,t%d,%s,i%d] = %d", player, type, name.c_str(), index, value);
+	if (type < COMP_NUMCOMPONENTS)
+	{
+		droidInvalidateDerivedStats(player);
+	}
 	if (type == COMP_BODY)
 	{
 		SCRIPT_ASSERT(false, context, index < asBodyStats.size(), "Bad index");
@@ -0,0 +1,121 @@
+// Linking hacks for the netplay tests: the socket layer needs the thread support of the backend (lib/sdl), and the
+// framework's debug code a few of its window functions, but the tests must not link the backend (and with it the game).
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
+
+// --- dummy backend implementation ----
+
+bool wzChangeWindowMode(WINDOW_MODE, bool)
+{
+	return false;
+}
+
+bool wzIsFullscreen()
+{
+	return false;
+}
+
+void wzDisplayDialog(DialogType, const char *, const char *)
+{
+}
+
+// --- thread support, as lib/sdl's but with the standard library ----
+
+struct WZ_THREAD
+{
+	std::thread thread;
+	int result = 0;
+};
+
+struct WZ_MUTEX
+{
+	std::mutex mutex;
+};
+
+struct WZ_SEMAPHORE
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	int value = 0;
+};
+
+// Starts the thread right away, like SDL_CreateThread (so wzThreadStart is a no-op, as in lib/sdl)
+WZ_THREAD *wzThreadCreate(int (*threadFunc)(void *), void *data, const char *)
+{
+	WZ_THREAD *thread = new WZ_THREAD;
+	thread->thread = std::thread([thread, threadFunc, data] { thread->result = threadFunc(data); });
+	return thread;
+}
+
+int wzThreadJoin(WZ_THREAD *thread)
+{
+	thread->thread.join();
+	int result = thread->result;
+	delete thread;
+	return result;
+}
+
+void wzThreadDetach(WZ_THREAD *thread)
+{
+	thread->thread.detach();
+	// Leaks the WZ_THREAD, since the detached thread still writes its result to it
+}
+
+void wzThreadStart(WZ_THREAD *)
+{
+}
+
+WZ_MUTEX *wzMutexCreate()
+{
+	return new WZ_MUTEX;
+}
+
+void wzMutexDestroy(WZ_MUTEX *mutex)
+{
+	delete mutex;
+}
+
+void wzMutexLock(WZ_MUTEX *mutex)
+{
+	mutex->mutex.lock();
+}
+
+void wzMutexUnlock(WZ_MUTEX *mutex)
+{
+	mutex->mutex.unlock();
+}
+
+WZ_SEMAPHORE *wzSemaphoreCreate(int startValue)
+{
+	WZ_SEMAPHORE *semaphore = new WZ_SEMAPHORE;
+	semaphore->value = startValue;
+	return semaphore;
+}
+
+void wzSemaphoreDestroy(WZ_SEMAPHORE *semaphore)
+{
+	delete semaphore;
+}
+
+void wzSemaphoreWait(WZ_SEMAPHORE *semaphore)
+{
+	std::unique_lock<std::mutex> lock(semaphore->mutex);
+	semaphore->cond.wait(lock, [semaphore] { return semaphore->value > 0; });
+	--semaphore->value;
+}
+
+void wzSemaphorePost(WZ_SEMAPHORE *semaphore)
+{
+	{
+		std::lock_guard<std::mutex> lock(semaphore->mutex);
+		++semaphore->value;
+	}
+	semaphore->cond.notify_one();
+}
+
+// --- end linking hacks ---
@@ -0,0 +1,105 @@
+// Micro-benchmark of NetQueue: messages are serialised with a MessageWriter, pushed through the byte stream of a
+// NetQueuePair, and deserialised with a MessageReader on the other side, the way game messages travel between clients.
+// Checks that every message arrives intact, and prints the encode and decode throughput.
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "lib/framework/frame.h"
+#include "lib/netplay/netqueue.h"
+
+#define NUM_ROUNDS 2000
+#define MESSAGES_PER_ROUND 64
+#define MAX_MESSAGE_SIZE 200
+#define MESSAGE_TYPE 42
+
+static size_t messageSize(unsigned round, unsigned n)
+{
+	return (round * 31 + n * 17) % MAX_MESSAGE_SIZE;
+}
+
+static uint8_t messageByte(unsigned round, unsigned n, size_t offset)
+{
+	return static_cast<uint8_t>(round * 7 + n * 13 + offset);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void)
+{
+	NetQueuePair sender, receiver;
+	NetMessage message;
+	std::vector<uint8_t> stream;
+	std::vector<uint8_t> decoded(MAX_MESSAGE_SIZE);
+	size_t totalBytes = 0;
+	double encodeTime = 0, decodeTime = 0;
+
+	for (unsigned round = 0; round < NUM_ROUNDS; ++round)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned n = 0; n < MESSAGES_PER_ROUND; ++n)
+		{
+			message.type = MESSAGE_TYPE;
+			message.data.clear();
+			MessageWriter writer(message);
+			for (size_t offset = 0; offset < messageSize(round, n); ++offset)
+			{
+				writer.byte(messageByte(round, n, offset));
+			}
+			sender.send.pushMessage(message);
+			totalBytes += message.data.size();
+		}
+		stream.clear();
+		while (sender.send.numMessagesForNet() > 0)
+		{
+			sender.send.getMessageForNet().rawDataAppendToVector(stream);
+			sender.send.popMessageForNet();
+		}
+		encodeTime += secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		receiver.receive.writeRawData(stream.data(), stream.size());
+		for (unsigned n = 0; n < MESSAGES_PER_ROUND; ++n)
+		{
+			if (!receiver.receive.haveMessage())
+			{
+				fprintf(stderr, "netqueuebench: Message %u of round %u is missing\n", n, round);
+				return -1;
+			}
+			const NetMessage &received = receiver.receive.getMessage();
+			MessageReader reader(received);
+			size_t size = messageSize(round, n);
+			for (size_t offset = 0; offset < size; ++offset)
+			{
+				reader.byte(decoded[offset]);
+			}
+			bool intact = received.type == MESSAGE_TYPE && received.data.size() == size && reader.valid();
+			for (size_t offset = 0; intact && offset < size; ++offset)
+			{
+				intact = decoded[offset] == messageByte(round, n, offset);
+			}
+			if (!intact)
+			{
+				fprintf(stderr, "netqueuebench: Message %u of round %u is damaged\n", n, round);
+				return -1;
+			}
+			receiver.receive.popMessage();
+		}
+		decodeTime += secondsSince(start);
+
+		if (receiver.receive.haveMessage() || receiver.receive.currentIncompleteDataBuffered() != 0)
+		{
+			fprintf(stderr, "netqueuebench: Unexpected data after round %u\n", round);
+			return -1;
+		}
+	}
+
+	unsigned numMessages = NUM_ROUNDS * MESSAGES_PER_ROUND;
+	printf("Encoded %u messages (%zu bytes) in %.3f ms: %.1f Mmsg/s, %.1f MB/s\n", numMessages, totalBytes, encodeTime * 1000, numMessages / encodeTime / 1e6, totalBytes / encodeTime / 1e6);
+	printf("Decoded %u messages (%zu bytes) in %.3f ms: %.1f Mmsg/s, %.1f MB/s\n", numMessages, totalBytes, decodeTime * 1000, numMessages / decodeTime / 1e6, totalBytes / decodeTime / 1e6);
+	return 0;
+}
@@ -0,0 +1,189 @@
+// Loopback test of the spectator relay: a spectator connects, gets the header and the game messages as they are
+// relayed, then a late spectator connects and must get the whole stream from the start. Closing the relay ends the
+// stream for both, after they got everything.
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "lib/framework/frame.h"
+#include "lib/netplay/netrelay.h"
+
+#define NUM_MESSAGES 500
+#define MAX_MESSAGE_SIZE 300
+#define MESSAGE_TYPE 42
+#define TEST_TIMEOUT 5000
+
+static const std::vector<uint8_t> header = {'W', 'Z', 'r', 'p', 1, 2, 3};
+
+static NetMessage makeMessage(unsigned n)
+{
+	NetMessage message(MESSAGE_TYPE);
+	for (size_t offset = 0; offset < (n * 37) % MAX_MESSAGE_SIZE; ++offset)
+	{
+		message.data.push_back(static_cast<uint8_t>(n * 7 + offset));
+	}
+	return message;
+}
+
+static bool checkRecord(const ReplayRelayRecord &record, unsigned n)
+{
+	NetMessage expected = makeMessage(n);
+	return record.player == n % 10 && record.message.type == expected.type && record.message.data == expected.data;
+}
+
+// Keeps the relay sending until the spectator got the records from first to end, and checks them.
+static bool receiveRecords(ReplayRelayServer &server, ReplayRelayClient &client, unsigned first, unsigned end, const char *name)
+{
+	std::vector<ReplayRelayRecord> records;
+	auto start = std::chrono::steady_clock::now();
+	while (records.size() < end - first)
+	{
+		server.update(true);
+		if (!client.receive(records))
+		{
+			fprintf(stderr, "netrelaytest: %s lost the connection\n", name);
+			return false;
+		}
+		if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(TEST_TIMEOUT))
+		{
+			fprintf(stderr, "netrelaytest: %s timed out after %zu of %u records\n", name, records.size(), end - first);
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		if (i >= end - first || !checkRecord(records[i], first + i))
+		{
+			fprintf(stderr, "netrelaytest: %s got a wrong record %zu\n", name, first + i);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool connectSpectator(ReplayRelayServer &server, ReplayRelayClient &client, const char *name)
+{
+	if (!client.connect("127.0.0.1", server.port(), TEST_TIMEOUT))
+	{
+		fprintf(stderr, "netrelaytest: %s failed to connect\n", name);
+		return false;
+	}
+	size_t numSpectators = server.numSpectators();
+	for (int attempt = 0; attempt < TEST_TIMEOUT && server.numSpectators() == numSpectators; ++attempt)
+	{
+		server.update();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	std::vector<uint8_t> receivedHeader(header.size());
+	if (server.numSpectators() != numSpectators + 1 || !client.readHeader(receivedHeader.data(), receivedHeader.size(), TEST_TIMEOUT) || receivedHeader != header)
+	{
+		fprintf(stderr, "netrelaytest: %s didn't get the header\n", name);
+		return false;
+	}
+	return true;
+}
+
+static bool runTest(ReplayRelayServer &server, ReplayRelayClient &early, ReplayRelayClient &late)
+{
+	server.setHeader(header);
+	if (!connectSpectator(server, early, "Early spectator"))
+	{
+		return false;
+	}
+
+	for (unsigned n = 0; n < NUM_MESSAGES / 2; ++n)
+	{
+		server.appendMessage(makeMessage(n), n % 10);
+	}
+	if (!receiveRecords(server, early, 0, NUM_MESSAGES / 2, "Early spectator"))
+	{
+		return false;
+	}
+
+	if (!connectSpectator(server, late, "Late spectator"))
+	{
+		return false;
+	}
+	for (unsigned n = NUM_MESSAGES / 2; n < NUM_MESSAGES; ++n)
+	{
+		server.appendMessage(makeMessage(n), n % 10);
+	}
+	if (!receiveRecords(server, early, NUM_MESSAGES / 2, NUM_MESSAGES, "Early spectator")
+	    || !receiveRecords(server, late, 0, NUM_MESSAGES, "Late spectator"))
+	{
+		return false;
+	}
+	printf("Relayed %d messages to 2 spectators\n", NUM_MESSAGES);
+
+	server.close();
+	std::vector<ReplayRelayRecord> records;
+	auto start = std::chrono::steady_clock::now();
+	bool earlyOpen = true, lateOpen = true;
+	while ((earlyOpen || lateOpen) && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(TEST_TIMEOUT))
+	{
+		earlyOpen = earlyOpen && early.receive(records);
+		lateOpen = lateOpen && late.receive(records);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (earlyOpen || lateOpen || !records.empty())
+	{
+		fprintf(stderr, "netrelaytest: Closing the relay didn't end the stream\n");
+		return false;
+	}
+	return true;
+}
+
+static bool checkAddress(const char *address, const char *expectedHost, unsigned expectedPort)
+{
+	std::string host;
+	unsigned port = 0;
+	bool parsed = parseReplayRelayAddress(address, host, port);
+	if (expectedHost == nullptr ? parsed : (!parsed || host != expectedHost || port != expectedPort))
+	{
+		fprintf(stderr, "netrelaytest: Wrong result for relay address \"%s\"\n", address);
+		return false;
+	}
+	return true;
+}
+
+static bool testAddresses()
+{
+	return checkAddress("example.com", "example.com", REPLAY_RELAY_DEFAULT_PORT)
+	    && checkAddress("example.com:2200", "example.com", 2200)
+	    && checkAddress("127.0.0.1:2200", "127.0.0.1", 2200)
+	    && checkAddress("[::1]:2200", "::1", 2200)
+	    && checkAddress("[::1]", "::1", REPLAY_RELAY_DEFAULT_PORT)
+	    && checkAddress("::1", "::1", REPLAY_RELAY_DEFAULT_PORT)
+	    && checkAddress("fe80::1:2200", "fe80::1:2200", REPLAY_RELAY_DEFAULT_PORT)
+	    && checkAddress("", nullptr, 0)
+	    && checkAddress("example.com:", nullptr, 0)
+	    && checkAddress("example.com:port", nullptr, 0)
+	    && checkAddress("example.com:70000", nullptr, 0)
+	    && checkAddress("[::1", nullptr, 0)
+	    && checkAddress("[::1]2200", nullptr, 0)
+	    && checkAddress("[]:2200", nullptr, 0);
+}
+
+int main(void)
+{
+	if (!testAddresses())
+	{
+		return -1;
+	}
+
+	SOCKETinit();
+
+	bool success;
+	{
+		// Let the system pick a free port, so the test can run alongside anything else
+		ReplayRelayServer server;
+		ReplayRelayClient early, late;
+		success = server.listen(0) && runTest(server, early, late);
+	}
+
+	SOCKETshutdown();
+	return success ? 0 : -1;
+}
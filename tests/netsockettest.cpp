@@ -0,0 +1,255 @@
+// Loopback stress test of the socket layer: hundreds of clients connect to one listening socket, and
+// messages go back and forth through two socket sets, the way the host and NETrecvNet() use them.
+// The host answers with one shared buffer for all clients, the way NETsend() broadcasts.
+// Then some of the connections repeat the exchange compressed, with each codec this build supports.
+
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "lib/framework/frame.h"
+#include "lib/netplay/netsocket.h"
+
+#define NUM_CLIENTS 300
+#define NUM_COMPRESSED_CLIENTS 16
+#define NUM_ROUNDS 20
+#define MESSAGE_SIZE 1500
+#define TEST_TIMEOUT 5000
+
+static uint8_t messageByte(size_t client, unsigned round, size_t offset)
+{
+	return static_cast<uint8_t>(client * 7 + round * 13 + offset);
+}
+
+static bool sendRound(const std::vector<Socket *> &sockets, unsigned round)
+{
+	std::vector<uint8_t> message(MESSAGE_SIZE);
+	for (size_t client = 0; client < sockets.size(); ++client)
+	{
+		for (size_t offset = 0; offset < MESSAGE_SIZE; ++offset)
+		{
+			message[offset] = messageByte(client, round, offset);
+		}
+		if (!writeAll(*sockets[client], message.data(), message.size()).has_value())
+		{
+			fprintf(stderr, "netsockettest: Failed to write to socket %zu\n", client);
+			return false;
+		}
+		socketFlush(*sockets[client], 0);  // Does nothing on uncompressed sockets.
+	}
+	return true;
+}
+
+static bool broadcastRound(const std::vector<Socket *> &sockets, unsigned round)
+{
+	auto message = std::make_shared<std::vector<uint8_t>>(MESSAGE_SIZE);
+	for (size_t offset = 0; offset < MESSAGE_SIZE; ++offset)
+	{
+		(*message)[offset] = messageByte(0, round, offset);
+	}
+	std::shared_ptr<const std::vector<uint8_t>> shared = message;
+	for (size_t client = 0; client < sockets.size(); ++client)
+	{
+		if (!writeAll(*sockets[client], shared).has_value())
+		{
+			fprintf(stderr, "netsockettest: Failed to write to socket %zu\n", client);
+			return false;
+		}
+		socketFlush(*sockets[client], 0);
+	}
+	return true;
+}
+
+// Read from whichever sockets of the set are ready, until every socket got the message of this round.
+static bool receiveRound(const SocketSet &set, const std::vector<Socket *> &sockets, unsigned round, bool broadcast)
+{
+	std::vector<size_t> received(sockets.size(), 0);
+	size_t numComplete = 0;
+	uint8_t buffer[MESSAGE_SIZE];
+	auto lastProgress = std::chrono::steady_clock::now();
+
+	while (numComplete < sockets.size())
+	{
+		int ret = checkSockets(set, 100);
+		if (ret == SOCKET_ERROR)
+		{
+			fprintf(stderr, "netsockettest: checkSockets failed\n");
+			return false;
+		}
+		if (ret == 0 && std::chrono::steady_clock::now() - lastProgress > std::chrono::milliseconds(TEST_TIMEOUT))
+		{
+			fprintf(stderr, "netsockettest: Timed out in round %u, %zu of %zu sockets complete\n", round, numComplete, sockets.size());
+			return false;
+		}
+
+		for (size_t client = 0; client < sockets.size(); ++client)
+		{
+			if (!socketReadReady(*sockets[client]))
+			{
+				continue;
+			}
+			// Nothing more is sent until the round is complete, so reading a whole buffer never takes data of the next round.
+			auto readResult = readNoInt(*sockets[client], buffer, sizeof(buffer));
+			if (!readResult.has_value() || readResult.value() < 0 || received[client] + readResult.value() > MESSAGE_SIZE)
+			{
+				fprintf(stderr, "netsockettest: Failed to read from socket %zu\n", client);
+				return false;
+			}
+			if (readResult.value() == 0)
+			{
+				continue;
+			}
+			for (ssize_t i = 0; i < readResult.value(); ++i)
+			{
+				if (buffer[i] != messageByte(broadcast ? 0 : client, round, received[client] + i))
+				{
+					fprintf(stderr, "netsockettest: Wrong data from socket %zu in round %u\n", client, round);
+					return false;
+				}
+			}
+			received[client] += readResult.value();
+			if (received[client] == MESSAGE_SIZE)
+			{
+				++numComplete;
+			}
+			lastProgress = std::chrono::steady_clock::now();
+		}
+	}
+	return true;
+}
+
+static bool runTest(Socket *listenSocket, const SocketAddress *address, SocketSet &hostSet, SocketSet &clientSet, std::vector<Socket *> &hostSockets, std::vector<Socket *> &clientSockets)
+{
+	for (size_t client = 0; client < NUM_CLIENTS; ++client)
+	{
+		auto openResult = socketOpen(address, TEST_TIMEOUT);
+		if (!openResult.has_value())
+		{
+			fprintf(stderr, "netsockettest: Failed to open client %zu\n", client);
+			return false;
+		}
+		clientSockets.push_back(openResult.value());
+		SocketSet_AddSocket(clientSet, openResult.value());
+
+		// Accept right away, so the listen backlog never fills up, and hostSockets[n] is the other end of clientSockets[n].
+		Socket *accepted = nullptr;
+		for (int attempt = 0; attempt < TEST_TIMEOUT && accepted == nullptr; ++attempt)
+		{
+			accepted = socketAccept(listenSocket);
+			if (accepted == nullptr)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		if (accepted == nullptr)
+		{
+			fprintf(stderr, "netsockettest: Failed to accept client %zu\n", client);
+			return false;
+		}
+		hostSockets.push_back(accepted);
+		SocketSet_AddSocket(hostSet, accepted);
+	}
+	printf("Connected %d clients\n", NUM_CLIENTS);
+
+	for (unsigned round = 0; round < NUM_ROUNDS; ++round)
+	{
+		if (!sendRound(clientSockets, round) || !receiveRound(hostSet, hostSockets, round, false)
+		    || !broadcastRound(hostSockets, round) || !receiveRound(clientSet, clientSockets, round, true))
+		{
+			return false;
+		}
+	}
+	printf("Exchanged %d rounds of %d byte messages\n", NUM_ROUNDS, MESSAGE_SIZE);
+
+	for (size_t client = 0; client < NUM_CLIENTS; ++client)
+	{
+		const SocketStatistics &stats = socketStatistics(*clientSockets[client]);
+		if (stats.uncompressedBytesSent != NUM_ROUNDS * MESSAGE_SIZE || stats.compressedBytesSent != stats.uncompressedBytesSent
+		    || stats.uncompressedBytesReceived != NUM_ROUNDS * MESSAGE_SIZE || stats.compressedBytesReceived != stats.uncompressedBytesReceived
+		    || stats.packetsSent != NUM_ROUNDS)
+		{
+			fprintf(stderr, "netsockettest: Wrong statistics for socket %zu\n", client);
+			return false;
+		}
+	}
+
+	// Alternate between the best codec and zlib, which every build has.
+	std::vector<Socket *> compressedHostSockets(hostSockets.begin(), hostSockets.begin() + NUM_COMPRESSED_CLIENTS);
+	std::vector<Socket *> compressedClientSockets(clientSockets.begin(), clientSockets.begin() + NUM_COMPRESSED_CLIENTS);
+	for (size_t client = 0; client < NUM_COMPRESSED_CLIENTS; ++client)
+	{
+		SocketCompression compression = (client % 2 == 0) ? socketChooseCompression(socketSupportedCompressions()) : SocketCompression::Zlib;
+		socketBeginCompression(*compressedHostSockets[client], compression);
+		socketBeginCompression(*compressedClientSockets[client], compression);
+	}
+	for (unsigned round = 0; round < NUM_ROUNDS; ++round)
+	{
+		if (!sendRound(compressedClientSockets, round) || !receiveRound(hostSet, compressedHostSockets, round, false)
+		    || !broadcastRound(compressedHostSockets, round) || !receiveRound(clientSet, compressedClientSockets, round, true))
+		{
+			return false;
+		}
+	}
+	printf("Exchanged %d rounds of %d byte messages on %d compressed connections (supported codecs: 0x%x)\n", NUM_ROUNDS, MESSAGE_SIZE, NUM_COMPRESSED_CLIENTS, socketSupportedCompressions());
+
+	for (size_t client = 0; client < NUM_COMPRESSED_CLIENTS; ++client)
+	{
+		const SocketStatistics &stats = socketStatistics(*compressedClientSockets[client]);
+		size_t compressedBytes = stats.compressedBytesSent - NUM_ROUNDS * MESSAGE_SIZE;  // Minus the uncompressed rounds.
+		if (stats.uncompressedBytesSent != 2 * NUM_ROUNDS * MESSAGE_SIZE || compressedBytes == 0 || compressedBytes >= NUM_ROUNDS * MESSAGE_SIZE
+		    || stats.uncompressedBytesReceived != 2 * NUM_ROUNDS * MESSAGE_SIZE)
+		{
+			fprintf(stderr, "netsockettest: Wrong statistics for compressed socket %zu\n", client);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(void)
+{
+	SOCKETinit();
+
+	// Let the system pick a free port, so the test can run alongside anything else
+	auto listenResult = socketListen(0);
+	unsigned port = listenResult.has_value() ? socketListenPort(*listenResult.value()) : 0;
+	if (port == 0)
+	{
+		fprintf(stderr, "netsockettest: Failed to listen\n");
+		SOCKETshutdown();
+		return -1;
+	}
+	auto addressResult = resolveHost("127.0.0.1", port);
+	if (!addressResult.has_value())
+	{
+		fprintf(stderr, "netsockettest: Failed to resolve 127.0.0.1\n");
+		socketClose(listenResult.value());
+		SOCKETshutdown();
+		return -1;
+	}
+
+	SocketSet *hostSet = allocSocketSet();
+	SocketSet *clientSet = allocSocketSet();
+	std::vector<Socket *> hostSockets, clientSockets;
+	bool success = runTest(listenResult.value(), addressResult.value(), *hostSet, *clientSet, hostSockets, clientSockets);
+
+	for (Socket *sock : clientSockets)
+	{
+		SocketSet_DelSocket(*clientSet, sock);
+		socketClose(sock);
+	}
+	for (Socket *sock : hostSockets)
+	{
+		SocketSet_DelSocket(*hostSet, sock);
+		socketClose(sock);
+	}
+	deleteSocketSet(clientSet);
+	deleteSocketSet(hostSet);
+	deleteSocketAddress(addressResult.value());
+	socketClose(listenResult.value());
+	SOCKETshutdown();
+
+	return success ? 0 : -1;
+}